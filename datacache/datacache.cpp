@@ -484,6 +484,7 @@ int CDataCacheSection::BeginFrameLocking()
 		}
 		pFrameLock->m_iLock = 1;
 		pFrameLock->m_pFirst = NULL;
+		ClearFrameLockRecent( pFrameLock );
 		m_ThreadFrameLock.Set( pFrameLock );
 	}
 	return pFrameLock->m_iLock;
@@ -514,6 +515,19 @@ void *CDataCacheSection::FrameLock( DataCacheHandle_t handle )
 	FrameLock_t *pFrameLock = m_ThreadFrameLock.Get();
 	if ( pFrameLock )
 	{
+		// Anything this thread frame locked stays put until EndFrameLocking unless it's
+		// discarded, so if nothing was we can skip the LRU mutex
+		if ( pFrameLock->m_nDiscardSerial != m_nDiscardSerial )
+		{
+			ClearFrameLockRecent( pFrameLock );
+		}
+
+		FrameLockRecent_t &recent = pFrameLock->m_Recent[ (uintp)handle & ( FRAMELOCK_RECENT_SIZE - 1 ) ];
+		if ( recent.m_hItem == handle )
+		{
+			return recent.m_pItemData;
+		}
+
 		DataCacheItem_t *pItem = m_LRU.LockResource( (memhandle_t)handle );
 
 		if ( pItem )
@@ -528,6 +542,9 @@ void *CDataCacheSection::FrameLock( DataCacheHandle_t handle )
 
 			pResult = const_cast<void *>(pItem->pItemData);
 			m_LRU.UnlockResource( (memhandle_t)handle );
+
+			recent.m_hItem = handle;
+			recent.m_pItemData = pResult;
 		}
 	}
 
@@ -535,6 +552,19 @@ void *CDataCacheSection::FrameLock( DataCacheHandle_t handle )
 }
 
 
+//-----------------------------------------------------------------------------
+// 
+//-----------------------------------------------------------------------------
+void CDataCacheSection::ClearFrameLockRecent( FrameLock_t *pFrameLock )
+{
+	pFrameLock->m_nDiscardSerial = m_nDiscardSerial;
+	for ( int i = 0; i < FRAMELOCK_RECENT_SIZE; i++ )
+	{
+		pFrameLock->m_Recent[i].m_hItem = DC_INVALID_HANDLE;
+	}
+}
+
+
 //-----------------------------------------------------------------------------
 // 
 //-----------------------------------------------------------------------------
@@ -884,6 +914,8 @@ bool CDataCacheSection::DiscardItemData( DataCacheItem_t *pItem, DataCacheNotifi
 {
 	if ( pItem )
 	{
+		++m_nDiscardSerial;
+
 		if ( type != DC_NONE )
 		{
 			Assert( type == DC_AGE_DISCARD || type == DC_FLUSH_DISCARD || DC_REMOVED );
@@ -173,6 +173,19 @@ private:
 	void NoteUnlock( int size );
 	void NoteSizeChanged( int oldSize, int newSize );
 
+	// Items a thread has already frame locked, so looking them up again doesn't
+	// take the LRU mutex. Must be a power of two.
+	enum
+	{
+		FRAMELOCK_RECENT_SIZE = 32
+	};
+
+	struct FrameLockRecent_t
+	{
+		DataCacheHandle_t	m_hItem;
+		void *				m_pItemData;
+	};
+
 	struct FrameLock_t
 	{
 		//$ WARNING: This needs a TSLNodeBase_t as the first item in here.
@@ -180,8 +193,12 @@ private:
 		int				m_iLock;
 		DataCacheItem_t *m_pFirst;
 		int				m_iThread;
+		int				m_nDiscardSerial;
+		FrameLockRecent_t m_Recent[FRAMELOCK_RECENT_SIZE];
 	};
 
+	void ClearFrameLockRecent( FrameLock_t *pFrameLock );
+
 	CDataCacheLRU &		m_LRU;
 	CTHREADLOCAL(FrameLock_t*)	m_ThreadFrameLock;
 	DataCacheStatus_t	m_status;
@@ -191,6 +208,7 @@ private:
 	CDataCache *		m_pSharedCache;
 	char				szName[DC_MAX_CLIENT_NAME + 1];
 	CTSSimpleList<FrameLock_t> m_FreeFrameLocks;
+	CInterlockedInt		m_nDiscardSerial;	// Bumped whenever an item goes away, frame locked or not
 
 protected:
 	CThreadFastMutex &	m_mutex;
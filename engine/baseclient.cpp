@@ -66,6 +66,8 @@ CBaseClient::CBaseClient()
 	m_bReportFakeClient = true;
 	m_iTracing = 0;
 	m_bPlayerNameLocked = false;
+	m_bInParallelSend = false;
+	m_szDeferredDisconnect[0] = '\0';
 }
 
 CBaseClient::~CBaseClient()
@@ -601,6 +603,40 @@ void CBaseClient::Connect( const char * szName, int nUserID, INetChannel *pNetCh
 //			*fmt -
 //			... -
 //-----------------------------------------------------------------------------
+void CBaseClient::BeginParallelSend()
+{
+	Assert( !m_bInParallelSend );
+	m_bInParallelSend = true;
+	m_szDeferredDisconnect[0] = '\0';
+}
+
+void CBaseClient::EndParallelSend()
+{
+	Assert( m_bInParallelSend );
+	m_bInParallelSend = false;
+
+	if ( m_szDeferredDisconnect[0] )
+	{
+		char reason[sizeof( m_szDeferredDisconnect )];
+		Q_strncpy( reason, m_szDeferredDisconnect, sizeof( reason ) );
+		m_szDeferredDisconnect[0] = '\0';
+		Disconnect( "%s", reason );
+	}
+}
+
+bool CBaseClient::DeferDisconnect( const char *pReason )
+{
+	if ( !m_bInParallelSend )
+		return false;
+
+	// keep the first reason, later errors are usually fallout from it
+	if ( !m_szDeferredDisconnect[0] )
+	{
+		Q_strncpy( m_szDeferredDisconnect, pReason, sizeof( m_szDeferredDisconnect ) );
+	}
+	return true;
+}
+
 void CBaseClient::Disconnect( const char *fmt, ... )
 {
 	va_list		argptr;
@@ -609,6 +645,13 @@ void CBaseClient::Disconnect( const char *fmt, ... )
 	if ( m_nSignonState == SIGNONSTATE_NONE )
 		return;	// no recursion
 
+	va_start (argptr,fmt);
+	Q_vsnprintf (string, sizeof( string ), fmt,argptr);
+	va_end (argptr);
+
+	if ( DeferDisconnect( string ) )
+		return;
+
 #if !defined( SWDS ) && defined( ENABLE_RPT )
 	SV_NotifyRPTOfDisconnect( m_nClientSlot );
 #endif
@@ -621,10 +664,6 @@ void CBaseClient::Disconnect( const char *fmt, ... )
 	// clear user info 
 	m_Server->UserInfoChanged( m_nClientSlot );
 
-	va_start (argptr,fmt);
-	Q_vsnprintf (string, sizeof( string ), fmt,argptr);
-	va_end (argptr);
-
 	ConMsg("Dropped %s from server (%s)\n", GetClientName(), string );
 
 	// remove the client as listener
@@ -1077,6 +1116,10 @@ void CBaseClient::EndTrace( bf_write &msg )
 		return;
 	}
 
+	// snapshots may be sent from several threads at once, keep the log writes together
+	static CThreadFastMutex s_LogMutex;
+	AUTO_LOCK( s_LogMutex );
+
 	CUtlBuffer logData( 0, 0, CUtlBuffer::TEXT_BUFFER );
 
 	logData.Printf( "%f/%d Player [%s][%d][adr:%s] was sent a datagram %d bits (%8.3f bytes), took %.2fms\n",
@@ -1309,6 +1352,15 @@ write_again:
 			TraceNetworkMsg( 0, "Finished [delta %s]", deltaFrame ? "yes" : "no" );
 			EndTrace( msg );
 		}
+
+		// stress bots never acknowledge anything. While sv_sendsnapshot_benchmark runs, do it
+		// for them so they keep getting delta updates like a real client instead of stalling
+		// after the first full update; otherwise they behave as they always have
+		if ( m_bFakePlayer && SV_IsSendSnapshotBenchmarkRunning() )
+		{
+			m_nForceWaitForTick = -1;
+			UpdateAcknowledgedFramecount( pFrame->tick_count );
+		}
 	}
 	else
 	{
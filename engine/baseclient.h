@@ -279,6 +279,16 @@ public:
 
 	unsigned int		m_SnapshotScratchBuffer[ SNAPSHOT_SCRATCH_BUFFER_SIZE / 4 ];
 
+	// While SendSnapshot runs on a job thread, Disconnect() only records the reason
+	// (dropping a client touches server and game state). EndParallelSend() runs on
+	// the main thread afterwards and performs the disconnect.
+	void				BeginParallelSend();
+	void				EndParallelSend();
+
+protected:
+	// Returns true if the disconnect was deferred until EndParallelSend().
+	bool				DeferDisconnect( const char *pReason );
+
 private:
 	void				StartTrace( bf_write &msg );
 	void				EndTrace( bf_write &msg );
@@ -286,6 +296,9 @@ private:
 
 	int					m_iTracing; // 0 = not active, 1 = active for this frame, 2 = forced active
 	CNetworkStatTrace	m_Trace;
+
+	bool				m_bInParallelSend;
+	char				m_szDeferredDisconnect[256];
 };
 
 
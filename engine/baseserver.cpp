@@ -54,6 +54,7 @@
 #include "sv_steamauth.h"
 #include "tier0/vcrmode.h"
 #include "sv_ipratelimit.h"
+#include "net_ws_receive_thread.h"
 #include "cl_steamauth.h"
 #include "sv_filter.h"
 #include "master.h"
@@ -79,6 +80,8 @@ static ConVar	sv_max_connects_sec_global( "sv_max_connects_sec_global", "0", 0,
 
 static CIPRateLimit s_queryRateChecker( &sv_max_queries_sec, &sv_max_queries_window, &sv_max_queries_sec_global );
 static CIPRateLimit s_connectRateChecker( &sv_max_connects_sec, &sv_max_connects_window, &sv_max_connects_sec_global );
+// only used from the network receive thread
+static CIPRateLimit s_threadedQueryRateChecker( &sv_max_queries_sec, &sv_max_queries_window, &sv_max_queries_sec_global );
 
 // Give new data to Steam's master server updater every N seconds.
 // This is NOT how often packets are sent to master servers, only how often the
@@ -662,6 +665,43 @@ bool CBaseServer::ValidInfoChallenge( netadr_t & adr, const char *nugget )
 }
 
 
+//-----------------------------------------------------------------------------
+// Purpose: Server queries the network receive thread rate limits before they get
+//  to ProcessConnectionlessPacket. SourceTV answers A2S_INFO itself without a
+//  rate limit, so that one is left alone there.
+//-----------------------------------------------------------------------------
+bool SV_IsPrefilteredQuery( int nSocket, char c )
+{
+	switch ( c )
+	{
+	case A2S_PLAYER:
+	case A2S_RULES:
+		return true;
+	case A2S_INFO:
+		return nSocket != NS_HLTV;
+	}
+
+	return false;
+}
+
+bool SV_PrefilterConnectionlessPacket( int nSocket, const netadr_t &adr, const unsigned char *pData, int nSize )
+{
+	// header plus command byte
+	if ( nSize < 5 )
+		return false;
+
+	char c = (char)pData[4];
+
+	// ProcessConnectionlessPacket ignores these
+	if ( c == 0 )
+		return false;
+
+	if ( SV_IsPrefilteredQuery( nSocket, c ) && !s_threadedQueryRateChecker.CheckIPNoLog( adr ) )
+		return false;
+
+	return true;
+}
+
 bool CBaseServer::ProcessConnectionlessPacket(netpacket_t * packet)
 {
 	master->ProcessConnectionlessPacket( packet );
@@ -767,8 +807,9 @@ bool CBaseServer::ProcessConnectionlessPacket(netpacket_t * packet)
 		
 		default:
 			{
-				// rate limit the more expensive server query packets
-				if ( !s_queryRateChecker.CheckIP( packet->from ) )
+				// rate limit the more expensive server query packets, unless the receive thread already did
+				bool bPrefiltered = g_pNetReceiveThread->IsReceivingSocket( packet->source ) && SV_IsPrefilteredQuery( packet->source, c );
+				if ( !bPrefiltered && !s_queryRateChecker.CheckIP( packet->from ) )
 					return false;
 
 				// We don't understand it, let the master server updater at it.
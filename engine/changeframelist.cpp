@@ -9,20 +9,50 @@
 #include "changeframelist.h"
 #include "dt.h"
 #include "utlvector.h"
+#include "bitvec.h"
 
 // memdbgon must be the last include file in a .cpp file!!!
 #include "tier0/memdbgon.h"
 
 
+// Instead of a tick per property, this keeps a few "change sets": a bitmask of properties
+// together with the tick they last changed at. The sets are ordered from oldest to newest
+// and every property is in exactly one of them, so "props changed after tick T" is the
+// union of the sets newer than T. Most entities only need one or two sets.
+//
+// When there are more than MAX_CHANGE_SETS sets the oldest one is moved out into a plain
+// per-property tick array, which is only allocated once an entity gets there. Properties
+// that aren't in any set changed at their tick in that array, so answers stay exact for
+// clients whose delta tick is further back.
+#define MAX_CHANGE_SETS	8
+
 class CChangeFrameList : public IChangeFrameList
 {
 public:
 
+	CChangeFrameList()
+	{
+		m_nProps = 0;
+		m_nWords = 0;
+		m_nSets = 0;
+		m_pBits = NULL;
+		m_pOldTicks = NULL;
+		m_iNewestOldTick = -1;
+	}
+
 	void	Init( int nProperties, int iCurTick )
 	{
-		m_ChangeTicks.SetSize( nProperties );
-		for ( int i=0; i < nProperties; i++ )
-			m_ChangeTicks[i] = iCurTick;
+		m_nProps = nProperties;
+		m_nWords = ( nProperties + 31 ) >> 5;
+		m_nSets = 1;
+		m_Ticks[0] = iCurTick;
+		m_pBits = new uint32[ m_nWords * MAX_CHANGE_SETS ];
+
+		// everything changed at iCurTick
+		for ( int i=0; i < m_nWords; i++ )
+			m_pBits[i] = 0xFFFFFFFF;
+		if ( nProperties & 31 )
+			m_pBits[m_nWords-1] = ( 1u << ( nProperties & 31 ) ) - 1;
 	}
 
 
@@ -38,45 +68,109 @@ public:
 	{
 		CChangeFrameList *pRet = new CChangeFrameList;
 
-		int numProps = m_ChangeTicks.Count();
-
-		pRet->m_ChangeTicks.SetSize( numProps );
+		pRet->m_nProps = m_nProps;
+		pRet->m_nWords = m_nWords;
+		pRet->m_nSets = m_nSets;
+		pRet->m_pBits = new uint32[ m_nWords * MAX_CHANGE_SETS ];
+		Q_memcpy( pRet->m_Ticks, m_Ticks, m_nSets * sizeof( int ) );
+		Q_memcpy( pRet->m_pBits, m_pBits, m_nSets * m_nWords * sizeof( uint32 ) );
 
-		for ( int i=0; i < numProps; i++ )
+		if ( m_pOldTicks )
 		{
-			pRet->m_ChangeTicks[ i ] = m_ChangeTicks[ i ];
+			pRet->m_pOldTicks = new int[ m_nProps ];
+			pRet->m_iNewestOldTick = m_iNewestOldTick;
+			Q_memcpy( pRet->m_pOldTicks, m_pOldTicks, m_nProps * sizeof( int ) );
 		}
 
 		return pRet;
-
 	}
 
 	virtual int		GetNumProps()
 	{
-		return m_ChangeTicks.Count();
+		return m_nProps;
 	}
 
 	virtual void	SetChangeTick( const int *pPropIndices, int nPropIndices, const int iTick )
 	{
+		if ( nPropIndices == 0 )
+			return;
+
+		// Ticks normally only go forward. If not, file the props under the newest
+		// tick, which is conservative.
+		if ( iTick > m_Ticks[m_nSets-1] )
+		{
+			if ( m_nSets == MAX_CHANGE_SETS )
+			{
+				RetireOldestSet();
+			}
+
+			m_Ticks[m_nSets] = iTick;
+			Q_memset( GetSet( m_nSets ), 0, m_nWords * sizeof( uint32 ) );
+			m_nSets++;
+		}
+
+		// move the props into the newest set
+		int iNewest = m_nSets-1;
 		for ( int i=0; i < nPropIndices; i++ )
 		{
-			m_ChangeTicks[ pPropIndices[i] ] = iTick;
+			int iProp = pPropIndices[i];
+			Assert( iProp >= 0 && iProp < m_nProps );
+
+			int iWord = iProp >> 5;
+			uint32 mask = 1u << ( iProp & 31 );
+			for ( int iSet=0; iSet < iNewest; iSet++ )
+			{
+				GetSet( iSet )[iWord] &= ~mask;
+			}
+			GetSet( iNewest )[iWord] |= mask;
 		}
+
+		RemoveEmptySets();
 	}
 
 	virtual int		GetPropsChangedAfterTick( int iTick, int *iOutProps, int nMaxOutProps )
 	{
-		int nOutProps = 0;
+		Assert( m_nProps <= nMaxOutProps );
+
+		// find the oldest set newer than iTick
+		int iFirstSet = m_nSets;
+		while ( iFirstSet > 0 && m_Ticks[iFirstSet-1] > iTick )
+		{
+			--iFirstSet;
+		}
 
-		int c = m_ChangeTicks.Count();
-		
-		Assert( c <= nMaxOutProps );
+		// retired props are all older than the sets. Those that are in a set again
+		// changed after their retired tick, so they're in the result already.
+		bool bOldTicks = m_pOldTicks && m_iNewestOldTick > iTick;
+
+		int nOutProps = 0;
+		if ( iFirstSet == m_nSets && !bOldTicks )
+			return nOutProps;
 
-		for ( int i=0; i < c; i++ )
+		for ( int iWord=0; iWord < m_nWords; iWord++ )
 		{
-			if ( m_ChangeTicks[i] > iTick )
+			uint32 bits = 0;
+			for ( int iSet=iFirstSet; iSet < m_nSets; iSet++ )
 			{
-				iOutProps[nOutProps] = i;
+				bits |= GetSet( iSet )[iWord];
+			}
+
+			if ( bOldTicks )
+			{
+				const int *pOldTicks = m_pOldTicks + ( iWord << 5 );
+				int nBits = MIN( 32, m_nProps - ( iWord << 5 ) );
+				for ( int iBit=0; iBit < nBits; iBit++ )
+				{
+					if ( pOldTicks[iBit] > iTick )
+						bits |= 1u << iBit;
+				}
+			}
+
+			while ( bits )
+			{
+				int iBit = FirstBitInWord( bits, 0 );
+				bits &= bits - 1;
+				iOutProps[nOutProps] = ( iWord << 5 ) + iBit;
 				++nOutProps;
 			}
 		}
@@ -89,11 +183,86 @@ protected:
 
 	virtual			~CChangeFrameList()
 	{
+		delete [] m_pBits;
+		delete [] m_pOldTicks;
 	}
 
 private:
-	// Change frames for each property.
-	CUtlVector<int>		m_ChangeTicks;
+	uint32*	GetSet( int iSet )
+	{
+		return m_pBits + iSet * m_nWords;
+	}
+
+	bool	IsSetEmpty( int iSet )
+	{
+		uint32 *pSet = GetSet( iSet );
+		for ( int i=0; i < m_nWords; i++ )
+		{
+			if ( pSet[i] )
+				return false;
+		}
+		return true;
+	}
+
+	void	RemoveSet( int iSet )
+	{
+		int nMove = m_nSets - iSet - 1;
+		if ( nMove > 0 )
+		{
+			Q_memmove( &m_Ticks[iSet], &m_Ticks[iSet+1], nMove * sizeof( int ) );
+			Q_memmove( GetSet( iSet ), GetSet( iSet+1 ), nMove * m_nWords * sizeof( uint32 ) );
+		}
+		m_nSets--;
+	}
+
+	// Sets whose props all changed again later hold nothing; drop them.
+	void	RemoveEmptySets()
+	{
+		for ( int iSet=m_nSets-2; iSet >= 0; iSet-- )
+		{
+			if ( IsSetEmpty( iSet ) )
+			{
+				RemoveSet( iSet );
+			}
+		}
+	}
+
+	// Moves the props of the oldest set into m_pOldTicks to make room for a new set.
+	void	RetireOldestSet()
+	{
+		Assert( m_nSets >= 2 );
+
+		if ( !m_pOldTicks )
+		{
+			// nothing was retired yet, so every prop is in a set
+			m_pOldTicks = new int[ m_nProps ];
+			for ( int i=0; i < m_nProps; i++ )
+				m_pOldTicks[i] = -1;
+		}
+
+		const uint32 *pOldest = GetSet( 0 );
+		for ( int iWord=0; iWord < m_nWords; iWord++ )
+		{
+			uint32 bits = pOldest[iWord];
+			while ( bits )
+			{
+				int iBit = FirstBitInWord( bits, 0 );
+				bits &= bits - 1;
+				m_pOldTicks[( iWord << 5 ) + iBit] = m_Ticks[0];
+			}
+		}
+
+		m_iNewestOldTick = m_Ticks[0];
+		RemoveSet( 0 );
+	}
+
+	int		m_nProps;
+	int		m_nWords;						// uint32s per set
+	int		m_nSets;
+	int		m_Ticks[MAX_CHANGE_SETS];		// change tick of each set, ascending
+	uint32	*m_pBits;						// m_nWords per set, room for MAX_CHANGE_SETS sets
+	int		*m_pOldTicks;					// change tick of props retired from the sets, or NULL
+	int		m_iNewestOldTick;				// newest tick in m_pOldTicks
 };
 
 
@@ -103,6 +272,3 @@ IChangeFrameList* AllocChangeFrameList( int nProperties, int iCurTick )
 	pRet->Init( nProperties, iCurTick);
 	return pRet;
 }
-
-
-
@@ -62,17 +62,53 @@ public:
 CTraceInfoPool g_TraceInfoPool;
 #endif
 
+//-----------------------------------------------------------------------------
+// Every thread keeps a few trace infos of its own so that threads tracing at
+// the same time don't all contend for the shared pool. The slots are indexed
+// by g_nThreadID, which tier0 gives each thread it starts and recycles when
+// the thread exits, so a slot is only ever used by one thread at a time.
+// Threads that weren't started by tier0 all have id 0, only the main thread
+// gets that slot and the others go to the shared pool.
+//-----------------------------------------------------------------------------
+#define TRACE_THREAD_SLOTS			128		// MAX_THREAD_IDS in tier0
+#define TRACE_THREAD_SLOT_SIZE		4		// enough for a packet of traces
+
+struct ALIGN128 ThreadTraceInfos_t
+{
+	TraceInfo_t *m_pTraceInfos[TRACE_THREAD_SLOT_SIZE];
+	int m_nCount;
+} ALIGN128_POST;
+
+static ThreadTraceInfos_t s_ThreadTraceInfos[TRACE_THREAD_SLOTS];
+
+static ThreadTraceInfos_t *GetThreadTraceInfos()
+{
+	int nThread = g_nThreadID;
+	if ( nThread >= TRACE_THREAD_SLOTS || ( nThread == 0 && !ThreadInMainThread() ) )
+		return NULL;
+
+	return &s_ThreadTraceInfos[nThread];
+}
+
 TraceInfo_t *BeginTrace()
 {
-#if TEST_TRACE_POOL
-	TraceInfo_t *pTraceInfo = g_TraceInfoPool.GetObject();
-#else
-	TraceInfo_t *pTraceInfo;
-	if ( !g_TraceInfoPool.PopItem( &pTraceInfo ) )
+	TraceInfo_t *pTraceInfo = NULL;
+	ThreadTraceInfos_t *pThreadTraceInfos = GetThreadTraceInfos();
+	if ( pThreadTraceInfos && pThreadTraceInfos->m_nCount )
 	{
-		pTraceInfo = new TraceInfo_t;
+		pTraceInfo = pThreadTraceInfos->m_pTraceInfos[ --pThreadTraceInfos->m_nCount ];
 	}
+	else
+	{
+#if TEST_TRACE_POOL
+		pTraceInfo = g_TraceInfoPool.GetObject();
+#else
+		if ( !g_TraceInfoPool.PopItem( &pTraceInfo ) )
+		{
+			pTraceInfo = new TraceInfo_t;
+		}
 #endif
+	}
 	if ( pTraceInfo->m_BrushCounters[0].Count() != GetCollisionBSPData()->numbrushes + 1 )
 	{
 		memset( pTraceInfo->m_Count, 0, sizeof( pTraceInfo->m_Count ) );
@@ -118,11 +154,20 @@ void EndTrace( TraceInfo_t *&pTraceInfo )
 {
 	PopTraceVisits( pTraceInfo );
 	Assert( pTraceInfo->m_nCheckDepth == -1 );
+
+	ThreadTraceInfos_t *pThreadTraceInfos = GetThreadTraceInfos();
+	if ( pThreadTraceInfos && pThreadTraceInfos->m_nCount < TRACE_THREAD_SLOT_SIZE )
+	{
+		pThreadTraceInfos->m_pTraceInfos[ pThreadTraceInfos->m_nCount++ ] = pTraceInfo;
+	}
+	else
+	{
 #if TEST_TRACE_POOL
-	g_TraceInfoPool.PutObject( pTraceInfo );
+		g_TraceInfoPool.PutObject( pTraceInfo );
 #else
-	g_TraceInfoPool.PushItem( pTraceInfo );
+		g_TraceInfoPool.PushItem( pTraceInfo );
 #endif
+	}
 	pTraceInfo = NULL;
 }
 
@@ -2039,6 +2084,191 @@ void FASTCALL CM_RecursiveHullCheck ( TraceInfo_t *pTraceInfo, int num, const fl
 	}
 }
 
+//-----------------------------------------------------------------------------
+// Packet version of CM_RecursiveHullCheckImpl. Up to four swept traces of the
+// same kind walk the tree together, one per lane: each node is fetched and
+// classified once for the whole packet, and the lanes only part ways where
+// their segments land on different sides of a plane. Every lane visits the
+// same leaves in the same order the single trace would.
+//-----------------------------------------------------------------------------
+struct TracePacket_t
+{
+	CCollisionBSPData	*m_pBSPData;
+	TraceInfo_t			*m_pTraceInfo[4];
+	FourVectors			m_extents;
+};
+
+template <bool IS_POINT>
+static void CM_RecursiveHullCheckPacket( const TracePacket_t &packet, int nLanes, int num, const fltx4 &p1f, const fltx4 &p2f, const FourVectors &p1, const FourVectors &p2 )
+{
+	for ( int i = 0; i < 4; i++ )
+	{
+		if ( ( nLanes & ( 1 << i ) ) && packet.m_pTraceInfo[i]->m_trace.fraction <= SubFloat( p1f, i ) )
+		{
+			nLanes &= ~( 1 << i );		// already hit something nearer
+		}
+	}
+
+	if ( !nLanes )
+		return;
+
+	cnode_t		*node = NULL;
+	fltx4		t1 = Four_Zeros, t2 = Four_Zeros, offset = Four_Zeros;
+	int			nFront = 0, nBack = 0;
+
+	while( num >= 0 )
+	{
+		node = packet.m_pBSPData->map_rootnode + num;
+		cplane_t *plane = node->plane;
+		byte type = plane->type;
+		fltx4 dist = ReplicateX4( plane->dist );
+
+		if (type < 3)
+		{
+			t1 = SubSIMD( p1[type], dist );
+			t2 = SubSIMD( p2[type], dist );
+			offset = packet.m_extents[type];
+		}
+		else
+		{
+			fltx4 nx = ReplicateX4( plane->normal[0] );
+			fltx4 ny = ReplicateX4( plane->normal[1] );
+			fltx4 nz = ReplicateX4( plane->normal[2] );
+			t1 = SubSIMD( AddSIMD( AddSIMD( MulSIMD( p1.x, nx ), MulSIMD( p1.y, ny ) ), MulSIMD( p1.z, nz ) ), dist );
+			t2 = SubSIMD( AddSIMD( AddSIMD( MulSIMD( p2.x, nx ), MulSIMD( p2.y, ny ) ), MulSIMD( p2.z, nz ) ), dist );
+			if( !IS_POINT )
+			{
+				// summed in the same order as the single trace so the lanes round the same way
+				offset = AddSIMD( AddSIMD( MulSIMD( packet.m_extents.x, ReplicateX4( fabsf( plane->normal[0] ) ) ),
+					MulSIMD( packet.m_extents.y, ReplicateX4( fabsf( plane->normal[1] ) ) ) ),
+					MulSIMD( packet.m_extents.z, ReplicateX4( fabsf( plane->normal[2] ) ) ) );
+			}
+		}
+
+		// see which sides the lanes need to consider
+		fltx4 negOffset = NegSIMD( offset );
+		nFront = TestSignSIMD( AndSIMD( CmpGtSIMD( t1, offset ), CmpGtSIMD( t2, offset ) ) ) & nLanes;
+		nBack = TestSignSIMD( AndSIMD( CmpLtSIMD( t1, negOffset ), CmpLtSIMD( t2, negOffset ) ) ) & nLanes;
+
+		if ( nFront == nLanes )
+		{
+			num = node->children[0];
+			continue;
+		}
+		if ( nBack == nLanes )
+		{
+			num = node->children[1];
+			continue;
+		}
+		break;
+	}
+
+	// if < 0, we are in a leaf node
+	if (num < 0)
+	{
+		for ( int i = 0; i < 4; i++ )
+		{
+			if ( nLanes & ( 1 << i ) )
+			{
+				CM_TraceToLeaf<IS_POINT>( packet.m_pTraceInfo[i], -1-num, SubFloat( p1f, i ), SubFloat( p2f, i ) );
+			}
+		}
+		return;
+	}
+
+	// The lanes part ways here. Lanes that don't cross the plane keep their
+	// segment for the one child they go to, lanes that do are split exactly
+	// like the single trace splits them.
+	FourVectors childP1[2] = { p1, p1 };
+	FourVectors childP2[2] = { p2, p2 };
+	fltx4 childP1f[2] = { p1f, p1f };
+	fltx4 childP2f[2] = { p2f, p2f };
+	int nChildLanes[2] = { nFront, nBack };
+	int nBackFirst = 0;
+
+	int nSplit = nLanes & ~( nFront | nBack );
+	for ( int i = 0; i < 4; i++ )
+	{
+		if ( !( nSplit & ( 1 << i ) ) )
+			continue;
+
+		float flT1 = SubFloat( t1, i );
+		float flT2 = SubFloat( t2, i );
+		float flOffset = SubFloat( offset, i );
+		float idist, frac, frac2, midf;
+		int side;
+
+		// put the crosspoint DIST_EPSILON pixels on the near side
+		if (flT1 < flT2)
+		{
+			idist = 1.0/(flT1-flT2);
+			side = 1;
+			frac2 = (flT1 + flOffset + DIST_EPSILON)*idist;
+			frac = (flT1 - flOffset - DIST_EPSILON)*idist;
+		}
+		else if (flT1 > flT2)
+		{
+			idist = 1.0/(flT1-flT2);
+			side = 0;
+			frac2 = (flT1 - flOffset - DIST_EPSILON)*idist;
+			frac = (flT1 + flOffset + DIST_EPSILON)*idist;
+		}
+		else
+		{
+			side = 0;
+			frac = 1;
+			frac2 = 0;
+		}
+
+		float flP1f = SubFloat( p1f, i );
+		float flP2f = SubFloat( p2f, i );
+		Vector vecP1 = p1.Vec( i );
+		Vector vecP2 = p2.Vec( i );
+		Vector mid;
+
+		// move up to the node
+		frac = clamp( frac, 0.f, 1.f );
+		midf = flP1f + (flP2f - flP1f)*frac;
+		VectorLerp( vecP1, vecP2, frac, mid );
+		SubFloat( childP2f[side], i ) = midf;
+		childP2[side].X( i ) = mid.x;
+		childP2[side].Y( i ) = mid.y;
+		childP2[side].Z( i ) = mid.z;
+
+		// go past the node
+		frac2 = clamp( frac2, 0.f, 1.f );
+		midf = flP1f + (flP2f - flP1f)*frac2;
+		VectorLerp( vecP1, vecP2, frac2, mid );
+		SubFloat( childP1f[side^1], i ) = midf;
+		childP1[side^1].X( i ) = mid.x;
+		childP1[side^1].Y( i ) = mid.y;
+		childP1[side^1].Z( i ) = mid.z;
+
+		nChildLanes[0] |= ( 1 << i );
+		nChildLanes[1] |= ( 1 << i );
+		if ( side )
+		{
+			nBackFirst |= ( 1 << i );
+		}
+	}
+
+	// each lane visits its near side first, just like the single trace
+	int nFrontFirst = nLanes & ~nBackFirst;
+	if ( nChildLanes[0] & nFrontFirst )
+	{
+		CM_RecursiveHullCheckPacket<IS_POINT>( packet, nChildLanes[0] & nFrontFirst, node->children[0], childP1f[0], childP2f[0], childP1[0], childP2[0] );
+	}
+	if ( nChildLanes[1] & nFrontFirst )
+	{
+		CM_RecursiveHullCheckPacket<IS_POINT>( packet, nChildLanes[1] & nFrontFirst, node->children[1], childP1f[1], childP2f[1], childP1[1], childP2[1] );
+	}
+	if ( nBackFirst )
+	{
+		CM_RecursiveHullCheckPacket<IS_POINT>( packet, nBackFirst, node->children[1], childP1f[1], childP2f[1], childP1[1], childP2[1] );
+		CM_RecursiveHullCheckPacket<IS_POINT>( packet, nBackFirst, node->children[0], childP1f[0], childP2f[0], childP1[0], childP2[0] );
+	}
+}
+
 void CM_ClearTrace( trace_t *trace )
 {
 	memset( trace, 0, sizeof(*trace));
@@ -2179,6 +2409,22 @@ void CM_BoxTraceAgainstLeafList( const Ray_t &ray, int *pLeafList, int nLeafCoun
 	Assert( !ray.m_IsRay || trace.allsolid || ( trace.fraction >= trace.fractionleftsolid ) );
 }
 
+static void CM_SetupTraceInfo( TraceInfo_t *pTraceInfo, const Ray_t& ray, int brushmask )
+{
+	pTraceInfo->m_bDispHit = false;
+	pTraceInfo->m_DispStabDir.Init();
+	pTraceInfo->m_contents = brushmask;
+	VectorCopy (ray.m_Start, pTraceInfo->m_start);
+	VectorAdd  (ray.m_Start, ray.m_Delta, pTraceInfo->m_end);
+	VectorMultiply (ray.m_Extents, -1.0f, pTraceInfo->m_mins);
+	VectorCopy (ray.m_Extents, pTraceInfo->m_maxs);
+	VectorCopy (ray.m_Extents, pTraceInfo->m_extents);
+	pTraceInfo->m_delta = ray.m_Delta;
+	pTraceInfo->m_invDelta = ray.InvDelta();
+	pTraceInfo->m_ispoint = ray.m_IsRay;
+	pTraceInfo->m_isswept = ray.m_IsSwept;
+}
+
 void CM_BoxTrace( const Ray_t& ray, int headnode, int brushmask, bool computeEndpt, trace_t& tr )
 {
 	VPROF("BoxTrace");
@@ -2203,18 +2449,7 @@ void CM_BoxTrace( const Ray_t& ray, int headnode, int brushmask, bool computeEnd
 		return;
 	}
 
-	pTraceInfo->m_bDispHit = false;
-	pTraceInfo->m_DispStabDir.Init();
-	pTraceInfo->m_contents = brushmask;
-	VectorCopy (ray.m_Start, pTraceInfo->m_start);
-	VectorAdd  (ray.m_Start, ray.m_Delta, pTraceInfo->m_end);
-	VectorMultiply (ray.m_Extents, -1.0f, pTraceInfo->m_mins);
-	VectorCopy (ray.m_Extents, pTraceInfo->m_maxs);
-	VectorCopy (ray.m_Extents, pTraceInfo->m_extents);
-	pTraceInfo->m_delta = ray.m_Delta;
-	pTraceInfo->m_invDelta = ray.InvDelta();
-	pTraceInfo->m_ispoint = ray.m_IsRay;
-	pTraceInfo->m_isswept = ray.m_IsSwept;
+	CM_SetupTraceInfo( pTraceInfo, ray, brushmask );
 
 	if (!ray.m_IsSwept)
 	{
@@ -2239,6 +2474,135 @@ void CM_BoxTrace( const Ray_t& ray, int headnode, int brushmask, bool computeEnd
 }
 
 
+//-----------------------------------------------------------------------------
+// Traces up to four swept rays of the same kind as one packet
+//-----------------------------------------------------------------------------
+static void CM_BoxTracePacket( const Ray_t *pRays, const int *pRayIndices, int nCount, int headnode, int brushmask, bool computeEndpt, trace_t *pTraces )
+{
+	Assert( nCount > 0 && nCount <= 4 );
+
+	TracePacket_t packet;
+	FourVectors p1, p2;
+	packet.m_pBSPData = GetCollisionBSPData();
+	packet.m_extents.x = packet.m_extents.y = packet.m_extents.z = Four_Zeros;
+	p1 = packet.m_extents;
+	p2 = packet.m_extents;
+
+	for ( int i = 0; i < 4; i++ )
+	{
+		if ( i >= nCount )
+		{
+			// unused lanes are never looked at
+			packet.m_pTraceInfo[i] = NULL;
+			continue;
+		}
+
+#ifdef COUNT_COLLISIONS
+		// for statistics, may be zeroed
+		g_CollisionCounts.m_Traces++;
+#endif
+
+		const Ray_t &ray = pRays[ pRayIndices[i] ];
+		TraceInfo_t *pTraceInfo = BeginTrace();
+		CM_ClearTrace( &pTraceInfo->m_trace );
+		pTraceInfo->m_pBSPData = packet.m_pBSPData;
+		CM_SetupTraceInfo( pTraceInfo, ray, brushmask );
+		packet.m_pTraceInfo[i] = pTraceInfo;
+
+		packet.m_extents.X( i ) = ray.m_Extents.x;
+		packet.m_extents.Y( i ) = ray.m_Extents.y;
+		packet.m_extents.Z( i ) = ray.m_Extents.z;
+		p1.X( i ) = pTraceInfo->m_start.x;
+		p1.Y( i ) = pTraceInfo->m_start.y;
+		p1.Z( i ) = pTraceInfo->m_start.z;
+		p2.X( i ) = pTraceInfo->m_end.x;
+		p2.Y( i ) = pTraceInfo->m_end.y;
+		p2.Z( i ) = pTraceInfo->m_end.z;
+	}
+
+	int nLanes = ( 1 << nCount ) - 1;
+	if ( pRays[ pRayIndices[0] ].m_IsRay )
+	{
+		CM_RecursiveHullCheckPacket<true>( packet, nLanes, headnode, Four_Zeros, Four_Ones, p1, p2 );
+	}
+	else
+	{
+		CM_RecursiveHullCheckPacket<false>( packet, nLanes, headnode, Four_Zeros, Four_Ones, p1, p2 );
+	}
+
+	for ( int i = 0; i < nCount; i++ )
+	{
+		const Ray_t &ray = pRays[ pRayIndices[i] ];
+		TraceInfo_t *pTraceInfo = packet.m_pTraceInfo[i];
+		if (computeEndpt)
+		{
+			CM_ComputeTraceEndpoints( ray, pTraceInfo->m_trace );
+		}
+
+		trace_t &tr = pTraces[ pRayIndices[i] ];
+		tr = pTraceInfo->m_trace;
+		EndTrace( pTraceInfo );
+		Assert( !ray.m_IsRay || tr.allsolid || (tr.fraction >= tr.fractionleftsolid) );
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Traces a batch of rays, giving the same results as calling CM_BoxTrace on
+// each of them. Swept rays go through the tree in packets of four, point rays
+// and boxes apart since they're clipped differently. Rays close together
+// should be next to each other in the batch, the packets are taken in order.
+//-----------------------------------------------------------------------------
+void CM_BoxTraceRays( int nRays, const Ray_t *pRays, int headnode, int brushmask, bool computeEndpt, trace_t *pTraces )
+{
+	VPROF("BoxTraceRays");
+
+	// check if the map is not loaded
+	if ( !GetCollisionBSPData()->numnodes )
+	{
+		for ( int i = 0; i < nRays; i++ )
+		{
+			CM_BoxTrace( pRays[i], headnode, brushmask, computeEndpt, pTraces[i] );
+		}
+		return;
+	}
+
+	int pendingRays[2][4];
+	int nPending[2] = { 0, 0 };
+	for ( int i = 0; i < nRays; i++ )
+	{
+		const Ray_t &ray = pRays[i];
+		if ( !ray.m_IsSwept )
+		{
+			// position tests don't walk the tree
+			CM_BoxTrace( ray, headnode, brushmask, computeEndpt, pTraces[i] );
+			continue;
+		}
+
+		int nKind = ray.m_IsRay ? 1 : 0;
+		pendingRays[nKind][ nPending[nKind]++ ] = i;
+		if ( nPending[nKind] == 4 )
+		{
+			CM_BoxTracePacket( pRays, pendingRays[nKind], 4, headnode, brushmask, computeEndpt, pTraces );
+			nPending[nKind] = 0;
+		}
+	}
+
+	for ( int nKind = 0; nKind < 2; nKind++ )
+	{
+		if ( nPending[nKind] == 1 )
+		{
+			int nRay = pendingRays[nKind][0];
+			CM_BoxTrace( pRays[nRay], headnode, brushmask, computeEndpt, pTraces[nRay] );
+		}
+		else if ( nPending[nKind] > 1 )
+		{
+			CM_BoxTracePacket( pRays, pendingRays[nKind], nPending[nKind], headnode, brushmask, computeEndpt, pTraces );
+		}
+	}
+}
+
+
 void CM_TransformedBoxTrace( const Ray_t& ray, int headnode, int brushmask,
 							const Vector& origin, QAngle const& angles, trace_t& tr )
 {
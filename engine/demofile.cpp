@@ -9,6 +9,7 @@
 #include <utlbuffer.h>
 
 #include "demofile.h"
+#include "demofilewriter.h"
 #include "filesystem_engine.h"
 #include "demo.h"
 #include "proto_version.h"
@@ -53,7 +54,8 @@ int CDbgPrint::s_nIndent = 0;
 CDemoFile::CDemoFile() :
 	m_pBuffer( NULL ),
 	m_bAllowHeaderWrite( true ),
-	m_bIsStreamBuffer( false )
+	m_bIsStreamBuffer( false ),
+	m_bIsAsyncWriteBuffer( false )
 {
 }
 
@@ -505,11 +507,29 @@ bool CDemoFile::Open(const char *name, bool bReadOnly, bool bMemoryBuffer, int n
 		Assert( nBufferSize > 0 );
 		m_pBuffer = new CUtlBuffer( nBufferSize, nBufferSize, 0 );
 		m_bIsStreamBuffer = false;
+		m_bIsAsyncWriteBuffer = false;
+	}
+	else if ( !bReadOnly && demo_asyncwrite.GetBool() )
+	{
+		// writes happen on the demo writer thread
+		m_pBuffer = new CDemoAsyncWriteBuffer( name, demo_compress.GetBool() );
+		m_bIsStreamBuffer = false;
+		m_bIsAsyncWriteBuffer = true;
+	}
+	else if ( bReadOnly && DemoFile_IsCompressed( name ) )
+	{
+		// compressed demos are decoded into memory up front, whatever
+		// could not be decoded fails the demo header check later
+		m_pBuffer = new CUtlBuffer( 0, 0, 0 );
+		m_bIsStreamBuffer = false;
+		m_bIsAsyncWriteBuffer = false;
+		DemoFile_ReadCompressed( name, *m_pBuffer );
 	}
 	else
 	{
 		m_pBuffer = new CUtlStreamBuffer( name, NULL, bReadOnly ? CUtlBuffer::READ_ONLY : 0, false );
 		m_bIsStreamBuffer = true;
+		m_bIsAsyncWriteBuffer = false;
 	}
 
 	// Demo files are always little endian
@@ -544,6 +564,11 @@ void CDemoFile::Close()
 		// Destructor will call Close() as needed
 		delete static_cast<CUtlStreamBuffer*>(m_pBuffer);
 	}
+	else if ( m_bIsAsyncWriteBuffer )
+	{
+		// Destructor waits for the writer thread and closes the file
+		delete static_cast<CDemoAsyncWriteBuffer*>(m_pBuffer);
+	}
 	else
 	{
 		delete m_pBuffer;
@@ -83,6 +83,7 @@ public:
 	CUtlBuffer		*m_pBuffer;
 	bool			m_bAllowHeaderWrite;
 	bool			m_bIsStreamBuffer;
+	bool			m_bIsAsyncWriteBuffer;
 };
 
 #endif // DEMOFILE_H
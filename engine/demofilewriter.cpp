@@ -0,0 +1,517 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Demo file buffer that hands its data to a background thread for
+//			writing, optionally snappy compressed.
+//
+//===========================================================================//
+
+#include "tier0/dbg.h"
+#include "tier0/threadtools.h"
+#include "tier1/convar.h"
+#include "tier1/strtools.h"
+#include "tier1/utllinkedlist.h"
+#include "tier1/snappy.h"
+#include "filesystem.h"
+#include "filesystem_engine.h"
+#include "demofilewriter.h"
+
+// NOTE: This has to be the last file included!
+#include "tier0/memdbgon.h"
+
+
+ConVar demo_asyncwrite( "demo_asyncwrite", "1", 0, "Write recorded demos from a background thread." );
+ConVar demo_compress( "demo_compress", "0", 0, "Snappy compress recorded demos. Needs demo_asyncwrite." );
+static ConVar demo_asyncwrite_maxqueue( "demo_asyncwrite_maxqueue", "8192", 0, "KB of demo data that may wait for the writer thread before recording blocks.", true, 64, false, 0 );
+
+#define DEMO_WRITE_CHUNK_SIZE	( 64 * 1024 )
+
+// Compressed demos start with this instead of DEMO_HEADER_ID, followed by records of
+// offset, size and compressed size (little endian uint32) and the snappy data. Records
+// are applied in file order, so a later record may overwrite an earlier one, like the
+// demo header that is rewritten when recording stops.
+#define DEMO_COMPRESSED_ID		"HL2DEMZ"
+
+struct DemoWriteTarget_t
+{
+	FileHandle_t	m_hFile;
+	bool			m_bCompress;
+	bool			m_bWriteError;		// set by the writer thread
+	int				m_nFilePos;			// writer thread only, file position of uncompressed writes
+	int				m_nPendingOps;
+};
+
+struct DemoWriteOp_t
+{
+	DemoWriteTarget_t	*m_pTarget;
+	int					m_nOffset;		// position in the uncompressed demo
+	int					m_nSize;
+	byte				*m_pData;
+	double				m_flQueueTime;
+};
+
+//-----------------------------------------------------------------------------
+// One thread writes for all open async demo buffers. It runs while at least one
+// of them is open.
+//-----------------------------------------------------------------------------
+class CDemoWriterThread : public CThread
+{
+public:
+	CDemoWriterThread();
+
+	void	AddTarget();
+	void	RemoveTarget();
+
+	// Copies the data and queues it, blocks while demo_asyncwrite_maxqueue is exceeded
+	void	Queue( DemoWriteTarget_t *pTarget, int nOffset, const void *pData, int nSize );
+
+	// Blocks until everything queued for the target is written
+	void	WaitForTarget( DemoWriteTarget_t *pTarget );
+
+	void	PrintStats();
+
+private:
+	virtual int Run();
+
+	void	WriteOp( DemoWriteOp_t &op );
+	bool	WriteCompressed( DemoWriteOp_t &op, int &nFileBytes );
+
+	// everything below is protected by m_Mutex unless noted
+	CThreadMutex					m_Mutex;
+	CUtlLinkedList<DemoWriteOp_t>	m_Queue;
+	int								m_nQueuedBytes;
+
+	CThreadEvent	m_WorkEvent;
+	CThreadEvent	m_DoneEvent;
+	volatile bool	m_bThreadShouldExit;
+	int				m_nTargets;			// main thread only
+	CUtlMemory<char> m_CompressBuffer;	// writer thread only
+
+	// stats
+	int				m_nPeakQueuedBytes;
+	int				m_nOps;
+	int64			m_nRawBytes;
+	int64			m_nFileBytes;
+	double			m_flTotalLatency;	// queued until written
+	double			m_flMaxLatency;
+	double			m_flTotalWriteTime;
+	int				m_nStalls;			// Queue calls that had to wait for the thread
+	double			m_flStallTime;
+};
+
+static CDemoWriterThread g_DemoWriterThread;
+
+
+CDemoWriterThread::CDemoWriterThread()
+{
+	SetName( "DemoWriter" );
+	m_nQueuedBytes = 0;
+	m_bThreadShouldExit = false;
+	m_nTargets = 0;
+
+	m_nPeakQueuedBytes = 0;
+	m_nOps = 0;
+	m_nRawBytes = 0;
+	m_nFileBytes = 0;
+	m_flTotalLatency = 0;
+	m_flMaxLatency = 0;
+	m_flTotalWriteTime = 0;
+	m_nStalls = 0;
+	m_flStallTime = 0;
+}
+
+void CDemoWriterThread::AddTarget()
+{
+	if ( m_nTargets++ == 0 && !IsAlive() )
+	{
+		m_bThreadShouldExit = false;
+
+		// if this fails Queue writes on the calling thread
+		Start();
+	}
+}
+
+void CDemoWriterThread::RemoveTarget()
+{
+	Assert( m_nTargets > 0 );
+
+	if ( --m_nTargets == 0 && IsAlive() )
+	{
+		m_bThreadShouldExit = true;
+		m_WorkEvent.Set();
+		Join(); // Wait for the thread to exit.
+	}
+}
+
+void CDemoWriterThread::Queue( DemoWriteTarget_t *pTarget, int nOffset, const void *pData, int nSize )
+{
+	DemoWriteOp_t op;
+	op.m_pTarget = pTarget;
+	op.m_nOffset = nOffset;
+	op.m_nSize = nSize;
+	op.m_pData = new byte[nSize];
+	op.m_flQueueTime = Plat_FloatTime();
+	Q_memcpy( op.m_pData, pData, nSize );
+
+	if ( !IsAlive() )
+	{
+		{
+			AUTO_LOCK( m_Mutex );
+			pTarget->m_nPendingOps++;
+			m_nQueuedBytes += nSize;
+		}
+		WriteOp( op );
+		return;
+	}
+
+	int nMaxQueuedBytes = demo_asyncwrite_maxqueue.GetInt() * 1024;
+	double flStallStart = 0;
+
+	for ( ;; )
+	{
+		{
+			AUTO_LOCK( m_Mutex );
+
+			// always let a single op through, even if it's bigger than the limit
+			if ( m_nQueuedBytes == 0 || m_nQueuedBytes + nSize <= nMaxQueuedBytes )
+			{
+				if ( flStallStart > 0 )
+				{
+					m_nStalls++;
+					m_flStallTime += Plat_FloatTime() - flStallStart;
+				}
+
+				m_Queue.AddToTail( op );
+				pTarget->m_nPendingOps++;
+				m_nQueuedBytes += nSize;
+				m_nPeakQueuedBytes = max( m_nPeakQueuedBytes, m_nQueuedBytes );
+				break;
+			}
+		}
+
+		// the disk can't keep up, wait for the writer thread to make room
+		if ( flStallStart == 0 )
+		{
+			flStallStart = Plat_FloatTime();
+		}
+		m_DoneEvent.Wait( 10 );
+	}
+
+	m_WorkEvent.Set();
+}
+
+void CDemoWriterThread::WaitForTarget( DemoWriteTarget_t *pTarget )
+{
+	for ( ;; )
+	{
+		{
+			AUTO_LOCK( m_Mutex );
+			if ( pTarget->m_nPendingOps == 0 )
+				return;
+		}
+
+		m_DoneEvent.Wait( 10 );
+	}
+}
+
+int CDemoWriterThread::Run()
+{
+	for ( ;; )
+	{
+		DemoWriteOp_t op;
+
+		{
+			AUTO_LOCK( m_Mutex );
+			if ( m_Queue.Count() )
+			{
+				op = m_Queue[m_Queue.Head()];
+				m_Queue.Remove( m_Queue.Head() );
+			}
+			else
+			{
+				op.m_pTarget = NULL;
+			}
+		}
+
+		if ( op.m_pTarget )
+		{
+			WriteOp( op );
+			continue;
+		}
+
+		// RemoveTarget only asks us to exit once everything is written
+		if ( m_bThreadShouldExit )
+			break;
+
+		m_WorkEvent.Wait( 100 );
+	}
+
+	return 0;
+}
+
+bool CDemoWriterThread::WriteCompressed( DemoWriteOp_t &op, int &nFileBytes )
+{
+	m_CompressBuffer.EnsureCapacity( snappy::MaxCompressedLength( op.m_nSize ) );
+
+	size_t nCompressed = 0;
+	snappy::RawCompress( (const char *)op.m_pData, op.m_nSize, m_CompressBuffer.Base(), &nCompressed );
+
+	uint32 header[3];
+	header[0] = LittleDWord( (uint32)op.m_nOffset );
+	header[1] = LittleDWord( (uint32)op.m_nSize );
+	header[2] = LittleDWord( (uint32)nCompressed );
+
+	FileHandle_t hFile = op.m_pTarget->m_hFile;
+	nFileBytes = g_pFileSystem->Write( header, sizeof( header ), hFile );
+	nFileBytes += g_pFileSystem->Write( m_CompressBuffer.Base(), nCompressed, hFile );
+
+	return nFileBytes == (int)( sizeof( header ) + nCompressed );
+}
+
+void CDemoWriterThread::WriteOp( DemoWriteOp_t &op )
+{
+	DemoWriteTarget_t *pTarget = op.m_pTarget;
+	double flStart = Plat_FloatTime();
+	int nFileBytes = 0;
+
+	// after an error there is no point in writing the rest
+	if ( !pTarget->m_bWriteError )
+	{
+		bool bOk;
+		if ( pTarget->m_bCompress )
+		{
+			bOk = WriteCompressed( op, nFileBytes );
+		}
+		else
+		{
+			if ( pTarget->m_nFilePos != op.m_nOffset )
+			{
+				g_pFileSystem->Seek( pTarget->m_hFile, op.m_nOffset, FILESYSTEM_SEEK_HEAD );
+			}
+
+			nFileBytes = g_pFileSystem->Write( op.m_pData, op.m_nSize, pTarget->m_hFile );
+			pTarget->m_nFilePos = op.m_nOffset + op.m_nSize;
+			bOk = ( nFileBytes == op.m_nSize );
+		}
+
+		if ( !bOk )
+		{
+			pTarget->m_bWriteError = true;
+		}
+	}
+
+	delete [] op.m_pData;
+
+	double flEnd = Plat_FloatTime();
+
+	{
+		AUTO_LOCK( m_Mutex );
+
+		pTarget->m_nPendingOps--;
+		m_nQueuedBytes -= op.m_nSize;
+
+		m_nOps++;
+		m_nRawBytes += op.m_nSize;
+		m_nFileBytes += nFileBytes;
+		m_flTotalLatency += flEnd - op.m_flQueueTime;
+		m_flMaxLatency = max( m_flMaxLatency, flEnd - op.m_flQueueTime );
+		m_flTotalWriteTime += flEnd - flStart;
+	}
+
+	m_DoneEvent.Set();
+}
+
+void CDemoWriterThread::PrintStats()
+{
+	AUTO_LOCK( m_Mutex );
+
+	ConMsg( "Demo writer: thread %s, %d open demo(s)\n", IsAlive() ? "running" : "stopped", m_nTargets );
+	ConMsg( "  queued:  %d KB now, %d KB peak, %d KB limit\n",
+		m_nQueuedBytes / 1024, m_nPeakQueuedBytes / 1024, demo_asyncwrite_maxqueue.GetInt() );
+	ConMsg( "  written: %d chunks, %lld KB demo data, %lld KB to disk\n",
+		m_nOps, m_nRawBytes / 1024, m_nFileBytes / 1024 );
+
+	if ( m_nOps > 0 )
+	{
+		ConMsg( "  latency: %.2f ms avg, %.2f ms max (queued to written), %.2f ms avg write\n",
+			1000.0 * m_flTotalLatency / m_nOps, 1000.0 * m_flMaxLatency, 1000.0 * m_flTotalWriteTime / m_nOps );
+	}
+
+	ConMsg( "  stalls:  %d, %.2f ms total\n", m_nStalls, 1000.0 * m_flStallTime );
+}
+
+CON_COMMAND( demo_writer_stats, "Print statistics of the demo writer thread." )
+{
+	g_DemoWriterThread.PrintStats();
+}
+
+
+//-----------------------------------------------------------------------------
+// CDemoAsyncWriteBuffer
+//-----------------------------------------------------------------------------
+CDemoAsyncWriteBuffer::CDemoAsyncWriteBuffer( const char *pFileName, bool bCompress ) :
+	BaseClass( DEMO_WRITE_CHUNK_SIZE, DEMO_WRITE_CHUNK_SIZE, 0 )
+{
+	SetUtlBufferOverflowFuncs( &CDemoAsyncWriteBuffer::AsyncGetOverflow, &CDemoAsyncWriteBuffer::AsyncPutOverflow );
+	m_pTarget = NULL;
+
+	FileHandle_t hFile = g_pFileSystem->Open( pFileName, "wb" );
+	if ( hFile == FILESYSTEM_INVALID_HANDLE )
+	{
+		m_Error |= FILE_OPEN_ERROR;
+		return;
+	}
+
+	if ( bCompress )
+	{
+		g_pFileSystem->Write( DEMO_COMPRESSED_ID, sizeof( DEMO_COMPRESSED_ID ), hFile );
+	}
+
+	m_pTarget = new DemoWriteTarget_t;
+	m_pTarget->m_hFile = hFile;
+	m_pTarget->m_bCompress = bCompress;
+	m_pTarget->m_bWriteError = false;
+	m_pTarget->m_nFilePos = 0;
+	m_pTarget->m_nPendingOps = 0;
+
+	g_DemoWriterThread.AddTarget();
+}
+
+CDemoAsyncWriteBuffer::~CDemoAsyncWriteBuffer()
+{
+	Close();
+}
+
+void CDemoAsyncWriteBuffer::Close()
+{
+	if ( !m_pTarget )
+		return;
+
+	QueueBytes();
+
+	g_DemoWriterThread.WaitForTarget( m_pTarget );
+	g_DemoWriterThread.RemoveTarget();
+
+	if ( m_pTarget->m_bWriteError )
+	{
+		Warning( "CDemoAsyncWriteBuffer::Close: writing demo failed, the file is incomplete.\n" );
+	}
+
+	g_pFileSystem->Close( m_pTarget->m_hFile );
+
+	delete m_pTarget;
+	m_pTarget = NULL;
+}
+
+void CDemoAsyncWriteBuffer::QueueBytes()
+{
+	int nBytesToWrite = TellPut() - m_nOffset;
+	if ( nBytesToWrite > 0 )
+	{
+		g_DemoWriterThread.Queue( m_pTarget, m_nOffset, Base(), nBytesToWrite );
+	}
+	m_nOffset = TellPut();
+}
+
+bool CDemoAsyncWriteBuffer::AsyncPutOverflow( int nSize )
+{
+	if ( !IsValid() || !m_pTarget )
+		return false;
+
+	// errors come back from the writer thread one chunk late
+	if ( m_pTarget->m_bWriteError )
+	{
+		m_Error |= FILE_WRITE_ERROR;
+		return false;
+	}
+
+	// Make sure the allocated size is at least as big as the requested size
+	if ( nSize > 0 && Size() < nSize + 1 )
+	{
+		m_Memory.Grow( nSize + 1 - Size() );
+	}
+
+	// Unlike CUtlStreamBuffer every byte is handed off, including the last one
+	// before a seek. Demo buffers are binary, nothing peeks behind the put position.
+	QueueBytes();
+
+	if ( nSize < 0 )
+	{
+		// SeekPut, the next bytes go to the new position
+		m_nOffset = -nSize-1;
+	}
+
+	return true;
+}
+
+bool CDemoAsyncWriteBuffer::AsyncGetOverflow( int nSize )
+{
+	// write only
+	return false;
+}
+
+
+//-----------------------------------------------------------------------------
+// Reading compressed demos
+//-----------------------------------------------------------------------------
+bool DemoFile_IsCompressed( const char *pFileName )
+{
+	FileHandle_t hFile = g_pFileSystem->Open( pFileName, "rb" );
+	if ( hFile == FILESYSTEM_INVALID_HANDLE )
+		return false;
+
+	char id[sizeof( DEMO_COMPRESSED_ID )];
+	bool bCompressed = g_pFileSystem->Read( id, sizeof( id ), hFile ) == sizeof( id ) &&
+		!Q_memcmp( id, DEMO_COMPRESSED_ID, sizeof( id ) );
+
+	g_pFileSystem->Close( hFile );
+	return bCompressed;
+}
+
+bool DemoFile_ReadCompressed( const char *pFileName, CUtlBuffer &buf )
+{
+	CUtlBuffer fileBuf;
+	if ( !g_pFileSystem->ReadFile( pFileName, NULL, fileBuf ) )
+		return false;
+
+	fileBuf.SeekGet( CUtlBuffer::SEEK_HEAD, sizeof( DEMO_COMPRESSED_ID ) );
+
+	CUtlMemory<char> uncompressed;
+
+	while ( fileBuf.GetBytesRemaining() > 0 )
+	{
+		uint32 header[3];
+		fileBuf.Get( header, sizeof( header ) );
+
+		int nOffset = (int)LittleDWord( header[0] );
+		int nSize = (int)LittleDWord( header[1] );
+		int nCompressed = (int)LittleDWord( header[2] );
+
+		// a demo that wasn't closed properly ends in a partial record, keep what we have
+		if ( !fileBuf.IsValid() || nCompressed > fileBuf.GetBytesRemaining() || nOffset > buf.TellMaxPut() )
+		{
+			Warning( "DemoFile_ReadCompressed: %s is truncated.\n", pFileName );
+			break;
+		}
+
+		uncompressed.EnsureCapacity( nSize );
+
+		size_t nUncompressed = 0;
+		const char *pCompressed = (const char *)fileBuf.PeekGet();
+		if ( !snappy::GetUncompressedLength( pCompressed, nCompressed, &nUncompressed ) ||
+			(int)nUncompressed != nSize ||
+			!snappy::RawUncompress( pCompressed, nCompressed, uncompressed.Base() ) )
+		{
+			Warning( "DemoFile_ReadCompressed: %s is corrupt.\n", pFileName );
+			return false;
+		}
+
+		fileBuf.SeekGet( CUtlBuffer::SEEK_CURRENT, nCompressed );
+
+		buf.SeekPut( CUtlBuffer::SEEK_HEAD, nOffset );
+		buf.Put( uncompressed.Base(), nSize );
+	}
+
+	// leave the put position at the end, like a file read into a buffer
+	buf.SeekPut( CUtlBuffer::SEEK_TAIL, 0 );
+	return true;
+}
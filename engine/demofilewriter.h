@@ -0,0 +1,61 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Demo file buffer that hands its data to a background thread for
+//			writing, optionally snappy compressed.
+//
+//===========================================================================//
+
+#ifndef DEMOFILEWRITER_H
+#define DEMOFILEWRITER_H
+#ifdef _WIN32
+#pragma once
+#endif
+
+#include "tier1/utlbuffer.h"
+
+class ConVar;
+struct DemoWriteTarget_t;
+
+//-----------------------------------------------------------------------------
+// Write only CUtlBuffer, used like CUtlStreamBuffer. Filled chunks go to the
+// demo writer thread instead of being written on the calling thread.
+//-----------------------------------------------------------------------------
+class CDemoAsyncWriteBuffer : public CUtlBuffer
+{
+	typedef CUtlBuffer BaseClass;
+
+public:
+	CDemoAsyncWriteBuffer( const char *pFileName, bool bCompress );
+	~CDemoAsyncWriteBuffer();
+
+	// Queues the remaining bytes and waits until everything is written
+	void Close();
+
+private:
+	// error flags
+	enum
+	{
+		FILE_OPEN_ERROR = MAX_ERROR_FLAG << 1,
+		FILE_WRITE_ERROR = MAX_ERROR_FLAG << 2,
+	};
+
+	// Overflow functions
+	bool AsyncPutOverflow( int nSize );
+	bool AsyncGetOverflow( int nSize );
+
+	// Hands the bytes between m_nOffset and the put position to the writer thread
+	void QueueBytes();
+
+	DemoWriteTarget_t	*m_pTarget;
+};
+
+// Returns true if the file was written with demo_compress
+bool DemoFile_IsCompressed( const char *pFileName );
+
+// Decodes a compressed demo into buf, which then reads like the uncompressed file
+bool DemoFile_ReadCompressed( const char *pFileName, CUtlBuffer &buf );
+
+extern ConVar demo_asyncwrite;
+extern ConVar demo_compress;
+
+#endif // DEMOFILEWRITER_H
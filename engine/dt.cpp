@@ -434,6 +434,20 @@ bool CSendTablePrecalc::SetupFlatPropertyArray()
 	m_DatatableProps.CopyArray( bhs.m_pDatatableProps, bhs.m_nDatatableProps );
 	m_PropProxyIndices.CopyArray( bhs.m_PropProxyIndices, bhs.m_nProps );
 
+	// Find the runs of plain floats that share a proxy so they can be quantized together.
+	m_FloatRunLengths.SetCount( bhs.m_nProps );
+	for ( int i=bhs.m_nProps-1; i >= 0; i-- )
+	{
+		int nRun = 0;
+		if ( m_Props[i]->m_Type == DPT_Float && Float_CanBatchEncode( m_Props[i] ) )
+		{
+			nRun = 1;
+			if ( i+1 < bhs.m_nProps && m_PropProxyIndices[i+1] == m_PropProxyIndices[i] )
+				nRun += m_FloatRunLengths[i+1];
+		}
+		m_FloatRunLengths[i] = (unsigned char)MIN( nRun, 255 );
+	}
+
 	// Assign the datatable proxy indices.
 	SetNumDataTableProxies( 0 );
 	SetDataTableProxyIndices_R( this, GetRootNode(), &bhs );
@@ -169,6 +169,9 @@ public:
 	// Write the next property index. Returns the number of bits used.
 	void		WritePropIndex( int iProp );
 
+	// Write the index followed by nBits of data, in a single write when they fit in 32 bits.
+	void		WritePropIndexAndUBits( int iProp, unsigned int data, int nBits );
+
 	// Access the buffer it's outputting to.
 	bf_write*	GetBitBuf();
 
@@ -202,6 +205,27 @@ FORCEINLINE void CDeltaBitsWriter::WritePropIndex( int iProp )
 	m_pBuf->WriteUBitLong( diff*8 - 8 + 4 + n*2 + 1, 8 + n*4 + 4 + 2 + 1 );
 }
 
+FORCEINLINE void CDeltaBitsWriter::WritePropIndexAndUBits( int iProp, unsigned int data, int nBits )
+{
+	Assert( iProp >= 0 && iProp < MAX_DATATABLE_PROPS );
+	unsigned int diff = iProp - m_iLastProp;
+	m_iLastProp = iProp;
+	Assert( diff > 0 && diff <= MAX_DATATABLE_PROPS );
+	// Same encoding as WritePropIndex.
+	int n = ((diff < 0x11u) ? -1 : 0) + ((diff < 0x101u) ? -1 : 0);
+	unsigned int index = diff*8 - 8 + 4 + n*2 + 1;
+	int nIndexBits = 8 + n*4 + 4 + 2 + 1;
+	if ( nIndexBits + nBits <= 32 )
+	{
+		m_pBuf->WriteUBitLong( index | ( data << nIndexBits ), nIndexBits + nBits );
+	}
+	else
+	{
+		m_pBuf->WriteUBitLong( index, nIndexBits );
+		m_pBuf->WriteUBitLong( data, nBits );
+	}
+}
+
 inline CDeltaBitsWriter::~CDeltaBitsWriter()
 {
 	m_pBuf->WriteOneBit( 0 );
@@ -386,6 +410,10 @@ public:
 
 	// Each datatable in a SendTable's tree gets a proxy index, and its properties reference that.
 	CUtlVector<unsigned char> m_PropProxyIndices;
+
+	// For each prop, how many consecutive props starting with it are plain quantized floats
+	// under the same proxy (capped at 255). SendTable_Encode quantizes these runs together.
+	CUtlVector<unsigned char> m_FloatRunLengths;
 	
 	// CSendNode::m_iDatatableProp indexes this.
 	// These are the datatable properties (SendPropDataTable).
@@ -9,6 +9,7 @@
 #include "dt.h"
 #include "dt_encode.h"
 #include "coordsize.h"
+#include "mathlib/ssemath.h"
 
 // memdbgon must be the last include file in a .cpp file!!!
 #include "tier0/memdbgon.h"
@@ -97,6 +98,70 @@ static inline void EncodeFloat( const SendProp *pProp, float fVal, bf_write *pOu
 }
 
 
+bool Float_CanBatchEncode( const SendProp *pProp )
+{
+	if ( pProp->m_Type != DPT_Float && pProp->m_Type != DPT_Vector )
+		return false;
+
+	const int nSpecialFlags = SPROP_COORD | SPROP_COORD_MP | SPROP_COORD_MP_LOWPRECISION | SPROP_COORD_MP_INTEGRAL | SPROP_NOSCALE | SPROP_NORMAL;
+	if ( pProp->GetFlags() & nSpecialFlags )
+		return false;
+
+	// Keep the quantized value inside a signed int for the SIMD conversion, and small enough
+	// that a one-prop index step and the value fit in a single 32-bit write.
+	return pProp->m_nBits > 0 && pProp->m_nBits <= 25;
+}
+
+
+uint32 Float_QuantizeBatch( const SendProp * const *ppProps, const float *pValues, int nValues, uint32 *pOut )
+{
+	Assert( nValues <= FLOAT_ENCODE_BATCH_SIZE );
+
+	uint32 outOfRange = 0;
+	for ( int i=0; i < nValues; i += 4 )
+	{
+		int nLanes = MIN( nValues - i, 4 );
+
+		// Gather the ranges. Unused lanes quantize 0 in [0,0] and are ignored.
+		ALIGN16 float flValues[4] ALIGN16_POST = { 0, 0, 0, 0 };
+		ALIGN16 float flLow[4] ALIGN16_POST = { 0, 0, 0, 0 };
+		ALIGN16 float flHigh[4] ALIGN16_POST = { 0, 0, 0, 0 };
+		ALIGN16 float flMul[4] ALIGN16_POST = { 0, 0, 0, 0 };
+		for ( int iLane=0; iLane < nLanes; iLane++ )
+		{
+			const SendProp *pProp = ppProps[i+iLane];
+			flValues[iLane] = pValues[i+iLane];
+			flLow[iLane] = pProp->m_fLowValue;
+			flHigh[iLane] = pProp->m_fHighValue;
+			flMul[iLane] = pProp->m_fHighLowMul;
+		}
+
+		fltx4 val = LoadAlignedSIMD( flValues );
+		fltx4 low = LoadAlignedSIMD( flLow );
+		fltx4 high = LoadAlignedSIMD( flHigh );
+
+		fltx4 clamped = OrSIMD( CmpLtSIMD( val, low ), CmpGtSIMD( val, high ) );
+		outOfRange |= ( (uint32)TestSignSIMD( clamped ) & ( ( 1u << nLanes ) - 1 ) ) << i;
+
+		// Same math and rounding as EncodeFloat / RoundFloatToUnsignedLong.
+		fltx4 rangeVal = MulSIMD( SubSIMD( val, low ), LoadAlignedSIMD( flMul ) );
+		ALIGN16 uint32 quantized[4] ALIGN16_POST;
+#if defined( _X360 )
+		for ( int iLane=0; iLane < nLanes; iLane++ )
+			quantized[iLane] = RoundFloatToUnsignedLong( SubFloat( rangeVal, iLane ) );
+#elif defined( __arm__ ) || defined( __aarch64__ )
+		_mm_store_si128( (__m128i*)quantized, _mm_cvttps_epi32( AddSIMD( rangeVal, Four_PointFives ) ) );
+#else
+		_mm_store_si128( (__m128i*)quantized, _mm_cvtps_epi32( rangeVal ) );
+#endif
+		for ( int iLane=0; iLane < nLanes; iLane++ )
+			pOut[i+iLane] = quantized[iLane];
+	}
+
+	return outOfRange;
+}
+
+
 // Look for special flags like SPROP_COORD, SPROP_NOSCALE, and SPROP_NORMAL and
 // decode if they're there. Fills in fVal and returns true if it decodes anything.
 static inline bool DecodeSpecialFloat( SendProp const *pProp, bf_read *pIn, float &fVal )
@@ -552,6 +617,33 @@ void Float_SkipProp( const SendProp *pProp, bf_read *pIn )
 
 void Vector_Encode( const unsigned char *pStruct, DVariant *pVar, const SendProp *pProp, bf_write *pOut, int objectID )
 {
+	// Plain quantized vectors: do all three components at once and write them in one go.
+	if ( Float_CanBatchEncode( pProp ) )
+	{
+		const SendProp *props[3] = { pProp, pProp, pProp };
+		uint32 quantized[3];
+		if ( !Float_QuantizeBatch( props, pVar->m_Vector, 3, quantized ) )
+		{
+			int nBits = pProp->m_nBits;
+			if ( nBits*3 <= 32 )
+			{
+				pOut->WriteUBitLong( quantized[0] | ( quantized[1] << nBits ) | ( quantized[2] << ( nBits*2 ) ), nBits*3 );
+			}
+			else if ( nBits*2 <= 32 )
+			{
+				pOut->WriteUBitLong( quantized[0] | ( quantized[1] << nBits ), nBits*2 );
+				pOut->WriteUBitLong( quantized[2], nBits );
+			}
+			else
+			{
+				pOut->WriteUBitLong( quantized[0], nBits );
+				pOut->WriteUBitLong( quantized[1], nBits );
+				pOut->WriteUBitLong( quantized[2], nBits );
+			}
+			return;
+		}
+	}
+
 	EncodeFloat(pProp, pVar->m_Vector[0], pOut, objectID);
 	EncodeFloat(pProp, pVar->m_Vector[1], pOut, objectID);
 	// Don't write out the third component for normals
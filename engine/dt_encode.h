@@ -86,6 +86,19 @@ typedef struct
 extern PropTypeFns g_PropTypeFns[DPT_NUMSendPropTypes];
 
 
+// Max number of floats Float_QuantizeBatch handles in one call (one bit each in its return value).
+#define FLOAT_ENCODE_BATCH_SIZE	32
+
+// Returns true if this is a plain range-quantized float (no coord, noscale or normal encoding)
+// that Float_QuantizeBatch can encode.
+bool	Float_CanBatchEncode( const SendProp *pProp );
+
+// Quantizes nValues floats four at a time, using ppProps[i]'s range for pValues[i], and stores
+// the bits to write in pOut. Returns a mask of the values that are out of range; those must be
+// written with the scalar encoder so they get clamped and warned about.
+uint32	Float_QuantizeBatch( const SendProp * const *ppProps, const float *pValues, int nValues, uint32 *pOut );
+
+
 // This is used for comparing packed buffers. Just extracts the raw bits for the 
 // data and returns the number of bits used to encode the data.
 int	DecodeBits( DecodeInfo *pInfo, unsigned char *pOut );
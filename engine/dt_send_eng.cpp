@@ -239,11 +239,9 @@ CRC32_t	g_SendTableCRC = 0;
 // SendTable functions.
 // ------------------------------------------------------------------------ //
 
-static bool s_debug_info_shown = false;
-static int  s_debug_bits_start = 0;
-
-
-static inline void ShowEncodeDeltaWatchInfo( 
+// Returns true if the prop was shown. Snapshots can be written from several
+// threads, so the caller keeps track of that rather than a static.
+static inline bool ShowEncodeDeltaWatchInfo( 
 	const SendTable *pTable,
 	const SendProp *pProp, 
 	bf_read &buffer,
@@ -251,7 +249,7 @@ static inline void ShowEncodeDeltaWatchInfo(
 	const int index )
 {
 	if ( !ShouldWatchThisProp( pTable, objectID, pProp->GetName()) )
-		return;
+		return false;
 	
 	static int lastframe = -1;
 	if ( host_framecount != lastframe )
@@ -263,8 +261,6 @@ static inline void ShowEncodeDeltaWatchInfo(
 	// work on copy of bitbuffer
 	bf_read copy = buffer;
 
-	s_debug_info_shown = true;
-
 	DecodeInfo info;
 	info.m_pStruct = NULL;
 	info.m_pData = NULL;
@@ -283,6 +279,7 @@ static inline void ShowEncodeDeltaWatchInfo(
 	const char *value = info.m_Value.ToString();
 
 	ConDMsg( "+ %s %s, %s, index %i, bits %i, value %s\n", pTable->GetName(), pProp->GetName(), type, index, bits, value );
+	return true;
 }
 
 
@@ -316,6 +313,71 @@ static FORCEINLINE void SendTable_EncodeProp( CEncodeInfo * pInfo, unsigned long
 }
 
 
+// Encodes a run of plain float props that share a struct base (see m_FloatRunLengths).
+// The proxies are called for the whole run, the values are quantized together, and each
+// index is written with its value. Returns the number of props consumed.
+static int SendTable_EncodeFloatRun( CEncodeInfo *pInfo, int iFirstProp, int nRun, bool bNonZeroOnly )
+{
+	nRun = MIN( nRun, FLOAT_ENCODE_BATCH_SIZE );
+
+	CSendTablePrecalc *pPrecalc = pInfo->m_pPrecalc;
+	pInfo->SeekToProp( iFirstProp );
+	unsigned char *pStructBase = pInfo->GetCurStructBase();
+
+	const SendProp *props[FLOAT_ENCODE_BATCH_SIZE];
+	float values[FLOAT_ENCODE_BATCH_SIZE];
+	int indices[FLOAT_ENCODE_BATCH_SIZE];
+	int nValues = 0;
+
+	for ( int i=0; i < nRun; i++ )
+	{
+		const SendProp *pProp = pPrecalc->GetProp( iFirstProp + i );
+
+		DVariant var;
+		pProp->GetProxyFn()( 
+			pProp,
+			pStructBase, 
+			pStructBase + pProp->GetOffset(), 
+			&var, 
+			0, // iElement
+			pInfo->GetObjectID()
+			);
+
+		// skip empty prop if we only encode non-zero values
+		if ( bNonZeroOnly && g_PropTypeFns[DPT_Float].IsZero( pStructBase, &var, pProp ) )
+			continue;
+
+		props[nValues] = pProp;
+		values[nValues] = var.m_Float;
+		indices[nValues] = iFirstProp + i;
+		nValues++;
+	}
+
+	uint32 quantized[FLOAT_ENCODE_BATCH_SIZE];
+	uint32 outOfRange = Float_QuantizeBatch( props, values, nValues, quantized );
+
+	for ( int i=0; i < nValues; i++ )
+	{
+		if ( outOfRange & ( 1u << i ) )
+		{
+			// Let the scalar encoder clamp it and warn.
+			DVariant var;
+			var.m_Type = DPT_Float;
+			var.m_Float = values[i];
+			pInfo->m_DeltaBitsWriter.WritePropIndex( indices[i] );
+			g_PropTypeFns[DPT_Float].Encode( pStructBase, &var, props[i], pInfo->m_DeltaBitsWriter.GetBitBuf(), pInfo->GetObjectID() );
+		}
+		else
+		{
+			pInfo->m_DeltaBitsWriter.WritePropIndexAndUBits( indices[i], quantized[i], props[i]->m_nBits );
+		}
+	}
+
+	pInfo->SeekToProp( iFirstProp + nRun - 1 );
+	return nRun;
+}
+
+
 static bool SendTable_IsPropZero( CEncodeInfo *pInfo, unsigned long iProp )
 {
 	const SendProp *pProp = pInfo->GetCurProp();
@@ -437,6 +499,14 @@ bool SendTable_Encode(
 		if ( !info.IsPropProxyValid( iProp ) )
 			continue;
 
+		// runs of plain floats are quantized together
+		int nFloatRun = pPrecalc->m_FloatRunLengths[iProp];
+		if ( nFloatRun > 1 )
+		{
+			iProp += SendTable_EncodeFloatRun( &info, iProp, nFloatRun, bNonZeroOnly ) - 1;
+			continue;
+		}
+
 		info.SeekToProp( iProp );
         
 		// skip empty prop if we only encode non-zero values
@@ -469,8 +539,8 @@ void SendTable_WritePropList(
 
 	bool bDebugWatch = Sendprop_UsingDebugWatch();
 
-	s_debug_info_shown = false;
-	s_debug_bits_start = pOut->GetNumBitsWritten();
+	bool bDebugInfoShown = false;
+	int nDebugBitsStart = pOut->GetNumBitsWritten();
 	
 	CSendTablePrecalc *pPrecalc = pTable->m_pPrecalc;
 	CDeltaBitsWriter deltaBitsWriter( pOut );
@@ -502,7 +572,7 @@ void SendTable_WritePropList(
 			// Show debug stuff.
 			if ( bDebugWatch )
 			{
-				ShowEncodeDeltaWatchInfo( pTable, pProp, inputBuffer, objectID, iToProp );
+				bDebugInfoShown |= ShowEncodeDeltaWatchInfo( pTable, pProp, inputBuffer, objectID, iToProp );
 			}
 
 			// See how many bits the data for this property takes up.
@@ -523,9 +593,9 @@ void SendTable_WritePropList(
 		++i;
 	}
 
-	if ( s_debug_info_shown )
+	if ( bDebugInfoShown )
 	{
-		int  bits = pOut->GetNumBitsWritten() - s_debug_bits_start;
+		int  bits = pOut->GetNumBitsWritten() - nDebugBitsStart;
 		ConDMsg( "= %i bits (%i bytes)\n", bits, Bits2Bytes(bits) );
 	}
 
@@ -28,6 +28,8 @@
 #include "mathlib/polyhedron.h"
 #include "sys_dll.h"
 #include "vphysics/virtualmesh.h"
+#include "vstdlib/jobthread.h"
+#include "vstdlib/random.h"
 
 // memdbgon must be the last include file in a .cpp file!!!
 #include "tier0/memdbgon.h"
@@ -70,7 +72,7 @@ static CUtlVector<Ray_t> s_BenchmarkRays;
 abstract_class CEngineTrace : public IEngineTrace
 {
 public:
-	CEngineTrace() { m_pRootMoveParent = NULL; }
+	CEngineTrace() {}
 	// Returns the contents mask at a particular world-space position
 	virtual int		GetPointContents( const Vector &vecAbsPosition, IHandleEntity** ppEntity );
 
@@ -125,6 +127,12 @@ public:
 	// Walks bsp to find the leaf containing the specified point
 	virtual int GetLeafContainingPoint( const Vector &ptTest );
 
+	// Traces a batch of rays
+	virtual void	TraceRays( int nRays, const Ray_t *pRays, unsigned int fMask, ITraceFilter *pTraceFilter, trace_t *pTraces );
+
+	virtual void	BeginConcurrentTraces();
+	virtual void	EndConcurrentTraces();
+
 private:
 	// FIXME: Different versions for client + server. Eventually we need to make these go away
 	virtual void SetTraceEntity( ICollideable *pCollideable, trace_t *pTrace ) = 0;
@@ -158,9 +166,16 @@ private:
 
 	// Clips a trace to another trace
 	bool ClipTraceToTrace( trace_t &clipTrace, trace_t *pFinalTrace );
+
+	// Shared by TraceRay and TraceRays: shortens the entity ray to the world trace,
+	// filters the entities, and puts the fractions back relative to the whole ray
+	void ClipEntityRayToWorld( const Ray_t &ray, trace_t *pTrace, Ray_t *pEntityRay, float *pWorldFraction, float *pWorldFractionLeftSolidScale );
+	bool ShouldClipRayToEntity( IHandleEntity *pHandleEntity, ICollideable *pCollideable, const char *pDebugName, unsigned int fMask, ITraceFilter *pTraceFilter, TraceType_t traceType );
+	void FinishEntityTrace( const Ray_t &ray, float flWorldFraction, float flWorldFractionLeftSolidScale, trace_t *pTrace );
 private:
 	int m_traceStatCounters[NUM_TRACE_STAT_COUNTER];
-	const matrix3x4_t *m_pRootMoveParent;
+	// Per thread, traces can run concurrently (see BeginConcurrentTraces)
+	CTHREADLOCALPTR( matrix3x4_t ) m_pRootMoveParent;
 	friend void RayBench( const CCommand &args );
 
 };
@@ -197,12 +212,18 @@ public:
 //-----------------------------------------------------------------------------
 // Expose CVEngineServer to the game + client DLLs
 //-----------------------------------------------------------------------------
+// Version 3 is version 4 without the methods added at the end of the vtable,
+// so the same objects serve DLLs built against it
+typedef IEngineTrace IEngineTrace003;
+
 static CEngineTraceServer	s_EngineTraceServer;
 EXPOSE_SINGLE_INTERFACE_GLOBALVAR(CEngineTraceServer, IEngineTrace, INTERFACEVERSION_ENGINETRACE_SERVER, s_EngineTraceServer);
+EXPOSE_SINGLE_INTERFACE_GLOBALVAR(CEngineTraceServer, IEngineTrace003, INTERFACEVERSION_ENGINETRACE_SERVER_VERSION_3, s_EngineTraceServer);
 
 #ifndef SWDS
 static CEngineTraceClient	s_EngineTraceClient;
 EXPOSE_SINGLE_INTERFACE_GLOBALVAR(CEngineTraceClient, IEngineTrace, INTERFACEVERSION_ENGINETRACE_CLIENT, s_EngineTraceClient);
+EXPOSE_SINGLE_INTERFACE_GLOBALVAR(CEngineTraceClient, IEngineTrace003, INTERFACEVERSION_ENGINETRACE_CLIENT_VERSION_3, s_EngineTraceClient);
 #endif
 
 //-----------------------------------------------------------------------------
@@ -934,19 +955,20 @@ bool CEngineTrace::ClipRayToBBox( const Ray_t &ray, unsigned int fMask, ICollide
 	VectorAligned vecAbsMins, vecAbsMaxs;
 	VectorAligned vecInvDelta;
 	// NOTE: If m_pRootMoveParent is set, then the boxes should be rotated into the root parent's space
-	if ( !ray.m_IsRay && m_pRootMoveParent )
+	const matrix3x4_t *pRootMoveParent = m_pRootMoveParent;
+	if ( !ray.m_IsRay && pRootMoveParent )
 	{
 		Ray_t ray_l;
 
 		ray_l.m_Extents = ray.m_Extents;
 
-		VectorIRotate( ray.m_Delta, *m_pRootMoveParent, ray_l.m_Delta );
+		VectorIRotate( ray.m_Delta, *pRootMoveParent, ray_l.m_Delta );
 		ray_l.m_StartOffset.Init();
-		VectorITransform( ray.m_Start, *m_pRootMoveParent, ray_l.m_Start );
+		VectorITransform( ray.m_Start, *pRootMoveParent, ray_l.m_Start );
 
 		vecInvDelta = ray_l.InvDelta();
 		Vector localEntityOrigin;
-		VectorITransform( pEntity->GetCollisionOrigin(), *m_pRootMoveParent, localEntityOrigin );
+		VectorITransform( pEntity->GetCollisionOrigin(), *pRootMoveParent, localEntityOrigin );
 		ray_l.m_IsRay = ray.m_IsRay;
 		ray_l.m_IsSwept = ray.m_IsSwept;
 
@@ -958,7 +980,7 @@ bool CEngineTrace::ClipRayToBBox( const Ray_t &ray, unsigned int fMask, ICollide
 		{
 			Vector temp;
 			VectorCopy (pTrace->plane.normal, temp);
-			VectorRotate( temp, *m_pRootMoveParent, pTrace->plane.normal );
+			VectorRotate( temp, *pRootMoveParent, pTrace->plane.normal );
 			VectorAdd( ray.m_Start, ray.m_StartOffset, pTrace->startpos );
 
 			if (pTrace->fraction == 1)
@@ -1080,7 +1102,7 @@ void CEngineTrace::ClipRayToCollideable( const Ray_t &ray, unsigned int fMask, I
 	const matrix3x4_t *pOldRoot = m_pRootMoveParent;
 	if ( pEntity->GetSolidFlags() & FSOLID_ROOT_PARENT_ALIGNED )
 	{
-		m_pRootMoveParent = pEntity->GetRootParentToWorldTransform();
+		m_pRootMoveParent = const_cast<matrix3x4_t *>( pEntity->GetRootParentToWorldTransform() );
 	}
 	bool bTraced = false;
 	bool bCustomPerformed = false;
@@ -1150,7 +1172,7 @@ void CEngineTrace::ClipRayToCollideable( const Ray_t &ray, unsigned int fMask, I
 	VectorMA( vecOffset, pTrace->fraction, ray.m_Delta, vecEndTest );
 	Assert( VectorsAreEqual( vecEndTest, pTrace->endpos, 0.1f ) );
 #endif
-	m_pRootMoveParent = pOldRoot;
+	m_pRootMoveParent = const_cast<matrix3x4_t *>( pOldRoot );
 }
 
 
@@ -1225,6 +1247,21 @@ public:
 	IHandleEntity	*m_EntityHandles[MAX_ENTITIES_ALONGRAY];
 };
 
+//-----------------------------------------------------------------------------
+// Enumerator class for TraceRays, has no limit on the number of entities
+//-----------------------------------------------------------------------------
+class CEntityListInBatch : public IPartitionEnumerator
+{
+public:
+	IterationRetval_t EnumElement( IHandleEntity *pHandleEntity )
+	{
+		m_EntityHandles.AddToTail( pHandleEntity );
+		return ITERATION_CONTINUE;
+	}
+
+	CUtlVectorFixedGrowable< IHandleEntity *, 256 > m_EntityHandles;
+};
+
 //-----------------------------------------------------------------------------
 // Makes sure the final trace is clipped to the clip trace
 // Returns true if clipping occurred
@@ -1720,35 +1757,11 @@ void CEngineTrace::TraceRay( const Ray_t &ray, unsigned int fMask, ITraceFilter
 		VectorAdd( pTrace->startpos, ray.m_Delta, pTrace->endpos );
 	}
 
-	// Save the world collision fraction.
-	float flWorldFraction = pTrace->fraction;
-	float flWorldFractionLeftSolidScale = flWorldFraction;
-
 	// Create a ray that extends only until we hit the world
 	// and adjust the trace accordingly
-	Ray_t entityRay = ray;
-
-	if ( pTrace->fraction == 0 )
-	{
-		entityRay.m_Delta.Init();
-		flWorldFractionLeftSolidScale = pTrace->fractionleftsolid;
-		pTrace->fractionleftsolid = 1.0f;
-		pTrace->fraction = 1.0f;
-	}
-	else
-	{
-		// Explicitly compute end so that this computation happens at the quantization of
-		// the output (endpos).  That way we won't miss any intersections we would get
-		// by feeding these results back in to the tracer
-		// This is not the same as entityRay.m_Delta *= pTrace->fraction which happens 
-		// at a quantization that is more precise as m_Start moves away from the origin
-		Vector end;
-		VectorMA( entityRay.m_Start, pTrace->fraction, entityRay.m_Delta, end );
-		VectorSubtract(end, entityRay.m_Start, entityRay.m_Delta);
-		// We know this is safe because pTrace->fraction != 0
-		pTrace->fractionleftsolid /= pTrace->fraction;
-		pTrace->fraction = 1.0;
-	}
+	Ray_t entityRay;
+	float flWorldFraction, flWorldFractionLeftSolidScale;
+	ClipEntityRayToWorld( ray, pTrace, &entityRay, &flWorldFraction, &flWorldFractionLeftSolidScale );
 
 	// Collide with entities along the ray
 	// FIXME: Hitbox code causes this to be re-entrant for the IK stuff.
@@ -1758,8 +1771,7 @@ void CEngineTrace::TraceRay( const Ray_t &ray, unsigned int fMask, ITraceFilter
 	enumerator.Reset();
 	SpatialPartition()->EnumerateElementsAlongRay( SpatialPartitionMask(), entityRay, false, &enumerator );
 
-	bool bNoStaticProps = pTraceFilter->GetTraceType() == TRACE_ENTITIES_ONLY;
-	bool bFilterStaticProps = pTraceFilter->GetTraceType() == TRACE_EVERYTHING_FILTER_PROPS;
+	TraceType_t traceType = pTraceFilter->GetTraceType();
 
 	trace_t tr;
 	ICollideable *pCollideable;
@@ -1771,33 +1783,8 @@ void CEngineTrace::TraceRay( const Ray_t &ray, unsigned int fMask, ITraceFilter
 		IHandleEntity *pHandleEntity = enumerator.m_EntityHandles[i];
 		HandleEntityToCollideable( pHandleEntity, &pCollideable, &pDebugName );
 
-		// Check for error condition
-		if ( IsPC() && IsDebug() && !IsSolid( pCollideable->GetSolid(), pCollideable->GetSolidFlags() ) )
-		{
-			Assert( 0 );
-			Msg( "%s in solid list (not solid)\n", pDebugName );
+		if ( !ShouldClipRayToEntity( pHandleEntity, pCollideable, pDebugName, fMask, pTraceFilter, traceType ) )
 			continue;
-		}
-
-		if ( !StaticPropMgr()->IsStaticProp( pHandleEntity ) )
-		{
-			if ( !pTraceFilter->ShouldHitEntity( pHandleEntity, fMask ) )
-				continue;
-		}
-		else
-		{
-			// FIXME: Could remove this check here by
-			// using a different spatial partition mask. Look into it
-			// if we want more speedups here.
-			if ( bNoStaticProps )
-				continue;
-
-			if ( bFilterStaticProps )
-			{
-				if ( !pTraceFilter->ShouldHitEntity( pHandleEntity, fMask ) )
-					continue;
-			}
-		}
 
 		ClipRayToCollideable( entityRay, fMask, pCollideable, &tr );
 
@@ -1809,8 +1796,81 @@ void CEngineTrace::TraceRay( const Ray_t &ray, unsigned int fMask, ITraceFilter
 			break;
 	}
 
-	// Fix up the fractions so they are appropriate given the original
-	// unclipped-to-world ray
+	FinishEntityTrace( ray, flWorldFraction, flWorldFractionLeftSolidScale, pTrace );
+}
+
+
+//-----------------------------------------------------------------------------
+// Creates a ray that extends only until the world trace hit something and
+// adjusts the trace accordingly
+//-----------------------------------------------------------------------------
+void CEngineTrace::ClipEntityRayToWorld( const Ray_t &ray, trace_t *pTrace, Ray_t *pEntityRay, float *pWorldFraction, float *pWorldFractionLeftSolidScale )
+{
+	// Save the world collision fraction.
+	*pWorldFraction = pTrace->fraction;
+	*pWorldFractionLeftSolidScale = pTrace->fraction;
+
+	*pEntityRay = ray;
+
+	if ( pTrace->fraction == 0 )
+	{
+		pEntityRay->m_Delta.Init();
+		*pWorldFractionLeftSolidScale = pTrace->fractionleftsolid;
+		pTrace->fractionleftsolid = 1.0f;
+		pTrace->fraction = 1.0f;
+	}
+	else
+	{
+		// Explicitly compute end so that this computation happens at the quantization of
+		// the output (endpos).  That way we won't miss any intersections we would get
+		// by feeding these results back in to the tracer
+		// This is not the same as entityRay.m_Delta *= pTrace->fraction which happens 
+		// at a quantization that is more precise as m_Start moves away from the origin
+		Vector end;
+		VectorMA( pEntityRay->m_Start, pTrace->fraction, pEntityRay->m_Delta, end );
+		VectorSubtract(end, pEntityRay->m_Start, pEntityRay->m_Delta);
+		// We know this is safe because pTrace->fraction != 0
+		pTrace->fractionleftsolid /= pTrace->fraction;
+		pTrace->fraction = 1.0;
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Should a trace hit this entity?
+//-----------------------------------------------------------------------------
+bool CEngineTrace::ShouldClipRayToEntity( IHandleEntity *pHandleEntity, ICollideable *pCollideable, const char *pDebugName, unsigned int fMask, ITraceFilter *pTraceFilter, TraceType_t traceType )
+{
+	// Check for error condition
+	if ( IsPC() && IsDebug() && !IsSolid( pCollideable->GetSolid(), pCollideable->GetSolidFlags() ) )
+	{
+		Assert( 0 );
+		Msg( "%s in solid list (not solid)\n", pDebugName );
+		return false;
+	}
+
+	if ( !StaticPropMgr()->IsStaticProp( pHandleEntity ) )
+		return pTraceFilter->ShouldHitEntity( pHandleEntity, fMask );
+
+	// FIXME: Could remove this check here by
+	// using a different spatial partition mask. Look into it
+	// if we want more speedups here.
+	if ( traceType == TRACE_ENTITIES_ONLY )
+		return false;
+
+	if ( traceType == TRACE_EVERYTHING_FILTER_PROPS )
+		return pTraceFilter->ShouldHitEntity( pHandleEntity, fMask );
+
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Fix up the fractions so they are appropriate given the original
+// unclipped-to-world ray
+//-----------------------------------------------------------------------------
+void CEngineTrace::FinishEntityTrace( const Ray_t &ray, float flWorldFraction, float flWorldFractionLeftSolidScale, trace_t *pTrace )
+{
 	pTrace->fraction *= flWorldFraction;
 	pTrace->fractionleftsolid *= flWorldFractionLeftSolidScale;
 
@@ -1837,6 +1897,361 @@ void CEngineTrace::TraceRay( const Ray_t &ray, unsigned int fMask, ITraceFilter
 }
 
 
+//-----------------------------------------------------------------------------
+// Traces a batch of rays. The world is traced in packets of four rays, see
+// CM_BoxTraceRays. When the rays are close together the partition is walked
+// once for the box around them, the filter is asked about each entity found
+// once, and a SIMD slab test against the entity bounds, four at a time, picks
+// out the entities each ray needs to be clipped against.
+//-----------------------------------------------------------------------------
+void CEngineTrace::TraceRays( int nRays, const Ray_t *pRays, unsigned int fMask, ITraceFilter *pTraceFilter, trace_t *pTraces )
+{
+	if ( nRays <= 1 )
+	{
+		if ( nRays == 1 )
+		{
+			TraceRay( pRays[0], fMask, pTraceFilter, pTraces );
+		}
+		return;
+	}
+
+#if defined _DEBUG && !defined SWDS
+	if( debugrayenable.GetBool() )
+	{
+		s_FrameRays.AddMultipleToTail( nRays, pRays );
+	}
+#endif
+
+	tmZone( TELEMETRY_LEVEL1, TMZF_NONE, "%s:%d", __FUNCTION__, __LINE__ );
+	VPROF( "CEngineTrace::TraceRays" );
+	VPROF_INCREMENT_COUNTER( "TraceRay", nRays );
+	m_traceStatCounters[TRACE_STAT_COUNTER_TRACERAY] += nRays;
+
+	CTraceFilterHitAll traceFilter;
+	if ( !pTraceFilter )
+	{
+		pTraceFilter = &traceFilter;
+	}
+
+	TraceType_t traceType = pTraceFilter->GetTraceType();
+
+	// Collide with the world.
+	if ( traceType != TRACE_ENTITIES_ONLY )
+	{
+		ICollideable *pCollide = GetWorldCollideable();
+		Assert( pCollide );
+		Assert(!pCollide || pCollide->GetCollisionOrigin() == vec3_origin );
+		Assert(!pCollide || pCollide->GetCollisionAngles() == vec3_angle );
+
+		CM_BoxTraceRays( nRays, pRays, 0, fMask, true, pTraces );
+		for ( int i = 0; i < nRays; ++i )
+		{
+			SetTraceEntity( pCollide, &pTraces[i] );
+		}
+
+		// Early out if we only trace against the world
+		if ( traceType == TRACE_WORLD_ONLY )
+			return;
+	}
+	else
+	{
+		for ( int i = 0; i < nRays; ++i )
+		{
+			CM_ClearTrace( &pTraces[i] );
+			VectorAdd( pRays[i].m_Start, pRays[i].m_StartOffset, pTraces[i].startpos );
+			VectorAdd( pTraces[i].startpos, pRays[i].m_Delta, pTraces[i].endpos );
+		}
+	}
+
+	struct BatchRay_t
+	{
+		int		m_nRay;
+		Vector	m_vecDelta;		// clipped to the world
+		float	m_flWorldFraction;
+		float	m_flWorldFractionLeftSolidScale;
+	};
+
+	// Clip the rays to the world and find the box around them. The partition's
+	// smallest voxels are 256 units on a side; walking the box visits each of
+	// the voxels in it once, walking the rays visits the voxels along each ray.
+	CUtlVectorFixedGrowable< BatchRay_t, 32 > batchRays;
+	Vector vecBatchMins( FLT_MAX, FLT_MAX, FLT_MAX );
+	Vector vecBatchMaxs( -FLT_MAX, -FLT_MAX, -FLT_MAX );
+	float flRayVoxels = 0.0f;
+	for ( int i = 0; i < nRays; ++i )
+	{
+		// inside world, no need to check being inside anything else
+		if ( traceType != TRACE_ENTITIES_ONLY && pTraces[i].startsolid )
+			continue;
+
+		Ray_t entityRay;
+		BatchRay_t &batchRay = batchRays[ batchRays.AddToTail() ];
+		batchRay.m_nRay = i;
+		ClipEntityRayToWorld( pRays[i], &pTraces[i], &entityRay, &batchRay.m_flWorldFraction, &batchRay.m_flWorldFractionLeftSolidScale );
+		batchRay.m_vecDelta = entityRay.m_Delta;
+
+		Vector vecEnd, vecRayMins, vecRayMaxs;
+		VectorAdd( entityRay.m_Start, entityRay.m_Delta, vecEnd );
+		VectorMin( entityRay.m_Start, vecEnd, vecRayMins );
+		VectorMax( entityRay.m_Start, vecEnd, vecRayMaxs );
+		VectorSubtract( vecRayMins, entityRay.m_Extents, vecRayMins );
+		VectorAdd( vecRayMaxs, entityRay.m_Extents, vecRayMaxs );
+		VectorMin( vecBatchMins, vecRayMins, vecBatchMins );
+		VectorMax( vecBatchMaxs, vecRayMaxs, vecBatchMaxs );
+
+		Vector vecRaySize;
+		VectorSubtract( vecRayMaxs, vecRayMins, vecRaySize );
+		flRayVoxels += ( vecRaySize.x + vecRaySize.y + vecRaySize.z ) * ( 1.0f / 256.0f ) + 1.0f;
+	}
+
+	if ( !batchRays.Count() )
+		return;
+
+	Vector vecBatchSize;
+	VectorSubtract( vecBatchMaxs, vecBatchMins, vecBatchSize );
+	float flBoxVoxels = ( vecBatchSize.x * ( 1.0f / 256.0f ) + 1.0f ) * ( vecBatchSize.y * ( 1.0f / 256.0f ) + 1.0f ) * ( vecBatchSize.z * ( 1.0f / 256.0f ) + 1.0f );
+
+	trace_t tr;
+	ICollideable *pCollideable;
+	const char *pDebugName;
+
+	if ( flBoxVoxels > flRayVoxels )
+	{
+		// The rays are too spread out, each one walks the partition like TraceRay does
+		for ( int iRay = 0; iRay < batchRays.Count(); ++iRay )
+		{
+			const BatchRay_t &batchRay = batchRays[iRay];
+			trace_t *pTrace = &pTraces[batchRay.m_nRay];
+			Ray_t entityRay = pRays[batchRay.m_nRay];
+			entityRay.m_Delta = batchRay.m_vecDelta;
+
+			CEntityListAlongRay enumerator;
+			enumerator.Reset();
+			SpatialPartition()->EnumerateElementsAlongRay( SpatialPartitionMask(), entityRay, false, &enumerator );
+
+			int nCount = enumerator.Count();
+			for ( int i = 0; i < nCount; ++i )
+			{
+				IHandleEntity *pHandleEntity = enumerator.m_EntityHandles[i];
+				HandleEntityToCollideable( pHandleEntity, &pCollideable, &pDebugName );
+
+				if ( !ShouldClipRayToEntity( pHandleEntity, pCollideable, pDebugName, fMask, pTraceFilter, traceType ) )
+					continue;
+
+				ClipRayToCollideable( entityRay, fMask, pCollideable, &tr );
+				ClipTraceToTrace( tr, pTrace );
+				if ( pTrace->allsolid )
+					break;
+			}
+
+			FinishEntityTrace( pRays[batchRay.m_nRay], batchRay.m_flWorldFraction, batchRay.m_flWorldFractionLeftSolidScale, pTrace );
+		}
+		return;
+	}
+
+	// Collide with entities in the box around the rays
+	// FIXME: Hitbox code causes this to be re-entrant for the IK stuff, so no static lists here either
+	CEntityListInBatch enumerator;
+	SpatialPartition()->EnumerateElementsInBox( SpatialPartitionMask(), vecBatchMins, vecBatchMaxs, false, &enumerator );
+
+	// Bounds of the entities that pass the filter, four to a group
+	struct BatchBounds_t
+	{
+		float	m_flMins[3][4];
+		float	m_flMaxs[3][4];
+	};
+
+	CUtlVectorFixedGrowable< ICollideable *, 64 > collideables;
+	CUtlVectorFixedGrowable< BatchBounds_t, 16 > bounds;
+	int nCount = enumerator.m_EntityHandles.Count();
+	for ( int i = 0; i < nCount; ++i )
+	{
+		IHandleEntity *pHandleEntity = enumerator.m_EntityHandles[i];
+		HandleEntityToCollideable( pHandleEntity, &pCollideable, &pDebugName );
+
+		if ( !ShouldClipRayToEntity( pHandleEntity, pCollideable, pDebugName, fMask, pTraceFilter, traceType ) )
+			continue;
+
+		int nEntity = collideables.AddToTail( pCollideable );
+		if ( ( nEntity & 3 ) == 0 )
+		{
+			bounds.AddToTail();
+		}
+
+		// The partition is built from the surrounding bounds, nothing outside them can be hit
+		Vector vecMins, vecMaxs;
+		pCollideable->WorldSpaceSurroundingBounds( &vecMins, &vecMaxs );
+		BatchBounds_t &group = bounds[ nEntity >> 2 ];
+		for ( int nAxis = 0; nAxis < 3; ++nAxis )
+		{
+			group.m_flMins[nAxis][nEntity & 3] = vecMins[nAxis];
+			group.m_flMaxs[nAxis][nEntity & 3] = vecMaxs[nAxis];
+		}
+	}
+
+	int nEntities = collideables.Count();
+	int nLastGroupMask = ( nEntities & 3 ) ? ( 1 << ( nEntities & 3 ) ) - 1 : 0xF;
+	for ( int iRay = 0; iRay < batchRays.Count(); ++iRay )
+	{
+		const BatchRay_t &batchRay = batchRays[iRay];
+		trace_t *pTrace = &pTraces[batchRay.m_nRay];
+		Ray_t entityRay = pRays[batchRay.m_nRay];
+		entityRay.m_Delta = batchRay.m_vecDelta;
+
+		// Slab test against the bounds grown by the ray extents, with a little slop
+		fltx4 fl4Lo[3], fl4Hi[3], fl4InvDelta[3];
+		Vector vecInvDelta = entityRay.InvDelta();
+		for ( int nAxis = 0; nAxis < 3; ++nAxis )
+		{
+			fl4Lo[nAxis] = ReplicateX4( entityRay.m_Start[nAxis] + entityRay.m_Extents[nAxis] + 1.0f );
+			fl4Hi[nAxis] = ReplicateX4( entityRay.m_Start[nAxis] - entityRay.m_Extents[nAxis] - 1.0f );
+			fl4InvDelta[nAxis] = ReplicateX4( vecInvDelta[nAxis] );
+		}
+
+		for ( int nGroup = 0; nGroup < bounds.Count() && !pTrace->allsolid; ++nGroup )
+		{
+			const BatchBounds_t &group = bounds[nGroup];
+			fltx4 fl4Near = Four_Zeros;
+			fltx4 fl4Far = Four_Ones;
+			for ( int nAxis = 0; nAxis < 3; ++nAxis )
+			{
+				fltx4 fl4T1 = MulSIMD( SubSIMD( LoadUnalignedSIMD( group.m_flMins[nAxis] ), fl4Lo[nAxis] ), fl4InvDelta[nAxis] );
+				fltx4 fl4T2 = MulSIMD( SubSIMD( LoadUnalignedSIMD( group.m_flMaxs[nAxis] ), fl4Hi[nAxis] ), fl4InvDelta[nAxis] );
+				fl4Near = MaxSIMD( fl4Near, MinSIMD( fl4T1, fl4T2 ) );
+				fl4Far = MinSIMD( fl4Far, MaxSIMD( fl4T1, fl4T2 ) );
+			}
+
+			int nHits = ~TestSignSIMD( CmpGtSIMD( fl4Near, fl4Far ) ) & 0xF;
+			if ( nGroup == bounds.Count() - 1 )
+			{
+				nHits &= nLastGroupMask;
+			}
+
+			for ( int i = 0; i < 4 && nHits; ++i, nHits >>= 1 )
+			{
+				if ( !( nHits & 1 ) )
+					continue;
+
+				ClipRayToCollideable( entityRay, fMask, collideables[ nGroup * 4 + i ], &tr );
+
+				// Make sure the ray is always shorter than it currently is
+				ClipTraceToTrace( tr, pTrace );
+
+				// Stop if we're in allsolid
+				if ( pTrace->allsolid )
+					break;
+			}
+		}
+
+		FinishEntityTrace( pRays[batchRay.m_nRay], batchRay.m_flWorldFraction, batchRay.m_flWorldFractionLeftSolidScale, pTrace );
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Concurrent traces: this side's partition tree stops locking, everything else
+// the traces touch is per thread already
+//-----------------------------------------------------------------------------
+void CEngineTrace::BeginConcurrentTraces()
+{
+	SpatialPartition()->BeginConcurrentReads( SpatialPartitionMask() );
+}
+
+void CEngineTrace::EndConcurrentTraces()
+{
+	SpatialPartition()->EndConcurrentReads( SpatialPartitionMask() );
+}
+
+
+//-----------------------------------------------------------------------------
+// Traces random rays and hulls through the loaded map on one thread and then
+// from the job pool, and compares the results
+//-----------------------------------------------------------------------------
+struct TraceStressItem_t
+{
+	Ray_t	m_Ray;
+	trace_t	m_Serial;
+	trace_t	m_Parallel;
+};
+
+static void TraceStressProcess( TraceStressItem_t &item )
+{
+	CTraceFilterHitAll traceFilter;
+	g_pEngineTraceServer->TraceRay( item.m_Ray, MASK_SOLID, &traceFilter, &item.m_Parallel );
+}
+
+CON_COMMAND_F( trace_stress, "Traces random rays from several threads at once and checks them against serial traces. Arguments: [count] [seed]", FCVAR_CHEAT )
+{
+	if ( !sv.IsActive() || !GetCollisionBSPData()->numcmodels )
+	{
+		Msg( "trace_stress needs a map loaded on a local server\n" );
+		return;
+	}
+
+	int nCount = ( args.ArgC() > 1 ) ? atoi( args[1] ) : 4096;
+	nCount = clamp( nCount, 1, 1024 * 1024 );
+
+	CUniformRandomStream random;
+	random.SetSeed( ( args.ArgC() > 2 ) ? atoi( args[2] ) : 1 );
+
+	const cmodel_t &world = GetCollisionBSPData()->map_cmodels[0];
+	CUtlVector< TraceStressItem_t > items;
+	items.SetCount( nCount );
+	for ( int i = 0; i < nCount; ++i )
+	{
+		Vector vecStart, vecEnd;
+		for ( int j = 0; j < 3; ++j )
+		{
+			vecStart[j] = random.RandomFloat( world.mins[j], world.maxs[j] );
+			vecEnd[j] = random.RandomFloat( world.mins[j], world.maxs[j] );
+		}
+
+		// Half of them hulls
+		if ( i & 1 )
+		{
+			Vector vecExtents( random.RandomFloat( 1, 32 ), random.RandomFloat( 1, 32 ), random.RandomFloat( 1, 72 ) );
+			items[i].m_Ray.Init( vecStart, vecEnd, -vecExtents, vecExtents );
+		}
+		else
+		{
+			items[i].m_Ray.Init( vecStart, vecEnd );
+		}
+	}
+
+	// The serial pass also applies any lazy partition updates
+	CTraceFilterHitAll traceFilter;
+	double flStart = Plat_FloatTime();
+	for ( int i = 0; i < nCount; ++i )
+	{
+		g_pEngineTraceServer->TraceRay( items[i].m_Ray, MASK_SOLID, &traceFilter, &items[i].m_Serial );
+	}
+	double flSerial = Plat_FloatTime() - flStart;
+
+	flStart = Plat_FloatTime();
+	g_pEngineTraceServer->BeginConcurrentTraces();
+	ParallelProcess( "TraceStressProcess", items.Base(), nCount, &TraceStressProcess );
+	g_pEngineTraceServer->EndConcurrentTraces();
+	double flParallel = Plat_FloatTime() - flStart;
+
+	int nMismatches = 0;
+	for ( int i = 0; i < nCount; ++i )
+	{
+		const trace_t &serial = items[i].m_Serial;
+		const trace_t &parallel = items[i].m_Parallel;
+		if ( serial.fraction != parallel.fraction || serial.endpos != parallel.endpos ||
+			serial.m_pEnt != parallel.m_pEnt || serial.allsolid != parallel.allsolid || serial.startsolid != parallel.startsolid )
+		{
+			if ( nMismatches++ < 10 )
+			{
+				Warning( "trace_stress: trace %d differs, fraction %f vs %f\n", i, serial.fraction, parallel.fraction );
+			}
+		}
+	}
+
+	Msg( "trace_stress: %d traces, %d mismatches, serial %.2f ms, parallel %.2f ms\n", nCount, nMismatches, flSerial * 1000.0, flParallel * 1000.0 );
+}
+
+
 //-----------------------------------------------------------------------------
 // A version that sweeps a collideable through the world
 //-----------------------------------------------------------------------------
@@ -1849,11 +2264,11 @@ void CEngineTrace::SweepCollideable( ICollideable *pCollide,
 	Assert( vecAngles == vec3_angle );
 	if ( pCollide->GetSolidFlags() & FSOLID_ROOT_PARENT_ALIGNED )
 	{
-		m_pRootMoveParent = pCollide->GetRootParentToWorldTransform();
+		m_pRootMoveParent = const_cast<matrix3x4_t *>( pCollide->GetRootParentToWorldTransform() );
 	}
 	ray.Init( vecAbsStart, vecAbsEnd, pCollide->OBBMins(), pCollide->OBBMaxs() );
 	TraceRay( ray, fMask, pTraceFilter, pTrace );
-	m_pRootMoveParent = pOldRoot;
+	m_pRootMoveParent = const_cast<matrix3x4_t *>( pOldRoot );
 }
 
 
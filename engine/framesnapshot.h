@@ -12,6 +12,7 @@
 
 #include <mempool.h>
 #include <utllinkedlist.h>
+#include "tier0/tslist.h"
 
 
 class PackedEntity;
@@ -111,6 +112,42 @@ private:
 	CInterlockedInt			m_nReferences;
 };
 
+//-----------------------------------------------------------------------------
+// Purpose: lock free PackedEntity allocator. The pack jobs of PackEntities_Normal
+//  allocate and release packed entities concurrently, this keeps them from
+//  serializing on a mutex. Memory of released entities is kept on a free list.
+//-----------------------------------------------------------------------------
+class CPackedEntityPool
+{
+public:
+	CPackedEntityPool();
+	~CPackedEntityPool();
+
+	PackedEntity*	Alloc();
+	void			Free( PackedEntity *pEntity );
+
+	// number of packed entities currently in use
+	int				Count() const { return m_nAllocated; }
+
+	// Releases the memory of all unused entities
+	void			Purge();
+
+	// Publishes the allocation counters to VPROF and resets them, main thread only
+	void			UpdateVProfCounters();
+
+private:
+	struct PackedEntityNode_t;
+
+	CTSSimpleList<PackedEntityNode_t>	m_FreeList;
+	CInterlockedInt		m_nAllocated;
+	CInterlockedInt		m_nNodes;			// total nodes owned by the pool
+
+	CInterlockedInt		m_nAllocs;			// allocations since last UpdateVProfCounters
+	CInterlockedInt		m_nFreeListMisses;	// allocations that had to create a new node
+	CInterlockedInt		m_nLockedFrees;		// frees that had to take the uncompressed cache lock
+	friend class CFrameSnapshotManager;
+};
+
 //-----------------------------------------------------------------------------
 // Purpose: snapshot manager class
 //-----------------------------------------------------------------------------
@@ -163,11 +200,23 @@ public:
 	// List of entities to explicitly delete
 	void			AddExplicitDelete( int iSlot );
 
+	// Reports PackedEntity allocator activity since the last call to VPROF
+	void			UpdateVProfCounters();
+
+	// While enabled, snapshots whose last reference goes away stay in the list and
+	// are only deleted when this is turned off again. Used while clients are sent
+	// their snapshots in parallel: WriteTempEntities walks the list between a client's
+	// last and current snapshot while other clients release their old frames.
+	void			DeferSnapshotDeletes( bool bDefer );
+
 private:
 	void	DeleteFrameSnapshot( CFrameSnapshot* pSnapshot );
 
 	CUtlLinkedList<CFrameSnapshot*, unsigned short>		m_FrameSnapshots;
-	CClassMemoryPool< PackedEntity >					m_PackedEntitiesPool;
+	CThreadFastMutex									m_FrameSnapshotsMutex;	// guards m_FrameSnapshots and m_DeferredDeletes
+	bool												m_bDeferDeletes;
+	CUtlVector<CFrameSnapshot*>							m_DeferredDeletes;
+	CPackedEntityPool									m_PackedEntitiesPool;
 
 	int								m_nPackedEntityCacheCounter;  // increase with every cache access
 	CUtlVector<UnpackedDataCache_t>	m_PackedEntityCache;	// cache for uncompressed packed entities
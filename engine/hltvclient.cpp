@@ -447,7 +447,8 @@ void CHLTVClient::SendSnapshot( CClientFrame * pFrame )
 	}
 
 	CClientFrame	*pDeltaFrame = GetDeltaFrame( m_nDeltaTick ); // NULL if delta_tick is not found
-	CHLTVFrame		*pLastFrame = (CHLTVFrame*) GetDeltaFrame( m_nLastSendTick );
+	// only the frame list is walked here, no need to rebuild a compacted frame's snapshot
+	CHLTVFrame		*pLastFrame = (CHLTVFrame*) m_pHLTV->GetClientFrame( m_nLastSendTick );
 
 	if ( pLastFrame )
 	{
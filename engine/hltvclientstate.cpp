@@ -603,7 +603,7 @@ bool CHLTVClientState::ProcessPacketEntities( SVC_PacketEntities *entmsg )
 		}
 
 		// Otherwise, mark where we are valid to and point to the packet entities we'll be updating from.
-		oldFrame = m_pHLTV->GetClientFrame( entmsg->m_nDeltaFrom );
+		oldFrame = m_pHLTV->MaterializeFrame( m_pHLTV->GetClientFrame( entmsg->m_nDeltaFrom ) );
 	}
 
 	// create new empty snapshot
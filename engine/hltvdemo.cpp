@@ -355,7 +355,7 @@ void CHLTVDemoRecorder::WriteFrame( CHLTVFrame *pFrame )
 #endif
 
 	// get delta frame
-	CClientFrame *deltaFrame = hltv->GetClientFrame( m_nDeltaTick ); // NULL if delta_tick is not found or -1
+	CClientFrame *deltaFrame = hltv->MaterializeFrame( hltv->GetClientFrame( m_nDeltaTick ) ); // NULL if delta_tick is not found or -1
 	
 	// send entity update, delta compressed if deltaFrame != NULL
 	sv.WriteDeltaEntities( hltv->m_MasterClient, pFrame, deltaFrame, msg );
@@ -87,6 +87,8 @@ ConVar tv_debug( "tv_debug", "0", 0, "SourceTV debug info." );
 ConVar tv_title( "tv_title", "SourceTV", 0, "Set title for SourceTV spectator UI", tv_title_changed_f );
 static ConVar tv_deltacache( "tv_deltacache", "2", 0, "Enable delta entity bit stream cache" );
 static ConVar tv_relayvoice( "tv_relayvoice", "1", 0, "Relay voice data: 0=off, 1=on" );
+static ConVar tv_deltaframes( "tv_deltaframes", "0", 0, "Store buffered SourceTV frames as differences to a keyframe to save memory" );
+static ConVar tv_keyframeinterval( "tv_keyframeinterval", "5", 0, "Seconds between keyframes if tv_deltaframes is enabled", true, 0.1, true, 60 );
 
 CDeltaEntityCache::CDeltaEntityCache()
 {
@@ -359,14 +361,211 @@ void CHLTVServer::InitClientRecvTables()
 
 
 
+//-----------------------------------------------------------------------------
+// tv_deltaframes: a frame's entity table stored as the entries that differ from
+// its keyframe snapshot
+//-----------------------------------------------------------------------------
+struct HLTVDeltaEntity_t
+{
+	int					m_nIndex;
+	bool				m_bValid;		// in the snapshot's valid entity list
+	CFrameSnapshotEntry	m_Entry;
+	CHLTVEntityData		m_HLTVData;		// only set if m_bValid and the snapshot has HLTV data
+};
+
+class CHLTVFrameDelta
+{
+public:
+	~CHLTVFrameDelta()
+	{
+		FOR_EACH_VEC( m_Entities, i )
+		{
+			if ( m_Entities[i].m_Entry.m_pPackedData != INVALID_PACKED_ENTITY_HANDLE )
+			{
+				framesnapshotmanager->RemoveEntityReference( m_Entities[i].m_Entry.m_pPackedData );
+			}
+		}
+	}
+
+	int		m_nNumEntities;
+	bool	m_bHLTVData;
+	CUtlVector<HLTVDeltaEntity_t>	m_Entities;		// sorted by entity index
+	CUtlVector<int>					m_iExplicitDeleteSlots;
+};
+
+// Walks the valid entity list of a snapshot, which is sorted, in ascending entity order
+class CValidEntityCursor
+{
+public:
+	CValidEntityCursor( CFrameSnapshot *pSnapshot ) : m_pSnapshot( pSnapshot ), m_iValid( 0 ) {}
+
+	// returns the position of the entity in the valid list or -1
+	int Find( int iEntity )
+	{
+		while ( m_iValid < m_pSnapshot->m_nValidEntities && m_pSnapshot->m_pValidEntities[m_iValid] < iEntity )
+		{
+			m_iValid++;
+		}
+
+		if ( m_iValid < m_pSnapshot->m_nValidEntities && m_pSnapshot->m_pValidEntities[m_iValid] == iEntity )
+			return m_iValid;
+
+		return -1;
+	}
+
+private:
+	CFrameSnapshot	*m_pSnapshot;
+	int				m_iValid;
+};
+
+static CHLTVFrameDelta *HLTV_CreateFrameDelta( CFrameSnapshot *pSnapshot, CFrameSnapshot *pKey )
+{
+	CHLTVFrameDelta *pDelta = new CHLTVFrameDelta;
+	pDelta->m_nNumEntities = pSnapshot->m_nNumEntities;
+	pDelta->m_bHLTVData = pSnapshot->m_pHLTVEntityData != NULL;
+	pDelta->m_iExplicitDeleteSlots.CopyArray( pSnapshot->m_iExplicitDeleteSlots.Base(), pSnapshot->m_iExplicitDeleteSlots.Count() );
+
+	Assert( pDelta->m_bHLTVData == ( pKey->m_pHLTVEntityData != NULL ) );
+
+	CValidEntityCursor validEntities( pSnapshot );
+	CValidEntityCursor keyValidEntities( pKey );
+
+	for ( int i = 0; i < pSnapshot->m_nNumEntities; i++ )
+	{
+		const CFrameSnapshotEntry &entry = pSnapshot->m_pEntities[i];
+		int iValid = validEntities.Find( i );
+		int iKeyValid = keyValidEntities.Find( i );
+
+		bool bSame;
+		if ( i < pKey->m_nNumEntities )
+		{
+			const CFrameSnapshotEntry &keyEntry = pKey->m_pEntities[i];
+			bSame = entry.m_pClass == keyEntry.m_pClass &&
+				entry.m_nSerialNumber == keyEntry.m_nSerialNumber &&
+				entry.m_pPackedData == keyEntry.m_pPackedData;
+		}
+		else
+		{
+			// same as what CreateEmptySnapshot fills in
+			bSame = entry.m_pClass == NULL && entry.m_nSerialNumber == -1 && entry.m_pPackedData == INVALID_PACKED_ENTITY_HANDLE;
+		}
+
+		bSame = bSame && ( iValid < 0 ) == ( iKeyValid < 0 );
+
+		if ( bSame && iValid >= 0 && pDelta->m_bHLTVData )
+		{
+			bSame = !Q_memcmp( &pSnapshot->m_pHLTVEntityData[iValid], &pKey->m_pHLTVEntityData[iKeyValid], sizeof( CHLTVEntityData ) );
+		}
+
+		if ( bSame )
+			continue;
+
+		HLTVDeltaEntity_t &delta = pDelta->m_Entities[ pDelta->m_Entities.AddToTail() ];
+		delta.m_nIndex = i;
+		delta.m_bValid = iValid >= 0;
+		delta.m_Entry = entry;
+
+		if ( delta.m_bValid && pDelta->m_bHLTVData )
+		{
+			delta.m_HLTVData = pSnapshot->m_pHLTVEntityData[iValid];
+		}
+		else
+		{
+			Q_memset( &delta.m_HLTVData, 0, sizeof( delta.m_HLTVData ) );
+		}
+
+		if ( entry.m_pPackedData != INVALID_PACKED_ENTITY_HANDLE )
+		{
+			framesnapshotmanager->AddEntityReference( entry.m_pPackedData );
+		}
+	}
+
+	return pDelta;
+}
+
+// Rebuilds the snapshot a delta was made from. Returns it with a reference count of 1.
+static CFrameSnapshot *HLTV_CreateSnapshotFromDelta( int nTick, const CHLTVFrameDelta *pDelta, CFrameSnapshot *pKey )
+{
+	CFrameSnapshot *pSnapshot = framesnapshotmanager->CreateEmptySnapshot( nTick, pDelta->m_nNumEntities );
+
+	// sized for the worst case, every entity valid
+	pSnapshot->m_pValidEntities = new unsigned short[pDelta->m_nNumEntities];
+	if ( pDelta->m_bHLTVData )
+	{
+		pSnapshot->m_pHLTVEntityData = new CHLTVEntityData[pDelta->m_nNumEntities];
+	}
+
+	CValidEntityCursor keyValidEntities( pKey );
+	int iDelta = 0;
+	int nValid = 0;
+
+	for ( int i = 0; i < pDelta->m_nNumEntities; i++ )
+	{
+		CFrameSnapshotEntry &entry = pSnapshot->m_pEntities[i];
+		int iKeyValid = keyValidEntities.Find( i );
+		const CHLTVEntityData *pHLTVData = NULL;
+		bool bValid;
+
+		if ( iDelta < pDelta->m_Entities.Count() && pDelta->m_Entities[iDelta].m_nIndex == i )
+		{
+			const HLTVDeltaEntity_t &delta = pDelta->m_Entities[iDelta++];
+			entry = delta.m_Entry;
+			bValid = delta.m_bValid;
+			pHLTVData = &delta.m_HLTVData;
+		}
+		else
+		{
+			// unchanged, an index past the keyframe's end stays empty
+			if ( i < pKey->m_nNumEntities )
+			{
+				entry = pKey->m_pEntities[i];
+			}
+			bValid = iKeyValid >= 0;
+			if ( bValid && pDelta->m_bHLTVData )
+			{
+				pHLTVData = &pKey->m_pHLTVEntityData[iKeyValid];
+			}
+		}
+
+		if ( entry.m_pPackedData != INVALID_PACKED_ENTITY_HANDLE )
+		{
+			framesnapshotmanager->AddEntityReference( entry.m_pPackedData );
+		}
+
+		if ( bValid )
+		{
+			pSnapshot->m_pValidEntities[nValid] = i;
+			if ( pDelta->m_bHLTVData )
+			{
+				pSnapshot->m_pHLTVEntityData[nValid] = *pHLTVData;
+			}
+			nValid++;
+		}
+	}
+
+	pSnapshot->m_nValidEntities = nValid;
+	pSnapshot->m_iExplicitDeleteSlots.CopyArray( pDelta->m_iExplicitDeleteSlots.Base(), pDelta->m_iExplicitDeleteSlots.Count() );
+
+	// temp entities are not restored, SourceTV sends them from its message buffers
+	return pSnapshot;
+}
+
 CHLTVFrame::CHLTVFrame()
 {
-	
+	m_pDelta = NULL;
+	m_pKeySnapshot = NULL;
 }
 
 CHLTVFrame::~CHLTVFrame()
 {
 	FreeBuffers();
+
+	delete m_pDelta;
+
+	if ( m_pKeySnapshot )
+	{
+		m_pKeySnapshot->ReleaseReference();
+	}
 }
 
 void CHLTVFrame::Reset( void )
@@ -455,6 +654,9 @@ CHLTVServer::CHLTVServer()
 	m_nFirstTick = -1;
 	m_nLastTick = 0;
 	m_CurrentFrame = NULL;
+	m_pLastAddedFrame = NULL;
+	m_pKeySnapshot = NULL;
+	m_nKeyFrameTick = 0;
 	m_nViewEntity = 0;
 	m_nPlayerSlot = 0;
 	m_bSignonState = false;
@@ -1363,6 +1565,13 @@ CClientFrame *CHLTVServer::AddNewFrame( CClientFrame *clientFrame )
 		m_DemoRecorder.WriteFrame( &m_HLTVFrame );
 	}
 
+	// the previous frame was the delta source for the new one and the demo, it can be stored compact now
+	if ( m_pLastAddedFrame && tv_deltaframes.GetBool() )
+	{
+		CompactFrame( m_pLastAddedFrame );
+	}
+	m_pLastAddedFrame = hltvFrame;
+
 	// reset HLTV frame for recording next messages etc.
 	m_HLTVFrame.Reset();
 	m_HLTVFrame.SetSnapshot( NULL );
@@ -1370,6 +1579,109 @@ CClientFrame *CHLTVServer::AddNewFrame( CClientFrame *clientFrame )
 	return hltvFrame;
 }
 
+//-----------------------------------------------------------------------------
+// tv_deltaframes: replaces the frame's snapshot with the differences to the current
+// keyframe, or makes the frame the new keyframe
+//-----------------------------------------------------------------------------
+void CHLTVServer::CompactFrame( CHLTVFrame *pFrame )
+{
+	VPROF_BUDGET( "CHLTVServer::CompactFrame", "HLTV" );
+
+	CFrameSnapshot *pSnapshot = pFrame->GetSnapshot();
+	if ( !pSnapshot || pFrame->m_pDelta )
+		return;
+
+	CHLTVFrameDelta *pDelta = NULL;
+
+	int nKeyFrameTicks = (int)( tv_keyframeinterval.GetFloat() / m_flTickInterval );
+
+	if ( m_pKeySnapshot &&
+		pFrame->tick_count - m_nKeyFrameTick < nKeyFrameTicks &&
+		( m_pKeySnapshot->m_pHLTVEntityData != NULL ) == ( pSnapshot->m_pHLTVEntityData != NULL ) )
+	{
+		pDelta = HLTV_CreateFrameDelta( pSnapshot, m_pKeySnapshot );
+
+		// not worth it, start over with this frame
+		if ( pDelta->m_Entities.Count() > pSnapshot->m_nNumEntities / 2 )
+		{
+			delete pDelta;
+			pDelta = NULL;
+		}
+	}
+
+	if ( !pDelta )
+	{
+		// keyframes keep their snapshot
+		if ( m_pKeySnapshot )
+		{
+			m_pKeySnapshot->ReleaseReference();
+		}
+		m_pKeySnapshot = pSnapshot;
+		m_pKeySnapshot->AddReference();
+		m_nKeyFrameTick = pFrame->tick_count;
+		return;
+	}
+
+	pFrame->m_pDelta = pDelta;
+	pFrame->m_pKeySnapshot = m_pKeySnapshot;
+	m_pKeySnapshot->AddReference();
+
+	if ( pFrame == m_CurrentFrame )
+	{
+		// still in use, released by UpdateTick
+		m_MaterializedFrames.AddToTail( pFrame );
+	}
+	else
+	{
+		pFrame->SetSnapshot( NULL );
+	}
+}
+
+CClientFrame *CHLTVServer::MaterializeFrame( CClientFrame *pFrame )
+{
+	if ( !pFrame || pFrame->GetSnapshot() )
+		return pFrame;
+
+	// only compacted HLTV frames come without a snapshot
+	CHLTVFrame *pHLTVFrame = static_cast<CHLTVFrame*>( pFrame );
+	Assert( pHLTVFrame->m_pDelta );
+
+	VPROF_BUDGET( "CHLTVServer::MaterializeFrame", "HLTV" );
+
+	CFrameSnapshot *pSnapshot = HLTV_CreateSnapshotFromDelta( pFrame->tick_count, pHLTVFrame->m_pDelta, pHLTVFrame->m_pKeySnapshot );
+	pFrame->SetSnapshot( pSnapshot );
+	pSnapshot->ReleaseReference();
+
+	m_MaterializedFrames.AddToTail( pHLTVFrame );
+
+	return pFrame;
+}
+
+void CHLTVServer::ReleaseMaterializedFrames( CClientFrame *pKeep )
+{
+	FOR_EACH_VEC_BACK( m_MaterializedFrames, i )
+	{
+		CHLTVFrame *pFrame = m_MaterializedFrames[i];
+		if ( pFrame == pKeep )
+			continue;
+
+		pFrame->SetSnapshot( NULL );
+		m_MaterializedFrames.FastRemove( i );
+	}
+}
+
+void CHLTVServer::ResetDeltaFrames()
+{
+	m_MaterializedFrames.RemoveAll();
+	m_pLastAddedFrame = NULL;
+
+	if ( m_pKeySnapshot )
+	{
+		m_pKeySnapshot->ReleaseReference();
+		m_pKeySnapshot = NULL;
+	}
+}
+
 void CHLTVServer::SendClientMessages ( bool bSendSnapshots )
 {
 	// build individual updates
@@ -1513,7 +1825,7 @@ IHLTVDirector *CHLTVServer::GetDirector()
 CClientFrame *CHLTVServer::GetDeltaFrame( int nTick )
 {
 	if ( !tv_deltacache.GetBool() )
-		return GetClientFrame( nTick ); //expensive
+		return MaterializeFrame( GetClientFrame( nTick ) ); //expensive
 
 	// TODO make that a utlmap
 	FOR_EACH_VEC( m_FrameCache, iFrame )
@@ -1527,7 +1839,7 @@ CClientFrame *CHLTVServer::GetDeltaFrame( int nTick )
 	CFrameCacheEntry_s &entry = m_FrameCache[i];
 
 	entry.nTick = nTick;
-	entry.pFrame = GetClientFrame( nTick ); //expensive
+	entry.pFrame = MaterializeFrame( GetClientFrame( nTick ) ); //expensive
 
 	return entry.pFrame;
 }
@@ -1570,7 +1882,9 @@ void CHLTVServer::RunFrame()
 
 	UpdateStats();
 
+	NET_BeginBatchedSend();
 	SendClientMessages( true );
+	NET_FlushBatchedSend();
 
 	// Update the Steam server if we're running a relay.
 	if ( !sv.IsActive() )
@@ -1610,6 +1924,10 @@ void CHLTVServer::UpdateTick( void )
 
 	m_CurrentFrame = newFrame;
 	m_nTickCount = m_CurrentFrame->tick_count;
+
+	// compacted frames only get their snapshot back while they are current or a delta source
+	MaterializeFrame( m_CurrentFrame );
+	ReleaseMaterializedFrames( m_CurrentFrame );
 	
 	if ( IsMasterProxy() )
 	{
@@ -1673,6 +1991,7 @@ void CHLTVServer::Clear( void )
 	m_HLTVFrame.FreeBuffers();
 	m_vPVSOrigin.Init();
 		
+	ResetDeltaFrames();
 	DeleteClientFrames( -1 );
 
 	m_DeltaCache.Flush();
@@ -1731,6 +2050,7 @@ void CHLTVServer::Changelevel()
 
 	InactivateClients();
 
+	ResetDeltaFrames();
 	DeleteClientFrames(-1);
 
 	m_CurrentFrame = NULL;
@@ -34,6 +34,8 @@
 
 extern ConVar tv_debug;
 
+class CHLTVFrameDelta;
+
 class CHLTVFrame : public CClientFrame
 {
 public:
@@ -51,6 +53,11 @@ public:
 
 	// message buffers:
 	bf_write	m_Messages[HLTV_BUFFER_MAX];
+
+	// tv_deltaframes: entities that differ from the keyframe snapshot. The frame's
+	// own snapshot is only kept while the frame is in use (see MaterializeFrame).
+	CHLTVFrameDelta	*m_pDelta;
+	CFrameSnapshot	*m_pKeySnapshot;
 };
 
 struct CFrameCacheEntry_s
@@ -187,6 +194,7 @@ public:
 	bool	DispatchToRelay( CHLTVClient *pClient);
 	bf_write *GetBuffer( int nBuffer);
 	CClientFrame *GetDeltaFrame( int nTick );
+	CClientFrame *MaterializeFrame( CClientFrame *pFrame ); // makes sure a tv_deltaframes frame has its snapshot, NULL safe
 		
 	inline  CHLTVClient* Client( int i ) { return static_cast<CHLTVClient*>(m_Clients[i]); }
 
@@ -205,6 +213,9 @@ private:
 	void		FreeClientRecvTables();
 	void		ReadCompleteDemoFile();
 	void		ResyncDemoClock();
+	void		CompactFrame( CHLTVFrame *pFrame );
+	void		ReleaseMaterializedFrames( CClientFrame *pKeep );
+	void		ResetDeltaFrames();
 
 #ifndef NO_STEAM
 	void		ReplyInfo( const netadr_t &adr );
@@ -247,6 +258,12 @@ public:
 	CDeltaEntityCache				m_DeltaCache;
 	CUtlVector<CFrameCacheEntry_s>	m_FrameCache;
 
+	// tv_deltaframes
+	CHLTVFrame		*m_pLastAddedFrame;		// compacted once the next frame arrives
+	CFrameSnapshot	*m_pKeySnapshot;		// snapshot new frames are stored against
+	int				m_nKeyFrameTick;
+	CUtlVector<CHLTVFrame*>	m_MaterializedFrames;	// compacted frames that got their snapshot back
+
 	// demoplayer stuff:
 	CDemoFile		m_DemoFile;		// for demo playback
 	int				m_nStartTick;
@@ -23,6 +23,13 @@ public:
 	virtual void Init( const Vector& worldmin, const Vector& worldmax ) = 0;
 
 	virtual void DrawDebugOverlays() = 0;
+
+	// Between these calls the tree used for listMask may be enumerated from
+	// several threads at once without locking. Nothing may be inserted, moved
+	// or removed from it, and the query callbacks aren't called, so lazy updates
+	// must be flushed first. The other tree keeps locking as usual.
+	virtual void BeginConcurrentReads( SpatialPartitionListMask_t listMask ) = 0;
+	virtual void EndConcurrentReads( SpatialPartitionListMask_t listMask ) = 0;
 };
 
 
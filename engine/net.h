@@ -137,6 +137,9 @@ void		NET_OutOfBandPrintf(int sock, const netadr_t &adr, PRINTF_FORMAT_STRING co
 int			NET_SendPacket ( INetChannel *chan, int sock,  const netadr_t &to, const  unsigned char *data, int length, bf_write *pVoicePayload = NULL, bool bUseCompression = false );
 // Called periodically to maybe send any queued packets (up to 4 per frame)
 void		NET_SendQueuedPackets();
+// Datagrams sent between these two are collected per socket and written out together (Linux only)
+void		NET_BeginBatchedSend();
+void		NET_FlushBatchedSend();
 // Start set current network configuration
 void		NET_SetMutiplayer(bool multiplayer);
 // Set net_time
@@ -12,6 +12,7 @@
 #include "tier0/vprof.h"
 #include "net_ws_headers.h"
 #include "net_ws_queued_packet_sender.h"
+#include "net_ws_receive_thread.h"
 #include "fmtstr.h"
 #include "master.h"
 
@@ -1400,6 +1401,274 @@ bool NET_GetLoopPacket ( netpacket_t * packet )
 	return ( NET_LagPacket( true, packet ) );	
 }
 
+//-----------------------------------------------------------------------------
+// Batched UDP I/O. On Linux recvmmsg/sendmmsg move a whole ring of datagrams per
+// syscall. Incoming datagrams are read ahead into a per-socket ring and handed out
+// one at a time by NET_ReceiveDatagram. Outgoing datagrams sent between
+// NET_BeginBatchedSend and NET_FlushBatchedSend (a tick's worth of snapshots) are
+// copied into a per-socket batch and written out together.
+//-----------------------------------------------------------------------------
+#if defined( LINUX )
+
+#define NET_BATCH_SLOTS		64
+#define NET_BATCH_SLOT_SIZE	2048	// nothing we send is bigger than MAX_ROUTABLE_PAYLOAD
+
+static ConVar net_udp_batch( "net_udp_batch", "1", 0, "Use recvmmsg/sendmmsg to read and write UDP datagrams in batches." );
+
+struct NetBatchRing_t
+{
+	NetBatchRing_t()
+	{
+		m_hSocket = 0;
+		m_nCount = 0;
+		m_nNext = 0;
+		Q_memset( m_Msgs, 0, sizeof( m_Msgs ) );
+		for ( int i=0; i < NET_BATCH_SLOTS; i++ )
+		{
+			m_Iovs[i].iov_base = m_Data[i];
+			m_Iovs[i].iov_len = NET_BATCH_SLOT_SIZE;
+			m_Msgs[i].msg_hdr.msg_iov = &m_Iovs[i];
+			m_Msgs[i].msg_hdr.msg_iovlen = 1;
+			m_Msgs[i].msg_hdr.msg_name = &m_Addrs[i];
+			m_Msgs[i].msg_hdr.msg_namelen = sizeof( m_Addrs[i] );
+		}
+	}
+
+	CThreadFastMutex	m_Mutex;	// send batches only, they are filled from the parallel send jobs
+	SOCKET				m_hSocket;	// socket the ring belongs to
+	int					m_nCount;	// datagrams in the ring
+	int					m_nNext;	// next one to hand out (receive only)
+	mmsghdr				m_Msgs[NET_BATCH_SLOTS];
+	iovec				m_Iovs[NET_BATCH_SLOTS];
+	struct sockaddr		m_Addrs[NET_BATCH_SLOTS];
+	byte				m_Data[NET_BATCH_SLOTS][NET_BATCH_SLOT_SIZE];
+};
+
+static NetBatchRing_t	*s_pRecvRings[MAX_SOCKETS];
+static NetBatchRing_t	*s_pSendBatches[MAX_SOCKETS];
+static volatile bool	s_bBatchingSends = false;
+
+static bool NET_UseRecvRing( int sock )
+{
+	if ( sock >= MAX_SOCKETS || VCRGetMode() != VCR_Disabled )
+		return false;
+
+	// keep draining a ring that still holds datagrams after net_udp_batch was turned off
+	NetBatchRing_t *pRing = s_pRecvRings[sock];
+	return net_udp_batch.GetBool() || ( pRing && pRing->m_nNext < pRing->m_nCount );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: recvfrom replacement that refills the socket's ring with a single
+//  recvmmsg whenever it runs dry. Datagrams too big for a slot are reported as
+//  len bytes long so the caller discards them as oversize.
+//-----------------------------------------------------------------------------
+static int NET_ReceiveBatched( int sock, SOCKET s, char *buf, int len, struct sockaddr *from, int *fromlen )
+{
+	NetBatchRing_t *pRing = s_pRecvRings[sock];
+	if ( !pRing )
+	{
+		pRing = s_pRecvRings[sock] = new NetBatchRing_t;
+	}
+
+	if ( pRing->m_hSocket != s )
+	{
+		// socket was reopened, whatever is left belongs to the old one
+		pRing->m_hSocket = s;
+		pRing->m_nCount = 0;
+		pRing->m_nNext = 0;
+	}
+
+	if ( pRing->m_nNext >= pRing->m_nCount )
+	{
+		pRing->m_nCount = 0;
+		pRing->m_nNext = 0;
+
+		for ( int i=0; i < NET_BATCH_SLOTS; i++ )
+		{
+			pRing->m_Msgs[i].msg_hdr.msg_namelen = sizeof( pRing->m_Addrs[i] );
+			pRing->m_Msgs[i].msg_hdr.msg_flags = 0;
+		}
+
+		int nReceived;
+		{
+			VPROF_BUDGET( "recvmmsg", VPROF_BUDGETGROUP_OTHER_NETWORKING );
+			nReceived = recvmmsg( s, pRing->m_Msgs, NET_BATCH_SLOTS, MSG_DONTWAIT, NULL );
+		}
+
+		if ( nReceived <= 0 )
+		{
+			if ( nReceived == 0 )
+			{
+				errno = EWOULDBLOCK;
+			}
+			return -1;
+		}
+
+		pRing->m_nCount = nReceived;
+	}
+
+	int iSlot = pRing->m_nNext++;
+	const mmsghdr &msg = pRing->m_Msgs[iSlot];
+
+	int nBytes = min( (int)msg.msg_len, len );
+	Q_memcpy( buf, pRing->m_Data[iSlot], nBytes );
+
+	int nFromLen = min( *fromlen, (int)msg.msg_hdr.msg_namelen );
+	Q_memcpy( from, msg.msg_hdr.msg_name, nFromLen );
+	*fromlen = nFromLen;
+
+	if ( msg.msg_hdr.msg_flags & MSG_TRUNC )
+		return len;
+
+	return nBytes;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Writes out everything in the batch, skipping (and reporting) any
+//  datagram the kernel refuses. Caller holds the batch mutex.
+//-----------------------------------------------------------------------------
+static void NET_FlushSendBatch( NetBatchRing_t *pBatch )
+{
+	VPROF_BUDGET( "sendmmsg", VPROF_BUDGETGROUP_OTHER_NETWORKING );
+
+	int nSent = 0;
+	while ( nSent < pBatch->m_nCount )
+	{
+		int ret = sendmmsg( pBatch->m_hSocket, &pBatch->m_Msgs[nSent], pBatch->m_nCount - nSent, 0 );
+		if ( ret > 0 )
+		{
+			nSent += ret;
+			continue;
+		}
+
+		int nError = errno;
+		if ( nError == EINTR )
+			continue;
+
+		// wouldblock and connreset are silent, same as NET_SendPacket
+		if ( nError != EWOULDBLOCK && nError != ECONNRESET )
+		{
+			netadr_t adr;
+			adr.SetFromSockadr( &pBatch->m_Addrs[nSent] );
+			ConDMsg( "NET_SendPacket Warning: %s : %s\n", NET_ErrorString( nError ), adr.ToString() );
+		}
+		++nSent;
+	}
+
+	pBatch->m_nCount = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Copies the datagram into its socket's batch if batching is on.
+//  Returns false if the caller should send it right away instead.
+//-----------------------------------------------------------------------------
+static bool NET_QueueBatchedSend( SOCKET s, const char *buf, int len, const struct sockaddr *to, int tolen )
+{
+	if ( !s_bBatchingSends )
+		return false;
+
+	NetBatchRing_t *pBatch = NULL;
+	for ( int i=0; i < MAX_SOCKETS; i++ )
+	{
+		if ( s_pSendBatches[i] && s_pSendBatches[i]->m_hSocket == s )
+		{
+			pBatch = s_pSendBatches[i];
+			break;
+		}
+	}
+
+	if ( !pBatch )
+		return false;
+
+	AUTO_LOCK( pBatch->m_Mutex );
+
+	// NET_FlushBatchedSend may have run since the check above
+	if ( !s_bBatchingSends )
+		return false;
+
+	if ( len > NET_BATCH_SLOT_SIZE || tolen > (int)sizeof( struct sockaddr ) )
+	{
+		// send what is already queued first so this one doesn't overtake it
+		NET_FlushSendBatch( pBatch );
+		return false;
+	}
+
+	if ( pBatch->m_nCount == NET_BATCH_SLOTS )
+	{
+		NET_FlushSendBatch( pBatch );
+	}
+
+	int iSlot = pBatch->m_nCount++;
+	Q_memcpy( pBatch->m_Data[iSlot], buf, len );
+	Q_memcpy( &pBatch->m_Addrs[iSlot], to, tolen );
+	pBatch->m_Iovs[iSlot].iov_len = len;
+	pBatch->m_Msgs[iSlot].msg_hdr.msg_namelen = tolen;
+	return true;
+}
+
+void NET_BeginBatchedSend()
+{
+	if ( !net_udp_batch.GetBool() || VCRGetMode() != VCR_Disabled || !net_multiplayer )
+		return;
+
+	for ( int i=0; i < MAX_SOCKETS && i < net_sockets.Count(); i++ )
+	{
+		if ( !net_sockets[i].hUDP )
+			continue;
+
+		if ( !s_pSendBatches[i] )
+		{
+			s_pSendBatches[i] = new NetBatchRing_t;
+		}
+
+		Assert( s_pSendBatches[i]->m_nCount == 0 );
+		s_pSendBatches[i]->m_hSocket = net_sockets[i].hUDP;
+	}
+
+	s_bBatchingSends = true;
+}
+
+void NET_FlushBatchedSend()
+{
+	if ( !s_bBatchingSends )
+		return;
+
+	s_bBatchingSends = false;
+
+	for ( int i=0; i < MAX_SOCKETS; i++ )
+	{
+		if ( s_pSendBatches[i] )
+		{
+			AUTO_LOCK( s_pSendBatches[i]->m_Mutex );
+			NET_FlushSendBatch( s_pSendBatches[i] );
+		}
+	}
+}
+
+static void NET_FreeBatchRings()
+{
+	for ( int i=0; i < MAX_SOCKETS; i++ )
+	{
+		delete s_pRecvRings[i];
+		s_pRecvRings[i] = NULL;
+		delete s_pSendBatches[i];
+		s_pSendBatches[i] = NULL;
+	}
+}
+
+#else
+
+void NET_BeginBatchedSend()
+{
+}
+
+void NET_FlushBatchedSend()
+{
+}
+
+#endif // LINUX
+
 bool NET_ReceiveDatagram ( const int sock, netpacket_t * packet )
 {
 	VPROF_BUDGET( "NET_ReceiveDatagram", VPROF_BUDGETGROUP_OTHER_NETWORKING );
@@ -1414,7 +1683,27 @@ bool NET_ReceiveDatagram ( const int sock, netpacket_t * packet )
 	int ret = 0;
 	{
 		VPROF_BUDGET( "recvfrom", VPROF_BUDGETGROUP_OTHER_NETWORKING );
-		ret = VCRHook_recvfrom(net_socket, (char *)packet->data, NET_MAX_MESSAGE, 0, (struct sockaddr *)&from, (int *)&fromlen );
+		if ( g_pNetReceiveThread->IsReceivingSocket( packet->source ) )
+		{
+			ret = g_pNetReceiveThread->ReceiveFrom( packet->source, (char *)packet->data, NET_MAX_MESSAGE, (struct sockaddr *)&from, &fromlen );
+			if ( ret < 0 )
+			{
+				// nothing queued, same as a recvfrom that would block
+				net_error = WSAEWOULDBLOCK;
+				return false;
+			}
+		}
+		else
+#if defined( LINUX )
+		if ( NET_UseRecvRing( packet->source ) )
+		{
+			ret = NET_ReceiveBatched( packet->source, net_socket, (char *)packet->data, NET_MAX_MESSAGE, (struct sockaddr *)&from, &fromlen );
+		}
+		else
+#endif
+		{
+			ret = VCRHook_recvfrom(net_socket, (char *)packet->data, NET_MAX_MESSAGE, 0, (struct sockaddr *)&from, (int *)&fromlen );
+		}
 	}
 	if ( ret >= NET_MIN_MESSAGE )
 	{
@@ -2009,6 +2298,13 @@ int NET_SendTo( bool verbose, SOCKET s, const char FAR * buf, int len, const str
 		}
 #endif // _WIN32
 
+#if defined( LINUX )
+		if ( NET_QueueBatchedSend( s, buf, len, to, tolen ) )
+		{
+			nSend = len;
+		}
+		else
+#endif
 		nSend = NET_SendToImpl
 		( 
 			s, 
@@ -2101,6 +2397,7 @@ struct SendQueue_t
 	}
 	int									m_nHostFrame;
 	CUtlLinkedList< SendQueueItem_t >	m_SendQueue;
+	CThreadFastMutex					m_Mutex;	// snapshots can be sent from several threads
 };
 
 static SendQueue_t g_SendQueue;
@@ -2115,6 +2412,7 @@ int NET_QueuePacketForSend( CNetChan *chan, bool verbose, SOCKET s, const char F
 	else
 	{
 		Assert( chan );
+		AUTO_LOCK( g_SendQueue.m_Mutex );
 		// Set up data structure
 		SendQueueItem_t *sq = &g_SendQueue.m_SendQueue[ g_SendQueue.m_SendQueue.AddToTail() ];
 		sq->m_Socket = s;
@@ -2145,6 +2443,7 @@ void NET_SendQueuedPacket( SendQueueItem_t *sq )
 
 void NET_ClearQueuedPacketsForChannel( INetChannel *channel )
 {
+	AUTO_LOCK( g_SendQueue.m_Mutex );
 	CUtlLinkedList< SendQueueItem_t >& list = g_SendQueue.m_SendQueue;
 
 	for ( unsigned short i = list.Head(); i != list.InvalidIndex();  )
@@ -2166,6 +2465,7 @@ void NET_SendQueuedPackets()
 		return;
 	g_SendQueue.m_nHostFrame = host_framecount;
 
+	AUTO_LOCK( g_SendQueue.m_Mutex );
 	CUtlLinkedList< SendQueueItem_t >& list = g_SendQueue.m_SendQueue;
 
 	int nRemaining = net_splitrate.GetInt();
@@ -2538,6 +2838,9 @@ NET_CloseAllSockets
 */
 void NET_CloseAllSockets (void)
 {
+	// the receive thread must not be reading from sockets we're about to close
+	g_pNetReceiveThread->Shutdown();
+
 	// shut down any existing and open sockets
 	for (int i=0 ; i<net_sockets.Count() ; i++)
 	{
@@ -2574,6 +2877,19 @@ void NET_FlushAllSockets( void )
 	char data[2048];
 	struct sockaddr	from;
 	int	fromlen = sizeof(from);
+
+	g_pNetReceiveThread->DiscardQueued();
+
+#if defined( LINUX )
+	for ( int i=0; i < MAX_SOCKETS; i++ )
+	{
+		if ( s_pRecvRings[i] )
+		{
+			s_pRecvRings[i]->m_nCount = 0;
+			s_pRecvRings[i]->m_nNext = 0;
+		}
+	}
+#endif
 	
 	for (int i=0 ; i<net_sockets.Count() ; i++)
 	{
@@ -2971,6 +3287,32 @@ NET_RunFrame
 RunFrame must be called each system frame before reading/sending on any socket
 ====================
 */
+//-----------------------------------------------------------------------------
+// Purpose: Starts, restarts or stops the receive thread to match net_receive_thread
+//  and the currently open server sockets.
+//-----------------------------------------------------------------------------
+static void NET_UpdateReceiveThread()
+{
+	int sockets[MAX_SOCKETS];
+	Q_memset( sockets, 0, sizeof( sockets ) );
+
+	if ( net_receive_thread.GetBool() && net_multiplayer && VCRGetMode() == VCR_Disabled )
+	{
+		static const int s_ServerSockets[] = { NS_SERVER, NS_HLTV, NS_SVLAN };
+		for ( int i=0; i < ARRAYSIZE( s_ServerSockets ); i++ )
+		{
+			int sock = s_ServerSockets[i];
+			if ( sock < net_sockets.Count() )
+			{
+				sockets[sock] = net_sockets[sock].hUDP;
+			}
+		}
+	}
+
+	// stops the thread if there's nothing left for it to read
+	g_pNetReceiveThread->Setup( sockets );
+}
+
 void NET_RunFrame( double flRealtime )
 {
 	NET_SetTime( flRealtime );
@@ -2991,6 +3333,8 @@ void NET_RunFrame( double flRealtime )
 
 	master->RunFrame();
 
+	NET_UpdateReceiveThread();
+
 #ifdef _X360
 	if ( net_logserver.GetInt() )
 	{
@@ -3338,6 +3682,9 @@ void NET_Shutdown (void)
 
 	NET_CloseAllSockets();
 	NET_ConfigLoopbackBuffers( false );
+#if defined( LINUX )
+	NET_FreeBatchRings();
+#endif
 
 #if defined(_WIN32)
 	if ( !net_noip )
@@ -0,0 +1,324 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Optional thread that drains the server's UDP sockets so the main
+//			thread only picks up already filtered datagrams.
+//
+//=============================================================================
+
+#include "net_ws_headers.h"
+#include "net_ws_receive_thread.h"
+#include "sv_ipratelimit.h"
+
+// memdbgon must be the last include file in a .cpp file!!!
+#include "tier0/memdbgon.h"
+
+ConVar net_receive_thread( "net_receive_thread", "0", 0, "Read server UDP sockets and rate limit connectionless queries on a separate thread." );
+
+#define NET_RECEIVE_QUEUE_SLOTS		256		// must be a power of two
+#define NET_RECEIVE_SLOT_SIZE		2048	// nothing the engine sends is bigger than MAX_ROUTABLE_PAYLOAD
+
+struct ReceivedDatagram_t
+{
+	int				m_nSize;
+	struct sockaddr	m_From;
+	byte			m_Data[NET_RECEIVE_SLOT_SIZE];
+};
+
+//-----------------------------------------------------------------------------
+// Single producer (receive thread) / single consumer (main thread) ring.
+// Each side keeps a cached copy of the other side's index and only does an
+// interlocked read of the real one when the ring looks full or empty.
+//-----------------------------------------------------------------------------
+class CReceiveQueue
+{
+public:
+	CReceiveQueue()
+	{
+		m_nTail = 0;
+		m_nCachedHead = 0;
+		m_nHead = 0;
+		m_nCachedTail = 0;
+	}
+
+	// Producer: slot to fill next, NULL if the ring is full
+	ReceivedDatagram_t *GetPushSlot()
+	{
+		if ( (uint32)( m_nTail - m_nCachedHead ) == NET_RECEIVE_QUEUE_SLOTS )
+		{
+			m_nCachedHead = ThreadInterlockedExchangeAdd( &m_nHead, 0 );
+			if ( (uint32)( m_nTail - m_nCachedHead ) == NET_RECEIVE_QUEUE_SLOTS )
+				return NULL;
+		}
+		return &m_Slots[m_nTail & ( NET_RECEIVE_QUEUE_SLOTS - 1 )];
+	}
+
+	// Producer: publish the slot returned by GetPushSlot
+	void Push()
+	{
+		ThreadInterlockedIncrement( &m_nTail );
+	}
+
+	// Consumer: oldest slot, NULL if the ring is empty
+	ReceivedDatagram_t *Peek()
+	{
+		if ( m_nHead == m_nCachedTail )
+		{
+			m_nCachedTail = ThreadInterlockedExchangeAdd( &m_nTail, 0 );
+			if ( m_nHead == m_nCachedTail )
+				return NULL;
+		}
+		return &m_Slots[m_nHead & ( NET_RECEIVE_QUEUE_SLOTS - 1 )];
+	}
+
+	// Consumer: release the slot returned by Peek
+	void Pop()
+	{
+		ThreadInterlockedIncrement( &m_nHead );
+	}
+
+private:
+	// written by the producer
+	int32 volatile		m_nTail;
+	int32				m_nCachedHead;
+	byte				m_Pad0[64];
+
+	// written by the consumer
+	int32 volatile		m_nHead;
+	int32				m_nCachedTail;
+	byte				m_Pad1[64];
+
+	ReceivedDatagram_t	m_Slots[NET_RECEIVE_QUEUE_SLOTS];
+};
+
+class CNetReceiveThread : public CThread, public INetReceiveThread
+{
+public:
+	CNetReceiveThread();
+	~CNetReceiveThread();
+
+	// INetReceiveThread
+
+	virtual bool Setup( const int *pSockets );
+	virtual void Shutdown();
+	virtual bool IsRunning() { return CThread::IsAlive(); }
+
+	virtual bool IsReceivingSocket( int sock ) const;
+	virtual int ReceiveFrom( int sock, char *buf, int len, struct sockaddr *from, int *fromlen );
+	virtual void DiscardQueued();
+
+private:
+
+	// CThread Overrides
+	virtual int Run();
+
+	// Reads everything pending on the socket into its queue. Returns false if the queue filled up.
+	bool DrainSocket( int sock );
+
+	int				m_Sockets[MAX_SOCKETS];	// UDP handles as kept in net_sockets
+	CReceiveQueue	*m_pQueues[MAX_SOCKETS];
+	volatile bool	m_bThreadShouldExit;
+};
+
+static CNetReceiveThread g_NetReceiveThread;
+INetReceiveThread *g_pNetReceiveThread = &g_NetReceiveThread;
+
+
+CNetReceiveThread::CNetReceiveThread()
+{
+	SetName( "NetReceive" );
+	Q_memset( m_Sockets, 0, sizeof( m_Sockets ) );
+	Q_memset( m_pQueues, 0, sizeof( m_pQueues ) );
+	m_bThreadShouldExit = false;
+}
+
+CNetReceiveThread::~CNetReceiveThread()
+{
+	Shutdown();
+
+	for ( int i = 0; i < MAX_SOCKETS; i++ )
+	{
+		delete m_pQueues[i];
+	}
+}
+
+bool CNetReceiveThread::Setup( const int *pSockets )
+{
+	if ( IsAlive() && !Q_memcmp( m_Sockets, pSockets, sizeof( m_Sockets ) ) )
+		return true;
+
+	Shutdown();
+
+	bool bAnySockets = false;
+	for ( int i = 0; i < MAX_SOCKETS; i++ )
+	{
+		if ( !pSockets[i] )
+			continue;
+
+		if ( !m_pQueues[i] )
+		{
+			m_pQueues[i] = new CReceiveQueue;
+		}
+		bAnySockets = true;
+	}
+
+	if ( !bAnySockets )
+		return false;
+
+	Q_memcpy( m_Sockets, pSockets, sizeof( m_Sockets ) );
+	m_bThreadShouldExit = false;
+
+	if ( !Start() )
+	{
+		Q_memset( m_Sockets, 0, sizeof( m_Sockets ) );
+		return false;
+	}
+
+	return true;
+}
+
+void CNetReceiveThread::Shutdown()
+{
+	if ( IsAlive() )
+	{
+		m_bThreadShouldExit = true;
+		Join(); // Wait for the thread to exit.
+	}
+
+	// anything still queued goes away with the thread, the main thread reads the sockets itself again
+	DiscardQueued();
+	Q_memset( m_Sockets, 0, sizeof( m_Sockets ) );
+}
+
+bool CNetReceiveThread::IsReceivingSocket( int sock ) const
+{
+	return sock >= 0 && sock < MAX_SOCKETS && m_Sockets[sock] != 0;
+}
+
+int CNetReceiveThread::ReceiveFrom( int sock, char *buf, int len, struct sockaddr *from, int *fromlen )
+{
+	Assert( IsReceivingSocket( sock ) );
+
+	ReceivedDatagram_t *pDatagram = m_pQueues[sock]->Peek();
+	if ( !pDatagram )
+		return -1;
+
+	int nSize = min( pDatagram->m_nSize, len );
+	Q_memcpy( buf, pDatagram->m_Data, nSize );
+
+	int nFromLen = min( *fromlen, (int)sizeof( pDatagram->m_From ) );
+	Q_memcpy( from, &pDatagram->m_From, nFromLen );
+	*fromlen = nFromLen;
+
+	m_pQueues[sock]->Pop();
+	return nSize;
+}
+
+void CNetReceiveThread::DiscardQueued()
+{
+	for ( int i = 0; i < MAX_SOCKETS; i++ )
+	{
+		if ( !m_pQueues[i] )
+			continue;
+
+		while ( m_pQueues[i]->Peek() )
+		{
+			m_pQueues[i]->Pop();
+		}
+	}
+}
+
+int CNetReceiveThread::Run()
+{
+	while ( !m_bThreadShouldExit )
+	{
+		fd_set readSet;
+		FD_ZERO( &readSet );
+
+		int maxSocket = 0;
+		for ( int i = 0; i < MAX_SOCKETS; i++ )
+		{
+			if ( m_Sockets[i] )
+			{
+				FD_SET( m_Sockets[i], &readSet );
+				maxSocket = max( maxSocket, m_Sockets[i] );
+			}
+		}
+
+		// wake up every now and then to see if we should exit
+		struct timeval tv;
+		tv.tv_sec = 0;
+		tv.tv_usec = 10 * 1000;
+
+		if ( select( maxSocket + 1, &readSet, NULL, NULL, &tv ) <= 0 )
+			continue;
+
+		bool bQueueFull = false;
+		for ( int i = 0; i < MAX_SOCKETS; i++ )
+		{
+			if ( m_Sockets[i] && FD_ISSET( m_Sockets[i], &readSet ) )
+			{
+				bQueueFull |= !DrainSocket( i );
+			}
+		}
+
+		// The main thread is behind. Leave the rest in the socket buffer and give it a moment
+		// rather than spinning on select.
+		if ( bQueueFull )
+		{
+			ThreadSleep( 1 );
+		}
+	}
+
+	return 0;
+}
+
+bool CNetReceiveThread::DrainSocket( int sock )
+{
+	SOCKET s = m_Sockets[sock];
+	CReceiveQueue *pQueue = m_pQueues[sock];
+
+	for ( ;; )
+	{
+		ReceivedDatagram_t *pSlot = pQueue->GetPushSlot();
+		if ( !pSlot )
+			return false;
+
+		socklen_t fromlen = sizeof( pSlot->m_From );
+#ifdef POSIX
+		// MSG_TRUNC makes recvfrom return the real size so oversize datagrams can be told apart
+		int ret = recvfrom( s, (char *)pSlot->m_Data, sizeof( pSlot->m_Data ), MSG_TRUNC, &pSlot->m_From, &fromlen );
+#else
+		int ret = recvfrom( s, (char *)pSlot->m_Data, sizeof( pSlot->m_Data ), 0, &pSlot->m_From, &fromlen );
+#endif
+
+		if ( ret < 0 )
+		{
+#ifdef _WIN32
+			int nError = WSAGetLastError();
+#else
+			int nError = errno;
+#endif
+			// these are per datagram, keep going
+			if ( nError == WSAECONNRESET || nError == WSAECONNREFUSED || nError == WSAEMSGSIZE )
+				continue;
+
+			return true;
+		}
+
+		// NET_ReceiveDatagram ignores runts, and oversize datagrams are never sent by the engine
+		if ( ret < NET_MIN_MESSAGE || ret > NET_RECEIVE_SLOT_SIZE )
+			continue;
+
+		if ( LittleLong( *(unsigned int *)pSlot->m_Data ) == CONNECTIONLESS_HEADER )
+		{
+			netadr_t adr;
+			adr.SetFromSockadr( &pSlot->m_From );
+
+			if ( !SV_PrefilterConnectionlessPacket( sock, adr, pSlot->m_Data, ret ) )
+				continue;
+		}
+
+		pSlot->m_nSize = ret;
+		pQueue->Push();
+	}
+}
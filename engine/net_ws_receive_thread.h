@@ -0,0 +1,39 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Optional thread that drains the server's UDP sockets so the main
+//			thread only picks up already filtered datagrams.
+//
+//=============================================================================
+
+#ifndef NET_WS_RECEIVE_THREAD_H
+#define NET_WS_RECEIVE_THREAD_H
+#ifdef _WIN32
+#pragma once
+#endif
+
+class ConVar;
+
+class INetReceiveThread
+{
+public:
+	// (Re)starts the thread on the given UDP sockets, indexed by NS_*, 0 to leave a socket
+	// to the main thread. Does nothing if it is already running on the same sockets.
+	virtual bool Setup( const int *pSockets ) = 0;
+	virtual void Shutdown() = 0;
+	virtual bool IsRunning() = 0;
+
+	// True if datagrams for this socket must come from ReceiveFrom rather than the socket
+	virtual bool IsReceivingSocket( int sock ) const = 0;
+
+	// Pops the next datagram queued for the socket. Returns -1 if there is none, otherwise
+	// the same as recvfrom. Main thread only.
+	virtual int ReceiveFrom( int sock, char *buf, int len, struct sockaddr *from, int *fromlen ) = 0;
+
+	// Throws away everything queued so far. Main thread only.
+	virtual void DiscardQueued() = 0;
+};
+
+extern INetReceiveThread *g_pNetReceiveThread;
+extern ConVar net_receive_thread;
+
+#endif // NET_WS_RECEIVE_THREAD_H
@@ -177,9 +177,11 @@ class IServerGameDLL;
 class IServerGameEnts;
 class IServerGameClients;
 class IServerGameTags;
+class IServerGameEntsEx;
 extern IServerGameDLL	*serverGameDLL;
 extern int g_iServerGameDLLVersion;
 extern IServerGameEnts *serverGameEnts;
+extern IServerGameEntsEx *serverGameEntsEx;
 
 extern IServerGameClients *serverGameClients;
 extern int g_iServerGameClientsVersion;	// This matches the number at the end of the interface name (so for "ServerGameClients004", this would be 4).
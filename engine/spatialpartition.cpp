@@ -120,7 +120,55 @@ struct LeafListData_t
 
 typedef CUtlFixedLinkedList<LeafListData_t>	CLeafList;
 
-typedef CVarBitVec CPartitionVisits;
+//-----------------------------------------------------------------------------
+// The elements an enumeration has already handed out. Each visit bumps the
+// stamp instead of clearing every element's entry.
+//-----------------------------------------------------------------------------
+class CPartitionVisits
+{
+public:
+	CPartitionVisits() : m_nStamp( 0 ), m_bReadLocked( false ) {}
+
+	void Begin( int nVisitBits )
+	{
+		Grow( nVisitBits );
+		if ( ++m_nStamp == 0 )
+		{
+			// Wrapped, forget every old stamp
+			memset( m_Stamps.Base(), 0, m_Stamps.Count() * sizeof( unsigned int ) );
+			m_nStamp = 1;
+		}
+	}
+
+	// Returns false if the element was already visited
+	bool Visit( int nVisitBit )
+	{
+		// Elements can be inserted after the visit started
+		Grow( nVisitBit + 1 );
+		if ( m_Stamps[nVisitBit] == m_nStamp )
+			return false;
+
+		m_Stamps[nVisitBit] = m_nStamp;
+		return true;
+	}
+
+	// Whether the enumeration holds the tree's read lock
+	bool m_bReadLocked;
+
+private:
+	void Grow( int nCount )
+	{
+		int nOldCount = m_Stamps.Count();
+		if ( nOldCount < nCount )
+		{
+			m_Stamps.AddMultipleToTail( nCount - nOldCount );
+			memset( m_Stamps.Base() + nOldCount, 0, ( nCount - nOldCount ) * sizeof( unsigned int ) );
+		}
+	}
+
+	CUtlVector<unsigned int> m_Stamps;
+	unsigned int m_nStamp;
+};
 
 //-----------------------------------------------------------------------------
 // Used when rendering the various levels of the voxel hash
@@ -160,6 +208,32 @@ class CSpatialEntry
 public:
 	SpatialPartitionHandle_t m_handle;
 	uint16 m_nListMask;
+	int m_nBoundsSlot;		// Slot in the voxel's CVoxelBounds
+};
+
+//-----------------------------------------------------------------------------
+// The bounds of the entities in a voxel, four to a group, so box and ray
+// queries can reject four entities at once without touching EntityInfo_t
+//-----------------------------------------------------------------------------
+struct VoxelBounds4_t
+{
+	float	m_flMins[3][4];
+	float	m_flMaxs[3][4];
+};
+
+class CVoxelBounds
+{
+public:
+	int Count() const	{ return m_Entities.Count(); }
+
+	CUtlVectorFixedGrowable< VoxelBounds4_t, 1 >	m_Bounds;
+	CUtlVectorFixedGrowable< intp, 4 >				m_Entities;		// m_aEntityList index of each slot
+};
+
+struct VoxelData_t
+{
+	intp	m_iEntityHead;	// Head of the voxel's entity list (m_aEntityList)
+	intp	m_iBounds;		// Entity bounds (m_aVoxelBounds)
 };
 //-----------------------------------------------------------------------------
 // A single voxel hash
@@ -186,6 +260,9 @@ public:
 	void RemoveFromTree( SpatialPartitionHandle_t hPartition );
 	void UpdateListMask( SpatialPartitionHandle_t hPartition );
 
+	// Copies the entity bounds into the voxels it's in, for moves that stay in the same voxels
+	void UpdateBounds( SpatialPartitionHandle_t hPartition );
+
 	// Debug!
 	void RenderAllObjectsInTree( float flTime );
 	void RenderObjectsInPlayerLeafs( const Vector &vecPlayerMin, const Vector &vecPlayerMax, float flTime );
@@ -224,6 +301,9 @@ public:
 	// Enumeration method when only 1 voxel is ever visited
 	template <class T> bool EnumerateElementsInSingleVoxel( Voxel_t voxel, const T &intersectTest, SpatialPartitionListMask_t listMask, IPartitionEnumerator* pIterator );
 
+	// Bounds test for one group of four entities in a voxel
+	template <class T> int CollectHitsInGroup( Voxel_t voxel, int nGroup, const T &intersectTest, CSpatialEntry *pHits );
+
 	bool EnumerateElementsAlongRay_ExtrudedRaySlice( SpatialPartitionListMask_t listMask, IPartitionEnumerator *pIterator, const CIntersectSweptBox &intersectSweptBox,	int voxelMin[3], int voxelMax[3], int iAxis, int *pStep );
 private:
 	bool EnumerateElementsAlongRay_Ray( SpatialPartitionListMask_t listMask, const Ray_t &ray, const Vector &vecInvDelta, const Vector &vecEnd, IPartitionEnumerator* pIterator );
@@ -231,12 +311,18 @@ private:
 
 	inline void PackVoxel( int iX, int iY, int iZ, Voxel_t &voxel );
 
-    typedef CUtlHashFixed<intp, SPHASH_BUCKET_COUNT, CUtlHashFixedGenericHash<SPHASH_BUCKET_COUNT> > CHashTable;
+	// Entity bounds slots
+	void AddBounds( intp iBounds, intp iEntity, const EntityInfo_t &info );
+	void RemoveBounds( intp iBounds, intp iEntity );
+	void SetBounds( CVoxelBounds &bounds, int nSlot, const EntityInfo_t &info );
+
+    typedef CUtlHashFixed<VoxelData_t, SPHASH_BUCKET_COUNT, CUtlHashFixedGenericHash<SPHASH_BUCKET_COUNT> > CHashTable;
 
 	Vector											m_vecVoxelOrigin;	// Voxel space (hash) origin.
-	CHashTable										m_aVoxelHash;		// Voxel tree (hash) - data = entity list head handle (m_aEntityList)
+	CHashTable										m_aVoxelHash;		// Voxel tree (hash) - data = entity list head handle (m_aEntityList) and bounds
 	int												m_nVoxelDelta[3];	// Voxel world - width(Dx), height(Dy), depth(Dz)
 	CUtlFixedLinkedList<CSpatialEntry>				m_aEntityList;	// Pool - Linked list(multilist) of entities per leaf.
+	CUtlFixedLinkedList<CVoxelBounds>				m_aVoxelBounds;	// Pool - Entity bounds per leaf.
 	CVoxelTree										*m_pTree;
 	int												m_nLevel;
 	float											m_flVoxelSize;
@@ -293,8 +379,14 @@ public:
 	void LockForWrite()		{ m_lock.LockForWrite(); }
 	void UnlockWrite()		{ m_lock.UnlockWrite(); }
 
-	void LockForRead()		{ m_lock.LockForRead(); }
-	void UnlockRead()		{ m_lock.UnlockRead(); }
+	// Readers don't lock while the tree is read only. Pass what LockForRead
+	// returned to UnlockRead, the mode may change in between.
+	bool LockForRead()				{ if ( m_bReadOnly ) return false; m_lock.LockForRead(); return true; }
+	void UnlockRead( bool bLocked )	{ if ( bLocked ) m_lock.UnlockRead(); }
+
+	// See ISpatialPartitionInternal::BeginConcurrentReads
+	void SetReadOnly( bool bReadOnly );
+	bool IsReadOnly() const			{ return m_bReadOnly; }
 
 	// Ray casting
 	bool EnumerateElementsAlongRay_Ray( SpatialPartitionListMask_t listMask, const Ray_t &ray, const Vector &vecInvDelta, const Vector &vecEnd, IPartitionEnumerator *pIterator );
@@ -312,12 +404,13 @@ private:
 	CVoxelHash*							m_pVoxelHash;
 	CLeafList							m_aLeafList;								// Pool - Linked list(multilist) of leaves per entity.
 	int									m_TreeId;
-	CPartitionVisits *                  m_pVisits[MAX_THREADS_SUPPORTED];
+	CTHREADLOCALPTR( CPartitionVisits )	m_pVisits;
 	CSpatialPartition *					m_pOwner;
 	CUtlVector<unsigned short>			m_AvailableVisitBits;
 	unsigned short						m_nNextVisitBit;
 	CTSPool<CPartitionVisits>			m_FreeVisits;
 	CThreadSpinRWLock					m_lock;
+	volatile bool						m_bReadOnly;
 };
 
 //-----------------------------------------------------------------------------
@@ -381,6 +474,8 @@ public:
 	virtual void RenderObjectsInPlayerLeafs( const Vector &vecPlayerMin, const Vector &vecPlayerMax, float flTime );
 	virtual void ReportStats( const char *pFileName );
 	virtual void DrawDebugOverlays();
+	virtual void BeginConcurrentReads( SpatialPartitionListMask_t listMask );
+	virtual void EndConcurrentReads( SpatialPartitionListMask_t listMask );
 
 	// Gets entity info (for enumerations).
 	EntityInfo_t &EntityInfo( SpatialPartitionHandle_t hPartition );
@@ -437,32 +532,23 @@ inline int CVoxelTree::GetTreeId() const
 
 inline CPartitionVisits *CVoxelTree::GetVisits()
 {
-	int nThread = g_nThreadID;
-	return m_pVisits[nThread];
+	return m_pVisits;
 }
 
 inline CPartitionVisits *CVoxelTree::BeginVisit()
 {
-	int nThread = g_nThreadID;
-	CPartitionVisits *pPrev = m_pVisits[nThread];
+	CPartitionVisits *pPrev = m_pVisits;
 	CPartitionVisits *pVisits = m_FreeVisits.GetObject();
-	if ( pVisits->GetNumBits() < m_nNextVisitBit )
-	{
-		pVisits->Resize( m_nNextVisitBit, true );
-	}
-	else
-	{
-		pVisits->ClearAll();
-	}
-	m_pVisits[g_nThreadID] = pVisits;
+	pVisits->Begin( m_nNextVisitBit );
+	pVisits->m_bReadLocked = false;
+	m_pVisits = pVisits;
 	return pPrev;
 }
 
 inline void CVoxelTree::EndVisit( CPartitionVisits *pPrev )
 {
-	int nThread = g_nThreadID;
-	m_FreeVisits.PutObject( m_pVisits[nThread] );
-	m_pVisits[nThread] = pPrev;
+	m_FreeVisits.PutObject( m_pVisits );
+	m_pVisits = pPrev;
 }
 
 inline CVoxelTree *CSpatialPartition::VoxelTree( SpatialPartitionListMask_t listMask )
@@ -681,6 +767,8 @@ void CVoxelHash::Init( CVoxelTree *pPartition, const Vector &worldmin, const Vec
 	}
 	m_aEntityList.Purge();
 	m_aEntityList.SetGrowSize( nGrowSize );
+	m_aVoxelBounds.Purge();
+	m_aVoxelBounds.SetGrowSize( nGrowSize );
 }
 
 
@@ -690,6 +778,7 @@ void CVoxelHash::Init( CVoxelTree *pPartition, const Vector &worldmin, const Vec
 void CVoxelHash::Shutdown( void )
 {
 	m_aEntityList.Purge();
+	m_aVoxelBounds.Purge();
 	m_aVoxelHash.Purge();
 }
 
@@ -740,14 +829,18 @@ void CVoxelHash::InsertIntoTree( SpatialPartitionHandle_t hPartition, Voxel_t vo
 				if ( hHash == m_aVoxelHash.InvalidHandle() )
 				{
 					// Add voxel(leaf) to hash.
-					hHash = m_aVoxelHash.FastInsert( voxel.uiVoxel, iEntity );
+					VoxelData_t voxelData;
+					voxelData.m_iEntityHead = iEntity;
+					voxelData.m_iBounds = m_aVoxelBounds.Alloc( true );
+					hHash = m_aVoxelHash.FastInsert( voxel.uiVoxel, voxelData );
 				}
 				else
 				{
-					intp iHead = m_aVoxelHash.Element( hHash );
+					intp iHead = m_aVoxelHash.Element( hHash ).m_iEntityHead;
 					m_aEntityList.LinkBefore( iHead, iEntity );
-					m_aVoxelHash[hHash] = iEntity;
+					m_aVoxelHash[hHash].m_iEntityHead = iEntity;
 				}
+				AddBounds( m_aVoxelHash[hHash].m_iBounds, iEntity, info );
 				
 				// Leaf list.
 				intp iLeafList = leafList.Alloc( true );
@@ -795,7 +888,8 @@ void CVoxelHash::RemoveFromTree( SpatialPartitionHandle_t hPartition )
 
 		// Get the head of the entity list for the voxel.
 		intp iEntity = leafList[iLeaf].m_iEntity;
-		intp iEntityHead = m_aVoxelHash[hHash];
+		intp iEntityHead = m_aVoxelHash[hHash].m_iEntityHead;
+		intp iBounds = m_aVoxelHash[hHash].m_iBounds;
 
 		if ( iEntityHead == iEntity )
 		{
@@ -803,12 +897,19 @@ void CVoxelHash::RemoveFromTree( SpatialPartitionHandle_t hPartition )
 			if ( iEntityNext == m_aEntityList.InvalidIndex() )
 			{
 				m_aVoxelHash.Remove( hHash );
+				m_aVoxelBounds.Remove( iBounds );
+				iBounds = m_aVoxelBounds.InvalidIndex();
 			}
 			else
 			{
-				m_aVoxelHash[hHash] = iEntityNext;
+				m_aVoxelHash[hHash].m_iEntityHead = iEntityNext;
 			}
 		}
+
+		if ( iBounds != m_aVoxelBounds.InvalidIndex() )
+		{
+			RemoveBounds( iBounds, iEntity );
+		}
 		
 		// Remove the entity from the entity list for the voxel.
 		m_aEntityList.Remove( iEntity );
@@ -835,7 +936,7 @@ void CVoxelHash::UpdateListMask( SpatialPartitionHandle_t hPartition )
 		UtlHashFixedHandle_t hHash = m_aVoxelHash.Find( vmin.uiVoxel );
 		if ( hHash != m_aVoxelHash.InvalidHandle() )
 		{
-			for ( intp i = m_aVoxelHash.Element( hHash ); i != m_aEntityList.InvalidIndex(); i = m_aEntityList.Next(i) )
+			for ( intp i = m_aVoxelHash.Element( hHash ).m_iEntityHead; i != m_aEntityList.InvalidIndex(); i = m_aEntityList.Next(i) )
 			{
 				SpatialPartitionHandle_t handle = m_aEntityList[i].m_handle;
 				if ( handle != hPartition )
@@ -866,7 +967,7 @@ void CVoxelHash::UpdateListMask( SpatialPartitionHandle_t hPartition )
 				UtlHashFixedHandle_t hHash = m_aVoxelHash.Find( voxel.uiVoxel );
 				if ( hHash != m_aVoxelHash.InvalidHandle() )
 				{
-					for ( intp i = m_aVoxelHash.Element( hHash ); i != m_aEntityList.InvalidIndex(); i = m_aEntityList.Next(i) )
+					for ( intp i = m_aVoxelHash.Element( hHash ).m_iEntityHead; i != m_aEntityList.InvalidIndex(); i = m_aEntityList.Next(i) )
 					{
 						if ( m_aEntityList[i].m_handle != hPartition )
 							continue;
@@ -880,6 +981,76 @@ void CVoxelHash::UpdateListMask( SpatialPartitionHandle_t hPartition )
 	}
 }
 
+//-----------------------------------------------------------------------------
+// Entity bounds slots. Removing a slot moves the last one into it.
+//-----------------------------------------------------------------------------
+void CVoxelHash::SetBounds( CVoxelBounds &bounds, int nSlot, const EntityInfo_t &info )
+{
+	VoxelBounds4_t &group = bounds.m_Bounds[ nSlot >> 2 ];
+	int nLane = nSlot & 3;
+	for ( int i = 0; i < 3; ++i )
+	{
+		group.m_flMins[i][nLane] = info.m_vecMin[i];
+		group.m_flMaxs[i][nLane] = info.m_vecMax[i];
+	}
+}
+
+void CVoxelHash::AddBounds( intp iBounds, intp iEntity, const EntityInfo_t &info )
+{
+	CVoxelBounds &bounds = m_aVoxelBounds[iBounds];
+	int nSlot = bounds.m_Entities.AddToTail( iEntity );
+	if ( ( nSlot & 3 ) == 0 )
+	{
+		bounds.m_Bounds.AddToTail();
+	}
+	SetBounds( bounds, nSlot, info );
+	m_aEntityList[iEntity].m_nBoundsSlot = nSlot;
+}
+
+void CVoxelHash::RemoveBounds( intp iBounds, intp iEntity )
+{
+	CVoxelBounds &bounds = m_aVoxelBounds[iBounds];
+	int nSlot = m_aEntityList[iEntity].m_nBoundsSlot;
+	int nLast = bounds.m_Entities.Count() - 1;
+	Assert( bounds.m_Entities[nSlot] == iEntity );
+	if ( nSlot != nLast )
+	{
+		intp iLastEntity = bounds.m_Entities[nLast];
+		bounds.m_Entities[nSlot] = iLastEntity;
+		m_aEntityList[iLastEntity].m_nBoundsSlot = nSlot;
+
+		const VoxelBounds4_t &lastGroup = bounds.m_Bounds[ nLast >> 2 ];
+		VoxelBounds4_t &group = bounds.m_Bounds[ nSlot >> 2 ];
+		for ( int i = 0; i < 3; ++i )
+		{
+			group.m_flMins[i][nSlot & 3] = lastGroup.m_flMins[i][nLast & 3];
+			group.m_flMaxs[i][nSlot & 3] = lastGroup.m_flMaxs[i][nLast & 3];
+		}
+	}
+
+	bounds.m_Entities.Remove( nLast );
+	if ( ( nLast & 3 ) == 0 )
+	{
+		bounds.m_Bounds.Remove( nLast >> 2 );
+	}
+}
+
+void CVoxelHash::UpdateBounds( SpatialPartitionHandle_t hPartition )
+{
+	EntityInfo_t &info = m_pTree->EntityInfo( hPartition );
+	CLeafList &leafList = m_pTree->LeafList();
+	for ( intp iLeaf = info.m_iLeafList[m_pTree->GetTreeId()]; iLeaf != leafList.InvalidIndex(); iLeaf = leafList.Next( iLeaf ) )
+	{
+		UtlHashFixedHandle_t hHash = leafList[iLeaf].m_hVoxel;
+		if ( hHash == m_aVoxelHash.InvalidHandle() )
+			continue;
+
+		CVoxelBounds &bounds = m_aVoxelBounds[ m_aVoxelHash[hHash].m_iBounds ];
+		SetBounds( bounds, m_aEntityList[ leafList[iLeaf].m_iEntity ].m_nBoundsSlot, info );
+	}
+}
+
+
 //-----------------------------------------------------------------------------
 // Purpose:
 //-----------------------------------------------------------------------------
@@ -972,14 +1143,7 @@ public:
 
 	bool Visit( SpatialPartitionHandle_t hPartition, EntityInfo_t &hInfo ) const
 	{
-		int nVisitBit = hInfo.m_nVisitBit[m_iTree];
-		if ( m_pVisits->IsBitSet( nVisitBit ) )
-		{
-			return false;
-		}
-
-		m_pVisits->Set( nVisitBit );
-		return true;
+		return m_pVisits->Visit( hInfo.m_nVisitBit[m_iTree] );
 	}
 
 private:
@@ -1011,11 +1175,47 @@ private:
 };
 */
 
+//-----------------------------------------------------------------------------
+// Ray test against four boxes, each expanded by the extents. The extents
+// include some slop, this only has to reject what the exact test would.
+//-----------------------------------------------------------------------------
+#define SPHASH_RAY_SLOP		0.125f
+
+inline int IntersectRayWithFourBoxes( const VoxelBounds4_t &bounds, const fltx4 *pStart, const fltx4 *pInvDelta, const fltx4 *pExtents )
+{
+	fltx4 f4Near = Four_Zeros;
+	fltx4 f4Far = Four_Ones;
+	for ( int i = 0; i < 3; ++i )
+	{
+		fltx4 f4Min = SubSIMD( SubSIMD( LoadUnalignedSIMD( bounds.m_flMins[i] ), pExtents[i] ), pStart[i] );
+		fltx4 f4Max = SubSIMD( AddSIMD( LoadUnalignedSIMD( bounds.m_flMaxs[i] ), pExtents[i] ), pStart[i] );
+		f4Min = MulSIMD( f4Min, pInvDelta[i] );
+		f4Max = MulSIMD( f4Max, pInvDelta[i] );
+		f4Near = MaxSIMD( f4Near, MinSIMD( f4Min, f4Max ) );
+		f4Far = MinSIMD( f4Far, MaxSIMD( f4Min, f4Max ) );
+	}
+	return TestSignSIMD( CmpLeSIMD( f4Near, f4Far ) );
+}
+
 class CIntersectBox : public CPartitionVisitor
 {
 public:
 	CIntersectBox( CVoxelTree *pPartition, const Vector &vecMins, const Vector &vecMaxs ) : CPartitionVisitor( pPartition ), m_vecMins( vecMins ), m_vecMaxs( vecMaxs )
 	{
+		for ( int i = 0; i < 3; ++i )
+		{
+			m_f4Mins[i] = ReplicateX4( vecMins[i] );
+			m_f4Maxs[i] = ReplicateX4( vecMaxs[i] );
+		}
+	}
+
+	// Returns a mask of which of the four boxes intersect
+	int IntersectsFour( const VoxelBounds4_t &bounds ) const
+	{
+		fltx4 f4Hit = AndSIMD( CmpLeSIMD( LoadUnalignedSIMD( bounds.m_flMins[0] ), m_f4Maxs[0] ), CmpGeSIMD( LoadUnalignedSIMD( bounds.m_flMaxs[0] ), m_f4Mins[0] ) );
+		f4Hit = AndSIMD( f4Hit, AndSIMD( CmpLeSIMD( LoadUnalignedSIMD( bounds.m_flMins[1] ), m_f4Maxs[1] ), CmpGeSIMD( LoadUnalignedSIMD( bounds.m_flMaxs[1] ), m_f4Mins[1] ) ) );
+		f4Hit = AndSIMD( f4Hit, AndSIMD( CmpLeSIMD( LoadUnalignedSIMD( bounds.m_flMins[2] ), m_f4Maxs[2] ), CmpGeSIMD( LoadUnalignedSIMD( bounds.m_flMaxs[2] ), m_f4Mins[2] ) ) );
+		return TestSignSIMD( f4Hit );
 	}
 
 	bool Intersects( const float *pMins, const float *pMaxs ) const
@@ -1033,6 +1233,8 @@ public:
 private:
 	const Vector &m_vecMins;
 	const Vector &m_vecMaxs;
+	fltx4 m_f4Mins[3];
+	fltx4 m_f4Maxs[3];
 };
 
 class CIntersectRay : public CPartitionVisitor
@@ -1043,6 +1245,18 @@ public:
 		m_f4Start = LoadAlignedSIMD( ray.m_Start.Base() );
 		m_f4Delta = LoadAlignedSIMD( ray.m_Delta.Base() );
 		m_f4InvDelta = LoadUnaligned3SIMD( vecInvDelta.Base() );
+		for ( int i = 0; i < 3; ++i )
+		{
+			m_f4StartAxis[i] = ReplicateX4( ray.m_Start[i] );
+			m_f4InvDeltaAxis[i] = ReplicateX4( vecInvDelta[i] );
+			m_f4Slop[i] = ReplicateX4( SPHASH_RAY_SLOP );
+		}
+	}
+
+	// Returns a mask of which of the four boxes may intersect
+	int IntersectsFour( const VoxelBounds4_t &bounds ) const
+	{
+		return IntersectRayWithFourBoxes( bounds, m_f4StartAxis, m_f4InvDeltaAxis, m_f4Slop );
 	}
 
 	bool Intersects( const float *pMins, const float *pMaxs ) const
@@ -1061,6 +1275,9 @@ private:
 	fltx4 m_f4Start;
 	fltx4 m_f4Delta;
 	fltx4 m_f4InvDelta;
+	fltx4 m_f4StartAxis[3];
+	fltx4 m_f4InvDeltaAxis[3];
+	fltx4 m_f4Slop[3];
 };
 
 
@@ -1073,6 +1290,18 @@ public:
 		m_f4Delta = LoadAlignedSIMD( ray.m_Delta.Base() );
 		m_f4Extents = LoadAlignedSIMD( ray.m_Extents.Base() );
 		m_f4InvDelta = LoadUnaligned3SIMD( vecInvDelta.Base() );
+		for ( int i = 0; i < 3; ++i )
+		{
+			m_f4StartAxis[i] = ReplicateX4( ray.m_Start[i] );
+			m_f4InvDeltaAxis[i] = ReplicateX4( vecInvDelta[i] );
+			m_f4ExtentsAxis[i] = ReplicateX4( ray.m_Extents[i] + SPHASH_RAY_SLOP );
+		}
+	}
+
+	// Returns a mask of which of the four boxes may intersect
+	int IntersectsFour( const VoxelBounds4_t &bounds ) const
+	{
+		return IntersectRayWithFourBoxes( bounds, m_f4StartAxis, m_f4InvDeltaAxis, m_f4ExtentsAxis );
 	}
 
 	bool Intersects( const float *pMins, const float *pMaxs ) const
@@ -1094,47 +1323,85 @@ private:
 	fltx4 m_f4Delta;
 	fltx4 m_f4InvDelta;
 	fltx4 m_f4Extents;
+	fltx4 m_f4StartAxis[3];
+	fltx4 m_f4InvDeltaAxis[3];
+	fltx4 m_f4ExtentsAxis[3];
 };
 
 //-----------------------------------------------------------------------------
-// Purpose:
+// Tests one group of four bounds in a voxel and copies out the list entries
+// of the hits. The callbacks run after this may change the voxel, so
+// the voxel and its bounds are looked up again for every group and never held
+// across them. Returns -1 once there are no more groups.
 //-----------------------------------------------------------------------------
 template <class T> 
-bool CVoxelHash::EnumerateElementsInVoxel( Voxel_t voxel, const T &intersectTest, SpatialPartitionListMask_t listMask, IPartitionEnumerator* pIterator )
+inline int CVoxelHash::CollectHitsInGroup( Voxel_t voxel, int nGroup, const T &intersectTest, CSpatialEntry *pHits )
 {
-	// If the voxel doesn't exist, nothing to iterate over
+	// The voxel is freed when its last entity leaves
 	UtlHashFixedHandle_t hHash = m_aVoxelHash.Find( voxel.uiVoxel );
 	if ( hHash == m_aVoxelHash.InvalidHandle() )
-		return true;
+		return -1;
 
-	for ( intp i = m_aVoxelHash.Element( hHash ); i != m_aEntityList.InvalidIndex(); i = m_aEntityList.Next(i) )
+	const CVoxelBounds &bounds = m_aVoxelBounds[ m_aVoxelHash.Element( hHash ).m_iBounds ];
+	if ( nGroup * 4 >= bounds.Count() )
+		return -1;
+
+	int nCount = 0;
+	int nHits = intersectTest.IntersectsFour( bounds.m_Bounds[nGroup] );
+	for ( int nLane = 0; nHits; ++nLane, nHits >>= 1 )
 	{
-		SpatialPartitionHandle_t handle = m_aEntityList[i].m_handle;
-		SpatialPartitionListMask_t nListMask = m_aEntityList[i].m_nListMask;
-		if ( handle == PARTITION_INVALID_HANDLE )
-			continue;
+		int nSlot = nGroup * 4 + nLane;
+		if ( ( nHits & 1 ) && nSlot < bounds.Count() )
+		{
+			pHits[nCount++] = m_aEntityList[ bounds.m_Entities[nSlot] ];
+		}
+	}
+	return nCount;
+}
 
-		// Keep going if this dude isn't in the list
-		if ( !( listMask & nListMask ) )
-			continue;
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+template <class T> 
+bool CVoxelHash::EnumerateElementsInVoxel( Voxel_t voxel, const T &intersectTest, SpatialPartitionListMask_t listMask, IPartitionEnumerator* pIterator )
+{
+	// Test four bounds at a time, only the hits need the entity
+	CSpatialEntry hits[4];
+	for ( int nGroup = 0; ; ++nGroup )
+	{
+		int nHits = CollectHitsInGroup( voxel, nGroup, intersectTest, hits );
+		if ( nHits < 0 )
+			break;
 
-		EntityInfo_t &hInfo = m_pTree->EntityInfo( handle );
-		Assert( hInfo.m_fList == nListMask );
+		for ( int nHit = 0; nHit < nHits; ++nHit )
+		{
+			SpatialPartitionHandle_t handle = hits[nHit].m_handle;
+			SpatialPartitionListMask_t nListMask = hits[nHit].m_nListMask;
+			if ( handle == PARTITION_INVALID_HANDLE )
+				continue;
 
-		if ( hInfo.m_flags & ENTITY_HIDDEN )
-			continue;
+			// Keep going if this dude isn't in the list
+			if ( !( listMask & nListMask ) )
+				continue;
 
-		// Has this handle already been visited?
-		if ( !intersectTest.Visit( handle, hInfo ) )
-			continue;
+			EntityInfo_t &hInfo = m_pTree->EntityInfo( handle );
+			Assert( hInfo.m_fList == nListMask );
 
-		// Intersection test
-		if ( !intersectTest.Intersects( hInfo.m_vecMin.Base(), hInfo.m_vecMax.Base() ) )
-			continue;
+			if ( hInfo.m_flags & ENTITY_HIDDEN )
+				continue;
 
-		// Okay, this one is good...
-		if ( pIterator->EnumElement( hInfo.m_pHandleEntity ) == ITERATION_STOP )
-			return false;
+			// Has this handle already been visited?
+			if ( !intersectTest.Visit( handle, hInfo ) )
+				continue;
+
+			// Intersection test
+			if ( !intersectTest.Intersects( hInfo.m_vecMin.Base(), hInfo.m_vecMax.Base() ) )
+				continue;
+
+			// Okay, this one is good...
+			if ( pIterator->EnumElement( hInfo.m_pHandleEntity ) == ITERATION_STOP )
+				return false;
+		}
 	}
 
 	return true;
@@ -1150,16 +1417,17 @@ bool CVoxelHash::EnumerateElementsInSingleVoxel( Voxel_t voxel, const T &interse
 {
 	// NOTE: We don't have to do the enum id checking, nor do we have to up the
 	// nesting level, since this only visits 1 voxel.
-	intp iEntityList;
-	UtlHashFixedHandle_t hHash = m_aVoxelHash.Find( voxel.uiVoxel );
-	if ( hHash != m_aVoxelHash.InvalidHandle() )
+	CSpatialEntry hits[4];
+	for ( int nGroup = 0; ; ++nGroup )
 	{
-		iEntityList = m_aVoxelHash.Element( hHash );
-		while ( iEntityList != m_aEntityList.InvalidIndex() )
+		int nHits = CollectHitsInGroup( voxel, nGroup, intersectTest, hits );
+		if ( nHits < 0 )
+			break;
+
+		for ( int nHit = 0; nHit < nHits; ++nHit )
 		{
-			SpatialPartitionHandle_t handle = m_aEntityList[iEntityList].m_handle;
-			SpatialPartitionListMask_t nListMask = m_aEntityList[iEntityList].m_nListMask;
-			iEntityList = m_aEntityList.Next( iEntityList );
+			SpatialPartitionHandle_t handle = hits[nHit].m_handle;
+			SpatialPartitionListMask_t nListMask = hits[nHit].m_nListMask;
 			if ( handle == PARTITION_INVALID_HANDLE )
 				continue;
 
@@ -1605,7 +1873,7 @@ bool CVoxelHash::EnumerateElementsAtPoint( SpatialPartitionListMask_t listMask,
 	UtlHashFixedHandle_t hHash = m_aVoxelHash.Find( v.uiVoxel );
 	if ( hHash != m_aVoxelHash.InvalidHandle() )
 	{
-		iEntityList = m_aVoxelHash.Element( hHash );
+		iEntityList = m_aVoxelHash.Element( hHash ).m_iEntityHead;
 		while ( iEntityList != m_aEntityList.InvalidIndex() )
 		{
 			SpatialPartitionHandle_t handle = m_aEntityList[iEntityList].m_handle;
@@ -1740,7 +2008,7 @@ void CVoxelHash::RenderObjectsInVoxel( Voxel_t voxel, CPartitionVisitor *pVisito
 	if ( hHash == m_aVoxelHash.InvalidHandle() )
 		return;
 
-	intp iEntityList = m_aVoxelHash.Element( hHash );
+	intp iEntityList = m_aVoxelHash.Element( hHash ).m_iEntityHead;
 	while ( iEntityList != m_aEntityList.InvalidIndex() )
 	{
 		SpatialPartitionHandle_t hPartition = m_aEntityList[iEntityList].m_handle;
@@ -1771,7 +2039,7 @@ int CVoxelHash::EntityCount()
 	
 		while ( hHash != m_aVoxelHash.m_aBuckets[iBucket].InvalidIndex() )
 		{
-			intp iEntity = m_aVoxelHash.m_aBuckets[iBucket][hHash].m_Data;
+			intp iEntity = m_aVoxelHash.m_aBuckets[iBucket][hHash].m_Data.m_iEntityHead;
 			while ( iEntity!= m_aEntityList.InvalidIndex() )
 			{
 				++nCount;
@@ -1852,7 +2120,7 @@ void CVoxelHash::RenderAllObjectsInTree( float flTime )
 
 		while ( hHash != m_aVoxelHash.m_aBuckets[iBucket].InvalidIndex() )
 		{
-			intp iEntity = m_aVoxelHash.m_aBuckets[iBucket][hHash].m_Data;
+			intp iEntity = m_aVoxelHash.m_aBuckets[iBucket][hHash].m_Data.m_iEntityHead;
 			while ( iEntity!= m_aEntityList.InvalidIndex() )
 			{
 				SpatialPartitionHandle_t hPartition = m_aEntityList[iEntity].m_handle;
@@ -1905,7 +2173,7 @@ void CVoxelHash::RenderObjectsInPlayerLeafs( const Vector &vecPlayerMin, const V
 // Purpose: Constructor
 //-----------------------------------------------------------------------------
 
-CVoxelTree::CVoxelTree() : m_pVoxelHash( NULL ), m_pOwner( NULL ), m_nNextVisitBit( 0 )
+CVoxelTree::CVoxelTree() : m_pVoxelHash( NULL ), m_pOwner( NULL ), m_nNextVisitBit( 0 ), m_bReadOnly( false )
 {
 	// Compute max number of levels
 	m_nLevelCount = 0;
@@ -1951,7 +2219,8 @@ void CVoxelTree::Init( CSpatialPartition *pOwner, int iTree, const Vector &world
 	m_TreeId = iTree;
 
 	// Reset the enumeration id.
-	memset( m_pVisits, 0, sizeof( m_pVisits ) );
+	m_pVisits = NULL;
+	m_bReadOnly = false;
 
 	for ( int i = 0; i < m_nLevelCount; ++i )
 	{
@@ -1982,6 +2251,7 @@ void CVoxelTree::Shutdown( void )
 void CVoxelTree::InsertIntoTree( SpatialPartitionHandle_t hPartition, const Vector& mins, const Vector& maxs, bool bReinsert )
 {
 	Assert( hPartition != PARTITION_INVALID_HANDLE );
+	AssertMsg( !m_bReadOnly, "Moving a spatial partition element during concurrent reads" );
 
 	EntityInfo_t &info = EntityInfo( hPartition );
 
@@ -2025,14 +2295,19 @@ void CVoxelTree::InsertIntoTree( SpatialPartitionHandle_t hPartition, const Vect
 	// Set/update the entity bounding box.
 	info.m_vecMin = vecMin;
 	info.m_vecMax = vecMax;
+	if ( !bDoInsert )
+	{
+		m_pVoxelHash[ (int)info.m_nLevel[m_TreeId] ].UpdateBounds( hPartition );
+	}
 
 	if ( bDoInsert )
 	{
-		bool bWasReading = ( m_pVisits[g_nThreadID] != NULL );
+		CPartitionVisits *pVisits = m_pVisits;
+		bool bWasReading = ( pVisits && pVisits->m_bReadLocked );
 		if ( bWasReading )
 		{
 			// If we're recursing in this thread, need to release our read lock to allow ourselves to write
-			UnlockRead();
+			m_lock.UnlockRead();
 		}
 		m_lock.LockForWrite();
 
@@ -2052,7 +2327,7 @@ void CVoxelTree::InsertIntoTree( SpatialPartitionHandle_t hPartition, const Vect
 		m_lock.UnlockWrite();
 		if ( bWasReading )
 		{
-			LockForRead();
+			m_lock.LockForRead();
 		}
 	}
 }
@@ -2068,11 +2343,13 @@ void CVoxelTree::RemoveFromTree( SpatialPartitionHandle_t hPartition )
 	int nLevel = info.m_nLevel[GetTreeId()];
 	if ( nLevel >= 0 )
 	{
-		bool bWasReading = ( m_pVisits[g_nThreadID] != NULL );
+		AssertMsg( !m_bReadOnly, "Removing a spatial partition element during concurrent reads" );
+		CPartitionVisits *pVisits = m_pVisits;
+		bool bWasReading = ( pVisits && pVisits->m_bReadLocked );
 		if ( bWasReading )
 		{
 			// If we're recursing in this thread, need to release our read lock to allow ourselves to write
-			UnlockRead();
+			m_lock.UnlockRead();
 		}
 
 		m_lock.LockForWrite();
@@ -2083,7 +2360,7 @@ void CVoxelTree::RemoveFromTree( SpatialPartitionHandle_t hPartition )
 
 		if ( bWasReading )
 		{
-			LockForRead();
+			m_lock.LockForRead();
 		}
 	}
 }
@@ -2094,9 +2371,9 @@ void CVoxelTree::UpdateListMask( SpatialPartitionHandle_t hPartition )
 	int nLevel = info.m_nLevel[GetTreeId()];
 	if ( nLevel >= 0 )
 	{
-		m_lock.LockForRead();
+		bool bLocked = LockForRead();
 		m_pVoxelHash[nLevel].UpdateListMask( hPartition );
-		m_lock.UnlockRead();
+		UnlockRead( bLocked );
 	}
 }
 
@@ -2149,12 +2426,13 @@ void CVoxelTree::EnumerateElementsInBox( SpatialPartitionListMask_t listMask,
 	// Callbacks.
 	CPartitionVisits *pPrevVisits = BeginVisit();
 
-	m_lock.LockForRead();
+	bool bLocked = LockForRead();
+	m_pVisits->m_bReadLocked = bLocked;
 	Voxel_t vs = m_pVoxelHash[0].VoxelIndexFromPoint( mins );
 	Voxel_t ve = m_pVoxelHash[0].VoxelIndexFromPoint( maxs );
 	if ( !m_pVoxelHash[0].EnumerateElementsInBox( listMask, vs, ve, mins, maxs, pIterator ) )
 	{
-		m_lock.UnlockRead();
+		UnlockRead( bLocked );
 		EndVisit( pPrevVisits );
 		return;
 	}
@@ -2163,7 +2441,7 @@ void CVoxelTree::EnumerateElementsInBox( SpatialPartitionListMask_t listMask,
 	ve = ConvertToNextLevel( ve );
 	if ( !m_pVoxelHash[1].EnumerateElementsInBox( listMask, vs, ve, mins, maxs, pIterator ) )
 	{
-		m_lock.UnlockRead();
+		UnlockRead( bLocked );
 		EndVisit( pPrevVisits );
 		return;
 	}
@@ -2172,7 +2450,7 @@ void CVoxelTree::EnumerateElementsInBox( SpatialPartitionListMask_t listMask,
 	ve = ConvertToNextLevel( ve );
 	if ( !m_pVoxelHash[2].EnumerateElementsInBox( listMask, vs, ve, mins, maxs, pIterator ) )
 	{
-		m_lock.UnlockRead();
+		UnlockRead( bLocked );
 		EndVisit( pPrevVisits );
 		return;
 	}
@@ -2181,7 +2459,7 @@ void CVoxelTree::EnumerateElementsInBox( SpatialPartitionListMask_t listMask,
 	ve = ConvertToNextLevel( ve );
 	m_pVoxelHash[3].EnumerateElementsInBox( listMask, vs, ve, mins, maxs, pIterator );
 
-	m_lock.UnlockRead();
+	UnlockRead( bLocked );
 	EndVisit( pPrevVisits );
 }
 
@@ -2594,7 +2872,8 @@ void CVoxelTree::EnumerateElementsAlongRay( SpatialPartitionListMask_t listMask,
 
 	CPartitionVisits *pPrevVisits = BeginVisit();
 
-	m_lock.LockForRead();
+	bool bLocked = LockForRead();
+	m_pVisits->m_bReadLocked = bLocked;
 	if ( ray.m_IsRay )
 	{
 		EnumerateElementsAlongRay_Ray( listMask, clippedRay, vecInvDelta, vecEnd, pIterator );
@@ -2604,7 +2883,7 @@ void CVoxelTree::EnumerateElementsAlongRay( SpatialPartitionListMask_t listMask,
 		EnumerateElementsAlongRay_ExtrudedRay( listMask, clippedRay, vecInvDelta, vecEnd, pIterator );
 	}
 
-	m_lock.UnlockRead();
+	UnlockRead( bLocked );
 	EndVisit( pPrevVisits );
 }
 
@@ -2622,32 +2901,32 @@ void CVoxelTree::EnumerateElementsAtPoint( SpatialPartitionListMask_t listMask,
 	if ( listMask == 0 )
 		return;
 
-	m_lock.LockForRead();
+	bool bLocked = LockForRead();
 	// Callbacks.
 	Voxel_t v = m_pVoxelHash[0].VoxelIndexFromPoint( pt );
 	if ( !m_pVoxelHash[0].EnumerateElementsAtPoint( listMask, v, pt, pIterator ) )
 	{
-		m_lock.UnlockRead();
+		UnlockRead( bLocked );
 		return;
 	}
 
 	v = ConvertToNextLevel( v );
 	if ( !m_pVoxelHash[1].EnumerateElementsAtPoint( listMask, v, pt, pIterator ) )
 	{
-		m_lock.UnlockRead();
+		UnlockRead( bLocked );
 		return;
 	}
 
 	v = ConvertToNextLevel( v );
 	if ( !m_pVoxelHash[2].EnumerateElementsAtPoint( listMask, v, pt, pIterator ) )
 	{
-		m_lock.UnlockRead();
+		UnlockRead( bLocked );
 		return;
 	}
 
 	v = ConvertToNextLevel( v );
 	m_pVoxelHash[3].EnumerateElementsAtPoint( listMask, v, pt, pIterator );
-	m_lock.UnlockRead();
+	UnlockRead( bLocked );
 }
 
 
@@ -2657,12 +2936,12 @@ void CVoxelTree::EnumerateElementsAtPoint( SpatialPartitionListMask_t listMask,
 void CVoxelTree::RenderAllObjectsInTree( float flTime )
 {
 	MDLCACHE_CRITICAL_SECTION_(g_pMDLCache);
-	m_lock.LockForRead();
+	bool bLocked = LockForRead();
 	for ( int i = 0; i < m_nLevelCount; ++i )
 	{
 		m_pVoxelHash[i].RenderAllObjectsInTree( flTime );
 	}
-	m_lock.UnlockRead();
+	UnlockRead( bLocked );
 }
 
 
@@ -2673,12 +2952,12 @@ void CVoxelTree::RenderAllObjectsInTree( float flTime )
 void CVoxelTree::RenderObjectsInPlayerLeafs( const Vector &vecPlayerMin, const Vector &vecPlayerMax, float flTime )
 {
 	MDLCACHE_CRITICAL_SECTION_(g_pMDLCache);
-	m_lock.LockForRead();
+	bool bLocked = LockForRead();
 	for ( int i = 0; i < m_nLevelCount; ++i )
 	{
 		m_pVoxelHash[i].RenderObjectsInPlayerLeafs( vecPlayerMin, vecPlayerMax, flTime );
 	}
-	m_lock.UnlockRead();
+	UnlockRead( bLocked );
 }
 
 
@@ -3020,9 +3299,16 @@ void CSpatialPartition::EnumerateElementsInBox( SpatialPartitionListMask_t listM
 {
 	MDLCACHE_CRITICAL_SECTION_(g_pMDLCache);
 	CVoxelTree *pTree = VoxelTree( listMask );
-	InvokeQueryCallbacks( listMask );
+	bool bCallbacks = !pTree->IsReadOnly();
+	if ( bCallbacks )
+	{
+		InvokeQueryCallbacks( listMask );
+	}
 	pTree->EnumerateElementsInBox( listMask, mins, maxs, coarseTest, pIterator );
-	InvokeQueryCallbacks( listMask, true );
+	if ( bCallbacks )
+	{
+		InvokeQueryCallbacks( listMask, true );
+	}
 }
 
 //-----------------------------------------------------------------------------
@@ -3032,9 +3318,16 @@ void CSpatialPartition::EnumerateElementsInSphere( SpatialPartitionListMask_t li
 {
 	MDLCACHE_CRITICAL_SECTION_(g_pMDLCache);
 	CVoxelTree *pTree = VoxelTree( listMask );
-	InvokeQueryCallbacks( listMask );
+	bool bCallbacks = !pTree->IsReadOnly();
+	if ( bCallbacks )
+	{
+		InvokeQueryCallbacks( listMask );
+	}
 	pTree->EnumerateElementsInSphere( listMask, origin, radius, coarseTest, pIterator );
-	InvokeQueryCallbacks( listMask, true );
+	if ( bCallbacks )
+	{
+		InvokeQueryCallbacks( listMask, true );
+	}
 }
 
 //-----------------------------------------------------------------------------
@@ -3044,9 +3337,16 @@ void CSpatialPartition::EnumerateElementsAlongRay( SpatialPartitionListMask_t li
 {
 	MDLCACHE_CRITICAL_SECTION_(g_pMDLCache);
 	CVoxelTree *pTree = VoxelTree( listMask );
-	InvokeQueryCallbacks( listMask );
+	bool bCallbacks = !pTree->IsReadOnly();
+	if ( bCallbacks )
+	{
+		InvokeQueryCallbacks( listMask );
+	}
 	pTree->EnumerateElementsAlongRay( listMask, ray, coarseTest, pIterator );
-	InvokeQueryCallbacks( listMask, true );
+	if ( bCallbacks )
+	{
+		InvokeQueryCallbacks( listMask, true );
+	}
 }
 
 //-----------------------------------------------------------------------------
@@ -3056,9 +3356,16 @@ void CSpatialPartition::EnumerateElementsAtPoint( SpatialPartitionListMask_t lis
 {
 	MDLCACHE_CRITICAL_SECTION_(g_pMDLCache);
 	CVoxelTree *pTree = VoxelTree( listMask );
-	InvokeQueryCallbacks( listMask );
+	bool bCallbacks = !pTree->IsReadOnly();
+	if ( bCallbacks )
+	{
+		InvokeQueryCallbacks( listMask );
+	}
 	pTree->EnumerateElementsAtPoint( listMask, pt, coarseTest, pIterator );
-	InvokeQueryCallbacks( listMask, true );
+	if ( bCallbacks )
+	{
+		InvokeQueryCallbacks( listMask, true );
+	}
 }
 
 
@@ -3180,7 +3487,7 @@ void CVoxelTree::DrawDebugOverlays()
 	if ( nLevel < 0 )
 		return;
 
-	m_lock.LockForRead();
+	bool bLocked = LockForRead();
 	for ( int i = 0; i < m_nLevelCount; ++i )
 	{
 		if ( ( nLevel >= 0 ) && ( nLevel != i ) )
@@ -3189,7 +3496,7 @@ void CVoxelTree::DrawDebugOverlays()
 		m_pVoxelHash[i].RenderGrid();
 		m_pVoxelHash[i].RenderAllObjectsInTree( 0.01f );
 	}
-	m_lock.UnlockRead();
+	UnlockRead( bLocked );
 }
 
 void CSpatialPartition::DrawDebugOverlays()
@@ -3200,6 +3507,31 @@ void CSpatialPartition::DrawDebugOverlays()
 	}
 }
 
+//-----------------------------------------------------------------------------
+// Read only mode, enumerations skip the tree locks and the query callbacks
+//-----------------------------------------------------------------------------
+void CVoxelTree::SetReadOnly( bool bReadOnly )
+{
+	// Waits for the readers and writers that took the lock before the switch
+	m_lock.LockForWrite();
+	m_bReadOnly = bReadOnly;
+	m_lock.UnlockWrite();
+}
+
+void CSpatialPartition::BeginConcurrentReads( SpatialPartitionListMask_t listMask )
+{
+	CVoxelTree *pTree = VoxelTree( listMask );
+	Assert( !pTree->IsReadOnly() );
+	pTree->SetReadOnly( true );
+}
+
+void CSpatialPartition::EndConcurrentReads( SpatialPartitionListMask_t listMask )
+{
+	CVoxelTree *pTree = VoxelTree( listMask );
+	Assert( pTree->IsReadOnly() );
+	pTree->SetReadOnly( false );
+}
+
 //=============================================================================
 ISpatialPartition *CreateSpatialPartition( const Vector& worldmin, const Vector& worldmax )
 {
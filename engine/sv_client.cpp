@@ -696,6 +696,9 @@ void CGameClient::Disconnect( const char *fmt, ... )
 	Q_vsnprintf (reason, sizeof( reason ), fmt,argptr);
 	va_end (argptr);
 
+	if ( DeferDisconnect( reason ) )
+		return;
+
 	// notify other clients of player leaving the game
 	// send the username and network id so we don't depend on the CBasePlayer pointer
 	IGameEvent *event = g_GameEventManager.CreateEvent( "player_disconnect" );
@@ -35,6 +35,8 @@ extern ConVar g_CV_DTWatchEnt;
 static ConVar		sv_deltatime( "sv_deltatime", "0", 0, "Enable profiling of CalcDelta calls" );
 static ConVar		sv_deltaprint( "sv_deltaprint", "0", 0, "Print accumulated CalcDelta profiling data (only if sv_deltatime is on)" );
 
+static ConVar		sv_deltacache( "sv_deltacache", "4096", 0, "Size in KB of the per-snapshot entity delta cache shared by all clients, 0 to disable" );
+
 #if defined( DEBUG_NETWORKING )
 ConVar  sv_packettrace( "sv_packettrace", "1", 0, "For debugging, print entity creation/deletion info to console." );
 #endif
@@ -77,6 +79,10 @@ public:
 
 	int				m_nFullProps;	// number of properties send as full update (Enter PVS)
 	bool			m_bCullProps;	// filter props by clients in recipient lists
+
+	bool			m_bUseDeltaCache;	// share written deltas with other clients of this snapshot
+	bool			m_bDeltaCacheable;	// current entity delta may be added to the shared cache
+	uint64			m_nDeltaSignature;	// recipient proxy bits of this client for the current entity
 	
 	/* Some profiling data
 	int				m_nTotalGap;
@@ -146,6 +152,390 @@ void PrintChangeTracks()
 }
 
 
+//-----------------------------------------------------------------------------
+// Shared entity delta cache.
+//
+// Most clients of a server delta the same entity between the same two packed
+// entities each tick, so the bit stream written by SV_WritePropsFromPackedEntity
+// is identical for all of them. The only client dependent part is the recipient
+// culling done by SendTable_CullPropsFromProxies, which is folded into the key
+// as a signature of the client's bits in the from/to recipient lists.
+//
+// Entries are only valid for a single to-snapshot: packed entity pointers may
+// be recycled once a snapshot is released, so the key also holds the from tick
+// and the cache is flushed as soon as a client is written against a different
+// snapshot. The entities are spread over shards with their own locks so clients
+// sent in parallel don't queue up on a single mutex.
+//-----------------------------------------------------------------------------
+class CSharedDeltaCache
+{
+	struct DeltaEntry_t
+	{
+		int					m_nFromTick;
+		const PackedEntity	*m_pFrom;
+		const PackedEntity	*m_pTo;
+		uint64				m_nSignature;
+		const unsigned char	*m_pData;
+		int					m_nBits;
+		int					m_nNext;	// next entry for the same entity index
+	};
+
+	enum
+	{
+		DELTA_CACHE_BLOCK_SIZE = 16 * 1024,
+		DELTA_CACHE_SHARDS = 16,		// entity index modulo this picks the shard
+	};
+
+	struct Shard_t
+	{
+		CThreadFastMutex			m_Mutex;
+		CUtlVector<DeltaEntry_t>	m_Entries;
+
+		// data blocks never move once allocated. Snapshots alternate between the two
+		// sets, so bits handed out by FindDeltaBits stay valid while the next snapshot
+		// is written
+		CUtlVector<unsigned char*>	m_Blocks[2];
+		int							m_nCurrentBlock;
+		int							m_nBlockUsed;
+		int							m_nBytesUsed;
+
+		// statistics
+		int							m_nHits;
+		int							m_nMisses;
+		int							m_nUniqueDeltas;
+		int							m_nRejected;		// didn't fit into cache
+		int64						m_nBitsSaved;
+	};
+
+public:
+	CSharedDeltaCache();
+	~CSharedDeltaCache();
+
+	bool					SetSnapshot( const CFrameSnapshot *pSnapshot, int nSpawnCount );
+	bool					FindDeltaBits( int nEntityIndex, int nFromTick, const PackedEntity *pFrom, const PackedEntity *pTo, uint64 nSignature, const unsigned char *&pData, int &nBits );
+	void					AddDeltaBits( int nEntityIndex, int nFromTick, int nToTick, const PackedEntity *pFrom, const PackedEntity *pTo, uint64 nSignature, int nBits, bf_write *pBuffer );
+
+	void					PrintStats();
+	void					ResetStats();
+
+private:
+	Shard_t&				GetShard( int nEntityIndex ) { return m_Shards[nEntityIndex % DELTA_CACHE_SHARDS]; }
+	int						FindEntry( Shard_t &shard, int nEntityIndex, int nFromTick, const PackedEntity *pFrom, const PackedEntity *pTo, uint64 nSignature );
+	unsigned char*			AllocData( Shard_t &shard, int nBytes );
+	static void				FreeBlocks( CUtlVector<unsigned char*> &blocks );
+
+	// guards switching snapshots, which also takes every shard lock
+	CThreadFastMutex		m_SnapshotMutex;
+
+	const CFrameSnapshot	*m_pSnapshot;
+	int						m_nTickCount;
+	int						m_nSpawnCount;	// tick counts restart on level change
+	int						m_nMaxShardBytes;
+	int						m_nBlockSet;	// which of the shards' block sets this snapshot uses
+	int						m_nSnapshots;
+
+	Shard_t					m_Shards[DELTA_CACHE_SHARDS];
+	int						m_EntityHeads[MAX_EDICTS];	// index into the shard's m_Entries or -1, guarded by the shard lock
+};
+
+static CSharedDeltaCache g_SharedDeltaCache;
+
+CSharedDeltaCache::CSharedDeltaCache()
+{
+	m_pSnapshot = NULL;
+	m_nTickCount = -1;
+	m_nSpawnCount = -1;
+	m_nMaxShardBytes = 0;
+	m_nBlockSet = 0;
+
+	for ( int i = 0; i < DELTA_CACHE_SHARDS; i++ )
+	{
+		m_Shards[i].m_nCurrentBlock = 0;
+		m_Shards[i].m_nBlockUsed = 0;
+		m_Shards[i].m_nBytesUsed = 0;
+	}
+
+	Q_memset( m_EntityHeads, 0xFF, sizeof( m_EntityHeads ) );
+	ResetStats();
+}
+
+CSharedDeltaCache::~CSharedDeltaCache()
+{
+	for ( int i = 0; i < DELTA_CACHE_SHARDS; i++ )
+	{
+		FreeBlocks( m_Shards[i].m_Blocks[0] );
+		FreeBlocks( m_Shards[i].m_Blocks[1] );
+	}
+}
+
+void CSharedDeltaCache::FreeBlocks( CUtlVector<unsigned char*> &blocks )
+{
+	for ( int i = 0; i < blocks.Count(); i++ )
+	{
+		free( blocks[i] );
+	}
+	blocks.Purge();
+}
+
+bool CSharedDeltaCache::SetSnapshot( const CFrameSnapshot *pSnapshot, int nSpawnCount )
+{
+	AUTO_LOCK( m_SnapshotMutex );
+
+	if ( pSnapshot == m_pSnapshot && pSnapshot->m_nTickCount == m_nTickCount && nSpawnCount == m_nSpawnCount )
+		return m_nMaxShardBytes > 0;
+
+	int nMaxBytes = sv_deltacache.GetInt() * 1024;
+
+	for ( int i = 0; i < DELTA_CACHE_SHARDS; i++ )
+	{
+		m_Shards[i].m_Mutex.Lock();
+	}
+
+	// the other block set was last used two snapshots ago, nobody reads from it anymore
+	m_nBlockSet ^= 1;
+
+	for ( int i = 0; i < DELTA_CACHE_SHARDS; i++ )
+	{
+		Shard_t &shard = m_Shards[i];
+		shard.m_Entries.RemoveAll();
+		shard.m_nCurrentBlock = 0;
+		shard.m_nBlockUsed = 0;
+		shard.m_nBytesUsed = 0;
+
+		if ( nMaxBytes <= 0 )
+		{
+			// release memory if cache got disabled, the previous snapshot's set goes
+			// on the next switch
+			FreeBlocks( shard.m_Blocks[m_nBlockSet] );
+		}
+	}
+
+	Q_memset( m_EntityHeads, 0xFF, sizeof( m_EntityHeads ) );
+
+	// remember the snapshot even when disabled, so the blocks are only freed once per switch
+	m_pSnapshot = pSnapshot;
+	m_nTickCount = pSnapshot->m_nTickCount;
+	m_nSpawnCount = nSpawnCount;
+	m_nMaxShardBytes = MAX( nMaxBytes, 0 ) / DELTA_CACHE_SHARDS;
+
+	if ( m_nMaxShardBytes > 0 )
+	{
+		m_nSnapshots++;
+	}
+
+	for ( int i = DELTA_CACHE_SHARDS - 1; i >= 0; i-- )
+	{
+		m_Shards[i].m_Mutex.Unlock();
+	}
+
+	return m_nMaxShardBytes > 0;
+}
+
+unsigned char* CSharedDeltaCache::AllocData( Shard_t &shard, int nBytes )
+{
+	if ( nBytes > DELTA_CACHE_BLOCK_SIZE || shard.m_nBytesUsed + nBytes > m_nMaxShardBytes )
+		return NULL;
+
+	CUtlVector<unsigned char*> &blocks = shard.m_Blocks[m_nBlockSet];
+
+	if ( shard.m_nCurrentBlock < blocks.Count() && shard.m_nBlockUsed + nBytes > DELTA_CACHE_BLOCK_SIZE )
+	{
+		// current block is full, continue with the next one
+		shard.m_nCurrentBlock++;
+		shard.m_nBlockUsed = 0;
+	}
+
+	if ( shard.m_nCurrentBlock >= blocks.Count() )
+	{
+		blocks.AddToTail( (unsigned char*)malloc( DELTA_CACHE_BLOCK_SIZE ) );
+		shard.m_nCurrentBlock = blocks.Count() - 1;
+		shard.m_nBlockUsed = 0;
+	}
+
+	unsigned char *pData = blocks[shard.m_nCurrentBlock] + shard.m_nBlockUsed;
+	shard.m_nBlockUsed += nBytes;
+	shard.m_nBytesUsed += nBytes;
+	return pData;
+}
+
+int CSharedDeltaCache::FindEntry( Shard_t &shard, int nEntityIndex, int nFromTick, const PackedEntity *pFrom, const PackedEntity *pTo, uint64 nSignature )
+{
+	for ( int i = m_EntityHeads[nEntityIndex]; i != -1; i = shard.m_Entries[i].m_nNext )
+	{
+		const DeltaEntry_t &entry = shard.m_Entries[i];
+		if ( entry.m_pFrom == pFrom && entry.m_pTo == pTo && entry.m_nFromTick == nFromTick && entry.m_nSignature == nSignature )
+			return i;
+	}
+	return -1;
+}
+
+bool CSharedDeltaCache::FindDeltaBits( int nEntityIndex, int nFromTick, const PackedEntity *pFrom, const PackedEntity *pTo, uint64 nSignature, const unsigned char *&pData, int &nBits )
+{
+	pData = NULL;
+	nBits = -1;
+
+	if ( nEntityIndex < 0 || nEntityIndex >= MAX_EDICTS )
+		return false;
+
+	Shard_t &shard = GetShard( nEntityIndex );
+	AUTO_LOCK( shard.m_Mutex );
+
+	int i = FindEntry( shard, nEntityIndex, nFromTick, pFrom, pTo, nSignature );
+	if ( i == -1 )
+	{
+		shard.m_nMisses++;
+		return false;
+	}
+
+	const DeltaEntry_t &entry = shard.m_Entries[i];
+	shard.m_nHits++;
+	shard.m_nBitsSaved += entry.m_nBits;
+	pData = entry.m_pData;
+	nBits = entry.m_nBits;
+	return true;
+}
+
+void CSharedDeltaCache::AddDeltaBits( int nEntityIndex, int nFromTick, int nToTick, const PackedEntity *pFrom, const PackedEntity *pTo, uint64 nSignature, int nBits, bf_write *pBuffer )
+{
+	if ( nEntityIndex < 0 || nEntityIndex >= MAX_EDICTS )
+		return;
+
+	int nBufferSize = PAD_NUMBER( Bits2Bytes( nBits ), 4 );
+
+	Shard_t &shard = GetShard( nEntityIndex );
+	AUTO_LOCK( shard.m_Mutex );
+
+	// the cache may have moved on to another snapshot while we were writing
+	if ( m_nMaxShardBytes <= 0 || nToTick != m_nTickCount )
+		return;
+
+	// another client may have added the same delta while we were writing ours
+	if ( FindEntry( shard, nEntityIndex, nFromTick, pFrom, pTo, nSignature ) != -1 )
+		return;
+
+	unsigned char *pData = NULL;
+
+	if ( nBits > 0 )
+	{
+		pData = AllocData( shard, nBufferSize );
+
+		if ( !pData )
+		{
+			shard.m_nRejected++;
+			return; // cache is full for this snapshot
+		}
+
+		bf_read inBuffer;
+		inBuffer.StartReading( pBuffer->GetData(), pBuffer->m_nDataBytes, pBuffer->GetNumBitsWritten() );
+		bf_write outBuffer( pData, nBufferSize );
+		outBuffer.WriteBitsFromBuffer( &inBuffer, nBits );
+	}
+
+	int iEntry = shard.m_Entries.AddToTail();
+	DeltaEntry_t &entry = shard.m_Entries[iEntry];
+	entry.m_nFromTick = nFromTick;
+	entry.m_pFrom = pFrom;
+	entry.m_pTo = pTo;
+	entry.m_nSignature = nSignature;
+	entry.m_pData = pData;
+	entry.m_nBits = nBits;
+	entry.m_nNext = m_EntityHeads[nEntityIndex];
+	m_EntityHeads[nEntityIndex] = iEntry;
+
+	shard.m_nUniqueDeltas++;
+}
+
+void CSharedDeltaCache::ResetStats()
+{
+	m_nSnapshots = 0;
+
+	for ( int i = 0; i < DELTA_CACHE_SHARDS; i++ )
+	{
+		Shard_t &shard = m_Shards[i];
+		AUTO_LOCK( shard.m_Mutex );
+		shard.m_nHits = 0;
+		shard.m_nMisses = 0;
+		shard.m_nUniqueDeltas = 0;
+		shard.m_nRejected = 0;
+		shard.m_nBitsSaved = 0;
+	}
+}
+
+void CSharedDeltaCache::PrintStats()
+{
+	int nHits = 0, nMisses = 0, nUniqueDeltas = 0, nRejected = 0, nBytesUsed = 0, nBlocks = 0;
+	int64 nBitsSaved = 0;
+
+	for ( int i = 0; i < DELTA_CACHE_SHARDS; i++ )
+	{
+		Shard_t &shard = m_Shards[i];
+		AUTO_LOCK( shard.m_Mutex );
+		nHits += shard.m_nHits;
+		nMisses += shard.m_nMisses;
+		nUniqueDeltas += shard.m_nUniqueDeltas;
+		nRejected += shard.m_nRejected;
+		nBitsSaved += shard.m_nBitsSaved;
+		nBytesUsed += shard.m_nBytesUsed;
+		nBlocks += shard.m_Blocks[0].Count() + shard.m_Blocks[1].Count();
+	}
+
+	int nLookups = nHits + nMisses;
+
+	ConMsg( "Shared delta cache (%s, %d KB):\n", m_nMaxShardBytes > 0 ? "enabled" : "disabled", sv_deltacache.GetInt() );
+	ConMsg( "  snapshots     : %d\n", m_nSnapshots );
+	ConMsg( "  lookups       : %d\n", nLookups );
+	ConMsg( "  hits          : %d (%.1f%%)\n", nHits, nLookups ? 100.0f * nHits / nLookups : 0.0f );
+	ConMsg( "  unique deltas : %d (%.1f per snapshot)\n", nUniqueDeltas, m_nSnapshots ? (float)nUniqueDeltas / m_nSnapshots : 0.0f );
+	ConMsg( "  rejected      : %d\n", nRejected );
+	ConMsg( "  bytes reused  : %lld\n", (long long)( nBitsSaved / 8 ) );
+	ConMsg( "  current usage : %d bytes in %d blocks\n", nBytesUsed, nBlocks );
+}
+
+CON_COMMAND( sv_deltacache_stats, "Print shared entity delta cache hit rates. Use 'sv_deltacache_stats reset' to clear them." )
+{
+	if ( args.ArgC() > 1 && !Q_stricmp( args[1], "reset" ) )
+	{
+		g_SharedDeltaCache.ResetStats();
+		return;
+	}
+
+	g_SharedDeltaCache.PrintStats();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Builds the key part that depends on the receiving client. Returns
+//  false if the entity has too many recipient proxies to be cached.
+//-----------------------------------------------------------------------------
+static inline bool SV_GetDeltaCacheSignature( CEntityWriteInfo &u, uint64 &nSignature )
+{
+	nSignature = 0;
+
+	const int nNewRecipients = u.m_pNewPack->GetNumRecipients();
+	const int nOldRecipients = u.m_pOldPack->GetNumRecipients();
+
+	if ( nNewRecipients > 32 || nOldRecipients > 32 )
+		return false;
+
+	const int iClient = u.m_nClientEntity - 1;
+	const CSendProxyRecipients *pNew = u.m_pNewPack->GetRecipients();
+	const CSendProxyRecipients *pOld = u.m_pOldPack->GetRecipients();
+
+	for ( int i = 0; i < nNewRecipients; i++ )
+	{
+		if ( pNew[i].m_Bits.Get( iClient ) )
+			nSignature |= ( (uint64)1 << i );
+	}
+
+	for ( int i = 0; i < nOldRecipients; i++ )
+	{
+		if ( pOld[i].m_Bits.Get( iClient ) )
+			nSignature |= ( (uint64)1 << ( 32 + i ) );
+	}
+
+	return true;
+}
+
+
 //-----------------------------------------------------------------------------
 // Purpose: Entity wasn't dealt with in packet, but it has been deleted, we'll flag
 //  the entity for destruction
@@ -358,7 +748,7 @@ static inline void SV_WritePropsFromPackedEntity(
 	int pSendProps[MAX_DATATABLE_PROPS];
 	const int *sendProps = pCheckProps;
 	int nSendProps = nCheckProps;
-	bf_write bufStart;
+	bf_write bufStart = *u.m_pBuf;
 
 
 	// cull properties that are removed by SendProxies for this client.
@@ -383,11 +773,6 @@ static inline void SV_WritePropsFromPackedEntity(
 		ARRAYSIZE( pSendProps )
 		);
 	}
-	else
-	{
-		// this is a HLTV relay proxy
-		bufStart = *u.m_pBuf;
-	}
 		
 	SendTable_WritePropList(
 		pSendTable, 
@@ -406,6 +791,12 @@ static inline void SV_WritePropsFromPackedEntity(
 		int nBits = u.m_pBuf->GetNumBitsWritten() - bufStart.GetNumBitsWritten();
 		hltv->m_DeltaCache.AddDeltaBits( pTo->m_nEntityIndex, u.m_pFromSnapshot->m_nTickCount, nBits, &bufStart );
 	}
+	else if ( u.m_bDeltaCacheable )
+	{
+		// let other clients of this snapshot reuse the delta bits
+		int nBits = u.m_pBuf->GetNumBitsWritten() - bufStart.GetNumBitsWritten();
+		g_SharedDeltaCache.AddDeltaBits( pTo->m_nEntityIndex, u.m_pFromSnapshot->m_nTickCount, u.m_pToSnapshot->m_nTickCount, pFrom, pTo, u.m_nDeltaSignature, nBits, &bufStart );
+	}
 }
 
 
@@ -533,6 +924,30 @@ static inline void SV_DetermineUpdateType( CEntityWriteInfo &u )
 	}
 #endif
 
+	u.m_bDeltaCacheable = u.m_bUseDeltaCache && SV_GetDeltaCacheSignature( u, u.m_nDeltaSignature );
+
+	if ( u.m_bDeltaCacheable )
+	{
+		const unsigned char *pBuffer;
+		int nBits;
+
+		if ( g_SharedDeltaCache.FindDeltaBits( u.m_nNewEntity, u.m_pFromSnapshot->m_nTickCount, u.m_pOldPack, u.m_pNewPack, u.m_nDeltaSignature, pBuffer, nBits ) )
+		{
+			if ( nBits > 0 )
+			{
+				SV_WriteDeltaHeader( u, u.m_nNewEntity, FHDR_ZERO );
+				u.m_pBuf->WriteBits( pBuffer, nBits );
+				u.m_UpdateType = DeltaEnt;
+			}
+			else
+			{
+				u.m_UpdateType = PreserveEnt;
+			}
+
+			return; // another client already wrote this delta
+		}
+	}
+
 	int checkProps[MAX_DATATABLE_PROPS];
 	int nCheckProps = u.m_pNewPack->GetPropsChangedAfterTick( u.m_pFromSnapshot->m_nTickCount, checkProps, ARRAYSIZE( checkProps ) );
 	
@@ -619,6 +1034,12 @@ static inline void SV_DetermineUpdateType( CEntityWriteInfo &u )
 #endif
 		}
 #endif
+		if ( u.m_bDeltaCacheable )
+		{
+			// no bits changed, PreserveEnt
+			g_SharedDeltaCache.AddDeltaBits( u.m_nNewEntity, u.m_pFromSnapshot->m_nTickCount, u.m_pToSnapshot->m_nTickCount, u.m_pOldPack, u.m_pNewPack, u.m_nDeltaSignature, 0, NULL );
+		}
+
 		u.m_UpdateType = PreserveEnt;
 	}
 }
@@ -890,6 +1311,11 @@ void CBaseServer::WriteDeltaEntities( CBaseClient *client, CClientFrame *to, CCl
 	{
 		u.m_bCullProps = true;	// always cull props for players
 	}
+
+	// HLTV and Replay servers have their own per-tick delta caches
+	u.m_bUseDeltaCache = u.m_bCullProps && !IsHLTV() && !IsReplay() && g_SharedDeltaCache.SetSnapshot( u.m_pToSnapshot, GetSpawnCount() );
+	u.m_bDeltaCacheable = false;
+	u.m_nDeltaSignature = 0;
 	
 	if ( from != NULL )
 	{
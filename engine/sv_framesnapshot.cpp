@@ -12,6 +12,7 @@
 #include "replayserver.h"
 #endif
 #include "framesnapshot.h"
+#include "packed_entity.h"
 #include "sys_dll.h"
 
 // memdbgon must be the last include file in a .cpp file!!!
@@ -27,14 +28,81 @@ extern	CGlobalVars g_ServerGlobalVariables;
 static CFrameSnapshotManager g_FrameSnapshotManager;
 CFrameSnapshotManager *framesnapshotmanager = &g_FrameSnapshotManager;
 
+//-----------------------------------------------------------------------------
+// CPackedEntityPool
+//-----------------------------------------------------------------------------
+struct TSLIST_NODE_ALIGN CPackedEntityPool::PackedEntityNode_t : public TSLNodeBase_t
+{
+	// constructed and destructed in place by Alloc/Free
+	byte	m_Entity[ sizeof( PackedEntity ) ];
+} TSLIST_NODE_ALIGN_POST;
+
+CPackedEntityPool::CPackedEntityPool()
+{
+}
+
+CPackedEntityPool::~CPackedEntityPool()
+{
+	Purge();
+}
+
+PackedEntity* CPackedEntityPool::Alloc()
+{
+	PackedEntityNode_t *pNode = m_FreeList.Pop();
+
+	if ( !pNode )
+	{
+		pNode = (PackedEntityNode_t *)MemAlloc_AllocAligned( sizeof( PackedEntityNode_t ), TSLIST_NODE_ALIGNMENT );
+		++m_nNodes;
+		++m_nFreeListMisses;
+	}
+
+	++m_nAllocated;
+	++m_nAllocs;
+
+	return Construct( (PackedEntity *)pNode->m_Entity );
+}
+
+void CPackedEntityPool::Free( PackedEntity *pEntity )
+{
+	Destruct( pEntity );
+
+	byte *pElem = (byte *)pEntity - offsetof( PackedEntityNode_t, m_Entity );
+	m_FreeList.Push( (PackedEntityNode_t *)pElem );
+
+	--m_nAllocated;
+}
+
+void CPackedEntityPool::Purge()
+{
+	PackedEntityNode_t *pNode;
+	while ( ( pNode = m_FreeList.Pop() ) != NULL )
+	{
+		MemAlloc_FreeAligned( pNode );
+		--m_nNodes;
+	}
+}
+
+void CPackedEntityPool::UpdateVProfCounters()
+{
+	VPROF_INCREMENT_COUNTER( "PackedEntity allocs", m_nAllocs );
+	VPROF_INCREMENT_COUNTER( "PackedEntity free list misses", m_nFreeListMisses );
+	VPROF_INCREMENT_COUNTER( "PackedEntity locked frees", m_nLockedFrees );
+
+	m_nAllocs = 0;
+	m_nFreeListMisses = 0;
+	m_nLockedFrees = 0;
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: 
 //-----------------------------------------------------------------------------
-CFrameSnapshotManager::CFrameSnapshotManager( void ) : m_PackedEntitiesPool( MAX_EDICTS / 16, CUtlMemoryPool::GROW_SLOW )
+CFrameSnapshotManager::CFrameSnapshotManager( void )
 {
 	COMPILE_TIME_ASSERT( INVALID_PACKED_ENTITY_HANDLE == 0 );
 	Q_memset( m_pPackedData, 0x00, MAX_EDICTS * sizeof(PackedEntityHandle_t) );
 
+	m_bDeferDeletes = false;
 }
 
 //-----------------------------------------------------------------------------
@@ -61,6 +129,9 @@ void CFrameSnapshotManager::LevelChanged()
 	m_PackedEntityCache.RemoveAll();
 	COMPILE_TIME_ASSERT( INVALID_PACKED_ENTITY_HANDLE == 0 );
 	Q_memset( m_pPackedData, 0x00, MAX_EDICTS * sizeof(PackedEntityHandle_t) );
+
+	// don't keep the free list of the last map around
+	m_PackedEntitiesPool.Purge();
 }
 
 CFrameSnapshot*	CFrameSnapshotManager::NextSnapshot( const CFrameSnapshot *pSnapshot )
@@ -68,6 +139,8 @@ CFrameSnapshot*	CFrameSnapshotManager::NextSnapshot( const CFrameSnapshot *pSnap
 	if ( !pSnapshot || ((unsigned short)pSnapshot->m_ListIndex == m_FrameSnapshots.InvalidIndex()) )
 		return NULL;
 
+	AUTO_LOCK( m_FrameSnapshotsMutex );
+
 	int next = m_FrameSnapshots.Next(pSnapshot->m_ListIndex);
 
 	if ( next == m_FrameSnapshots.InvalidIndex() )
@@ -100,7 +173,26 @@ CFrameSnapshot*	CFrameSnapshotManager::CreateEmptySnapshot( int tickcount, int m
 		entry++;
 	}
 
-	snap->m_ListIndex = m_FrameSnapshots.AddToTail( snap );
+	{
+		AUTO_LOCK( m_FrameSnapshotsMutex );
+
+		// keep the list in tick order for NextSnapshot, SourceTV rebuilds snapshots of
+		// older ticks for its compacted frames
+		unsigned short i = m_FrameSnapshots.Tail();
+		while ( i != m_FrameSnapshots.InvalidIndex() && m_FrameSnapshots[i]->m_nTickCount > tickcount )
+		{
+			i = m_FrameSnapshots.Previous( i );
+		}
+
+		if ( i == m_FrameSnapshots.InvalidIndex() )
+		{
+			snap->m_ListIndex = m_FrameSnapshots.AddToHead( snap );
+		}
+		else
+		{
+			snap->m_ListIndex = m_FrameSnapshots.InsertAfter( i, snap );
+		}
+	}
 	return snap;
 }
 
@@ -181,6 +273,13 @@ CFrameSnapshot* CFrameSnapshotManager::TakeTickSnapshot( int tickcount )
 
 void CFrameSnapshotManager::DeleteFrameSnapshot( CFrameSnapshot* pSnapshot )
 {
+	if ( m_bDeferDeletes )
+	{
+		AUTO_LOCK( m_FrameSnapshotsMutex );
+		m_DeferredDeletes.AddToTail( pSnapshot );
+		return;
+	}
+
 	// Decrement reference counts of all packed entities
 	for (int i = 0; i < pSnapshot->m_nNumEntities; ++i)
 	{
@@ -190,10 +289,27 @@ void CFrameSnapshotManager::DeleteFrameSnapshot( CFrameSnapshot* pSnapshot )
 		}
 	}
 
-	m_FrameSnapshots.Remove( pSnapshot->m_ListIndex );
+	{
+		AUTO_LOCK( m_FrameSnapshotsMutex );
+		m_FrameSnapshots.Remove( pSnapshot->m_ListIndex );
+	}
 	delete pSnapshot;
 }
 
+void CFrameSnapshotManager::DeferSnapshotDeletes( bool bDefer )
+{
+	Assert( ThreadInMainThread() );
+	m_bDeferDeletes = bDefer;
+	if ( bDefer )
+		return;
+
+	FOR_EACH_VEC( m_DeferredDeletes, i )
+	{
+		DeleteFrameSnapshot( m_DeferredDeletes[i] );
+	}
+	m_DeferredDeletes.RemoveAll();
+}
+
 void CFrameSnapshotManager::RemoveEntityReference( PackedEntityHandle_t handle )
 {
 	Assert( handle != INVALID_PACKED_ENTITY_HANDLE );
@@ -202,21 +318,28 @@ void CFrameSnapshotManager::RemoveEntityReference( PackedEntityHandle_t handle )
 
 	if ( --packedEntity->m_ReferenceCount <= 0)
 	{
-		AUTO_LOCK( m_WriteMutex );
+		// the uncompression cache only exists for compressed entities (HLTV and
+		// Replay playback), normal servers free without taking the lock
+		if ( m_PackedEntityCache.Count() )
+		{
+			AUTO_LOCK( m_WriteMutex );
 
-		m_PackedEntitiesPool.Free( packedEntity );
+			++m_PackedEntitiesPool.m_nLockedFrees;
 
-		// if we have a uncompression cache, remove reference too
-		FOR_EACH_VEC( m_PackedEntityCache, i )
-		{
-			UnpackedDataCache_t &pdc = m_PackedEntityCache[i];
-			if ( pdc.pEntity == packedEntity )
+			// if we have a uncompression cache, remove reference too
+			FOR_EACH_VEC( m_PackedEntityCache, i )
 			{
-				pdc.pEntity = NULL;
-				pdc.counter = 0;
-				break;
+				UnpackedDataCache_t &pdc = m_PackedEntityCache[i];
+				if ( pdc.pEntity == packedEntity )
+				{
+					pdc.pEntity = NULL;
+					pdc.counter = 0;
+					break;
+				}
 			}
 		}
+
+		m_PackedEntitiesPool.Free( packedEntity );
 	}
 }
 
@@ -316,16 +439,19 @@ CThreadFastMutex &CFrameSnapshotManager::GetMutex()
 	return m_WriteMutex;
 }
 
+void CFrameSnapshotManager::UpdateVProfCounters()
+{
+	m_PackedEntitiesPool.UpdateVProfCounters();
+}
+
 //-----------------------------------------------------------------------------
 // Returns the pack data for a particular entity for a particular snapshot
 //-----------------------------------------------------------------------------
 
 PackedEntity* CFrameSnapshotManager::CreatePackedEntity( CFrameSnapshot* pSnapshot, int entity )
 {
-	m_WriteMutex.Lock();
 	PackedEntity *packedEntity = m_PackedEntitiesPool.Alloc();
 	PackedEntityHandle_t handle = reinterpret_cast< PackedEntityHandle_t >( packedEntity );
-	m_WriteMutex.Unlock();
 	
 	Assert( entity < pSnapshot->m_nNumEntities );
 
@@ -432,7 +558,7 @@ UnpackedDataCache_t *CFrameSnapshotManager::GetCachedUncompressedEntity( PackedE
 // ------------------------------------------------------------------------------------------------ //
 
 #if defined( _DEBUG )
-	int g_nAllocatedSnapshots = 0;
+	CInterlockedInt g_nAllocatedSnapshots( 0 );
 #endif
 
 
@@ -493,8 +619,8 @@ void CFrameSnapshot::ReleaseReference()
 {
 	Assert( m_nReferences > 0 );
 
-	--m_nReferences;
-	if ( m_nReferences == 0 )
+	// clients release their frames from the job threads when snapshots are sent in parallel
+	if ( --m_nReferences == 0 )
 	{
 		g_FrameSnapshotManager.DeleteFrameSnapshot( this );
 	}
@@ -23,6 +23,8 @@ public:
 
 	// updates an ip entry, return true if the ip is allowed, false otherwise
 	bool CheckIP( netadr_t ip );
+	// same without sv_logblocks logging, for use off the main thread
+	bool CheckIPNoLog( netadr_t ip ) { return CheckIPInternal( ip ); }
 
 private:
 	bool CheckIPInternal( netadr_t ip );
@@ -52,4 +54,10 @@ private:
 // returns false if this IP exceeds rate limits
 bool CheckConnectionLessRateLimits( netadr_t & adr );
 
+// Called by the network receive thread for connectionless packets on server sockets,
+// returns false if the packet should be dropped before it reaches the main thread
+bool SV_PrefilterConnectionlessPacket( int nSocket, const netadr_t &adr, const unsigned char *pData, int nSize );
+// true if SV_PrefilterConnectionlessPacket already rate limits this query type on the socket
+bool SV_IsPrefilteredQuery( int nSocket, char c );
+
 #endif // SVIPRATELIMIT_H
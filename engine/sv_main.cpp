@@ -48,6 +48,7 @@
 #include "vgui_baseui_interface.h"
 #endif
 #include "cbenchmark.h"
+#include "dt_instrumentation_server.h"
 #include "client.h"
 #include "hltvserver.h"
 #include "replay_internal.h"
@@ -1818,36 +1819,74 @@ void CGameServer::CopyTempEntities( CFrameSnapshot* pSnapshot )
 	}
 }
 
-// If enabled, random crashes start to appear in WriteTempEntities, etc. It looks like
-// one thread can be in WriteDeltaEntities while another is in WriteTempEntities, and both are
-// partying on g_FrameSnapshotManager.m_FrameSnapshots. Bruce sent e-mail from a customer
-// that stated these crashes don't occur when parallel_sendsnapshot is disabled. Zoid said:
-//
-//   Easiest is just turn off parallel snapshots, it's not much of a win on servers where we
-//   are running many instances anyway. It's off in Dota and CSGO dedicated servers.
-//
-// Bruce also had a patch to disable this in //ValveGames/staging/game/tf/cfg/unencrypted/print_instance_config.py
-static ConVar sv_parallel_sendsnapshot( "sv_parallel_sendsnapshot", "0" );
+// Clients are sent their snapshots from the job threads. Anything in the send path that
+// touches shared state either takes a lock (snapshot list, send queue, netspike log) or is
+// deferred to the main thread (snapshot deletes, disconnects). HLTV and Replay clients
+// modify their server's frame lists and are always sent on the main thread.
+static ConVar sv_parallel_sendsnapshot( "sv_parallel_sendsnapshot", "1", 0, "Send snapshots to clients in parallel." );
 
 static void SV_ParallelSendSnapshot( CGameClient *& pClient )
 {
-	// HLTV and replay clients must be handled on the main thread
-	// because they access and modify global state. Skip them.
-	if ( pClient->IsHLTV() )
-		return;
-#if defined( REPLAY_ENABLED )
-	if ( pClient->IsReplay() )
-		return;
-#endif
 	CClientFrame *pFrame = pClient->GetSendFrame();
 	if ( pFrame )
 	{
 		pClient->SendSnapshot( pFrame );
 		pClient->UpdateSendState();
 	}
-	// Replace this parallel processing array entry with NULL so
-	// that the calling code knows that this entry was handled.
-	pClient = NULL;
+}
+
+//-----------------------------------------------------------------------------
+// sv_sendsnapshot_benchmark: times the snapshot send phase for a number of frames
+// serially and then the same number in parallel. Load the server with bots and
+// sv_stressbots 1 (or connect tv_test_start clients) before running it.
+//-----------------------------------------------------------------------------
+struct SendSnapshotBenchmark_t
+{
+	int		m_nFramesPerPass;	// 0 when not running
+	int		m_nFrame;			// first pass is serial, second is parallel
+	double	m_flTime[2];
+	int		m_nClients[2];		// summed over the frames of each pass
+};
+
+static SendSnapshotBenchmark_t s_SendSnapshotBenchmark;
+
+bool SV_IsSendSnapshotBenchmarkRunning()
+{
+	return s_SendSnapshotBenchmark.m_nFramesPerPass > 0;
+}
+
+CON_COMMAND( sv_sendsnapshot_benchmark, "Times sending snapshots serially and in parallel. Usage: sv_sendsnapshot_benchmark [frames per pass]" )
+{
+	if ( !sv.IsActive() )
+	{
+		ConMsg( "Server not running.\n" );
+		return;
+	}
+
+	Q_memset( &s_SendSnapshotBenchmark, 0, sizeof( s_SendSnapshotBenchmark ) );
+	s_SendSnapshotBenchmark.m_nFramesPerPass = ( args.ArgC() > 1 ) ? MAX( Q_atoi( args[1] ), 1 ) : 300;
+
+	ConMsg( "Benchmarking snapshot send for %d frames serially, then %d frames in parallel...\n",
+		s_SendSnapshotBenchmark.m_nFramesPerPass, s_SendSnapshotBenchmark.m_nFramesPerPass );
+}
+
+static void SV_SendSnapshotBenchmarkFrame( double flTime, int nClients )
+{
+	SendSnapshotBenchmark_t &b = s_SendSnapshotBenchmark;
+	int iPass = ( b.m_nFrame >= b.m_nFramesPerPass ) ? 1 : 0;
+	b.m_flTime[iPass] += flTime;
+	b.m_nClients[iPass] += nClients;
+
+	if ( ++b.m_nFrame < b.m_nFramesPerPass * 2 )
+		return;
+
+	double flSerial = b.m_flTime[0] * 1000.0 / b.m_nFramesPerPass;
+	double flParallel = b.m_flTime[1] * 1000.0 / b.m_nFramesPerPass;
+	ConMsg( "Snapshot send benchmark (%d frames per pass, %d job threads):\n", b.m_nFramesPerPass, g_pThreadPool ? g_pThreadPool->NumThreads() : 0 );
+	ConMsg( "  serial:   %.3f ms/frame, %.1f clients\n", flSerial, (float)b.m_nClients[0] / b.m_nFramesPerPass );
+	ConMsg( "  parallel: %.3f ms/frame, %.1f clients (%.2fx)\n", flParallel, (float)b.m_nClients[1] / b.m_nFramesPerPass,
+		flParallel > 0.0 ? flSerial / flParallel : 0.0 );
+	b.m_nFramesPerPass = 0;
 }
 
 void CGameServer::SendClientMessages ( bool bSendSnapshots )
@@ -1905,12 +1944,42 @@ void CGameServer::SendClientMessages ( bool bSendSnapshots )
 		// Compute the client packs
 		SV_ComputeClientPacks( receivingClientCount, pReceivingClients, pSnapshot );
 
-		if ( receivingClientCount > 1 && sv_parallel_sendsnapshot.GetBool() )
+		bool bParallel = receivingClientCount > 1 && sv_parallel_sendsnapshot.GetBool() && !g_bServerDTIEnabled;
+		bool bBenchmark = s_SendSnapshotBenchmark.m_nFramesPerPass > 0;
+		if ( bBenchmark )
+		{
+			bParallel = receivingClientCount > 1 && s_SendSnapshotBenchmark.m_nFrame >= s_SendSnapshotBenchmark.m_nFramesPerPass;
+		}
+		double flSendStart = Plat_FloatTime();
+
+		if ( bParallel )
 		{
-			// SV_ParallelSendSnapshot will not process HLTV or Replay clients as they
-			// must be run on the main thread due to un-threadsafe global state access.
-			// It will replace anything that it does process with a NULL pointer.
-			ParallelProcess( "SV_ParallelSendSnapshot", pReceivingClients, receivingClientCount, &SV_ParallelSendSnapshot );
+			// HLTV and Replay clients stay in pReceivingClients for the main thread loop below
+			CGameClient *pParallelClients[ABSOLUTE_PLAYER_LIMIT];
+			int nParallelClients = 0;
+			for ( int i = 0; i < receivingClientCount; ++i )
+			{
+				CGameClient *pClient = pReceivingClients[i];
+				if ( pClient->IsHLTV() )
+					continue;
+#if defined( REPLAY_ENABLED )
+				if ( pClient->IsReplay() )
+					continue;
+#endif
+				pClient->BeginParallelSend();
+				pParallelClients[nParallelClients++] = pClient;
+				pReceivingClients[i] = NULL;
+			}
+
+			framesnapshotmanager->DeferSnapshotDeletes( true );
+			ParallelProcess( "SV_ParallelSendSnapshot", pParallelClients, nParallelClients, &SV_ParallelSendSnapshot );
+			framesnapshotmanager->DeferSnapshotDeletes( false );
+
+			// carry out any disconnects that happened while sending
+			for ( int i = 0; i < nParallelClients; ++i )
+			{
+				pParallelClients[i]->EndParallelSend();
+			}
 		}
 		
 		for (int i = 0; i < receivingClientCount; ++i)
@@ -1924,6 +1993,11 @@ void CGameServer::SendClientMessages ( bool bSendSnapshots )
 			pClient->SendSnapshot( pFrame );
 			pClient->UpdateSendState();
 		}
+
+		if ( bBenchmark )
+		{
+			SV_SendSnapshotBenchmarkFrame( Plat_FloatTime() - flSendStart, receivingClientCount );
+		}
 	
 		pSnapshot->ReleaseReference();
 	}
@@ -2901,7 +2975,9 @@ void SV_SendClientUpdates( bool bIsSimulating, bool bSendDuringPause )
 	SV_PreClientUpdate( bIsSimulating );
 
 	// This causes network messages to be sent
+	NET_BeginBatchedSend();
 	sv.SendClientMessages( bIsSimulating || bForcedSend );
+	NET_FlushBatchedSend();
 
 	// tricky, increase stringtable tick at least one tick
 	// so changes made after this point are not counted to this server
@@ -63,6 +63,7 @@ class IServerEntity;
 void SV_ExecuteClientMessage (CGameClient *cl);
 
 bool SV_ActivateServer();
+bool SV_IsSendSnapshotBenchmarkRunning();
 void SV_InitGameServerSteam();
 
 #ifdef ENABLE_RPT
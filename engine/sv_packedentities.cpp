@@ -463,10 +463,53 @@ void PackEntities_Normal(
 		}
 	}
 
+	framesnapshotmanager->UpdateVProfCounters();
+
 	InvalidateSharedEdictChangeInfos();
 }
 
 
+static ConVar sv_parallel_checktransmit( "sv_parallel_checktransmit", "1", 0, "Run CheckTransmit for each client on the job threads if the game dll supports it" );
+
+struct CheckTransmitWork_t
+{
+	CGameClient		*pClient;
+
+	static void Process( CheckTransmitWork_t &item )
+	{
+		CGameClient *pClient = item.pClient;
+		CFrameSnapshot *pSnapshot = pClient->m_pCurrentFrame->GetSnapshot();
+
+		// pack info, PVS and transmit bits are owned by the client, so
+		// nothing here is shared with the other jobs
+		serverGameEnts->CheckTransmit( &pClient->m_PackInfo, pSnapshot->m_pValidEntities, pSnapshot->m_nValidEntities );
+		pClient->SetupPrevPackInfo();
+	}
+};
+
+static void SV_ParallelCheckTransmit( 
+	int clientCount, 
+	CGameClient **clients,
+	CFrameSnapshot *snapshot )
+{
+	CUtlVectorFixed< CheckTransmitWork_t, ABSOLUTE_PLAYER_LIMIT > workItems;
+
+	// SetupPackInfo calls into ClientSetupVisibility which builds the PVS
+	// through engine globals (g_AreasNetworked), so it stays serial
+	for ( int iClient = 0; iClient < clientCount; ++iClient )
+	{
+		clients[iClient]->SetupPackInfo( snapshot );
+
+		CheckTransmitWork_t w;
+		w.pClient = clients[iClient];
+		workItems.AddToTail( w );
+	}
+
+	serverGameEntsEx->PrepareCheckTransmit( snapshot->m_pValidEntities, snapshot->m_nValidEntities );
+
+	ParallelProcess( "CheckTransmitWork_t::Process", workItems.Base(), workItems.Count(), &CheckTransmitWork_t::Process );
+}
+
 //-----------------------------------------------------------------------------
 // Writes the compressed packet of entities to all clients
 //-----------------------------------------------------------------------------
@@ -483,12 +526,20 @@ void SV_ComputeClientPacks(
 	{
 		VPROF_BUDGET_FLAGS( "SV_ComputeClientPacks", "CheckTransmit", BUDGETFLAG_SERVER );
 
-		for (int iClient = 0; iClient < clientCount; ++iClient)
+		if ( clientCount > 1 && sv_parallel_checktransmit.GetBool() &&
+			 serverGameEntsEx && serverGameEntsEx->IsCheckTransmitThreadSafe() )
+		{
+			SV_ParallelCheckTransmit( clientCount, clients, snapshot );
+		}
+		else
 		{
-			CCheckTransmitInfo *pInfo = &clients[iClient]->m_PackInfo;
-			clients[iClient]->SetupPackInfo( snapshot );
-			serverGameEnts->CheckTransmit( pInfo, snapshot->m_pValidEntities, snapshot->m_nValidEntities );
-			clients[iClient]->SetupPrevPackInfo();
+			for (int iClient = 0; iClient < clientCount; ++iClient)
+			{
+				CCheckTransmitInfo *pInfo = &clients[iClient]->m_PackInfo;
+				clients[iClient]->SetupPackInfo( snapshot );
+				serverGameEnts->CheckTransmit( pInfo, snapshot->m_pValidEntities, snapshot->m_nValidEntities );
+				clients[iClient]->SetupPrevPackInfo();
+			}
 		}
 	}
 
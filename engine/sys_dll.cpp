@@ -128,6 +128,7 @@ typedef void (DLLEXPORT * PFN_GlobalMethod)( edict_t *pEntity );
 IServerGameDLL	*serverGameDLL = NULL;
 int g_iServerGameDLLVersion = 0;
 IServerGameEnts *serverGameEnts = NULL;
+IServerGameEntsEx *serverGameEntsEx = NULL;
 
 IServerGameClients *serverGameClients = NULL;
 int g_iServerGameClientsVersion = 0;	// This matches the number at the end of the interface name (so for "ServerGameClients004", this would be 4).
@@ -1171,6 +1172,9 @@ static bool LoadThisDll( char *szDllFilename, bool bIsServerOnly )
 			goto IgnoreThisDLL;
 		}
 
+		serverGameEntsEx = (IServerGameEntsEx*)g_ServerFactory(INTERFACEVERSION_SERVERGAMEENTSEX, NULL);
+		// Possible that this is NULL - optional interface
+
 		serverGameClients = (IServerGameClients*)g_ServerFactory(INTERFACEVERSION_SERVERGAMECLIENTS, NULL);
 		if ( serverGameClients )
 		{
@@ -1216,6 +1220,7 @@ IgnoreThisDLL:
 		g_pFileSystem->UnloadModule(pDLL);
 		serverGameDLL = NULL;
 		serverGameEnts = NULL;
+		serverGameEntsEx = NULL;
 		serverGameClients = NULL;
 	}
 	return false;
@@ -1570,6 +1575,7 @@ void UnloadEntityDLLs( void )
 	g_GameDLL = NULL;
 	serverGameDLL = NULL;
 	serverGameEnts = NULL;
+	serverGameEntsEx = NULL;
 	serverGameClients = NULL;
 	sv_noclipduringpause = NULL;
 }
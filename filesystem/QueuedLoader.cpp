@@ -101,6 +101,13 @@ struct FileJob_t
 	LoaderError_t			m_LoaderError;
 	unsigned int			m_ThreadId;
 
+	// decode stage
+	ResourcePreload_t		m_DecodeType;
+	void					*m_pDeliveredData;
+	FileJob_t				*m_pNextDecode;		// next delivered job with the same context
+	double					m_flSubmitTime;
+	double					m_flDeliverTime;
+
 	unsigned int			m_bFinished : 1;
 	unsigned int			m_bFreeTargetAfterIO : 1;
 	unsigned int			m_bFileExists : 1;
@@ -158,6 +165,10 @@ public:
 	// submit any queued jobs to the async loader, called by main or async thread to get more work
 	void								SubmitPendingJobs();
 
+	// hand a job's delivered i/o to the decode workers, called by the async thread
+	void								DeliverFileJob( FileJob_t *pFileJob );
+	void								SpewDecodeReport();
+
 	void								PurgeAll();
 
 
@@ -177,6 +188,16 @@ private:
 	};
 	typedef CUtlSortVector< FileNameHandle_t, CResourceNameLessFunc > ResourceList_t;
 
+	struct DecodeStats_t
+	{
+		int		m_nJobs;
+		int64	m_nBytes;
+		double	m_flIOTime;				// submit to delivery
+		double	m_flWaitTime;			// delivery to decode start
+		double	m_flDecodeTime;			// callback
+		double	m_flMaxDecodeTime;
+	};
+
 	static void							BuildResources( IResourcePreload *pLoader, ResourceList_t *pList, float *pBuildTime );
 	static void							BuildMaterialResources( IResourcePreload *pLoader, ResourceList_t *pList, float *pBuildTime );
 
@@ -189,6 +210,11 @@ private:
 	void								PurgeUnreferencedResources();
 	void								AddResourceToTable( const char *pFilename );
 
+	static ResourcePreload_t			GetDecodeType( const char *pFilename );
+	static void							DecodeFileJobs( FileJob_t *pFileJob );
+	void								StartDecodePool();
+	void								ResetDecodeStats();
+
 	bool								m_bStarted;
 	bool								m_bActive;
 	bool								m_bBatching;
@@ -222,6 +248,16 @@ private:
 	float								m_LoaderTimes[RESOURCEPRELOAD_COUNT];
 	ILoaderProgress						*m_pProgress;
 	CThreadFastMutex					m_Mutex;
+
+	// Delivered i/o is decoded on its own workers, so a slow parse doesn't hold up the reads.
+	// Jobs that share a context are decoded one at a time in delivery order.
+	IThreadPool							*m_pDecodePool;
+	CThreadFastMutex					m_DecodeMutex;
+	CUtlMap< void *, FileJob_t * >		m_DecodeChains;		// context -> last delivered job for it
+	DecodeStats_t						m_DecodeStats[RESOURCEPRELOAD_COUNT];
+	double								m_flFirstSubmitTime;
+	double								m_flLastDeliverTime;
+	double								m_flLastDecodeTime;
 };
 static CQueuedLoader g_QueuedLoader;
 EXPOSE_SINGLE_INTERFACE_GLOBALVAR( CQueuedLoader, IQueuedLoader, QUEUEDLOADER_INTERFACE_VERSION, g_QueuedLoader );
@@ -275,15 +311,22 @@ ConVar loader_spew_info( "loader_spew_info", "0", 0, "0:Off, 1:Timing, 2:Complet
 //			  by whoever sees this comment after we've shipped a DLL using it!
 ConVar loader_sped_info_ex( "loader_spew_info_ex", "0", 0, "(internal)" );
 
+ConVar loader_decode_threads( "loader_decode_threads", "0", 0, "Number of workers decoding delivered map resources, 0:One less than the number of cores" );
+
 CON_COMMAND( loader_dump_table, "" )
 {
 	g_QueuedLoader.SpewInfo();
 }
 
+CON_COMMAND( loader_report, "I/O and decode timing by resource type for the last queued load" )
+{
+	g_QueuedLoader.SpewDecodeReport();
+}
+
 //-----------------------------------------------------------------------------
 // Constructor
 //-----------------------------------------------------------------------------
-CQueuedLoader::CQueuedLoader() : BaseClass( false )
+CQueuedLoader::CQueuedLoader() : BaseClass( false ), m_DecodeChains( 0, 0, DefLessFunc( void * ) )
 {
 	m_bStarted = false;
 	m_bActive = false;
@@ -305,6 +348,9 @@ CQueuedLoader::CQueuedLoader() : BaseClass( false )
 	m_pProgress = &s_DummyProgress;
 	V_memset( m_pLoaders, 0, sizeof( m_pLoaders ) );
 
+	m_pDecodePool = NULL;
+	ResetDecodeStats();
+
 	// set resource dictionaries sort context
 	for ( intp i = 0; i < RESOURCEPRELOAD_COUNT; i++ )
 	{
@@ -466,8 +512,12 @@ void AdjustAsyncIOSpeed()
 //-----------------------------------------------------------------------------
 // Computation job to do work after IO, runs callback
 //-----------------------------------------------------------------------------
-void IOComputationJob( FileJob_t *pFileJob, void *pData, int nSize, LoaderError_t loaderError )
+void IOComputationJob( FileJob_t *pFileJob )
 {
+	void *pData = pFileJob->m_pDeliveredData;
+	int nSize = pFileJob->m_nActualBytesRead;
+	LoaderError_t loaderError = pFileJob->m_LoaderError;
+
 	int spewDetail = g_QueuedLoader.GetSpewDetail();
 	if ( spewDetail & ( LOADER_DETAIL_COMPLETIONS|LOADER_DETAIL_LATECOMPLETIONS ) )
 	{
@@ -493,9 +543,6 @@ void IOComputationJob( FileJob_t *pFileJob, void *pData, int nSize, LoaderError_
 		Warning( "QueuedLoader:: I/O Error on %s\n", szFilename );
 	}
 
-	pFileJob->m_nActualBytesRead = nSize;
-	pFileJob->m_LoaderError = loaderError;
-
 	if ( !pFileJob->m_pCallback )
 	{
 		// absent callback means resource loader want this system to delay buffer until ready for it
@@ -518,7 +565,14 @@ void IOComputationJob( FileJob_t *pFileJob, void *pData, int nSize, LoaderError_
 		// memory has been consumed
 		g_nIOMemory -= nSize;
 	}
+}
 
+//-----------------------------------------------------------------------------
+// Marks a decoded job as completed. The main thread is free to delete the job
+// once this has been called.
+//-----------------------------------------------------------------------------
+void FinishFileJob( FileJob_t *pFileJob )
+{
 	// mark as completed
 	pFileJob->m_bFinished = true;
 	pFileJob->m_FinishTime = Plat_MSTime();
@@ -535,7 +589,7 @@ void IOComputationJob( FileJob_t *pFileJob, void *pData, int nSize, LoaderError_
 
 	g_nQueuedJobs--;
 
-	if ( g_nQueuedJobs == 0 && ( spewDetail & LOADER_DETAIL_TIMING ) )
+	if ( g_nQueuedJobs == 0 && ( g_QueuedLoader.GetSpewDetail() & LOADER_DETAIL_TIMING ) )
 	{
 		Msg( "QueuedLoader: Finished I/O of all queued jobs!\n" );
 	}
@@ -604,14 +658,10 @@ void IOAsyncCallback( const FileAsyncRequest_t &asyncRequest, int numReadBytes,
 	}
 
 	// have data or error, do callback as a computation job
-	if ( !g_QueuedLoader.IsDynamic() )
-	{
-		g_pThreadPool->QueueCall( IOComputationJob, pFileJob, asyncRequest.pData, numReadBytes, loaderError )->Release();
-	}
-	else
-	{
-		g_QueuedLoader.QueueDynamicLoadFunctor( CreateFunctor( IOComputationJob, pFileJob, asyncRequest.pData, numReadBytes, loaderError ) );
-	}
+	pFileJob->m_pDeliveredData = asyncRequest.pData;
+	pFileJob->m_nActualBytesRead = numReadBytes;
+	pFileJob->m_LoaderError = loaderError;
+	g_QueuedLoader.DeliverFileJob( pFileJob );
 	
 	// don't let the i/o starve, possibly get some more work from the pending queue
 	g_QueuedLoader.SubmitPendingJobs();
@@ -621,6 +671,208 @@ void IOAsyncCallback( const FileAsyncRequest_t &asyncRequest, int numReadBytes,
 	--g_nActiveJobs;
 }
 
+//-----------------------------------------------------------------------------
+// Hands delivered i/o to the decode workers. A job whose context already has a
+// decode in flight is chained behind it instead, so the parts of a resource
+// (i.e. a model's mdl/vtx/vvd/phy) are decoded one at a time in delivery order.
+//-----------------------------------------------------------------------------
+void CQueuedLoader::DeliverFileJob( FileJob_t *pFileJob )
+{
+	pFileJob->m_flDeliverTime = Plat_FloatTime();
+	pFileJob->m_pNextDecode = NULL;
+
+	void *pContext = pFileJob->m_pCallback ? pFileJob->m_pContext : NULL;
+	if ( pContext )
+	{
+		AUTO_LOCK( m_DecodeMutex );
+		unsigned short iChain = m_DecodeChains.Find( pContext );
+		if ( iChain != m_DecodeChains.InvalidIndex() )
+		{
+			// the worker decoding this context picks it up when done
+			m_DecodeChains[iChain]->m_pNextDecode = pFileJob;
+			m_DecodeChains[iChain] = pFileJob;
+			return;
+		}
+		m_DecodeChains.Insert( pContext, pFileJob );
+	}
+
+	if ( m_bDynamic )
+	{
+		QueueDynamicLoadFunctor( CreateFunctor( DecodeFileJobs, pFileJob ) );
+	}
+	else
+	{
+		IThreadPool *pPool = m_pDecodePool ? m_pDecodePool : g_pThreadPool;
+		pPool->QueueCall( DecodeFileJobs, pFileJob )->Release();
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Decode worker, runs the job's callback and then any jobs for the same
+// context that were delivered in the meantime.
+//-----------------------------------------------------------------------------
+void CQueuedLoader::DecodeFileJobs( FileJob_t *pFileJob )
+{
+	while ( pFileJob )
+	{
+		double flStartTime = Plat_FloatTime();
+		IOComputationJob( pFileJob );
+		double flEndTime = Plat_FloatTime();
+
+		FileJob_t *pNextFileJob;
+		{
+			AUTO_LOCK( g_QueuedLoader.m_DecodeMutex );
+
+			DecodeStats_t &stats = g_QueuedLoader.m_DecodeStats[pFileJob->m_DecodeType];
+			stats.m_nJobs++;
+			stats.m_nBytes += pFileJob->m_nActualBytesRead;
+			stats.m_flIOTime += pFileJob->m_flDeliverTime - pFileJob->m_flSubmitTime;
+			stats.m_flWaitTime += flStartTime - pFileJob->m_flDeliverTime;
+			stats.m_flDecodeTime += flEndTime - flStartTime;
+			stats.m_flMaxDecodeTime = MAX( stats.m_flMaxDecodeTime, flEndTime - flStartTime );
+			g_QueuedLoader.m_flLastDeliverTime = MAX( g_QueuedLoader.m_flLastDeliverTime, pFileJob->m_flDeliverTime );
+			g_QueuedLoader.m_flLastDecodeTime = MAX( g_QueuedLoader.m_flLastDecodeTime, flEndTime );
+
+			pNextFileJob = pFileJob->m_pNextDecode;
+			if ( !pNextFileJob && pFileJob->m_pCallback && pFileJob->m_pContext )
+			{
+				// nothing else arrived for this context
+				g_QueuedLoader.m_DecodeChains.Remove( pFileJob->m_pContext );
+			}
+		}
+
+		// the job can be freed once it's marked finished
+		FinishFileJob( pFileJob );
+		pFileJob = pNextFileJob;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Classifies a job by the kind of resource its callback decodes
+//-----------------------------------------------------------------------------
+ResourcePreload_t CQueuedLoader::GetDecodeType( const char *pFilename )
+{
+	const char *pExt = V_GetFileExtension( pFilename );
+	if ( !pExt )
+	{
+		return RESOURCEPRELOAD_UNKNOWN;
+	}
+
+	if ( !V_stricmp( pExt, "wav" ) || !V_stricmp( pExt, "mp3" ) )
+	{
+		return RESOURCEPRELOAD_SOUND;
+	}
+	if ( !V_stricmp( pExt, "vmt" ) )
+	{
+		return RESOURCEPRELOAD_MATERIAL;
+	}
+	if ( !V_stricmp( pExt, "vtf" ) )
+	{
+		bool bCubemap = V_stristr( pFilename, "maps\\" ) || V_stristr( pFilename, "maps/" );
+		return bCubemap ? RESOURCEPRELOAD_CUBEMAP : RESOURCEPRELOAD_MATERIAL;
+	}
+	if ( !V_stricmp( pExt, "mdl" ) || !V_stricmp( pExt, "vtx" ) || !V_stricmp( pExt, "vvd" ) || !V_stricmp( pExt, "phy" ) || !V_stricmp( pExt, "bsp" ) )
+	{
+		return RESOURCEPRELOAD_MODEL;
+	}
+	if ( !V_stricmp( pExt, "vhv" ) )
+	{
+		return RESOURCEPRELOAD_STATICPROPLIGHTING;
+	}
+	return RESOURCEPRELOAD_UNKNOWN;
+}
+
+//-----------------------------------------------------------------------------
+// Decode workers live from the first queued load until shutdown, late jobs
+// can still be delivered after the load has ended.
+//-----------------------------------------------------------------------------
+void CQueuedLoader::StartDecodePool()
+{
+	if ( m_pDecodePool )
+	{
+		return;
+	}
+
+	int nThreads = loader_decode_threads.GetInt();
+	if ( nThreads <= 0 )
+	{
+		// leave a core for the main thread
+		nThreads = MAX( 1, GetCPUInformation()->m_nLogicalProcessors - 1 );
+	}
+
+	ThreadPoolStartParams_t params;
+	params.nThreads = MIN( nThreads, TP_MAX_POOL_THREADS );
+
+	m_pDecodePool = CreateThreadPool();
+	m_pDecodePool->Start( params, "LoaderDecode" );
+}
+
+void CQueuedLoader::ResetDecodeStats()
+{
+	AUTO_LOCK( m_DecodeMutex );
+	V_memset( m_DecodeStats, 0, sizeof( m_DecodeStats ) );
+	m_flFirstSubmitTime = 0;
+	m_flLastDeliverTime = 0;
+	m_flLastDecodeTime = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Spew per stage timing of the queued load by resource type. Stage times are
+// summed over jobs, the stages of different jobs overlap.
+//-----------------------------------------------------------------------------
+void CQueuedLoader::SpewDecodeReport()
+{
+	DecodeStats_t stats[RESOURCEPRELOAD_COUNT];
+	double flFirstSubmitTime, flLastDeliverTime, flLastDecodeTime;
+	{
+		AUTO_LOCK( m_DecodeMutex );
+		V_memcpy( stats, m_DecodeStats, sizeof( stats ) );
+		flFirstSubmitTime = m_flFirstSubmitTime;
+		flLastDeliverTime = m_flLastDeliverTime;
+		flLastDecodeTime = m_flLastDecodeTime;
+	}
+
+	Msg( "Queued Loader Decode (%d workers):\n\n", m_pDecodePool ? m_pDecodePool->NumThreads() : 0 );
+	Msg( "%-14s %6s %9s %9s %9s %9s %9s\n", "Type", "Jobs", "MB", "I/O(s)", "Wait(s)", "Decode(s)", "Max(ms)" );
+
+	DecodeStats_t total;
+	V_memset( &total, 0, sizeof( total ) );
+	for ( int i = 0; i < RESOURCEPRELOAD_COUNT; i++ )
+	{
+		if ( !stats[i].m_nJobs )
+		{
+			continue;
+		}
+
+		Msg( "%-14s %6d %9.2f %9.2f %9.2f %9.2f %9.2f\n",
+			g_ResourceLoaderNames[i],
+			stats[i].m_nJobs,
+			(double)stats[i].m_nBytes / ( 1024.0 * 1024.0 ),
+			stats[i].m_flIOTime,
+			stats[i].m_flWaitTime,
+			stats[i].m_flDecodeTime,
+			stats[i].m_flMaxDecodeTime * 1000.0 );
+
+		total.m_nJobs += stats[i].m_nJobs;
+		total.m_nBytes += stats[i].m_nBytes;
+		total.m_flIOTime += stats[i].m_flIOTime;
+		total.m_flWaitTime += stats[i].m_flWaitTime;
+		total.m_flDecodeTime += stats[i].m_flDecodeTime;
+		total.m_flMaxDecodeTime = MAX( total.m_flMaxDecodeTime, stats[i].m_flMaxDecodeTime );
+	}
+
+	Msg( "%-14s %6d %9.2f %9.2f %9.2f %9.2f %9.2f\n", "Total", total.m_nJobs, (double)total.m_nBytes / ( 1024.0 * 1024.0 ),
+		total.m_flIOTime, total.m_flWaitTime, total.m_flDecodeTime, total.m_flMaxDecodeTime * 1000.0 );
+
+	if ( total.m_nJobs && flFirstSubmitTime )
+	{
+		// decode finishing well after the last delivery means the load is bound by decode, not the disk
+		double flIOSpan = flLastDeliverTime - flFirstSubmitTime;
+		Msg( "\nI/O: %.2fs, %.2f MB/s\n", flIOSpan, flIOSpan > 0 ? ( (double)total.m_nBytes / ( 1024.0 * 1024.0 ) ) / flIOSpan : 0 );
+		Msg( "Decode finished %.2fs after the last delivery\n", MAX( flLastDecodeTime - flLastDeliverTime, 0.0 ) );
+	}
+}
+
 //-----------------------------------------------------------------------------
 // Public method to filename dictionary
 //-----------------------------------------------------------------------------
@@ -820,6 +1072,11 @@ void CQueuedLoader::SubmitPendingJobs()
 		
 		pFileJob->m_SubmitTag = m_nSubmitCount;
 		pFileJob->m_SubmitTime = Plat_MSTime();
+		pFileJob->m_flSubmitTime = Plat_FloatTime();
+		if ( !m_flFirstSubmitTime )
+		{
+			m_flFirstSubmitTime = pFileJob->m_flSubmitTime;
+		}
 
 		m_SubmittedJobs.AddToTail( pFileJob );
 
@@ -861,10 +1118,10 @@ void CQueuedLoader::SubmitPendingJobs()
 		{
 			// prevent dragging the i/o system down for known failures
 			// still need to do callback so subsystems can do the right thing based on file absence
-			if ( IsDynamic() )
-				QueueDynamicLoadFunctor( CreateFunctor( IOComputationJob, pFileJob, pFileJob->m_pTargetData, 0, LOADERERROR_FILEOPEN ) );
-			else
-				g_pThreadPool->QueueCall( IOComputationJob, pFileJob, pFileJob->m_pTargetData, 0, LOADERERROR_FILEOPEN )->Release();
+			pFileJob->m_pDeliveredData = pFileJob->m_pTargetData;
+			pFileJob->m_nActualBytesRead = 0;
+			pFileJob->m_LoaderError = LOADERERROR_FILEOPEN;
+			DeliverFileJob( pFileJob );
 		}
 	}
 }
@@ -950,6 +1207,7 @@ bool CQueuedLoader::AddJob( const LoaderJob_t *pLoaderJob )
 	pFileJob->m_nBytesToRead = pLoaderJob->m_nBytesToRead;
 	pFileJob->m_nStartOffset = pLoaderJob->m_nStartOffset;
 	pFileJob->m_Priority = bFileIsFromBSP ? LOADERPRIORITY_DURINGPRELOAD : pLoaderJob->m_Priority;
+	pFileJob->m_DecodeType = pLoaderJob->m_pCallback ? GetDecodeType( pFullPath ) : RESOURCEPRELOAD_ANONYMOUS;
 
 	if ( pLoaderJob->m_pTargetData )
 	{
@@ -1316,6 +1574,13 @@ InitReturnVal_t CQueuedLoader::Init()
 //-----------------------------------------------------------------------------
 void CQueuedLoader::Shutdown()
 {
+	if ( m_pDecodePool )
+	{
+		m_pDecodePool->Stop();
+		DestroyThreadPool( m_pDecodePool );
+		m_pDecodePool = NULL;
+	}
+
 	BaseClass::Shutdown();
 }
 
@@ -1670,6 +1935,9 @@ bool CQueuedLoader::BeginMapLoading( const char *pMapName, bool bLoadForHDR, boo
 	CleanQueue();
 	Assert( m_SubmittedJobs.Count() == 0 && g_nActiveJobs == 0 && g_nQueuedJobs == 0 );
 
+	StartDecodePool();
+	ResetDecodeStats();
+
 	m_bActive = true;
 	m_nSubmitCount = 0;
 	m_StartTime = Plat_MSTime();
@@ -1796,6 +2064,11 @@ void CQueuedLoader::EndMapLoading( bool bAbort )
 		m_EndTime = Plat_MSTime();
 		m_bActive = false;
 
+		if ( GetSpewDetail() & LOADER_DETAIL_TIMING )
+		{
+			SpewDecodeReport();
+		}
+
 		// transmit the end map event
 		for ( int i = RESOURCEPRELOAD_UNKNOWN+1; i < RESOURCEPRELOAD_COUNT; i++ )
 		{
@@ -15,6 +15,7 @@
 #include "tier1/utlbuffer.h"
 #include "tier1/convar.h"
 #include "tier1/KeyValues.h"
+#include "tier1/keyvaluesview.h"
 #include "tier0/icommandline.h"
 #include "generichash.h"
 #include "tier1/utllinkedlist.h"
@@ -43,6 +44,7 @@
 #endif
 
 #include <time.h>
+#include <errno.h>
 
 // memdbgon must be the last include file in a .cpp file!!!
 #include "tier0/memdbgon.h"
@@ -53,6 +55,8 @@
 
 ConVar fs_report_sync_opens( "fs_report_sync_opens", "0", 0, "0:Off, 1:Blocking only, 2:All" );
 ConVar fs_warning_mode( "fs_warning_mode", "0", 0, "0:Off, 1:Warn main thread, 2:Warn other threads"  );
+ConVar fs_negative_lookup_cache( "fs_negative_lookup_cache", "1", 0, "Remember which search paths a file is missing from" );
+ConVar fs_negative_lookup_cache_ttl( "fs_negative_lookup_cache_ttl", "10", 0, "Seconds a missing loose file is remembered, so files created outside the filesystem show up", true, 0, false, 0 );
 
 #define BSPOUTPUT	0	// bsp output flag -- determines type of fs_log output to generate
 
@@ -509,6 +513,7 @@ void CBaseFileSystem::Shutdown()
 #endif
 
 	UnloadCompiledKeyValues();
+	m_KeyValuesCache.Shutdown();
 
 	RemoveAllSearchPaths();
 	Trace_DumpUnclosedFiles();
@@ -794,6 +799,8 @@ CPackedStoreRefCount::CPackedStoreRefCount( char const *pFileBasename, char *psz
 void CBaseFileSystem::AddVPKFile( char const *pPath, const char *pPathID, SearchPathAdd_t addType )
 {
 #if defined( SUPPORT_PACKED_STORE )
+	InvalidateNegativeLookups();
+
 	char nameBuf[MAX_PATH];
 
 	Q_MakeAbsolutePath( nameBuf, sizeof( nameBuf ), pPath );
@@ -828,6 +835,12 @@ void CBaseFileSystem::AddVPKFile( char const *pPath, const char *pPathID, Search
 			return;
 		}
 		pVPK->RegisterFileTracker( (IThreadedFileMD5Processor *)&m_FileTracker2 );
+#if defined( PLATFORM_64BITS ) && defined( POSIX )
+		// Plenty of address space to map every chunk, reads become memcpys out of the page cache.
+		// Opt in only: mapped reads skip the read cache's MD5 checks, and a chunk truncated
+		// while mapped faults instead of failing the read.
+		pVPK->SetUseMemoryMapping( CommandLine()->FindParm( "-vpkmmap" ) != 0 );
+#endif
 
 		pVPK->m_PackFileID = m_FileTracker2.NotePackFileOpened( pVPK->FullPathName(), pPathID, 0 );
 	}
@@ -1095,6 +1108,7 @@ void CBaseFileSystem::AddPackFiles( const char *pPath, const CUtlSymbol &pathID,
 void CBaseFileSystem::RemoveAllMapSearchPaths( void )
 {
 	AsyncFinishAll();
+	InvalidateNegativeLookups();
 
 	int c = m_SearchPaths.Count();
 	for ( int i = c - 1; i >= 0; i-- )
@@ -1113,6 +1127,8 @@ void CBaseFileSystem::RemoveAllMapSearchPaths( void )
 //-----------------------------------------------------------------------------
 void CBaseFileSystem::AddMapPackFile( const char *pPath, const char *pPathID, SearchPathAdd_t addType )
 {
+	InvalidateNegativeLookups();
+
 	char tempPathID[MAX_PATH];
 	ParsePathID( pPath, pPathID, tempPathID );
 
@@ -1542,6 +1558,8 @@ CBaseFileSystem::CSearchPath *CBaseFileSystem::FindSearchPathByStoreId( int stor
 //-----------------------------------------------------------------------------
 void CBaseFileSystem::AddSearchPath( const char *pPath, const char *pathID, SearchPathAdd_t addType )
 {
+	InvalidateNegativeLookups();
+
 	int currCount = m_SearchPaths.Count();
 
 	AddSearchPathInternal( pPath, pathID, addType, true );
@@ -1638,6 +1656,7 @@ int CBaseFileSystem::GetSearchPath( const char *pathID, bool bGetPackFiles, OUT_
 bool CBaseFileSystem::RemoveSearchPath( const char *pPath, const char *pathID )
 {
 	AsyncFinishAll();
+	InvalidateNegativeLookups();
 
 	char newPath[ MAX_FILEPATH ];
 	newPath[ 0 ] = 0;
@@ -1694,6 +1713,7 @@ bool CBaseFileSystem::RemoveSearchPath( const char *pPath, const char *pathID )
 void CBaseFileSystem::RemoveSearchPaths( const char *pathID )
 {
 	AsyncFinishAll();
+	InvalidateNegativeLookups();
 
 	int nCount = m_SearchPaths.Count();
 	for (int i = nCount - 1; i >= 0; i--)
@@ -2121,6 +2141,7 @@ bool CBaseFileSystem::UnzipFile( const char *pFileName, const char *pPath, const
 void CBaseFileSystem::RemoveAllSearchPaths( void )
 {
 	AUTO_LOCK( m_SearchPathsMutex );
+	InvalidateNegativeLookups();
 	m_SearchPaths.Purge();
 	//m_PackFileHandles.Purge();
 }
@@ -2306,6 +2327,109 @@ void CBaseFileSystem::HandleOpenRegularFile( CFileOpenInfo &openInfo, bool bIsAb
 }
 
 
+//-----------------------------------------------------------------------------
+// Negative lookup cache. Most search paths don't have most files, so the same
+// relative filename gets probed (stat/fopen, zip or VPK directory lookups) in
+// every search path on every open. Misses are remembered per search path.
+// Pack file misses last until the search paths change. Loose file misses are
+// keyed by absolute path so a write through the filesystem drops just that
+// file, and expire after fs_negative_lookup_cache_ttl for outside writers.
+//-----------------------------------------------------------------------------
+#define MAX_NEGATIVE_LOOKUPS	( 64 * 1024 )
+
+static void BuildNegativeLookupKey( char *pKey, int nKeySize, const char *pDirectory, int storeId, const char *pFileName )
+{
+	if ( pDirectory )
+	{
+		V_snprintf( pKey, nKeySize, "%s%s", pDirectory, pFileName );
+	}
+	else
+	{
+		V_snprintf( pKey, nKeySize, "%d:%s", storeId, pFileName );
+	}
+	V_strlower( pKey );
+	V_FixSlashes( pKey );
+	V_FixDoubleSlashes( pKey );
+}
+
+static void BuildNegativeLookupKey( char *pKey, int nKeySize, const CBaseFileSystem::CSearchPath *pSearchPath, const char *pFileName )
+{
+	bool bIsPack = pSearchPath->GetPackFile() || pSearchPath->GetPackedStore();
+	BuildNegativeLookupKey( pKey, nKeySize, bIsPack ? NULL : pSearchPath->GetPathString(), pSearchPath->m_storeId, pFileName );
+}
+
+bool CBaseFileSystem::IsKnownMissing( const CSearchPath *pSearchPath, const char *pFileName )
+{
+	m_Stats.nSearchPathProbes++;
+
+	if ( !fs_negative_lookup_cache.GetBool() )
+		return false;
+
+	char szKey[ MAX_FILEPATH ];
+	BuildNegativeLookupKey( szKey, sizeof( szKey ), pSearchPath, pFileName );
+
+	m_NegativeLookupLock.LockForRead();
+	UtlHashHandle_t h = m_NegativeLookups.Find( szKey );
+	bool bMissing = ( h != m_NegativeLookups.InvalidHandle() ) && ( m_NegativeLookups[h] == 0 || m_NegativeLookups[h] > Plat_FloatTime() );
+	m_NegativeLookupLock.UnlockRead();
+
+	if ( bMissing )
+	{
+		m_Stats.nSearchPathProbesAvoided++;
+	}
+	return bMissing;
+}
+
+void CBaseFileSystem::NoteMissing( const CSearchPath *pSearchPath, const char *pFileName, int nOpenError )
+{
+	if ( !fs_negative_lookup_cache.GetBool() )
+		return;
+
+	// A loose file that failed to open for any other reason (access, out of
+	// handles, sharing violation) may well be there next time
+	bool bIsPack = pSearchPath->GetPackFile() || pSearchPath->GetPackedStore();
+	if ( !bIsPack && nOpenError != ENOENT )
+		return;
+
+	char szKey[ MAX_FILEPATH ];
+	BuildNegativeLookupKey( szKey, sizeof( szKey ), pSearchPath, pFileName );
+
+	double flExpireTime = bIsPack ? 0 : Plat_FloatTime() + fs_negative_lookup_cache_ttl.GetFloat();
+
+	m_NegativeLookupLock.LockForWrite();
+	if ( m_NegativeLookups.Count() >= MAX_NEGATIVE_LOOKUPS )
+	{
+		m_NegativeLookups.RemoveAll();
+	}
+	m_NegativeLookups[ m_NegativeLookups.Insert( szKey ) ] = flExpireTime;
+	m_NegativeLookupLock.UnlockWrite();
+}
+
+void CBaseFileSystem::InvalidateNegativeLookup( const char *pFullPath )
+{
+	char szKey[ MAX_FILEPATH ];
+	BuildNegativeLookupKey( szKey, sizeof( szKey ), pFullPath, 0, "" );
+
+	m_NegativeLookupLock.LockForWrite();
+	m_NegativeLookups.Remove( szKey );
+	m_NegativeLookupLock.UnlockWrite();
+}
+
+void CBaseFileSystem::InvalidateNegativeLookups()
+{
+	m_NegativeLookupLock.LockForWrite();
+	m_NegativeLookups.RemoveAll();
+	m_NegativeLookupLock.UnlockWrite();
+}
+
+CON_COMMAND( fs_negative_lookup_stats, "Show how many search path probes the negative lookup cache avoided" )
+{
+	const FileSystemStatistics *pStats = BaseFileSystem()->GetFilesystemStatistics();
+	unsigned int nProbes = pStats->nSearchPathProbes;
+	unsigned int nAvoided = pStats->nSearchPathProbesAvoided;
+	Msg( "Search path probes: %u, avoided: %u (%.1f%%)\n", nProbes, nAvoided, nProbes ? 100.0f * nAvoided / nProbes : 0.0f );
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: The base file search goes through here
 // Input  : *path - 
@@ -2522,8 +2646,16 @@ FileHandle_t CBaseFileSystem::OpenForRead( const char *pFileNameT, const char *p
 	CSearchPathsIterator iter( this, &pFileName, pathID, pathFilter );
 	for ( openInfo.m_pSearchPath = iter.GetFirst(); openInfo.m_pSearchPath != NULL; openInfo.m_pSearchPath = iter.GetNext() )
 	{
+		if ( IsKnownMissing( openInfo.m_pSearchPath, openInfo.m_pFileName ) )
+			continue;
+
+		errno = 0;
 		FileHandle_t filehandle = FindFileInSearchPath( openInfo );
-		if ( filehandle )
+		if ( !filehandle )
+		{
+			NoteMissing( openInfo.m_pSearchPath, openInfo.m_pFileName, errno );
+		}
+		else
 		{
 			// Check if search path is excluded due to pure server white list,
 			// then we should make a note of this fact, and keep searching
@@ -2589,6 +2721,9 @@ FileHandle_t CBaseFileSystem::OpenForWrite( const char *pFileName, const char *p
 		return ( FileHandle_t )0;
 	}
 
+	// A file that didn't exist before may now be visible through the search paths
+	InvalidateNegativeLookup( pTmpFileName );
+
 	CFileHandle *fh = new CFileHandle( this );
 	fh->m_nLength = size;
 	fh->m_type = FT_NORMAL;
@@ -3084,6 +3219,127 @@ bool CBaseFileSystem::ExtractRootKeyName( KeyValuesPreloadType_t type, char *out
 	return bret;
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: Opens kvcache.dat in the write path once there is one
+// Output : Returns false if the cache is turned off
+//-----------------------------------------------------------------------------
+bool CBaseFileSystem::InitKeyValuesCache()
+{
+	static bool s_bDisabled = CommandLine()->FindParm( "-nokvcache" ) != 0;
+	if ( s_bDisabled )
+		return false;
+
+	if ( m_KeyValuesCache.IsInitialized() )
+		return true;
+
+	char szPath[MAX_PATH * 4];
+	if ( GetSearchPath( "DEFAULT_WRITE_PATH", false, szPath, sizeof( szPath ) ) <= 1 &&
+		GetSearchPath( "MOD", false, szPath, sizeof( szPath ) ) <= 1 )
+	{
+		// keep using the in memory entries until we know where the file goes
+		return true;
+	}
+
+	char *pSeparator = strchr( szPath, ';' );
+	if ( pSeparator )
+	{
+		*pSeparator = 0;
+	}
+
+	char szFileName[MAX_PATH];
+	V_ComposeFileName( szPath, "kvcache.dat", szFileName, sizeof( szFileName ) );
+	m_KeyValuesCache.Init( szFileName );
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Looks up a compiled KeyValues file by the hash of its text
+// Input  : nHash - HashKeyValuesText() of the file
+//			*pSize - size of the returned blob
+// Output : The blob, NULL if it isn't cached
+//-----------------------------------------------------------------------------
+const void *CBaseFileSystem::FindCompiledKeyValues( uint64 nHash, int *pSize )
+{
+	if ( !InitKeyValuesCache() )
+		return NULL;
+
+	return m_KeyValuesCache.Find( nHash, pSize );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Compiles a freshly parsed KeyValues file into the cache
+// Output : The blob, NULL if the keys can't be compiled
+//-----------------------------------------------------------------------------
+const void *CBaseFileSystem::AddCompiledKeyValues( uint64 nHash, KeyValues *pKeyValues, int *pSize )
+{
+	if ( !InitKeyValuesCache() )
+		return NULL;
+
+	return m_KeyValuesCache.Add( nHash, pKeyValues, pSize );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Points view at the compiled form of a KeyValues file, parsing and
+//			caching it first if it hasn't been seen before
+// Output : Returns false if the file is missing, uses #include/#base or the cache is off
+//-----------------------------------------------------------------------------
+bool CBaseFileSystem::LoadKeyValuesView( CKeyValuesView &view, const char *filename, const char *pPathID /*= 0*/ )
+{
+	view = CKeyValuesView();
+	if ( !InitKeyValuesCache() )
+		return false;
+
+	FileHandle_t f = Open( filename, "rb", pPathID );
+	if ( !f )
+		return false;
+
+	int fileSize = Size( f );
+	unsigned bufSize = GetOptimalReadSize( f, fileSize + 2 );
+	char *buffer = (char *)AllocOptimalReadBuffer( f, bufSize, 0 );
+	bool bRetOK = ( ReadEx( buffer, bufSize, fileSize, f ) != 0 );
+	Close( f );
+
+	if ( bRetOK )
+	{
+		buffer[fileSize] = 0;
+		buffer[fileSize+1] = 0;
+
+		// the cache only knows about this file's text, not the ones it pulls in
+		bRetOK = !V_stristr( buffer, "#include" ) && !V_stristr( buffer, "#base" );
+	}
+
+	const void *pBlob = NULL;
+	if ( bRetOK )
+	{
+		// same flags as a default constructed KeyValues, so LoadFromFile shares the entries
+		uint64 nHash = HashKeyValuesText( buffer, fileSize, false, true );
+		int nSize;
+		pBlob = m_KeyValuesCache.Find( nHash, &nSize );
+		if ( !pBlob )
+		{
+			KeyValues *pKeyValues = new KeyValues( filename );
+			if ( pKeyValues->LoadFromBuffer( filename, buffer, this, pPathID ) )
+			{
+				pBlob = m_KeyValuesCache.Add( nHash, pKeyValues, &nSize );
+			}
+			pKeyValues->deleteThis();
+		}
+	}
+
+	FreeOptimalReadBuffer( buffer );
+
+	if ( !pBlob )
+		return false;
+
+	view = CKeyValuesView( pBlob );
+	return true;
+}
+
+CON_COMMAND( fs_kvcache_stats, "Show how the compiled KeyValues cache is doing" )
+{
+	BaseFileSystem()->PrintKeyValuesCacheStats();
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: 
 //-----------------------------------------------------------------------------
@@ -4724,6 +4980,7 @@ bool CBaseFileSystem::RenameFile( char const *pOldPath, char const *pNewPath, co
 		return false;
 	}
 
+	InvalidateNegativeLookup( pNewFileName );
 	return true;
 }
 
@@ -5465,6 +5722,28 @@ int CFileHandle::GetSectorSize()
 	}
 }
 
+//-----------------------------------------------------------------------------
+// OS file descriptor of a plain file on disk, -1 for pack files, memory files
+// and file systems that don't have one
+//-----------------------------------------------------------------------------
+int CFileHandle::GetNativeFileDescriptor()
+{
+	Assert( IsValid() );
+
+#if defined( SUPPORT_PACKED_STORE )
+	if ( m_VPKHandle )
+	{
+		return -1;
+	}
+#endif
+
+	if ( m_pFile && !m_pPackFileHandle && m_type == FT_NORMAL )
+	{
+		return m_fs->FS_GetNativeFileDescriptor( m_pFile );
+	}
+	return -1;
+}
+
 bool CFileHandle::IsOK()
 {
 #if defined( SUPPORT_PACKED_STORE )
@@ -61,6 +61,7 @@
 #include "byteswap.h"
 #include "threadsaferefcountedobject.h"
 #include "filetracker.h"
+#include "keyvaluescache.h"
 // #include "filesystem_init.h"
 
 #if defined( SUPPORT_PACKED_STORE )
@@ -126,6 +127,7 @@ public:
 	void	Init( CBaseFileSystem* fs );
 
 	int		GetSectorSize();
+	int		GetNativeFileDescriptor();
 	bool	IsOK();
 	void	Flush();
 	void	SetBufferSize( int nBytes );
@@ -428,6 +430,7 @@ public:
 	virtual bool				FullPathToRelativePathEx( const char *pFullpath, const char *pPathId, OUT_Z_CAP(maxLenInChars) char *pDest, int maxLenInChars );
 
 	FSAsyncStatus_t				SyncRead( const FileAsyncRequest_t &request );
+	void							SyncReadBatch( CFileAsyncReadJob **ppJobs, int nJobs );
 	FSAsyncStatus_t				SyncWrite(const char *pszFilename, const void *pSrc, int nSrcBytes, bool bFreeMemory, bool bAppend );
 	FSAsyncStatus_t				SyncAppendFile(const char *pAppendToFileName, const char *pAppendFromFileName );
 	FSAsyncStatus_t				SyncGetFileSize( const FileAsyncRequest_t &request );
@@ -444,6 +447,11 @@ public:
 	virtual bool				LoadKeyValues( KeyValues& head, KeyValuesPreloadType_t type, char const *filename, char const *pPathID = 0 );
 	virtual bool				ExtractRootKeyName( KeyValuesPreloadType_t type, char *outbuf, size_t bufsize, char const *filename, char const *pPathID = 0 );
 
+	virtual const void			*FindCompiledKeyValues( uint64 nHash, int *pSize );
+	virtual const void			*AddCompiledKeyValues( uint64 nHash, KeyValues *pKeyValues, int *pSize );
+	virtual bool				LoadKeyValuesView( CKeyValuesView &view, const char *filename, const char *pPathID = 0 );
+	void						PrintKeyValuesCacheStats() { m_KeyValuesCache.PrintStats(); }
+
 	virtual DVDMode_t			GetDVDMode() { return m_DVDMode; }
 
 	FSDirtyDiskReportFunc_t		GetDirtyDiskReportFunc() { return m_DirtyDiskReportFunc; }
@@ -721,6 +729,7 @@ protected:
 	virtual bool FS_FindNextFile(HANDLE handle, WIN32_FIND_DATA *dat) = 0;
 	virtual bool FS_FindClose(HANDLE handle) = 0;
 	virtual int FS_GetSectorSize( FILE * ) { return 1; }
+	virtual int FS_GetNativeFileDescriptor( FILE * ) { return -1; }
 
 #if defined( TRACK_BLOCKING_IO )
 	void BlockingFileAccess_EnterCriticalSection();
@@ -759,6 +768,12 @@ protected:
 	CThreadFastMutex m_MemoryFileMutex;
 	CUtlHashtable< const char*, CMemoryFileBacking* > m_MemoryFileHash;
 
+	// Keyed by "<storeId>:<relative filename>" for pack files and by absolute
+	// path for loose files, lowercase. The value is the Plat_FloatTime() the
+	// entry expires at, 0 for never.
+	CThreadSpinRWLock m_NegativeLookupLock;
+	CUtlHashtable< CUtlString, double > m_NegativeLookups;
+
 
 	//CUtlRBTree< COpenedFile, int > m_OpenedFiles;
 	CThreadMutex m_OpenedFilesMutex;
@@ -796,6 +811,12 @@ protected:
 	void						HandleOpenRegularFile( CFileOpenInfo &openInfo, bool bIsAbsolutePath );
 
 	FileHandle_t				FindFileInSearchPath( CFileOpenInfo &openInfo );
+
+	// Negative lookup cache: relative filenames known to be missing from a search path
+	bool						IsKnownMissing( const CSearchPath *pSearchPath, const char *pFileName );
+	void						NoteMissing( const CSearchPath *pSearchPath, const char *pFileName, int nOpenError );
+	void						InvalidateNegativeLookup( const char *pFullPath );
+	void						InvalidateNegativeLookups();
 	time_t						FastFileTime( const CSearchPath *path, const char *pFileName );
 
 	const char					*GetWritePath( const char *pFilename, const char *pathID );
@@ -841,6 +862,10 @@ protected:
 
 	CompiledKeyValuesPreloaders_t	m_PreloadData[ NUM_PRELOAD_TYPES ];
 
+	// Opened lazily, the write path usually isn't set up when the first KeyValues files load
+	bool InitKeyValuesCache();
+	CKeyValuesCache					m_KeyValuesCache;
+
 	static CUtlSymbol			m_GamePathID;
 	static CUtlSymbol			m_BSPPathID;
 
@@ -27,6 +27,10 @@
 #include "tier0/icommandline.h"
 #include "vstdlib/random.h"
 #include "basefilesystem.h"
+#ifdef LINUX
+#include "linux_uring.h"
+#include <unistd.h>
+#endif
 
 // VCR mode for now is handled by not running async.  This is primarily for
 // performance reasons. VCR mode would preclude the use of a lock-free job
@@ -44,6 +48,16 @@
 ConVar async_mode( "async_mode", "0", 0, "Set the async filesystem mode (0 = async, 1 = synchronous)" );
 #define GetAsyncMode() ( (FSAsyncMode_t)( async_mode.GetInt() ) )
 
+#ifdef LINUX
+ConVar async_batch_reads( "async_batch_reads", "1", 0, "Keep all the reads of an AsyncReadMultiple call in flight at once through io_uring" );
+
+// Reads in flight per batch
+#define ASYNC_BATCH_RING_ENTRIES 64
+
+// Set by InitAsync if the kernel lets us create rings
+static bool s_bIOUringAvailable;
+#endif
+
 #ifndef DISABLE_ASYNC
 
 #ifndef _RETAIL
@@ -270,7 +284,11 @@ public:
 		m_pfnRealCallback( fromRequest.pfnCallback ),
 		m_pCustomFetcher(NULL),
 		m_hCustomFetcherHandle(NULL),
-		m_pOwnerFileSystem(pOwnerFileSystem)
+		m_pOwnerFileSystem(pOwnerFileSystem),
+		m_pPrefetchedData( NULL ),
+		m_nPrefetchedBytes( 0 ),
+		m_PrefetchedStatus( FSASYNC_OK ),
+		m_bPrefetched( false )
 	{
 #if defined( TRACK_BLOCKING_IO )
 		m_Timer.Start();
@@ -339,6 +357,12 @@ public:
 				retval = -1; // generic failure code...?
 			}
 		}
+		else if ( m_bPrefetched )
+		{
+			// SyncReadBatch already did the read
+			BaseFileSystem()->DoAsyncCallback( *this, m_pPrefetchedData, m_nPrefetchedBytes, m_PrefetchedStatus );
+			retval = m_PrefetchedStatus;
+		}
 		else
 		{
 			int iPrevPriority = ThreadGetPriority();
@@ -361,6 +385,15 @@ public:
 		return retval;
 	}
 
+	// Called with the job locked, Execute() then just delivers the data
+	void SetPrefetchedData( void *pData, int nBytesRead, FSAsyncStatus_t status )
+	{
+		m_pPrefetchedData = pData;
+		m_nPrefetchedBytes = nBytesRead;
+		m_PrefetchedStatus = status;
+		m_bPrefetched = true;
+	}
+
 	virtual JobStatus_t GetResult( void **ppData, int *pSize ) 
 	{ 
 		if ( m_pResultData )
@@ -424,6 +457,10 @@ private:
 	int						m_nResultSize;
 	void *					m_pRealContext;
 	FSAsyncCallbackFunc_t	m_pfnRealCallback;
+	void *					m_pPrefetchedData;
+	int						m_nPrefetchedBytes;
+	FSAsyncStatus_t			m_PrefetchedStatus;
+	bool					m_bPrefetched;
 #if defined( TRACK_BLOCKING_IO )
 	CFastTimer				m_Timer;
 #endif
@@ -433,6 +470,63 @@ private:
 #endif
 };
 
+//---------------------------------------------------------
+// The read jobs of one AsyncReadMultiple call, serviced
+// together so their reads can all be in flight at once.
+// The read jobs stay the caller's handles.
+//---------------------------------------------------------
+class CFileAsyncReadBatchJob : public CFileAsyncJob
+{
+public:
+	CFileAsyncReadBatchJob( CFileAsyncReadJob **ppJobs, int nJobs )
+	{
+		// highest priority first, request order within a priority
+		for ( int iPriority = JP_HIGH; iPriority >= JP_LOW; iPriority-- )
+		{
+			for ( int i = 0; i < nJobs; i++ )
+			{
+				if ( ppJobs[i]->GetPriority() == iPriority )
+				{
+					ppJobs[i]->AddRef();
+					m_Jobs.AddToTail( ppJobs[i] );
+				}
+			}
+		}
+		SetPriority( m_Jobs[0]->GetPriority() );
+	}
+
+	~CFileAsyncReadBatchJob()
+	{
+		for ( int i = 0; i < m_Jobs.Count(); i++ )
+		{
+			m_Jobs[i]->Release();
+		}
+	}
+
+	virtual char const *Describe()
+	{
+		return "AsyncReadBatch";
+	}
+
+	virtual JobStatus_t DoExecute()
+	{
+		BaseFileSystem()->SyncReadBatch( m_Jobs.Base(), m_Jobs.Count() );
+		return JOB_OK;
+	}
+
+	virtual JobStatus_t DoAbort( bool bDiscard )
+	{
+		for ( int i = 0; i < m_Jobs.Count(); i++ )
+		{
+			m_Jobs[i]->Abort( bDiscard );
+		}
+		return JOB_STATUS_ABORTED;
+	}
+
+private:
+	CUtlVector<CFileAsyncReadJob *> m_Jobs;
+};
+
 //---------------------------------------------------------
 // Append to a file
 //---------------------------------------------------------
@@ -689,6 +783,15 @@ void CBaseFileSystem::InitAsync()
 			SafeRelease( m_pThreadPool );
 		}
 	}
+
+#ifdef LINUX
+	CIOUring ring;
+	s_bIOUringAvailable = ring.Init( ASYNC_BATCH_RING_ENTRIES );
+	if ( !s_bIOUringAvailable )
+	{
+		DevMsg( "io_uring unavailable, async reads are serviced by the i/o threads one at a time\n" );
+	}
+#endif
 }
 
 //-----------------------------------------------------------------------------
@@ -806,6 +909,12 @@ FSAsyncStatus_t CBaseFileSystem::AsyncReadMultipleCreditAlloc( const FileAsyncRe
 
 	CFileAsyncReadJob *pJob;
 
+#ifdef LINUX
+	// Plain reads get serviced together instead of one job at a time
+	bool bBatch = ( !bSynchronous && nRequests > 1 && s_bIOUringAvailable && async_batch_reads.GetBool() );
+	CUtlVector<CFileAsyncReadJob *> batchJobs;
+#endif
+
 	for ( int i = 0; i < nRequests; i++ )
 	{
 		if ( pRequests[i].nBytes >= 0 )
@@ -873,8 +982,18 @@ FSAsyncStatus_t CBaseFileSystem::AsyncReadMultipleCreditAlloc( const FileAsyncRe
 
 		if ( !bSynchronous )
 		{
-			// async mode, queue request
-			m_pThreadPool->AddJob( pJob );
+#ifdef LINUX
+			if ( bBatch && pRequests[i].nBytes >= 0 )
+			{
+				batchJobs.AddToTail( pJob );
+				pJob->AddRef();
+			}
+			else
+#endif
+			{
+				// async mode, queue request
+				m_pThreadPool->AddJob( pJob );
+			}
 		}
 		else
 		{
@@ -892,6 +1011,24 @@ FSAsyncStatus_t CBaseFileSystem::AsyncReadMultipleCreditAlloc( const FileAsyncRe
 		}
 	}
 
+#ifdef LINUX
+	if ( batchJobs.Count() > 1 )
+	{
+		CFileAsyncReadBatchJob *pBatchJob = new CFileAsyncReadBatchJob( batchJobs.Base(), batchJobs.Count() );
+		m_pThreadPool->AddJob( pBatchJob );
+		pBatchJob->Release();
+	}
+	else if ( batchJobs.Count() )
+	{
+		m_pThreadPool->AddJob( batchJobs[0] );
+	}
+
+	for ( int i = 0; i < batchJobs.Count(); i++ )
+	{
+		batchJobs[i]->Release();
+	}
+#endif
+
 	return FSASYNC_OK;
 }
 
@@ -1400,6 +1537,245 @@ FSAsyncStatus_t CBaseFileSystem::SyncRead( const FileAsyncRequest_t &request )
 	return result;
 }
 
+//-----------------------------------------------------------------------------
+// Services a batch of read jobs with all their reads in flight at once, so the
+// drive sees a deep queue instead of one read at a time. Jobs that can't be read
+// straight from a file descriptor (pack files, custom allocators, held files)
+// run the usual way while the batched reads are in flight.
+//-----------------------------------------------------------------------------
+void CBaseFileSystem::SyncReadBatch( CFileAsyncReadJob **ppJobs, int nJobs )
+{
+#ifdef LINUX
+	struct BatchedRead_t
+	{
+		CFileAsyncReadJob *m_pJob;
+		FileHandle_t m_hFile;
+		int m_fd;
+		char *m_pDest;
+		int m_nBytesToRead;
+		int m_nBytesRead;
+		bool m_bQueued;			// handed to the ring and not completed yet
+	};
+
+	CIOUring ring;
+	bool bUseRing = ring.Init( ASYNC_BATCH_RING_ENTRIES );
+
+	CUtlVector<BatchedRead_t> reads;
+	CUtlVector<CFileAsyncReadJob *> unbatchedJobs;
+
+	for ( int i = 0; i < nJobs; i++ )
+	{
+		CFileAsyncReadJob *pJob = ppJobs[i];
+
+		// Whoever else got to the job first (AsyncFinish, a raised priority) services it.
+		// Batched jobs stay locked until their data is delivered, so nobody reads them twice.
+		if ( !pJob->TryLock() )
+			continue;
+
+		if ( pJob->IsFinished() )
+		{
+			pJob->Unlock();
+			continue;
+		}
+
+		const FileAsyncRequest_t &request = *pJob->GetRequest();
+		FileHandle_t hFile = NULL;
+		int fd = -1;
+		if ( bUseRing && !request.pfnAlloc && request.hSpecificAsyncFile == FS_INVALID_ASYNC_FILE && request.nOffset >= 0 )
+		{
+			hFile = OpenEx( request.pszFilename, "rb", 0, request.pszPathID );
+			if ( hFile )
+			{
+				fd = ( (CFileHandle *)hFile )->GetNativeFileDescriptor();
+				if ( fd == -1 )
+				{
+					Close( hFile );
+				}
+			}
+		}
+
+		if ( fd == -1 )
+		{
+			pJob->Unlock();
+			unbatchedJobs.AddToTail( pJob );
+			continue;
+		}
+
+		BatchedRead_t &read = reads[ reads.AddToTail() ];
+		read.m_pJob = pJob;
+		read.m_hFile = hFile;
+		read.m_fd = fd;
+		read.m_nBytesRead = 0;
+		read.m_bQueued = false;
+		read.m_nBytesToRead = MAX( 0, ( request.nBytes ) ? request.nBytes : Size( hFile ) - request.nOffset );
+
+		if ( request.pData )
+		{
+			// caller provided buffer
+			Assert( !( request.flags & FSASYNC_FLAGS_NULLTERMINATE ) );
+			read.m_pDest = (char *)request.pData;
+		}
+		else
+		{
+			// allocate an optimal buffer, same as SyncRead
+			unsigned nOffsetAlign;
+			int nBytesBuffer = read.m_nBytesToRead + ( ( request.flags & FSASYNC_FLAGS_NULLTERMINATE ) ? 1 : 0 );
+			if ( GetOptimalIOConstraints( hFile, &nOffsetAlign, NULL, NULL) && ( request.nOffset % nOffsetAlign == 0 ) )
+			{
+				nBytesBuffer = GetOptimalReadSize( hFile, nBytesBuffer );
+			}
+			read.m_pDest = (char *)AllocOptimalReadBuffer( hFile, nBytesBuffer, request.nOffset );
+		}
+	}
+
+	int nNextRead = 0;
+	int nInFlight = 0;
+	int nDelivered = 0;
+	bool bRingOK = true;
+	bool bFirstWave = true;
+	CUtlVector<int> completedReads;
+
+	while ( nDelivered < reads.Count() || bFirstWave )
+	{
+		// keep the ring full
+		while ( bRingOK && nNextRead < reads.Count() && nInFlight < (int)ring.GetEntries() )
+		{
+			BatchedRead_t &read = reads[nNextRead];
+			if ( !ring.QueueRead( read.m_fd, read.m_pDest, read.m_nBytesToRead, read.m_pJob->GetRequest()->nOffset, nNextRead ) )
+				break;
+			read.m_bQueued = true;
+			nNextRead++;
+			nInFlight++;
+		}
+
+		if ( bRingOK && nInFlight )
+		{
+			bRingOK = ring.Submit( bFirstWave ? 0 : 1 );
+		}
+
+		if ( bFirstWave )
+		{
+			// everything else is serviced while the first wave is in flight
+			bFirstWave = false;
+			for ( int i = 0; i < unbatchedJobs.Count(); i++ )
+			{
+				unbatchedJobs[i]->Execute();
+			}
+		}
+
+		uint64 nRead;
+		int nResult;
+		while ( bRingOK && ring.PopCompletion( &nRead, &nResult ) )
+		{
+			BatchedRead_t &read = reads[(int)nRead];
+			read.m_bQueued = false;
+			nInFlight--;
+
+			if ( nResult > 0 )
+			{
+				read.m_nBytesRead += nResult;
+				if ( read.m_nBytesRead < read.m_nBytesToRead )
+				{
+					// short read, go again for the rest
+					int64 nOffset = read.m_pJob->GetRequest()->nOffset + read.m_nBytesRead;
+					if ( ring.QueueRead( read.m_fd, read.m_pDest + read.m_nBytesRead, read.m_nBytesToRead - read.m_nBytesRead, nOffset, nRead ) )
+					{
+						read.m_bQueued = true;
+						nInFlight++;
+						continue;
+					}
+				}
+			}
+			completedReads.AddToTail( (int)nRead );
+		}
+
+		if ( !bRingOK )
+		{
+			// Shouldn't happen once the ring is set up. Read whatever is left ourselves,
+			// but only once the kernel is done with the buffers of the reads it took.
+			::Warning( "io_uring failed, finishing async reads one at a time\n" );
+
+			int nKernelOwned = nInFlight - (int)ring.GetUnsubmitted();
+			while ( nKernelOwned > 0 )
+			{
+				if ( ring.PopCompletion( &nRead, &nResult ) )
+				{
+					BatchedRead_t &read = reads[(int)nRead];
+					read.m_bQueued = false;
+					read.m_nBytesRead += MAX( nResult, 0 );
+					nKernelOwned--;
+				}
+				else if ( !ring.WaitForCompletion() )
+				{
+					break;
+				}
+			}
+
+			// Reads complete in any order, so anything not delivered yet is still in the list
+			for ( int i = 0; i < reads.Count(); i++ )
+			{
+				BatchedRead_t &read = reads[i];
+				if ( !read.m_hFile || completedReads.Find( i ) != completedReads.InvalidIndex() )
+					continue;
+
+				if ( read.m_bQueued && nKernelOwned > 0 )
+				{
+					// Couldn't wait for the kernel. It may still write this read's buffer, so
+					// ours gets abandoned. A caller's buffer would only get the same bytes.
+					read.m_nBytesRead = 0;
+					if ( !read.m_pJob->GetRequest()->pData )
+					{
+						int nBytesBuffer = read.m_nBytesToRead + ( ( read.m_pJob->GetRequest()->flags & FSASYNC_FLAGS_NULLTERMINATE ) ? 1 : 0 );
+						read.m_pDest = (char *)AllocOptimalReadBuffer( read.m_hFile, nBytesBuffer, read.m_pJob->GetRequest()->nOffset );
+					}
+				}
+
+				while ( read.m_nBytesRead < read.m_nBytesToRead )
+				{
+					int nResult = pread( read.m_fd, read.m_pDest + read.m_nBytesRead, read.m_nBytesToRead - read.m_nBytesRead, read.m_pJob->GetRequest()->nOffset + read.m_nBytesRead );
+					if ( nResult <= 0 )
+						break;
+					read.m_nBytesRead += nResult;
+				}
+				completedReads.AddToTail( i );
+			}
+			nInFlight = 0;
+		}
+
+		for ( int i = 0; i < completedReads.Count(); i++ )
+		{
+			BatchedRead_t &read = reads[ completedReads[i] ];
+			const FileAsyncRequest_t &request = *read.m_pJob->GetRequest();
+
+			Close( read.m_hFile );
+			read.m_hFile = NULL;
+
+			if ( request.flags & FSASYNC_FLAGS_NULLTERMINATE )
+			{
+				read.m_pDest[read.m_nBytesRead] = 0;
+			}
+
+			if ( m_fwLevel >= FILESYSTEM_WARNING_REPORTALLACCESSES_ASYNC )
+			{
+				LogAccessToFile( "async", request.pszFilename, "" );
+			}
+
+			FSAsyncStatus_t result = ( ( read.m_nBytesRead == 0 ) && ( read.m_nBytesToRead != 0 ) ) ? FSASYNC_ERR_READING : FSASYNC_OK;
+			read.m_pJob->SetPrefetchedData( read.m_pDest, read.m_nBytesRead, result );
+			read.m_pJob->Execute();
+			read.m_pJob->Unlock();
+			nDelivered++;
+		}
+		completedReads.RemoveAll();
+	}
+#else
+	for ( int i = 0; i < nJobs; i++ )
+	{
+		ppJobs[i]->Execute();
+	}
+#endif
+}
+
 //-----------------------------------------------------------------------------
 // 
 //-----------------------------------------------------------------------------
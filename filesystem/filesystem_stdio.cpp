@@ -85,6 +85,7 @@ protected:
 	virtual bool FS_FindNextFile(HANDLE handle, WIN32_FIND_DATA *dat);
 	virtual bool FS_FindClose(HANDLE handle);
 	virtual int FS_GetSectorSize( FILE * );
+	virtual int FS_GetNativeFileDescriptor( FILE * );
 
 private:
 	bool CanAsync() const
@@ -117,6 +118,7 @@ public:
 	virtual int FS_fflush() = 0;
 	virtual char *FS_fgets( char *dest, int destSize ) = 0;
 	virtual int FS_GetSectorSize() { return 1; }
+	virtual int FS_GetNativeFileDescriptor() { return -1; }
 };
 
 //---------------------------------------------------------
@@ -138,6 +140,9 @@ public:
 	virtual int FS_ferror();
 	virtual int FS_fflush();
 	virtual char *FS_fgets( char *dest, int destSize );
+#ifdef POSIX
+	virtual int FS_GetNativeFileDescriptor() { return fileno( m_pFile ); }
+#endif
 
 #ifdef POSIX
 	static CUtlMap< ino_t, CThreadMutex * > m_LockedFDMap;
@@ -764,6 +769,15 @@ int CFileSystem_Stdio::FS_GetSectorSize( FILE *fp )
 	return pFile->FS_GetSectorSize();
 }
 
+//-----------------------------------------------------------------------------
+// 
+//-----------------------------------------------------------------------------
+int CFileSystem_Stdio::FS_GetNativeFileDescriptor( FILE *fp )
+{
+	CStdFilesystemFile *pFile = ((CStdFilesystemFile *)fp);
+	return pFile->FS_GetNativeFileDescriptor();
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: files are always immediately available on disk
 //-----------------------------------------------------------------------------
@@ -871,9 +885,15 @@ CStdioFile *CStdioFile::FS_fopen( const char *filenameT, const char *options, in
 #if defined(LINUX) || defined(PLATFORM_BSD)
 	if(!pFile && !strchr(options,'w') && !strchr(options,'+') ) // try opening the lower cased version
 	{
+		// callers look at errno to tell a missing file from one that failed to open
+		int nOpenError = errno;
 		char caseFixedName[ MAX_PATH ];
 		bool found = findFileInDirCaseInsensitive_safe( filename, caseFixedName );
-		if ( found )
+		if ( !found )
+		{
+			errno = nOpenError;
+		}
+		else
 		{	
 			pFile = fopen( caseFixedName, options );
 
@@ -0,0 +1,474 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: On disk cache of compiled KeyValues files, keyed by a hash of the
+//			file contents
+//
+// $NoKeywords: $
+//=============================================================================//
+
+#include "keyvaluescache.h"
+#include "tier1/keyvaluesview.h"
+#include "tier1/utlbuffer.h"
+#include "tier1/strtools.h"
+#include "tier0/dbg.h"
+
+#include <stdio.h>
+#include <time.h>
+#ifdef POSIX
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#include <process.h>
+#endif
+
+// memdbgon must be the last include file in a .cpp file!!!
+#include "tier0/memdbgon.h"
+
+#define KEYVALUES_CACHE_ID			MAKEID( 'V', 'K', 'V', 'C' )
+#define KEYVALUES_CACHE_VERSION		2
+
+// blobs are 8 byte aligned in the file so the nodes can be read in place
+#define KEYVALUES_CACHE_ALIGN		8
+
+// entries not found for this long are dropped on save
+#define KEYVALUES_CACHE_MAX_AGE			( 30 * 24 * 60 * 60 )
+// past this the least recently used entries are dropped on save
+#define KEYVALUES_CACHE_MAX_SIZE		( 64 * 1024 * 1024 )
+// an entry found this long after its last recorded use gets the file rewritten
+#define KEYVALUES_CACHE_TOUCH_INTERVAL	( 24 * 60 * 60 )
+
+struct KeyValuesCacheHeader_t
+{
+	uint32	m_nId;
+	uint32	m_nVersion;
+	uint32	m_nEntries;
+	uint32	m_nUnused;
+};
+
+CKeyValuesCache::CKeyValuesCache() : m_Added( 0, 0, DefLessFunc( uint64 ) )
+{
+	m_bInitialized = false;
+	m_szPath[0] = 0;
+	m_pFile = NULL;
+	m_nFileSize = 0;
+	m_pFileEntries = NULL;
+	m_nFileEntries = 0;
+	m_bDirty = false;
+	m_nHits = 0;
+	m_nMisses = 0;
+	m_nRejected = 0;
+}
+
+CKeyValuesCache::~CKeyValuesCache()
+{
+	Assert( !m_pFile && !m_Added.Count() );
+}
+
+void CKeyValuesCache::Init( const char *pFullPath )
+{
+	AUTO_LOCK( m_Mutex );
+	if ( m_bInitialized )
+		return;
+
+	m_bInitialized = true;
+	V_strncpy( m_szPath, pFullPath, sizeof( m_szPath ) );
+
+	void *pFile = NULL;
+	int64 nFileSize = 0;
+#ifdef POSIX
+	int fd = open( m_szPath, O_RDONLY );
+	if ( fd >= 0 )
+	{
+		struct stat st;
+		if ( fstat( fd, &st ) == 0 && st.st_size > 0 )
+		{
+			pFile = mmap( NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+			if ( pFile == MAP_FAILED )
+			{
+				pFile = NULL;
+			}
+			else
+			{
+				nFileSize = st.st_size;
+			}
+		}
+		close( fd );
+	}
+#else
+	// no mapping here, read it all in up front
+	FILE *fp = fopen( m_szPath, "rb" );
+	if ( fp )
+	{
+		fseek( fp, 0, SEEK_END );
+		long nSize = ftell( fp );
+		fseek( fp, 0, SEEK_SET );
+		if ( nSize > 0 )
+		{
+			pFile = malloc( nSize );
+			if ( fread( pFile, 1, nSize, fp ) == (size_t)nSize )
+			{
+				nFileSize = nSize;
+			}
+			else
+			{
+				free( pFile );
+				pFile = NULL;
+			}
+		}
+		fclose( fp );
+	}
+#endif
+
+	if ( !pFile )
+		return;
+
+	m_pFile = (const uint8 *)pFile;
+	m_nFileSize = nFileSize;
+
+	const KeyValuesCacheHeader_t *pHeader = (const KeyValuesCacheHeader_t *)m_pFile;
+	if ( m_nFileSize < (int64)sizeof( KeyValuesCacheHeader_t ) ||
+		pHeader->m_nId != KEYVALUES_CACHE_ID ||
+		pHeader->m_nVersion != KEYVALUES_CACHE_VERSION ||
+		(int64)sizeof( KeyValuesCacheHeader_t ) + (int64)pHeader->m_nEntries * (int64)sizeof( FileEntry_t ) > m_nFileSize )
+	{
+		// the blobs are validated when they're found, this only makes sure the table is usable
+		Unmap();
+		return;
+	}
+
+	m_pFileEntries = (const FileEntry_t *)( pHeader + 1 );
+	m_nFileEntries = pHeader->m_nEntries;
+	m_FileEntryUsed.SetCount( m_nFileEntries );
+	m_FileEntryUsed.FillWithValue( false );
+}
+
+void CKeyValuesCache::Unmap()
+{
+	if ( m_pFile )
+	{
+#ifdef POSIX
+		munmap( (void *)m_pFile, m_nFileSize );
+#else
+		free( (void *)m_pFile );
+#endif
+	}
+
+	m_pFile = NULL;
+	m_nFileSize = 0;
+	m_pFileEntries = NULL;
+	m_nFileEntries = 0;
+	m_FileEntryUsed.Purge();
+}
+
+void CKeyValuesCache::Shutdown()
+{
+	AUTO_LOCK( m_Mutex );
+
+	if ( m_bInitialized && m_bDirty )
+	{
+		if ( !Save() )
+		{
+			Warning( "Unable to write KeyValues cache %s\n", m_szPath );
+		}
+	}
+
+	Unmap();
+
+	FOR_EACH_MAP_FAST( m_Added, i )
+	{
+		free( m_Added[i].m_pData );
+	}
+	m_Added.Purge();
+	m_bDirty = false;
+	m_bInitialized = false;
+}
+
+const CKeyValuesCache::FileEntry_t *CKeyValuesCache::FindFileEntry( uint64 nHash ) const
+{
+	int nLow = 0;
+	int nHigh = m_nFileEntries - 1;
+	while ( nLow <= nHigh )
+	{
+		int nMid = ( nLow + nHigh ) / 2;
+		const FileEntry_t &entry = m_pFileEntries[nMid];
+		if ( entry.m_nHash == nHash )
+			return &entry;
+
+		if ( entry.m_nHash < nHash )
+		{
+			nLow = nMid + 1;
+		}
+		else
+		{
+			nHigh = nMid - 1;
+		}
+	}
+	return NULL;
+}
+
+const void *CKeyValuesCache::Find( uint64 nHash, int *pSize )
+{
+	AUTO_LOCK( m_Mutex );
+
+	int i = m_Added.Find( nHash );
+	if ( m_Added.IsValidIndex( i ) )
+	{
+		m_nHits++;
+		*pSize = m_Added[i].m_nSize;
+		return m_Added[i].m_pData;
+	}
+
+	const FileEntry_t *pEntry = FindFileEntry( nHash );
+	if ( pEntry )
+	{
+		const uint8 *pBlob = m_pFile + pEntry->m_nOffset;
+		if ( (int64)pEntry->m_nOffset + pEntry->m_nSize <= m_nFileSize &&
+			( pEntry->m_nOffset % KEYVALUES_CACHE_ALIGN ) == 0 &&
+			IsValidKeyValuesBlob( pBlob, pEntry->m_nSize ) )
+		{
+			m_nHits++;
+			m_FileEntryUsed[ pEntry - m_pFileEntries ] = true;
+			if ( (uint32)time( NULL ) - pEntry->m_nLastUsed > KEYVALUES_CACHE_TOUCH_INTERVAL )
+			{
+				m_bDirty = true;
+			}
+			*pSize = pEntry->m_nSize;
+			return pBlob;
+		}
+
+		m_nRejected++;
+	}
+
+	m_nMisses++;
+	return NULL;
+}
+
+const void *CKeyValuesCache::Add( uint64 nHash, KeyValues *pKeyValues, int *pSize )
+{
+	CUtlBuffer buf;
+	if ( !CompileKeyValuesBlob( pKeyValues, buf ) )
+		return NULL;
+
+	AUTO_LOCK( m_Mutex );
+
+	// someone else might have loaded the same file meanwhile
+	int i = m_Added.Find( nHash );
+	if ( !m_Added.IsValidIndex( i ) )
+	{
+		AddedBlob_t blob;
+		blob.m_nSize = buf.TellPut();
+		blob.m_pData = (uint8 *)malloc( blob.m_nSize );
+		V_memcpy( blob.m_pData, buf.Base(), blob.m_nSize );
+		i = m_Added.Insert( nHash, blob );
+		m_bDirty = true;
+	}
+
+	*pSize = m_Added[i].m_nSize;
+	return m_Added[i].m_pData;
+}
+
+//-----------------------------------------------------------------------------
+// Merges the entries of the old file with the added ones, both are sorted.
+// Entries past their age or the size cap are dropped along the way.
+//-----------------------------------------------------------------------------
+bool CKeyValuesCache::Save()
+{
+	struct SaveEntry_t
+	{
+		uint64		m_nHash;
+		const void	*m_pData;
+		uint32		m_nSize;
+		uint32		m_nLastUsed;
+	};
+
+	uint32 nNow = (uint32)time( NULL );
+
+	CUtlVector< SaveEntry_t > entries;
+	entries.EnsureCapacity( m_nFileEntries + m_Added.Count() );
+
+	int nFile = 0;
+	int nAdded = m_Added.FirstInorder();
+	while ( nFile < m_nFileEntries || m_Added.IsValidIndex( nAdded ) )
+	{
+		SaveEntry_t entry;
+		if ( m_Added.IsValidIndex( nAdded ) && ( nFile >= m_nFileEntries || m_Added.Key( nAdded ) <= m_pFileEntries[nFile].m_nHash ) )
+		{
+			if ( nFile < m_nFileEntries && m_Added.Key( nAdded ) == m_pFileEntries[nFile].m_nHash )
+			{
+				// replaces an entry that didn't validate
+				nFile++;
+			}
+
+			entry.m_nHash = m_Added.Key( nAdded );
+			entry.m_pData = m_Added[nAdded].m_pData;
+			entry.m_nSize = m_Added[nAdded].m_nSize;
+			entry.m_nLastUsed = nNow;
+			nAdded = m_Added.NextInorder( nAdded );
+		}
+		else
+		{
+			int iFileEntry = nFile++;
+			const FileEntry_t &fileEntry = m_pFileEntries[iFileEntry];
+			if ( (int64)fileEntry.m_nOffset + fileEntry.m_nSize > m_nFileSize )
+				continue;
+
+			entry.m_nLastUsed = m_FileEntryUsed[iFileEntry] ? nNow : fileEntry.m_nLastUsed;
+			if ( nNow - entry.m_nLastUsed > KEYVALUES_CACHE_MAX_AGE )
+				continue;
+
+			entry.m_nHash = fileEntry.m_nHash;
+			entry.m_pData = m_pFile + fileEntry.m_nOffset;
+			entry.m_nSize = fileEntry.m_nSize;
+		}
+
+		entries.AddToTail( entry );
+	}
+
+	// Over the size cap, keep the most recently used entries that fit
+	int64 nTotalSize = 0;
+	for ( int i = 0; i < entries.Count(); i++ )
+	{
+		nTotalSize += AlignValue( entries[i].m_nSize, KEYVALUES_CACHE_ALIGN ) + sizeof( FileEntry_t );
+	}
+
+	if ( nTotalSize > KEYVALUES_CACHE_MAX_SIZE )
+	{
+		struct EntryAge_t
+		{
+			uint32	m_nLastUsed;
+			int		m_iEntry;
+
+			// newest first
+			static int __cdecl Compare( const EntryAge_t *pLeft, const EntryAge_t *pRight )
+			{
+				if ( pLeft->m_nLastUsed != pRight->m_nLastUsed )
+					return ( pLeft->m_nLastUsed > pRight->m_nLastUsed ) ? -1 : 1;
+				return pLeft->m_iEntry - pRight->m_iEntry;
+			}
+		};
+
+		CUtlVector< EntryAge_t > byAge;
+		byAge.SetCount( entries.Count() );
+		for ( int i = 0; i < entries.Count(); i++ )
+		{
+			byAge[i].m_nLastUsed = entries[i].m_nLastUsed;
+			byAge[i].m_iEntry = i;
+		}
+		byAge.Sort( &EntryAge_t::Compare );
+
+		CUtlVector< bool > keep;
+		keep.SetCount( entries.Count() );
+		keep.FillWithValue( false );
+
+		int64 nKeptSize = 0;
+		for ( int i = 0; i < byAge.Count(); i++ )
+		{
+			int iEntry = byAge[i].m_iEntry;
+			nKeptSize += AlignValue( entries[iEntry].m_nSize, KEYVALUES_CACHE_ALIGN ) + sizeof( FileEntry_t );
+			if ( nKeptSize > KEYVALUES_CACHE_MAX_SIZE )
+				break;
+			keep[iEntry] = true;
+		}
+
+		int nKept = 0;
+		for ( int i = 0; i < entries.Count(); i++ )
+		{
+			if ( keep[i] )
+			{
+				entries[nKept++] = entries[i];
+			}
+		}
+		entries.SetCountNonDestructively( nKept );
+	}
+
+	// Other processes may be saving the same cache, each writes its own temp file
+	// and the last rename wins
+	char szTempPath[MAX_PATH];
+	FILE *fp = NULL;
+#ifdef POSIX
+	V_snprintf( szTempPath, sizeof( szTempPath ), "%s.XXXXXX", m_szPath );
+	int fd = mkstemp( szTempPath );
+	if ( fd >= 0 )
+	{
+		fp = fdopen( fd, "wb" );
+		if ( !fp )
+		{
+			close( fd );
+			remove( szTempPath );
+		}
+	}
+#else
+	V_snprintf( szTempPath, sizeof( szTempPath ), "%s.%d.tmp", m_szPath, _getpid() );
+	fp = fopen( szTempPath, "wb" );
+#endif
+	if ( !fp )
+		return false;
+
+	KeyValuesCacheHeader_t header;
+	header.m_nId = KEYVALUES_CACHE_ID;
+	header.m_nVersion = KEYVALUES_CACHE_VERSION;
+	header.m_nEntries = entries.Count();
+	header.m_nUnused = 0;
+	bool bOK = fwrite( &header, sizeof( header ), 1, fp ) == 1;
+
+	uint32 nOffset = sizeof( KeyValuesCacheHeader_t ) + entries.Count() * sizeof( FileEntry_t );
+	for ( int i = 0; i < entries.Count() && bOK; i++ )
+	{
+		nOffset = AlignValue( nOffset, KEYVALUES_CACHE_ALIGN );
+
+		FileEntry_t fileEntry;
+		fileEntry.m_nHash = entries[i].m_nHash;
+		fileEntry.m_nOffset = nOffset;
+		fileEntry.m_nSize = entries[i].m_nSize;
+		fileEntry.m_nLastUsed = entries[i].m_nLastUsed;
+		fileEntry.m_nUnused = 0;
+		bOK = fwrite( &fileEntry, sizeof( fileEntry ), 1, fp ) == 1;
+
+		nOffset += entries[i].m_nSize;
+	}
+
+	static const uint8 s_Padding[KEYVALUES_CACHE_ALIGN] = { 0 };
+	nOffset = sizeof( KeyValuesCacheHeader_t ) + entries.Count() * sizeof( FileEntry_t );
+	for ( int i = 0; i < entries.Count() && bOK; i++ )
+	{
+		uint32 nAligned = AlignValue( nOffset, KEYVALUES_CACHE_ALIGN );
+		if ( nAligned != nOffset )
+		{
+			bOK = fwrite( s_Padding, nAligned - nOffset, 1, fp ) == 1;
+		}
+
+		bOK = bOK && fwrite( entries[i].m_pData, entries[i].m_nSize, 1, fp ) == 1;
+		nOffset = nAligned + entries[i].m_nSize;
+	}
+
+	bOK = ( fclose( fp ) == 0 ) && bOK;
+	if ( !bOK )
+	{
+		remove( szTempPath );
+		return false;
+	}
+
+	// the old file is still mapped, which is fine on POSIX; elsewhere it was read into memory
+#ifdef _WIN32
+	remove( m_szPath );
+#endif
+	if ( rename( szTempPath, m_szPath ) != 0 )
+	{
+		remove( szTempPath );
+		return false;
+	}
+	return true;
+}
+
+void CKeyValuesCache::PrintStats()
+{
+	AUTO_LOCK( m_Mutex );
+
+	Msg( "KeyValues cache: %s\n", m_bInitialized ? m_szPath : "(not opened yet)" );
+	Msg( "  %d entries on disk (%.2f MB), %d added\n", m_nFileEntries, m_nFileSize / ( 1024.0f * 1024.0f ), m_Added.Count() );
+	Msg( "  entries unused for %d days or past %d MB are dropped on save\n", KEYVALUES_CACHE_MAX_AGE / ( 24 * 60 * 60 ), KEYVALUES_CACHE_MAX_SIZE / ( 1024 * 1024 ) );
+	Msg( "  %d hits, %d misses, %d rejected\n", m_nHits, m_nMisses, m_nRejected );
+}
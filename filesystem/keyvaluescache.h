@@ -0,0 +1,85 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: On disk cache of compiled KeyValues files, keyed by a hash of the
+//			file contents
+//
+// $NoKeywords: $
+//=============================================================================//
+#ifndef KEYVALUESCACHE_H
+#define KEYVALUESCACHE_H
+#ifdef _WIN32
+#pragma once
+#endif
+
+#include "tier0/platform.h"
+#include "tier0/threadtools.h"
+#include "tier1/utlmap.h"
+#include "tier1/utlvector.h"
+
+class KeyValues;
+
+//-----------------------------------------------------------------------------
+// The cache file is mapped read-only when it's opened. Blobs added after that
+// are kept in memory and merged into a new file on Shutdown. Blobs returned by
+// Find stay valid until Shutdown. Entries that go unused for a month, or the
+// least recently used ones past the size cap, are dropped when saving.
+//-----------------------------------------------------------------------------
+class CKeyValuesCache
+{
+public:
+	CKeyValuesCache();
+	~CKeyValuesCache();
+
+	// Opens the cache file, a missing or stale file just starts out empty
+	void Init( const char *pFullPath );
+	bool IsInitialized() const { return m_bInitialized; }
+
+	// Writes out the cache file if anything was added or needs its last use
+	// updated, then frees everything
+	void Shutdown();
+
+	const void *Find( uint64 nHash, int *pSize );
+	const void *Add( uint64 nHash, KeyValues *pKeyValues, int *pSize );
+
+	void PrintStats();
+
+private:
+	struct FileEntry_t
+	{
+		uint64	m_nHash;
+		uint32	m_nOffset;
+		uint32	m_nSize;
+		uint32	m_nLastUsed;	// time() of the last session that found it, rounded to saves
+		uint32	m_nUnused;
+	};
+
+	struct AddedBlob_t
+	{
+		uint8	*m_pData;
+		int		m_nSize;
+	};
+
+	const FileEntry_t *FindFileEntry( uint64 nHash ) const;
+	bool Save();
+	void Unmap();
+
+	CThreadFastMutex m_Mutex;
+	bool m_bInitialized;
+	char m_szPath[MAX_PATH];
+
+	// the mapped cache file
+	const uint8 *m_pFile;
+	int64 m_nFileSize;
+	const FileEntry_t *m_pFileEntries;
+	int m_nFileEntries;
+	CUtlVector< bool > m_FileEntryUsed;		// found this session, parallel to m_pFileEntries
+
+	CUtlMap< uint64, AddedBlob_t, int > m_Added;
+	bool m_bDirty;
+
+	int m_nHits;
+	int m_nMisses;
+	int m_nRejected;
+};
+
+#endif // KEYVALUESCACHE_H
@@ -8,6 +8,9 @@
 #include "linux_support.h"
 #include "tier0/threadtools.h" // For ThreadInMainThread()
 #include "tier1/strtools.h"
+#include "tier1/utlstring.h"
+#include "tier1/utlhashtable.h"
+#include <time.h>
 
 char selectBuf[PATH_MAX];
 
@@ -199,6 +202,85 @@ bool FindClose(HANDLE handle)
 
 
 
+//-----------------------------------------------------------------------------
+// Case insensitive name -> best matching real name for one directory, so a
+// case-fixing lookup is a stat() of the directory and a hash lookup instead
+// of a full readdir(). Entries are revalidated against the directory's
+// identity and mtime/ctime, which change whenever a name is added, removed
+// or renamed in it.
+//-----------------------------------------------------------------------------
+class CCaseInsensitiveDirIndex
+{
+public:
+	CCaseInsensitiveDirIndex() : m_Names( 64 ) {}
+
+	bool IsCurrent( const struct stat &dirStat ) const
+	{
+		return m_bTrusted && m_nDev == dirStat.st_dev && m_nIno == dirStat.st_ino &&
+			m_nMTime == dirStat.st_mtime && m_nCTime == dirStat.st_ctime;
+	}
+
+	bool Scan( const char *pDirName, const struct stat &dirStat );
+
+	const char *Find( const char *pFileName ) const
+	{
+		const CUtlString *pName = m_Names.GetPtr( pFileName );
+		return pName ? pName->Get() : NULL;
+	}
+
+private:
+	dev_t	m_nDev;
+	ino_t	m_nIno;
+	time_t	m_nMTime;
+	time_t	m_nCTime;
+	bool	m_bTrusted;
+	CUtlHashtable< CUtlString, CUtlString, CaselessStringHashFunctor, CaselessStringEqualFunctor > m_Names;
+};
+
+bool CCaseInsensitiveDirIndex::Scan( const char *pDirName, const struct stat &dirStat )
+{
+	m_Names.RemoveAll();
+	m_bTrusted = false;
+
+	DIR* pDir = opendir( pDirName );
+	if ( !pDir )
+		return false;
+
+	for ( dirent* pEntry = NULL; ( pEntry = readdir( pDir ) ); /**/ )
+	{
+		// If we don't have an existing candidate or if this name is
+		// a better candidate then copy it in. A 'better' candidate
+		// means that test beats tesT which beats tEst -- more lowercase
+		// letters earlier equals victory.
+		bool bInserted;
+		UtlHashHandle_t h = m_Names.Insert( pEntry->d_name, pEntry->d_name, &bInserted );
+		if ( !bInserted && strcmp( m_Names[ h ], pEntry->d_name ) < 0 )
+		{
+			m_Names[ h ] = pEntry->d_name;
+		}
+	}
+
+	closedir( pDir );
+
+	m_nDev = dirStat.st_dev;
+	m_nIno = dirStat.st_ino;
+	m_nMTime = dirStat.st_mtime;
+	m_nCTime = dirStat.st_ctime;
+
+	// Timestamps only have a one second resolution on some filesystems, so a
+	// directory changed within the last couple of seconds could change again
+	// without its times moving. Don't reuse those scans.
+	time_t now = time( NULL );
+	m_bTrusted = ( now - MAX( m_nMTime, m_nCTime ) ) > 2;
+	return true;
+}
+
+// Directories are keyed by the exact path string they were looked up with
+#define MAX_CASE_INDEX_DIRS	4096
+
+static CThreadFastMutex s_DirIndexMutex;
+static CUtlHashtable< CUtlString, CCaseInsensitiveDirIndex * > s_DirIndex;
+
 // Pass this function a full path and it will look for files in the specified
 // directory that match the file name but potentially with different case.
 // The directory name itself is not treated specially.
@@ -225,8 +307,8 @@ bool findFileInDirCaseInsensitive( const char *file, char* output, size_t bufSiz
 
 	V_strncpy( dirName , file, dirSize );
 
-	DIR* pDir = opendir( dirName );
-	if ( !pDir )
+	struct stat dirStat;
+	if ( stat( dirName, &dirStat ) != 0 || !S_ISDIR( dirStat.st_mode ) )
 		return false;
 
 	const char* filePart = dirSep + 1;
@@ -234,24 +316,37 @@ bool findFileInDirCaseInsensitive( const char *file, char* output, size_t bufSiz
 	char outputFileName[ MAX_PATH ];
 	bool foundMatch = false;
 
-	// Scan through the directory.
-	for ( dirent* pEntry = NULL; ( pEntry = readdir( pDir ) ); /**/ )
 	{
-		if ( strcasecmp( pEntry->d_name, filePart ) == 0 )
+		AUTO_LOCK( s_DirIndexMutex );
+
+		CCaseInsensitiveDirIndex *pIndex = s_DirIndex.Get( dirName, NULL );
+		if ( !pIndex || !pIndex->IsCurrent( dirStat ) )
 		{
-			// If we don't have an existing candidate or if this name is
-			// a better candidate then copy it in. A 'better' candidate
-			// means that test beats tesT which beats tEst -- more lowercase
-			// letters earlier equals victory.
-			if ( !foundMatch || strcmp( outputFileName, pEntry->d_name ) < 0 )
+			if ( !pIndex )
 			{
-				foundMatch = true;
-				V_strcpy_safe( outputFileName, pEntry->d_name );
+				if ( s_DirIndex.Count() >= MAX_CASE_INDEX_DIRS )
+				{
+					FOR_EACH_HASHTABLE( s_DirIndex, h )
+					{
+						delete s_DirIndex[ h ];
+					}
+					s_DirIndex.RemoveAll();
+				}
+				pIndex = new CCaseInsensitiveDirIndex;
+				s_DirIndex.Insert( dirName, pIndex );
 			}
+
+			if ( !pIndex->Scan( dirName, dirStat ) )
+				return false;
 		}
-	}
 
-	closedir( pDir );
+		const char *pRealName = pIndex->Find( filePart );
+		if ( pRealName )
+		{
+			foundMatch = true;
+			V_strcpy_safe( outputFileName, pRealName );
+		}
+	}
 
 	// If we didn't find any matching names then lowercase the passed in
 	// file name and use that.
@@ -44,8 +44,8 @@ bool FindClose(HANDLE handle);
 // filename will be returned in the user's buffer and 'true' will be returned.
 // If the file does not exist then the filename will be lowercased and 'false'
 // will be returned.
-// This function uses a static buffer for internal purposes and is therefore
-// not thread safe, so it must only be called from the main thread.
+// Directory listings are cached per directory and revalidated against the
+// directory's mtime, so repeated lookups in one directory only cost a stat().
 bool findFileInDirCaseInsensitive( const char *file, OUT_Z_BYTECAP(bufSize) char* output, size_t bufSize );
 // The _safe version of this function should be preferred since it always infers
 // the directory size correctly.
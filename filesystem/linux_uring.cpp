@@ -0,0 +1,258 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Minimal io_uring wrapper used to keep many async reads in flight
+//
+// $NoKeywords: $
+//=============================================================================//
+
+#include "linux_uring.h"
+#include "tier0/dbg.h"
+
+#ifdef LINUX
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+#endif
+
+// memdbgon must be the last include file in a .cpp file!!!
+#include "tier0/memdbgon.h"
+
+CIOUring::CIOUring()
+{
+	m_RingFd = -1;
+	m_nEntries = 0;
+	m_nToSubmit = 0;
+	m_pSQRing = NULL;
+	m_pCQRing = NULL;
+	m_nSQRingSize = 0;
+	m_nCQRingSize = 0;
+	m_nSQEsSize = 0;
+	m_pSQEs = NULL;
+	m_pCQEs = NULL;
+	m_pIOVecs = NULL;
+	m_pSQHead = m_pSQTail = m_pSQMask = m_pSQArray = NULL;
+	m_pCQHead = m_pCQTail = m_pCQMask = NULL;
+}
+
+CIOUring::~CIOUring()
+{
+	Shutdown();
+}
+
+#ifdef LINUX
+
+bool CIOUring::Init( unsigned nEntries )
+{
+	Assert( m_RingFd == -1 );
+
+	io_uring_params params;
+	memset( &params, 0, sizeof( params ) );
+	m_RingFd = syscall( __NR_io_uring_setup, nEntries, &params );
+	if ( m_RingFd < 0 )
+	{
+		m_RingFd = -1;
+		return false;
+	}
+
+	m_nSQRingSize = params.sq_off.array + params.sq_entries * sizeof( unsigned );
+	m_nCQRingSize = params.cq_off.cqes + params.cq_entries * sizeof( io_uring_cqe );
+	if ( params.features & IORING_FEAT_SINGLE_MMAP )
+	{
+		m_nSQRingSize = m_nCQRingSize = MAX( m_nSQRingSize, m_nCQRingSize );
+	}
+
+	m_pSQRing = mmap( NULL, m_nSQRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_RingFd, IORING_OFF_SQ_RING );
+	if ( m_pSQRing == MAP_FAILED )
+	{
+		m_pSQRing = NULL;
+		Shutdown();
+		return false;
+	}
+
+	if ( params.features & IORING_FEAT_SINGLE_MMAP )
+	{
+		m_pCQRing = m_pSQRing;
+	}
+	else
+	{
+		m_pCQRing = mmap( NULL, m_nCQRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_RingFd, IORING_OFF_CQ_RING );
+		if ( m_pCQRing == MAP_FAILED )
+		{
+			m_pCQRing = NULL;
+			Shutdown();
+			return false;
+		}
+	}
+
+	m_nSQEsSize = params.sq_entries * sizeof( io_uring_sqe );
+	m_pSQEs = (io_uring_sqe *)mmap( NULL, m_nSQEsSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_RingFd, IORING_OFF_SQES );
+	if ( m_pSQEs == MAP_FAILED )
+	{
+		m_pSQEs = NULL;
+		Shutdown();
+		return false;
+	}
+
+	uint8 *pSQ = (uint8 *)m_pSQRing;
+	m_pSQHead = (unsigned *)( pSQ + params.sq_off.head );
+	m_pSQTail = (unsigned *)( pSQ + params.sq_off.tail );
+	m_pSQMask = (unsigned *)( pSQ + params.sq_off.ring_mask );
+	m_pSQArray = (unsigned *)( pSQ + params.sq_off.array );
+
+	uint8 *pCQ = (uint8 *)m_pCQRing;
+	m_pCQHead = (unsigned *)( pCQ + params.cq_off.head );
+	m_pCQTail = (unsigned *)( pCQ + params.cq_off.tail );
+	m_pCQMask = (unsigned *)( pCQ + params.cq_off.ring_mask );
+	m_pCQEs = (io_uring_cqe *)( pCQ + params.cq_off.cqes );
+
+	m_nEntries = MIN( params.sq_entries, params.cq_entries );
+	m_pIOVecs = (iovec *)calloc( params.sq_entries, sizeof( iovec ) );
+	return true;
+}
+
+void CIOUring::Shutdown()
+{
+	if ( m_pSQEs )
+	{
+		munmap( m_pSQEs, m_nSQEsSize );
+	}
+	if ( m_pCQRing && m_pCQRing != m_pSQRing )
+	{
+		munmap( m_pCQRing, m_nCQRingSize );
+	}
+	if ( m_pSQRing )
+	{
+		munmap( m_pSQRing, m_nSQRingSize );
+	}
+	if ( m_RingFd != -1 )
+	{
+		close( m_RingFd );
+	}
+	free( m_pIOVecs );
+
+	m_RingFd = -1;
+	m_nEntries = 0;
+	m_nToSubmit = 0;
+	m_pSQRing = m_pCQRing = NULL;
+	m_pSQEs = NULL;
+	m_pCQEs = NULL;
+	m_pIOVecs = NULL;
+}
+
+bool CIOUring::QueueRead( int fd, void *pDest, unsigned nBytes, int64 nOffset, uint64 nUserData )
+{
+	// we're the only producer, the kernel only moves the head
+	unsigned nTail = *m_pSQTail;
+	if ( nTail - __atomic_load_n( m_pSQHead, __ATOMIC_ACQUIRE ) > *m_pSQMask )
+		return false;
+
+	unsigned nIndex = nTail & *m_pSQMask;
+
+	// readv rather than read so this works on kernels before 5.6
+	m_pIOVecs[nIndex].iov_base = pDest;
+	m_pIOVecs[nIndex].iov_len = nBytes;
+
+	io_uring_sqe *pSQE = &m_pSQEs[nIndex];
+	memset( pSQE, 0, sizeof( *pSQE ) );
+	pSQE->opcode = IORING_OP_READV;
+	pSQE->fd = fd;
+	pSQE->off = nOffset;
+	pSQE->addr = (uint64)(uintp)&m_pIOVecs[nIndex];
+	pSQE->len = 1;
+	pSQE->user_data = nUserData;
+
+	m_pSQArray[nIndex] = nIndex;
+	__atomic_store_n( m_pSQTail, nTail + 1, __ATOMIC_RELEASE );
+	m_nToSubmit++;
+	return true;
+}
+
+bool CIOUring::Submit( unsigned nMinComplete )
+{
+	for ( ;; )
+	{
+		int nResult = syscall( __NR_io_uring_enter, m_RingFd, m_nToSubmit, nMinComplete, nMinComplete ? IORING_ENTER_GETEVENTS : 0, NULL, 0 );
+		if ( nResult >= 0 )
+		{
+			m_nToSubmit -= MIN( (unsigned)nResult, m_nToSubmit );
+			if ( !m_nToSubmit || nMinComplete )
+				return true;
+
+			continue;
+		}
+
+		if ( errno == EINTR )
+			continue;
+
+		// completion queue is backed up, the caller has to reap before we can submit more
+		if ( errno == EAGAIN || errno == EBUSY )
+			return true;
+
+		return false;
+	}
+}
+
+bool CIOUring::WaitForCompletion()
+{
+	for ( ;; )
+	{
+		if ( syscall( __NR_io_uring_enter, m_RingFd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0 ) >= 0 )
+			return true;
+
+		if ( errno != EINTR )
+			return false;
+	}
+}
+
+bool CIOUring::PopCompletion( uint64 *pUserData, int *pResult )
+{
+	// we're the only consumer, the kernel only moves the tail
+	unsigned nHead = *m_pCQHead;
+	if ( nHead == __atomic_load_n( m_pCQTail, __ATOMIC_ACQUIRE ) )
+		return false;
+
+	io_uring_cqe *pCQE = &m_pCQEs[nHead & *m_pCQMask];
+	*pUserData = pCQE->user_data;
+	*pResult = pCQE->res;
+
+	__atomic_store_n( m_pCQHead, nHead + 1, __ATOMIC_RELEASE );
+	return true;
+}
+
+#else
+
+bool CIOUring::Init( unsigned nEntries )
+{
+	return false;
+}
+
+void CIOUring::Shutdown()
+{
+}
+
+bool CIOUring::QueueRead( int fd, void *pDest, unsigned nBytes, int64 nOffset, uint64 nUserData )
+{
+	return false;
+}
+
+bool CIOUring::Submit( unsigned nMinComplete )
+{
+	return false;
+}
+
+bool CIOUring::WaitForCompletion()
+{
+	return false;
+}
+
+bool CIOUring::PopCompletion( uint64 *pUserData, int *pResult )
+{
+	return false;
+}
+
+#endif
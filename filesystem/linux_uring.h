@@ -0,0 +1,75 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Minimal io_uring wrapper used to keep many async reads in flight
+//
+// $NoKeywords: $
+//=============================================================================//
+#ifndef LINUX_URING_H
+#define LINUX_URING_H
+#ifdef _WIN32
+#pragma once
+#endif
+
+#include "tier0/platform.h"
+
+struct iovec;
+
+//-----------------------------------------------------------------------------
+// Talks to the kernel directly instead of through liburing. A ring must only
+// be used by one thread at a time.
+//-----------------------------------------------------------------------------
+class CIOUring
+{
+public:
+	CIOUring();
+	~CIOUring();
+
+	// Returns false if io_uring isn't available (old kernel, blocked by seccomp, ...)
+	bool Init( unsigned nEntries );
+	void Shutdown();
+
+	// How many reads may be in flight at once without overflowing the completion queue
+	unsigned GetEntries() const { return m_nEntries; }
+
+	// Adds a read to the submission queue, returns false if the queue is full
+	bool QueueRead( int fd, void *pDest, unsigned nBytes, int64 nOffset, uint64 nUserData );
+
+	// Hands queued reads to the kernel and waits until at least nMinComplete reads
+	// have completed. Returns false if the ring is unusable.
+	bool Submit( unsigned nMinComplete );
+
+	// Fetches a completed read. nResult is the number of bytes read or -errno.
+	bool PopCompletion( uint64 *pUserData, int *pResult );
+
+	// Reads queued but not handed to the kernel yet. The kernel never touches their
+	// buffers unless Submit is called again.
+	unsigned GetUnsubmitted() const { return m_nToSubmit; }
+
+	// Waits for at least one read the kernel has taken to complete, without
+	// submitting any more. Returns false if the ring is unusable.
+	bool WaitForCompletion();
+
+private:
+	int m_RingFd;
+	unsigned m_nEntries;
+	unsigned m_nToSubmit;
+
+	void *m_pSQRing;
+	void *m_pCQRing;
+	size_t m_nSQRingSize;
+	size_t m_nCQRingSize;
+	size_t m_nSQEsSize;
+	struct io_uring_sqe *m_pSQEs;
+	struct io_uring_cqe *m_pCQEs;
+	struct iovec *m_pIOVecs;							// one per submission slot
+
+	unsigned *m_pSQHead;
+	unsigned *m_pSQTail;
+	unsigned *m_pSQMask;
+	unsigned *m_pSQArray;
+	unsigned *m_pCQHead;
+	unsigned *m_pCQTail;
+	unsigned *m_pCQMask;
+};
+
+#endif // LINUX_URING_H
@@ -689,6 +689,7 @@ C_BaseAnimating::C_BaseAnimating() :
 
 	m_iMostRecentModelBoneCounter = 0xFFFFFFFF;
 	m_iMostRecentBoneSetupRequest = g_iPreviousBoneCounter - 1;
+	m_nThreadedBoneSetupLevel = 0;
 	m_flLastBoneSetupTime = -FLT_MAX;
 
 	m_vecPreRagdollMins = vec3_origin;
@@ -2647,16 +2648,35 @@ CMouthInfo *C_BaseAnimating::GetMouth( void )
 #ifdef DEBUG_BONE_SETUP_THREADING
 ConVar cl_warn_thread_contested_bone_setup("cl_warn_thread_contested_bone_setup", "0" );
 #endif
-ConVar cl_threaded_bone_setup("cl_threaded_bone_setup", "0", 0, "Enable parallel processing of C_BaseAnimating::SetupBones()" );
+ConVar cl_threaded_bone_setup("cl_threaded_bone_setup", "1", 0, "Enable parallel processing of C_BaseAnimating::SetupBones()" );
 
 //-----------------------------------------------------------------------------
 // Purpose: Do the default sequence blending rules as done in HL1
 //-----------------------------------------------------------------------------
 
+// The entity each ThreadedBoneSetup worker is setting up
+static CTHREADLOCALPTR( C_BaseAnimating ) s_pThreadedBoneSetupEntity;
+
 static void SetupBonesOnBaseAnimating( C_BaseAnimating *&pBaseAnimating )
 {
-	if ( !pBaseAnimating->GetMoveParent() )
-		pBaseAnimating->SetupBones( NULL, -1, -1, gpGlobals->curtime );
+	s_pThreadedBoneSetupEntity = pBaseAnimating;
+	pBaseAnimating->SetupBones( NULL, -1, -1, gpGlobals->curtime );
+	s_pThreadedBoneSetupEntity = NULL;
+}
+
+//-----------------------------------------------------------------------------
+// The nearest animating entity up the move parent chain. Bone merged and
+// attached entities read its bones while setting up their own.
+//-----------------------------------------------------------------------------
+static C_BaseAnimating *GetBoneSetupParent( C_BaseAnimating *pBaseAnimating )
+{
+	for ( C_BaseEntity *pParent = pBaseAnimating->GetMoveParent(); pParent; pParent = pParent->GetMoveParent() )
+	{
+		C_BaseAnimating *pAnimatingParent = pParent->GetBaseAnimating();
+		if ( pAnimatingParent )
+			return pAnimatingParent;
+	}
+	return NULL;
 }
 
 static void PreThreadedBoneSetup()
@@ -2688,9 +2708,75 @@ void C_BaseAnimating::ThreadedBoneSetup()
 		int nCount = g_PreviousBoneSetups.Count();
 		if ( nCount > 1 )
 		{
+			VPROF_BUDGET( "C_BaseAnimating::ThreadedBoneSetup", VPROF_BUDGETGROUP_CLIENT_ANIMATION );
+
+			// Parents get set up before anything that reads their bones, so pull in
+			// any that weren't asked for last frame. The list grows as we go.
+			for ( int i = 0; i < g_PreviousBoneSetups.Count(); i++ )
+			{
+				C_BaseAnimating *pParent = GetBoneSetupParent( g_PreviousBoneSetups[i] );
+				if ( pParent && pParent->m_iMostRecentBoneSetupRequest != g_iPreviousBoneCounter )
+				{
+					pParent->m_iMostRecentBoneSetupRequest = g_iPreviousBoneCounter;
+					g_PreviousBoneSetups.AddToTail( pParent );
+				}
+			}
+			nCount = g_PreviousBoneSetups.Count();
+
+			// SetupBones reads the move parents' abs transforms, and siblings would
+			// race to compute a dirty one (CalcAbsolutePosition clears the dirty flag
+			// before it writes the matrix). Levels only order animating parents, so
+			// compute every move parent chain here before any worker starts.
+			for ( int i = 0; i < nCount; i++ )
+			{
+				C_BaseEntity *pMoveParent = g_PreviousBoneSetups[i]->GetMoveParent();
+				if ( pMoveParent )
+				{
+					pMoveParent->GetAbsOrigin();
+				}
+			}
+
+			// Each level only depends on the ones before it
+			int nLevels = 0;
+			for ( int i = 0; i < nCount; i++ )
+			{
+				C_BaseAnimating *pBaseAnimating = g_PreviousBoneSetups[i];
+				int nLevel = 0;
+				for ( C_BaseAnimating *pParent = GetBoneSetupParent( pBaseAnimating ); pParent; pParent = GetBoneSetupParent( pParent ) )
+				{
+					nLevel++;
+				}
+				pBaseAnimating->m_nThreadedBoneSetupLevel = nLevel;
+				nLevels = MAX( nLevels, nLevel + 1 );
+			}
+
+			CUtlVectorFixedGrowable< int, 8 > levelStart;
+			levelStart.SetCount( nLevels + 1 );
+			memset( levelStart.Base(), 0, levelStart.Count() * sizeof( int ) );
+			for ( int i = 0; i < nCount; i++ )
+			{
+				levelStart[ g_PreviousBoneSetups[i]->m_nThreadedBoneSetupLevel + 1 ]++;
+			}
+			for ( int i = 1; i <= nLevels; i++ )
+			{
+				levelStart[i] += levelStart[i - 1];
+			}
+
+			CUtlVector< C_BaseAnimating * > sorted;
+			sorted.SetCount( nCount );
+			CUtlVectorFixedGrowable< int, 8 > levelFill;
+			levelFill.CopyArray( levelStart.Base(), nLevels );
+			for ( int i = 0; i < nCount; i++ )
+			{
+				sorted[ levelFill[ g_PreviousBoneSetups[i]->m_nThreadedBoneSetupLevel ]++ ] = g_PreviousBoneSetups[i];
+			}
+
 			g_bInThreadedBoneSetup = true;
 
-			ParallelProcess( "C_BaseAnimating::ThreadedBoneSetup", g_PreviousBoneSetups.Base(), nCount, &SetupBonesOnBaseAnimating, &PreThreadedBoneSetup, &PostThreadedBoneSetup );
+			for ( int nLevel = 0; nLevel < nLevels; nLevel++ )
+			{
+				ParallelProcess( "C_BaseAnimating::ThreadedBoneSetup", sorted.Base() + levelStart[nLevel], levelStart[nLevel + 1] - levelStart[nLevel], &SetupBonesOnBaseAnimating, &PreThreadedBoneSetup, &PostThreadedBoneSetup );
+			}
 
 			g_bInThreadedBoneSetup = false;
 		}
@@ -2752,7 +2838,26 @@ bool C_BaseAnimating::SetupBones( matrix3x4_t *pBoneToWorldOut, int nMaxBones, i
 	{
 		if ( !m_BoneSetupLock.TryLock() )
 		{
-			return false;
+			// Only wait on the parents of the entity this thread is setting up.
+			// Those locks are always taken child first, so whoever holds one is
+			// never waiting on us. Anything else could be, so give up instead.
+			bool bIsOwnParent = false;
+			C_BaseAnimating *pSetupEntity = s_pThreadedBoneSetupEntity;
+			for ( C_BaseAnimating *pParent = pSetupEntity ? GetBoneSetupParent( pSetupEntity ) : NULL; pParent; pParent = GetBoneSetupParent( pParent ) )
+			{
+				if ( pParent == this )
+				{
+					bIsOwnParent = true;
+					break;
+				}
+			}
+
+			if ( !bIsOwnParent )
+			{
+				return false;
+			}
+
+			m_BoneSetupLock.Lock();
 		}
 	}
 
@@ -2800,7 +2905,7 @@ bool C_BaseAnimating::SetupBones( matrix3x4_t *pBoneToWorldOut, int nMaxBones, i
 	}
 
 	int nBoneCount = m_CachedBoneData.Count();
-	if ( g_bDoThreadedBoneSetup && !g_bInThreadedBoneSetup && ( nBoneCount >= 16 ) && !GetMoveParent() && m_iMostRecentBoneSetupRequest != g_iPreviousBoneCounter )
+	if ( g_bDoThreadedBoneSetup && !g_bInThreadedBoneSetup && ( nBoneCount >= 16 ) && m_iMostRecentBoneSetupRequest != g_iPreviousBoneCounter )
 	{
 		m_iMostRecentBoneSetupRequest = g_iPreviousBoneCounter;
 		Assert( g_PreviousBoneSetups.Find( this ) == -1 );
@@ -510,6 +510,7 @@ protected:
 	// bone transformation matrix
 	unsigned long					m_iMostRecentModelBoneCounter;
 	unsigned long					m_iMostRecentBoneSetupRequest;
+	int								m_nThreadedBoneSetupLevel;	// Number of animating move parents, for ThreadedBoneSetup
 	int								m_iPrevBoneMask;
 	int								m_iAccumulatedBoneMask;
 
@@ -2633,6 +2633,53 @@ void CServerGameEnts::CheckTransmit( CCheckTransmitInfo *pInfo, const unsigned s
 }
 
 
+//-----------------------------------------------------------------------------
+// CheckTransmit above only writes to the CCheckTransmitInfo it is handed, the
+// one piece of shared state it modifies is the lazily recomputed PVS info of
+// the networked entities. Bring that up to date once so the engine can call
+// CheckTransmit for all clients in parallel.
+//
+// Entity ShouldTransmit/SetTransmit overrides can touch shared state too, so
+// this stays off until a mod has checked its own and turns it on.
+//-----------------------------------------------------------------------------
+ConVar sv_checktransmit_threadsafe( "sv_checktransmit_threadsafe", "0", 0, "Set if this mod's ShouldTransmit/SetTransmit overrides are safe to call for several clients at once, allows sv_parallel_checktransmit" );
+
+class CServerGameEntsEx : public IServerGameEntsEx
+{
+public:
+	virtual bool			IsCheckTransmitThreadSafe();
+	virtual void			PrepareCheckTransmit( const unsigned short *pEdictIndices, int nEdicts );
+};
+EXPOSE_SINGLE_INTERFACE(CServerGameEntsEx, IServerGameEntsEx, INTERFACEVERSION_SERVERGAMEENTSEX);
+
+bool CServerGameEntsEx::IsCheckTransmitThreadSafe()
+{
+	return sv_checktransmit_threadsafe.GetBool();
+}
+
+void CServerGameEntsEx::PrepareCheckTransmit( const unsigned short *pEdictIndices, int nEdicts )
+{
+	edict_t *pBaseEdict = engine->PEntityOfEntIndex( 0 );
+
+	for ( int i=0; i < nEdicts; i++ )
+	{
+		edict_t *pEdict = &pBaseEdict[ pEdictIndices[i] ];
+		
+		// entities that are never PVS checked don't need their PVS info
+		if ( pEdict->m_fStateFlags & (FL_EDICT_DONTSEND|FL_EDICT_ALWAYS) )
+			continue;
+
+		// CheckTransmit also walks up the hierarchy checking the move parents
+		CServerNetworkProperty *netProp = static_cast<CServerNetworkProperty*>( pEdict->GetNetworkable() );
+		while ( netProp )
+		{
+			netProp->RecomputePVSInformation();
+			netProp = netProp->GetNetworkParent();
+		}
+	}
+}
+
+
 CServerGameClients g_ServerGameClients;
 // INTERFACEVERSION_SERVERGAMECLIENTS_VERSION_3 is compatible with the latest since we're only adding things to the end, so expose that as well.
 EXPOSE_SINGLE_INTERFACE_GLOBALVAR(CServerGameClients, IServerGameClients003, INTERFACEVERSION_SERVERGAMECLIENTS_VERSION_3, g_ServerGameClients );
@@ -10,8 +10,8 @@
 #include "igamesystem.h"
 #include "ilagcompensationmanager.h"
 #include "inetchannelinfo.h"
-#include "utllinkedlist.h"
 #include "BaseAnimatingOverlay.h"
+#include "collisionutils.h"
 #include "tier0/vprof.h"
 
 // memdbgon must be the last include file in a .cpp file!!!
@@ -36,6 +36,10 @@ ConVar sv_lagflushbonecache( "sv_lagflushbonecache", "1", FCVAR_DEVELOPMENTONLY,
 ConVar sv_showlagcompensation( "sv_showlagcompensation", "0", FCVAR_CHEAT, "Show lag compensated hitboxes whenever a player is lag compensated." );
 
 ConVar sv_unlag_fixstuck( "sv_unlag_fixstuck", "0", FCVAR_DEVELOPMENTONLY, "Disallow backtracking a player for lag compensation if it will cause them to become stuck" );
+ConVar sv_unlag_prefilter( "sv_unlag_prefilter", "0", FCVAR_DEVELOPMENTONLY, "If set, only lag compensate players whose backtracked bounds are within this many units along the shooter's aim" );
+
+// Added to the bounds used by sv_unlag_prefilter, the hitboxes move with the animation
+#define LAG_COMPENSATION_PREFILTER_BLOAT	8.0f
 
 //-----------------------------------------------------------------------------
 // Purpose: 
@@ -115,6 +119,123 @@ public:
 };
 
 
+//-----------------------------------------------------------------------------
+// The history of one player, a ring buffer with the newest record at index 0.
+// Simulation times only go down from there, so records are found with a
+// binary search. Where the player died or teleported between two records is
+// worked out when a record is added instead of on every backtrack.
+//-----------------------------------------------------------------------------
+class CLagRecordTrack
+{
+public:
+	CLagRecordTrack() : m_nHead( 0 ), m_nCount( 0 ), m_nHeadSequence( 0 ), m_nNewestBreak( -1 )
+	{
+	}
+
+	int Count() const
+	{
+		return m_nCount;
+	}
+
+	LagRecord &operator[]( int i )
+	{
+		Assert( i >= 0 && i < m_nCount );
+		return m_Records[ ( m_nHead + i ) & ( m_Records.Count() - 1 ) ];
+	}
+
+	LagRecord &Head()
+	{
+		return (*this)[0];
+	}
+
+	LagRecord &Tail()
+	{
+		return (*this)[ m_nCount - 1 ];
+	}
+
+	// Overwrites the oldest record when full
+	LagRecord &AddToHead()
+	{
+		if ( !m_Records.Count() )
+		{
+			// Enough for sv_maxunlag at its maximum, one record per tick
+			m_Records.SetCount( SmallestPowerOfTwoGreaterOrEqual( TIME_TO_TICKS( 1.0f ) + 2 ) );
+		}
+
+		m_nHead = ( m_nHead - 1 ) & ( m_Records.Count() - 1 );
+		m_nCount = MIN( m_nCount + 1, m_Records.Count() );
+		++m_nHeadSequence;
+		return Head();
+	}
+
+	// Call once the new head is filled in, checks it against the record before it
+	void LinkHead( float flTeleportDistanceSqr )
+	{
+		if ( m_nCount < 2 )
+			return;
+
+		const LagRecord &prev = (*this)[1];
+		Vector delta = prev.m_vecOrigin - Head().m_vecOrigin;
+		if ( !( prev.m_fFlags & LC_ALIVE ) || delta.Length2DSqr() > flTeleportDistanceSqr )
+		{
+			m_nNewestBreak = m_nHeadSequence - 1;
+		}
+	}
+
+	void RemoveTail()
+	{
+		Assert( m_nCount > 0 );
+		--m_nCount;
+	}
+
+	void RemoveAll()
+	{
+		m_nCount = 0;
+	}
+
+	void Purge()
+	{
+		m_Records.Purge();
+		m_nHead = 0;
+		m_nCount = 0;
+	}
+
+	// The newest record at or before the time, or the oldest one
+	int Find( float flTime )
+	{
+		int nLow = 0;
+		int nHigh = m_nCount - 1;
+		while ( nLow < nHigh )
+		{
+			int nMid = ( nLow + nHigh ) / 2;
+			if ( (*this)[nMid].m_flSimulationTime <= flTime )
+			{
+				nHigh = nMid;
+			}
+			else
+			{
+				nLow = nMid + 1;
+			}
+		}
+		return nLow;
+	}
+
+	// Whether the player was alive and didn't teleport from record 1 through i,
+	// the head is checked against the player by the caller
+	bool IsContinuous( int i ) const
+	{
+		return m_nNewestBreak < m_nHeadSequence - i;
+	}
+
+private:
+	CUtlVector< LagRecord >	m_Records;
+	int						m_nHead;
+	int						m_nCount;
+	int						m_nHeadSequence;	// Counts the records added
+	int						m_nNewestBreak;		// Sequence of the newest record that is dead or teleported from
+};
+
+
 //
 // Try to take the player from his current origin to vWantedPos.
 // If it can't get there, leave the player where he is.
@@ -195,7 +316,7 @@ public:
 	void			FinishLagCompensation( CBasePlayer *player );
 
 private:
-	void			BacktrackPlayer( CBasePlayer *player, float flTargetTime );
+	void			BacktrackPlayer( CBasePlayer *player, float flTargetTime, const Vector *pShotStart = NULL, const Vector *pShotDelta = NULL );
 
 	void ClearHistory()
 	{
@@ -203,8 +324,8 @@ private:
 			m_PlayerTrack[i].Purge();
 	}
 
-	// keep a list of lag records for each player
-	CUtlFixedLinkedList< LagRecord >	m_PlayerTrack[ MAX_PLAYERS ];
+	// keep a history of lag records for each player
+	CLagRecordTrack			m_PlayerTrack[ MAX_PLAYERS ];
 
 	// Scratchpad for determining what needs to be restored
 	CBitVec<MAX_PLAYERS>	m_RestorePlayer;
@@ -238,46 +359,31 @@ void CLagCompensationManager::FrameUpdatePostEntityThink()
 	VPROF_BUDGET( "FrameUpdatePostEntityThink", "CLagCompensationManager" );
 
 	// remove all records before that time:
-	int flDeadtime = gpGlobals->curtime - sv_maxunlag.GetFloat();
+	float flDeadtime = gpGlobals->curtime - sv_maxunlag.GetFloat();
 
 	// Iterate all active players
 	for ( int i = 1; i <= gpGlobals->maxClients; i++ )
 	{
 		CBasePlayer *pPlayer = UTIL_PlayerByIndex( i );
 
-		CUtlFixedLinkedList< LagRecord > *track = &m_PlayerTrack[i-1];
+		CLagRecordTrack *track = &m_PlayerTrack[i-1];
 
 		if ( !pPlayer )
 		{
-			if ( track->Count() > 0 )
-			{
-				track->RemoveAll();
-			}
-
+			track->RemoveAll();
 			continue;
 		}
 
-		Assert( track->Count() < 1000 ); // insanity check
-
 		// remove tail records that are too old
-		intp tailIndex = track->Tail();
-		while ( track->IsValidIndex( tailIndex ) )
+		while ( track->Count() > 0 && track->Tail().m_flSimulationTime < flDeadtime )
 		{
-			LagRecord &tail = track->Element( tailIndex );
-
-			// if tail is within limits, stop
-			if ( tail.m_flSimulationTime >= flDeadtime )
-				break;
-			
-			// remove tail, get new tail
-			track->Remove( tailIndex );
-			tailIndex = track->Tail();
+			track->RemoveTail();
 		}
 
 		// check if head has same simulation time
 		if ( track->Count() > 0 )
 		{
-			LagRecord &head = track->Element( track->Head() );
+			LagRecord &head = track->Head();
 
 			// check if player changed simulation time since last time updated
 			if ( head.m_flSimulationTime >= pPlayer->GetSimulationTime() )
@@ -285,7 +391,7 @@ void CLagCompensationManager::FrameUpdatePostEntityThink()
 		}
 
 		// add new record to player track
-		LagRecord &record = track->Element( track->AddToHead() );
+		LagRecord &record = track->AddToHead();
 
 		record.m_fFlags = 0;
 		if ( pPlayer->IsAlive() )
@@ -313,6 +419,8 @@ void CLagCompensationManager::FrameUpdatePostEntityThink()
 		}
 		record.m_masterSequence = pPlayer->GetSequence();
 		record.m_masterCycle = pPlayer->GetCycle();
+
+		track->LinkHead( m_flTeleportDistanceSqr );
 	}
 
 	//Clear the current player.
@@ -385,6 +493,16 @@ void CLagCompensationManager::StartLagCompensation( CBasePlayer *player, CUserCm
 		targettick = gpGlobals->tickcount - TIME_TO_TICKS( correct );
 	}
 	
+	// The shot, for sv_unlag_prefilter
+	Vector vecShotStart, vecShotDelta;
+	float flPrefilterRange = sv_unlag_prefilter.GetFloat();
+	if ( flPrefilterRange > 0.0f )
+	{
+		vecShotStart = player->EyePosition();
+		AngleVectors( cmd->viewangles, &vecShotDelta );
+		vecShotDelta *= flPrefilterRange;
+	}
+
 	// Iterate all active players
 	const CBitVec<MAX_EDICTS> *pEntityTransmitBits = engine->GetEntityTransmitBitsForClient( player->entindex() - 1 );
 	for ( int i = 1; i <= gpGlobals->maxClients; i++ )
@@ -407,11 +525,18 @@ void CLagCompensationManager::StartLagCompensation( CBasePlayer *player, CUserCm
 			continue;
 
 		// Move other player back in time
-		BacktrackPlayer( pPlayer, TICKS_TO_TIME( targettick ) );
+		if ( flPrefilterRange > 0.0f )
+		{
+			BacktrackPlayer( pPlayer, TICKS_TO_TIME( targettick ), &vecShotStart, &vecShotDelta );
+		}
+		else
+		{
+			BacktrackPlayer( pPlayer, TICKS_TO_TIME( targettick ) );
+		}
 	}
 }
 
-void CLagCompensationManager::BacktrackPlayer( CBasePlayer *pPlayer, float flTargetTime )
+void CLagCompensationManager::BacktrackPlayer( CBasePlayer *pPlayer, float flTargetTime, const Vector *pShotStart, const Vector *pShotDelta )
 {
 	Vector org;
 	Vector minsPreScaled;
@@ -422,61 +547,60 @@ void CLagCompensationManager::BacktrackPlayer( CBasePlayer *pPlayer, float flTar
 	int pl_index = pPlayer->entindex() - 1;
 
 	// get track history of this player
-	CUtlFixedLinkedList< LagRecord > *track = &m_PlayerTrack[ pl_index ];
+	CLagRecordTrack *track = &m_PlayerTrack[ pl_index ];
 
 	// check if we have at leat one entry
 	if ( track->Count() <= 0 )
 		return;
 
-    intp curr = track->Head();
-
-	LagRecord *prevRecord = NULL;
-	LagRecord *record = NULL;
+	// find the newest context at or before the target time
+	int nRecord = track->Find( flTargetTime );
+	LagRecord *record = &(*track)[ nRecord ];
+	LagRecord *prevRecord = ( nRecord > 0 ) ? &(*track)[ nRecord - 1 ] : NULL;
 
-	Vector prevOrg = pPlayer->GetLocalOrigin();
-	
-	// Walk context looking for any invalidating event
-	while( track->IsValidIndex(curr) )
+	// Look for any invalidating event between now and then
+	LagRecord &head = track->Head();
+	if ( !(head.m_fFlags & LC_ALIVE) || !track->IsContinuous( nRecord ) )
 	{
-		// remember last record
-		prevRecord = record;
-
-		// get next record
-		record = &track->Element( curr );
-
-		if ( !(record->m_fFlags & LC_ALIVE) )
-		{
-			// player most be alive, lost track
-			return;
-		}
-
-		Vector delta = record->m_vecOrigin - prevOrg;
-		if ( delta.Length2DSqr() > m_flTeleportDistanceSqr )
-		{
-			// lost track, too much difference
-			return; 
-		}
-
-		// did we find a context smaller than target time ?
-		if ( record->m_flSimulationTime <= flTargetTime )
-			break; // hurra, stop
-
-		prevOrg = record->m_vecOrigin;
-
-		// go one step back
-		curr = track->Next( curr );
+		// player most be alive, lost track
+		return;
 	}
 
-	Assert( record );
+	Vector delta = head.m_vecOrigin - pPlayer->GetLocalOrigin();
+	if ( delta.Length2DSqr() > m_flTeleportDistanceSqr )
+	{
+		// lost track, too much difference
+		return; 
+	}
 
-	if ( !record )
+	if ( pShotStart )
 	{
-		if ( sv_unlag_debug.GetBool() )
+		// Leave the player alone if the shot doesn't come near where they were. The
+		// current surrounding bounds stand in for the hitboxes, made square around
+		// the origin since the player may have turned since.
+		Vector vecSurroundMins, vecSurroundMaxs;
+		pPlayer->CollisionProp()->WorldSpaceSurroundingBounds( &vecSurroundMins, &vecSurroundMaxs );
+		vecSurroundMins -= pPlayer->GetAbsOrigin();
+		vecSurroundMaxs -= pPlayer->GetAbsOrigin();
+
+		float flRadius = MAX( MAX( -vecSurroundMins.x, vecSurroundMaxs.x ), MAX( -vecSurroundMins.y, vecSurroundMaxs.y ) );
+		Vector vecMins( -flRadius, -flRadius, vecSurroundMins.z );
+		Vector vecMaxs( flRadius, flRadius, vecSurroundMaxs.z );
+		VectorMin( vecMins, record->m_vecMinsPreScaled, vecMins );
+		VectorMax( vecMaxs, record->m_vecMaxsPreScaled, vecMaxs );
+		vecMins -= Vector( LAG_COMPENSATION_PREFILTER_BLOAT, LAG_COMPENSATION_PREFILTER_BLOAT, LAG_COMPENSATION_PREFILTER_BLOAT );
+		vecMaxs += Vector( LAG_COMPENSATION_PREFILTER_BLOAT, LAG_COMPENSATION_PREFILTER_BLOAT, LAG_COMPENSATION_PREFILTER_BLOAT );
+
+		Vector vecBoxMins = record->m_vecOrigin + vecMins;
+		Vector vecBoxMaxs = record->m_vecOrigin + vecMaxs;
+		if ( prevRecord )
 		{
-			DevMsg( "No valid positions in history for BacktrackPlayer client ( %s )\n", pPlayer->GetPlayerName() );
+			VectorMin( vecBoxMins, prevRecord->m_vecOrigin + vecMins, vecBoxMins );
+			VectorMax( vecBoxMaxs, prevRecord->m_vecOrigin + vecMaxs, vecBoxMaxs );
 		}
 
-		return; // that should never happen
+		if ( !IsBoxIntersectingRay( vecBoxMins, vecBoxMaxs, *pShotStart, *pShotDelta ) )
+			return;
 	}
 
 	float frac = 0.0f;
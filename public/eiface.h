@@ -672,6 +672,24 @@ public:
 	virtual void			CheckTransmit( CCheckTransmitInfo *pInfo, const unsigned short *pEdictIndices, int nEdicts ) = 0;
 };
 
+#define INTERFACEVERSION_SERVERGAMEENTSEX		"ServerGameEntsEx001"
+//-----------------------------------------------------------------------------
+// Purpose: Optional extension of IServerGameEnts. A game dll that exposes it
+//  lets the engine run CheckTransmit for several clients at once.
+//-----------------------------------------------------------------------------
+abstract_class IServerGameEntsEx
+{
+public:
+	// Return true if IServerGameEnts::CheckTransmit may be called concurrently for
+	// different clients. Each call must only write to the CCheckTransmitInfo it was passed.
+	virtual bool			IsCheckTransmitThreadSafe() = 0;
+
+	// Called once on the main thread before the concurrent CheckTransmit calls of a frame.
+	// Update any lazily computed entity state (PVS clusters, areas) here so the
+	// CheckTransmit calls only have to read it.
+	virtual void			PrepareCheckTransmit( const unsigned short *pEdictIndices, int nEdicts ) = 0;
+};
+
 #define INTERFACEVERSION_SERVERGAMECLIENTS_VERSION_3	"ServerGameClients003"
 #define INTERFACEVERSION_SERVERGAMECLIENTS				"ServerGameClients004"
 
@@ -123,8 +123,10 @@ public:
 //-----------------------------------------------------------------------------
 // Interface the engine exposes to the game DLL
 //-----------------------------------------------------------------------------
-#define INTERFACEVERSION_ENGINETRACE_SERVER	"EngineTraceServer003"
-#define INTERFACEVERSION_ENGINETRACE_CLIENT	"EngineTraceClient003"
+#define INTERFACEVERSION_ENGINETRACE_SERVER_VERSION_3	"EngineTraceServer003"
+#define INTERFACEVERSION_ENGINETRACE_CLIENT_VERSION_3	"EngineTraceClient003"
+#define INTERFACEVERSION_ENGINETRACE_SERVER	"EngineTraceServer004"
+#define INTERFACEVERSION_ENGINETRACE_CLIENT	"EngineTraceClient004"
 abstract_class IEngineTrace
 {
 public:
@@ -185,6 +187,22 @@ public:
 
 	// Walks bsp to find the leaf containing the specified point
 	virtual int GetLeafContainingPoint( const Vector &ptTest ) = 0;
+
+	// Traces a batch of rays, pTraces gets one result per ray. Rays close to each
+	// other are traced together, so keep rays from the same origin and heading next
+	// to each other in the array. The world results match TraceRay. The entities may
+	// be clipped against in a different order, so when two entities are hit at exactly
+	// the same fraction the one reported can differ from TraceRay's. The filter is
+	// asked about each entity once for the whole batch, so it can't depend on the ray.
+	virtual void	TraceRays( int nRays, const Ray_t *pRays, unsigned int fMask, ITraceFilter *pTraceFilter, trace_t *pTraces ) = 0;
+
+	// Between these calls any thread may trace through this interface at the same
+	// time, as long as no entity on this side (server or client) is moved, added
+	// or removed. The other side's traces keep locking and aren't affected. The
+	// game must flush its lazy partition updates before beginning, they aren't
+	// applied during concurrent traces.
+	virtual void	BeginConcurrentTraces() = 0;
+	virtual void	EndConcurrentTraces() = 0;
 };
 
 
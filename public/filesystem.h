@@ -36,6 +36,7 @@ class KeyValues;
 class IFileList;
 class IThreadPool;
 class CMemoryFileBacking;
+class CKeyValuesView;
 
 typedef void * FileHandle_t;
 typedef void * FileCacheHandle_t;
@@ -285,7 +286,9 @@ struct FileSystemStatistics
 						nWrites,		
 						nBytesRead,
 						nBytesWritten,
-						nSeeks;
+						nSeeks,
+						nSearchPathProbes,			// search paths tried when opening relative filenames for read
+						nSearchPathProbesAvoided;	// ... and skipped because the file was known to be missing there
 };
 
 //-----------------------------------------------------------------------------
@@ -928,6 +931,15 @@ public:
 	{
 		return GetCaseCorrectFullPath_Ptr( pFullPath, pDest, (int)maxLenInChars );
 	}
+
+	// Compiled KeyValues cache, keyed by HashKeyValuesText() of the file contents. The returned
+	// blobs are read with CKeyValuesView and stay valid until the filesystem shuts down.
+	virtual const void		*FindCompiledKeyValues( uint64 nHash, int *pSize ) = 0;
+	virtual const void		*AddCompiledKeyValues( uint64 nHash, KeyValues *pKeyValues, int *pSize ) = 0;
+
+	// Loads a KeyValues file through the cache and points view at it, without building a KeyValues tree
+	// if the file has been seen before. Files that #include or #base others can't be viewed.
+	virtual bool			LoadKeyValuesView( CKeyValuesView &view, const char *filename, const char *pPathID = 0 ) = 0;
 };
 
 //-----------------------------------------------------------------------------
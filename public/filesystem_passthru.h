@@ -124,6 +124,9 @@ public:
 	virtual const char		*GetLocalPath( const char *pFileName, OUT_Z_CAP(maxLenInChars) char *pDest, int maxLenInChars )	{ return m_pFileSystemPassThru->GetLocalPath( pFileName, pDest, maxLenInChars ); }
 	virtual bool			FullPathToRelativePath( const char *pFullpath, OUT_Z_CAP(maxLenInChars) char *pDest, int maxLenInChars )		{ return m_pFileSystemPassThru->FullPathToRelativePath( pFullpath, pDest, maxLenInChars ); }
 	virtual bool			GetCaseCorrectFullPath_Ptr( const char *pFullPath, OUT_Z_CAP(maxLenInChars) char *pDest, int maxLenInChars ) { return m_pFileSystemPassThru->GetCaseCorrectFullPath_Ptr( pFullPath, pDest, maxLenInChars ); }
+	virtual const void		*FindCompiledKeyValues( uint64 nHash, int *pSize )									{ return m_pFileSystemPassThru->FindCompiledKeyValues( nHash, pSize ); }
+	virtual const void		*AddCompiledKeyValues( uint64 nHash, KeyValues *pKeyValues, int *pSize )			{ return m_pFileSystemPassThru->AddCompiledKeyValues( nHash, pKeyValues, pSize ); }
+	virtual bool			LoadKeyValuesView( CKeyValuesView &view, const char *filename, const char *pPathID = 0 ) { return m_pFileSystemPassThru->LoadKeyValuesView( view, filename, pPathID ); }
 	virtual bool			GetCurrentDirectory( char* pDirectory, int maxlen )									{ return m_pFileSystemPassThru->GetCurrentDirectory( pDirectory, maxlen ); }
 	virtual void			PrintOpenedFiles( void )															{ m_pFileSystemPassThru->PrintOpenedFiles(); }
 	virtual void			PrintSearchPaths( void )															{ m_pFileSystemPassThru->PrintSearchPaths(); }
@@ -39,6 +39,8 @@ class CUtlBuffer;
 class Color;
 typedef void * FileHandle_t;
 class CKeyValuesGrowableStringTable;
+class CKeyValuesArena;
+class CKeyValuesChildIndex;
 
 //-----------------------------------------------------------------------------
 // Purpose: Simple recursive data access class
@@ -80,6 +82,16 @@ public:
 
 	KeyValues( const char *setName );
 
+	// Creates the root of a tree whose keys are all carved out of one arena, which
+	// deleteThis() on the root frees in one go. Keys created through the tree (FindKey,
+	// LoadFromBuffer, ReadAsBinary, CopySubkeys...) come from the same arena. Keys of an
+	// arena tree live until the root is deleted and deleteThis() on any other one of them
+	// frees nothing, so don't move them into trees that outlive the root. Values that get
+	// replaced stay in the arena as well, so this suits trees that are loaded and then read.
+	// nBlockSize is the arena block size in bytes, 0 picks the default.
+	static KeyValues *CreateArenaTree( const char *setName, int nBlockSize = 0 );
+	bool IsArenaAllocated() const { return m_bArenaAllocated != 0; }
+
 	//
 	// AutoDelete class to automatically free the keyvalues.
 	// Simply construct it with the keyvalues you allocated and it will free them when falls out of scope.
@@ -120,6 +132,8 @@ public:
 	// File access. Set UsesEscapeSequences true, if resource file/buffer uses Escape Sequences (eg \n, \t)
 	void UsesEscapeSequences(bool state); // default false
 	void UsesConditionals(bool state); // default true
+	bool HasEscapeSequences() const { return m_bHasEscapeSequences != 0; }
+	bool EvaluatesConditionals() const { return m_bEvaluateConditionals != 0; }
 	bool LoadFromFile( IBaseFileSystem *filesystem, const char *resourceName, const char *pathID = NULL, bool refreshCache = false );
 	bool SaveToFile( IBaseFileSystem *filesystem, const char *resourceName, const char *pathID = NULL, bool sortKeys = false, bool bAllowEmptyString = false, bool bCacheResult = false );
 
@@ -137,6 +151,12 @@ public:
 	void AddSubKey( KeyValues *pSubkey );	// Adds a subkey. Make sure the subkey isn't a child of some other keyvalues
 	void RemoveSubKey(KeyValues *subKey);	// removes a subkey from the list, DOES NOT DELETE IT
 
+	// Hashes the children of this key and every key below it that has at least nMinChildren
+	// of them, so FindKey doesn't walk the list. The index follows changes made through the
+	// parent (FindKey( name, true ), AddSubKey, RemoveSubKey, Clear...), but the children of
+	// an indexed key must not be renamed or relinked through SetName/SetNextKey directly.
+	void BuildChildIndexes( int nMinChildren = 16 );
+
 	// Key iteration.
 	//
 	// NOTE: GetFirstSubKey/GetNextKey will iterate keys AND values. Use the functions 
@@ -147,7 +167,7 @@ public:
 	const KeyValues *GetNextKey() const { return m_pPeer; }		// returns the next subkey
 
 	void SetNextKey( KeyValues * pDat);
-	KeyValues *FindLastSubKey();	// returns the LAST subkey in the list.  This requires a linked list iteration to find the key.  Returns NULL if we don't have any children
+	KeyValues *FindLastSubKey();	// returns the LAST subkey in the list.  This requires a linked list iteration to find the key (unless the children are indexed).  Returns NULL if we don't have any children
 
 	//
 	// These functions can be used to treat it like a true key/values tree instead of 
@@ -309,7 +329,18 @@ private:
 	void WriteIndents( IBaseFileSystem *filesystem, FileHandle_t f, CUtlBuffer *pBuf, int indentLevel );
 
 	void FreeAllocatedValue();
-	void AllocateValueBlock(int size);
+	char *AllocateValueBlock(int size);
+
+	CKeyValuesArena *GetArena() const;
+	void ReleaseArenaKey();
+	void NoteLinkedKey( KeyValues *pKey );
+
+	CKeyValuesChildIndex *GetChildIndex() const;
+	void SetChildIndex( CKeyValuesChildIndex *pIndex );
+	void BuildChildIndex();
+	void RebuildChildIndex();
+	void FreeChildIndex();
+	void AddToChildIndex( KeyValues *pKey );
 
 	intp m_iKeyName;	// keyname is a symbol defined in KeyValuesSystem
 
@@ -329,12 +360,15 @@ private:
 	char	   m_iDataType;
 	char	   m_bHasEscapeSequences; // true, if while parsing this KeyValue, Escape Sequences are used (default false)
 	char	   m_bEvaluateConditionals; // true, if while parsing this KeyValue, conditionals blocks are evaluated (default true)
-	char	   unused[1];
+	unsigned char m_bArenaAllocated : 1; // true, if this key came out of a CKeyValuesArena instead of the KeyValuesSystem pool
+	unsigned char m_bHasChildIndex : 1; // true, if the subkeys are hashed, see BuildChildIndexes(). The index is kept outside the key.
 
 	KeyValues *m_pPeer;	// pointer to next key in list
 	KeyValues *m_pSub;	// pointer to Start of a new sub key list
 	KeyValues *m_pChain;// Search here if it's not in our list
 
+	friend class CKeyValuesArenaScope;
+
 private:
 	// Statics to implement the optional growable string table
 	// Function pointers that will determine which mode we are in
@@ -356,6 +390,22 @@ public:
 	static const char *CallGetStringForSymbol( intp symbol ) { return s_pfGetStringForSymbol( symbol ); }
 };
 
+//-----------------------------------------------------------------------------
+// Keys constructed with new KeyValues while one of these is in scope are
+// allocated wherever pKeyValues lives: its arena, or the usual pool if it's
+// not an arena key (or NULL). KeyValues uses this itself whenever it creates
+// subkeys, code that builds trees by hand can use it the same way.
+//-----------------------------------------------------------------------------
+class CKeyValuesArenaScope
+{
+public:
+	explicit CKeyValuesArenaScope( const KeyValues *pKeyValues );
+	~CKeyValuesArenaScope();
+
+private:
+	CKeyValuesArena *m_pPrevArena;
+};
+
 typedef KeyValues::AutoDelete KeyValuesAD;
 
 enum KeyValuesUnpackDestinationTypes_t
@@ -0,0 +1,103 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Flat, position independent form of a KeyValues tree, and a read-only
+//			view that looks keys up in place (i.e. straight out of a memory mapped
+//			cache file) without building KeyValues nodes.
+//
+// $NoKeywords: $
+//=============================================================================//
+
+#ifndef KEYVALUESVIEW_H
+#define KEYVALUESVIEW_H
+#ifdef _WIN32
+#pragma once
+#endif
+
+#include "tier1/KeyValues.h"
+
+class CUtlBuffer;
+
+#define KEYVALUES_BLOB_VERSION	1
+
+//-----------------------------------------------------------------------------
+// A compiled tree is a header, the nodes, then the string pool. Node 0 is the
+// root, its siblings follow the same way the peers of a loaded file do.
+// Values use the KeyValues::types_t tags that WriteAsBinary uses.
+//-----------------------------------------------------------------------------
+struct KeyValuesBlobHeader_t
+{
+	uint32	m_nVersion;
+	uint32	m_nNodes;
+	uint32	m_nStringBytes;
+	uint32	m_nFlags;
+};
+
+struct KeyValuesBlobNode_t
+{
+	uint32	m_nName;			// offset of the name in the string pool
+	uint32	m_nNext;			// index of the next sibling, 0 if none (the root is never a sibling)
+	uint32	m_nValue;			// first child index (0 if none), string offset, int, float or color bits
+	uint32	m_nValueHigh;		// high bits of a TYPE_UINT64
+	uint32	m_nType;			// KeyValues::types_t
+};
+
+//-----------------------------------------------------------------------------
+// Compiles a tree and its peers. Fails for values that can't be stored flat
+// (pointers, wide strings).
+//-----------------------------------------------------------------------------
+bool CompileKeyValuesBlob( KeyValues *pKeyValues, CUtlBuffer &buf );
+
+// Checks the header and that every offset stays inside nSize bytes
+bool IsValidKeyValuesBlob( const void *pBlob, int nSize );
+
+// Hash of a KeyValues text file, salted with everything besides the text that changes the parse
+uint64 HashKeyValuesText( const void *pText, int nTextBytes, bool bEscapeSequences, bool bConditionals );
+
+//-----------------------------------------------------------------------------
+// Read-only view of one key in a compiled tree. The blob must outlive the view.
+//-----------------------------------------------------------------------------
+class CKeyValuesView
+{
+public:
+	CKeyValuesView() : m_pBlob( NULL ), m_nNode( 0 ) {}
+	explicit CKeyValuesView( const void *pBlob ) : m_pBlob( (const uint8 *)pBlob ), m_nNode( 0 ) {}
+
+	bool IsValid() const { return m_pBlob != NULL; }
+	const char *GetName() const;
+	KeyValues::types_t GetDataType( const char *pszKeyName = NULL ) const;
+
+	// Accepts "a/b/c" paths the same as KeyValues::FindKey
+	CKeyValuesView FindKey( const char *pszKeyName ) const;
+	CKeyValuesView GetFirstSubKey() const;
+	CKeyValuesView GetNextKey() const;
+
+	int GetInt( const char *pszKeyName = NULL, int nDefault = 0 ) const;
+	uint64 GetUint64( const char *pszKeyName = NULL, uint64 nDefault = 0 ) const;
+	float GetFloat( const char *pszKeyName = NULL, float flDefault = 0.0f ) const;
+	bool GetBool( const char *pszKeyName = NULL, bool bDefault = false ) const;
+	Color GetColor( const char *pszKeyName = NULL ) const;
+
+	// Numbers are formatted into pBuf the way KeyValues::GetString does. Without
+	// a buffer the default is returned for them.
+	const char *GetString( const char *pszKeyName = NULL, const char *pszDefault = "", char *pBuf = NULL, int nBufSize = 0 ) const;
+
+	// Builds the viewed key into pDest, appending to any subkeys it already has.
+	// With bPeers the keys after this one are created as new peers of pDest, the
+	// same as loading a file with several top level keys.
+	bool CopyTo( KeyValues *pDest, bool bPeers = false ) const;
+
+private:
+	CKeyValuesView( const uint8 *pBlob, uint32 nNode ) : m_pBlob( pBlob ), m_nNode( nNode ) {}
+
+	const KeyValuesBlobHeader_t *Header() const { return (const KeyValuesBlobHeader_t *)m_pBlob; }
+	const KeyValuesBlobNode_t *Node( uint32 nNode ) const { return (const KeyValuesBlobNode_t *)( m_pBlob + sizeof( KeyValuesBlobHeader_t ) ) + nNode; }
+	const char *String( uint32 nOffset ) const { return (const char *)( Node( Header()->m_nNodes ) ) + nOffset; }
+
+	void CopyValue( KeyValues *pDest, const KeyValuesBlobNode_t *pNode ) const;
+	void CopySubKeys( KeyValues *pDest, const KeyValuesBlobNode_t *pNode ) const;
+
+	const uint8	*m_pBlob;
+	uint32		m_nNode;
+};
+
+#endif // KEYVALUESVIEW_H
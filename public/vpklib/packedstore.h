@@ -23,6 +23,7 @@
 #include "tier1/UtlSortVector.h"
 #include "tier1/utlmap.h"
 #include "tier1/checksum_md5.h"
+#include "tier1/refcount.h"
 
 //#define VPK_ENABLE_SIGNING
 
@@ -137,6 +138,19 @@ struct FileHandleTracker_t
 	}
 };
 
+// A chunk file mapped read-only into memory. The CPackedStore holds a reference
+// for its lifetime.
+class CPackedStoreMappedChunk : public CRefCounted<>
+{
+public:
+	CPackedStoreMappedChunk( int nFileNumber, void *pBase, int64 nSize );
+	~CPackedStoreMappedChunk();
+
+	int m_nFileNumber;
+	const uint8 *m_pBase;									// NULL if the file couldn't be mapped
+	int64 m_nSize;
+};
+
 enum ePackedStoreAddResultCode
 {
 	EPADD_NEWFILE,											// the file was added and is new
@@ -293,6 +307,12 @@ public:
 
 	int ReadData( CPackedStoreFileHandle &handle, void *pOutData, int nNumBytes );
 
+	// Serve reads straight out of memory mapped chunk files instead of going through
+	// file handles and the read cache. Mapped reads skip the read cache's MD5 checks,
+	// so only use this for trusted local content.
+	void SetUseMemoryMapping( bool bEnable ) { m_bUseMemoryMapping = bEnable; }
+	bool IsUsingMemoryMapping() const { return m_bUseMemoryMapping; }
+
 	~CPackedStore( void );
 
 	FORCEINLINE void *DirectoryData( void )
@@ -398,6 +418,25 @@ private:
 
 	CUtlIntrusiveList<class CFileExtensionData> m_pExtensionData[PACKEDFILE_EXT_HASH_SIZE];
 
+	// Minimal perfect hash over the full path of every file, built by BuildHashTables.
+	// Names are stored as offsets into m_DirectoryData rather than copied.
+	struct PackedPathDir_t
+	{
+		uint32 m_nExtOffset;
+		uint32 m_nDirOffset;
+	};
+
+	struct PackedPathEntry_t
+	{
+		uint32 m_nHashCheck;								// low bits of the path hash, rejects most misses without touching the names
+		uint32 m_nNameOffset;
+		uint32 m_nDirIndex;									// into m_PathHashDirs
+	};
+
+	CUtlVector<int32> m_PathHashSeeds;						// per bucket: >= 0 seed to rehash with, < 0 -(slot+1)
+	CUtlVector<PackedPathEntry_t> m_PathHashEntries;
+	CUtlVector<PackedPathDir_t> m_PathHashDirs;
+
 	CUtlVector<uint8> m_DirectoryData;
 	CUtlBlockVector<uint8> m_EmbeddedChunkData;
 
@@ -425,16 +464,29 @@ private:
 	uint32 m_nSizeOfSignedData;
 
 	FileHandleTracker_t m_FileHandles[MAX_ARCHIVE_FILES_TO_KEEP_OPEN_AT_ONCE];
+
+	bool m_bUseMemoryMapping;
+	CPackedStoreMappedChunk * volatile m_pMappedChunks[MAX_ARCHIVE_FILES_TO_KEEP_OPEN_AT_ONCE];	// set once under m_Mutex, read without it
 	
 	void Init( void );
 
 	struct CFileHeaderFixedData *FindFileEntry( 
 		char const *pDirname, char const *pBaseName, char const *pExtension,
-		uint8 **pExtBaseOut = NULL, uint8 **pNameBaseOut = NULL );
+		uint8 **pNameBaseOut = NULL );
 
 	void BuildHashTables( void );
+	bool BuildPathHash( CUtlVector<uint64> &pathHashes );
+
+	// Replaces the path hash with the per-extension tables, which edits to the
+	// directory need. Also used if the path hash couldn't be built.
+	void BuildExtensionHashTables( void );
+	void PurgeExtensionHashTables( void );
 
 	FileHandleTracker_t &GetFileHandle( int nFileNumber );
+	CPackedStoreMappedChunk *GetMappedChunk( int nFileNumber );
+
+	// Position of the handle's current offset within its chunk file
+	int GetChunkFileOffset( const CPackedStoreFileHandle &handle ) const;
 
 	void CloseWriteHandle( void );
 
@@ -425,6 +425,7 @@ JOB_INTERFACE void DestroyThreadPool( IThreadPool *pPool );
 //-------------------------------------
 
 JOB_INTERFACE void RunThreadPoolTests();
+JOB_INTERFACE void RunParallelProcessBenchmark( int nItems, int nRuns );
 
 //-----------------------------------------------------------------------------
 
@@ -846,13 +847,154 @@ protected:
 	void (FUNCTION_CLASS::*m_pfnEnd)();
 };
 
+//-----------------------------------------------------------------------------
+// Hands out the items [0,nItems) of a parallel process. Each worker owns an
+// equal share and takes shrinking chunks off its front. A worker that runs dry
+// steals the back half of the largest share left, so workers only touch each
+// other's cache lines once their own share is used up.
+//-----------------------------------------------------------------------------
+class CWorkStealingRange
+{
+public:
+	enum
+	{
+		MAX_WORKERS = 64,
+		CHUNK_DIVISOR = 8,		// a chunk is this fraction of what is left in the share
+	};
+
+	void Init( unsigned nItems, int nWorkers )
+	{
+		Assert( nWorkers > 0 && nWorkers <= MAX_WORKERS );
+
+		m_nWorkers = nWorkers;
+		m_nAttached = 0;
+
+		for ( int i = 0; i < nWorkers; i++ )
+		{
+			unsigned iBegin = (unsigned)( ( (uint64)nItems * i ) / nWorkers );
+			unsigned iEnd = (unsigned)( ( (uint64)nItems * ( i + 1 ) ) / nWorkers );
+			m_Shares[i].m_Range = MakeRange( iBegin, iEnd );
+		}
+	}
+
+	// Every executing thread calls this once, returns the share it owns
+	int AttachWorker()
+	{
+		int iWorker = m_nAttached++;
+		Assert( iWorker < m_nWorkers );
+		return iWorker % m_nWorkers;
+	}
+
+	// Next chunk for the worker, false once all items have been handed out
+	bool GetChunk( int iWorker, unsigned &iBegin, unsigned &iEnd )
+	{
+		int64 volatile *pShare = &m_Shares[iWorker].m_Range;
+
+		for ( ;; )
+		{
+			int64 range = LoadRange( pShare );
+			unsigned iShareBegin = RangeBegin( range );
+			unsigned iShareEnd = RangeEnd( range );
+
+			if ( iShareBegin >= iShareEnd )
+			{
+				if ( !Steal( iWorker ) )
+					return false;
+				continue;
+			}
+
+			unsigned nChunk = ( iShareEnd - iShareBegin ) / CHUNK_DIVISOR;
+			if ( nChunk == 0 )
+			{
+				nChunk = 1;
+			}
+
+			// fails if a thief took the back of the share in the meantime
+			if ( ThreadInterlockedAssignIf64( pShare, MakeRange( iShareBegin + nChunk, iShareEnd ), range ) )
+			{
+				iBegin = iShareBegin;
+				iEnd = iShareBegin + nChunk;
+				return true;
+			}
+		}
+	}
+
+private:
+	bool Steal( int iWorker )
+	{
+		for ( ;; )
+		{
+			int iVictim = -1;
+			int64 victimRange = 0;
+			unsigned nMost = 0;
+
+			for ( int i = 0; i < m_nWorkers; i++ )
+			{
+				if ( i == iWorker )
+					continue;
+
+				int64 range = LoadRange( &m_Shares[i].m_Range );
+				unsigned iShareBegin = RangeBegin( range );
+				unsigned iShareEnd = RangeEnd( range );
+				if ( iShareBegin < iShareEnd && iShareEnd - iShareBegin > nMost )
+				{
+					nMost = iShareEnd - iShareBegin;
+					iVictim = i;
+					victimRange = range;
+				}
+			}
+
+			// Everything is handed out. Work being moved by another thief isn't
+			// visible here, but that thief processes it itself.
+			if ( iVictim == -1 )
+				return false;
+
+			unsigned iVictimBegin = RangeBegin( victimRange );
+			unsigned iVictimEnd = RangeEnd( victimRange );
+			unsigned iSplit = iVictimEnd - ( nMost + 1 ) / 2;
+
+			if ( ThreadInterlockedAssignIf64( &m_Shares[iVictim].m_Range, MakeRange( iVictimBegin, iSplit ), victimRange ) )
+			{
+				// our share is empty, thieves leave it alone until this store
+				ThreadInterlockedExchange64( &m_Shares[iWorker].m_Range, MakeRange( iSplit, iVictimEnd ) );
+				return true;
+			}
+		}
+	}
+
+	static int64 MakeRange( unsigned iBegin, unsigned iEnd )	{ return (int64)( ( (uint64)iEnd << 32 ) | iBegin ); }
+	static unsigned RangeBegin( int64 range )					{ return (unsigned)( (uint64)range & 0xffffffff ); }
+	static unsigned RangeEnd( int64 range )						{ return (unsigned)( (uint64)range >> 32 ); }
+
+	static int64 LoadRange( int64 volatile *pRange )
+	{
+#ifdef PLATFORM_64BITS
+		return *pRange;
+#else
+		// compare exchange with itself reads all 64 bits at once
+		return ThreadInterlockedCompareExchange64( pRange, 0, 0 );
+#endif
+	}
+
+	// one cache line per share
+	struct Share_t
+	{
+		int64 volatile	m_Range;	// end << 32 | begin
+		byte			m_Pad[64 - sizeof( int64 )];
+	};
+
+	Share_t				m_Shares[MAX_WORKERS];
+	int					m_nWorkers;
+	CInterlockedInt		m_nAttached;
+};
+
 template <typename ITEM_TYPE, class ITEM_PROCESSOR_TYPE>
 class CParallelProcessor
 {
 public:
 	CParallelProcessor( const char *pszDescription )
 	{
-		m_pItems = m_pLimit= 0;
+		m_pItems = NULL;
 		m_szDescription = pszDescription;
 	}
 
@@ -869,7 +1011,6 @@ public:
 		}
 
 		m_pItems = pItems;
-		m_pLimit = pItems + nItems;
 
 		int nJobs = nItems - 1;
 
@@ -880,6 +1021,7 @@ public:
 
 		if (! pThreadPool )									// only possible on linux
 		{
+			m_Range.Init( nItems, 1 );
 			DoExecute( );
 			return;
 		}
@@ -890,8 +1032,16 @@ public:
 			nJobs = nThreads;
 		}
 
+		if ( nJobs > CWorkStealingRange::MAX_WORKERS - 1 )
+		{
+			nJobs = CWorkStealingRange::MAX_WORKERS - 1;
+		}
+
 		if ( nJobs > 1 )
 		{
+			// jobs that never get a thread leave their share to be stolen
+			m_Range.Init( nItems, nJobs + 1 );
+
 			CJob **jobs = (CJob **)stackalloc( nJobs * sizeof(CJob **) );
 			int i = nJobs;
 
@@ -911,6 +1061,7 @@ public:
 		}
 		else
 		{
+			m_Range.Init( nItems, 1 );
 			DoExecute();
 		}
 	}
@@ -922,30 +1073,27 @@ private:
 	{
 		tmZone( TELEMETRY_LEVEL0, TMZF_NONE, "DoExecute %s", m_szDescription );
 
-		if ( m_pItems < m_pLimit )
+		int iWorker = m_Range.AttachWorker();
+		unsigned iBegin, iEnd;
+
+		if ( m_Range.GetChunk( iWorker, iBegin, iEnd ) )
 		{
 			m_ItemProcessor.Begin();
 
-			ITEM_TYPE *pLimit = m_pLimit;
-
-			for (;;)
+			do
 			{
-				ITEM_TYPE *pCurrent = m_pItems++;
-				if ( pCurrent < pLimit )
-				{
-					m_ItemProcessor.Process( *pCurrent );
-				}
-				else
+				for ( unsigned i = iBegin; i < iEnd; i++ )
 				{
-					break;
+					m_ItemProcessor.Process( m_pItems[i] );
 				}
-			}
+			} while ( m_Range.GetChunk( iWorker, iBegin, iEnd ) );
 
 			m_ItemProcessor.End();
 		}
 	}
-	CInterlockedPtr<ITEM_TYPE>	m_pItems;
-	ITEM_TYPE *					m_pLimit;
+
+	CWorkStealingRange			m_Range;
+	ITEM_TYPE *					m_pItems;
 	const char *				m_szDescription;
 };
 
@@ -982,7 +1130,7 @@ class CParallelLoopProcessor
 public:
 	CParallelLoopProcessor( const char *pszDescription )
 	{
-		m_lIndex = m_lLimit= 0;
+		m_lBegin = 0;
 		m_nActive = 0;
 		m_szDescription = pszDescription;
 	}
@@ -991,8 +1139,7 @@ public:
 	{
 		if ( nItems )
 		{
-			m_lIndex = lBegin;
-			m_lLimit = lBegin + nItems;
+			m_lBegin = lBegin;
 			int i = g_pThreadPool->NumIdleThreads();
 
 			if ( nMaxParallel < i)
@@ -1000,6 +1147,13 @@ public:
 				i = nMaxParallel;
 			}
 
+			if ( i > CWorkStealingRange::MAX_WORKERS - 1 )
+			{
+				i = CWorkStealingRange::MAX_WORKERS - 1;
+			}
+
+			m_Range.Init( nItems, i + 1 );
+
 			while( i-- )
 			{
 				++m_nActive;
@@ -1025,27 +1179,24 @@ private:
 
 		m_ItemProcessor.Begin();
 
-		long lLimit = m_lLimit;
+		int iWorker = m_Range.AttachWorker();
+		unsigned iBegin, iEnd;
 
-		for (;;)
+		while ( m_Range.GetChunk( iWorker, iBegin, iEnd ) )
 		{
-			long lIndex = m_lIndex ++;
-			if ( lIndex < lLimit )
+			for ( unsigned i = iBegin; i < iEnd; i++ )
 			{
+				long lIndex = m_lBegin + (long)i;
 				m_ItemProcessor.Process( lIndex );
 			}
-			else
-			{
-				break;
-			}
 		}
 
 		m_ItemProcessor.End();
 
 		--m_nActive;
 	}
-	CInterlockedInt				m_lIndex;
-	long						m_lLimit;
+	CWorkStealingRange			m_Range;
+	long						m_lBegin;
 	CInterlockedInt				m_nActive;
 	const char *				m_szDescription;
 };
@@ -26,10 +26,12 @@
 #include "tier0/mem.h"
 #include "utlbuffer.h"
 #include "utlhash.h"
+#include "utlhashtable.h"
 #include "utlvector.h"
 #include "utlqueue.h"
 #include "UtlSortVector.h"
 #include "convar.h"
+#include "tier1/keyvaluesview.h"
 
 // memdbgon must be the last include file in a .cpp file!!!
 #include <tier0/memdbgon.h>
@@ -369,6 +371,204 @@ const char *KeyValues::GetStringForSymbolGrowable( intp symbol )
 }
 
 
+//-----------------------------------------------------------------------------
+// Arena for KeyValues trees made with KeyValues::CreateArenaTree. Keys and
+// their values are carved out of big blocks and never freed one at a time,
+// deleting the root throws all the blocks away at once. Every key is preceded
+// by a pointer back to its arena.
+//-----------------------------------------------------------------------------
+#define KEYVALUES_ARENA_BLOCK_SIZE	( 32 * 1024 )
+#define KEYVALUES_ARENA_ALIGN		8
+
+// Child indexes are kept outside KeyValues so its size doesn't change, keyed by the
+// parent. Arena trees keep theirs in the arena, pool keys share a global table.
+typedef CUtlHashtable< const KeyValues *, CKeyValuesChildIndex * > CKeyValuesChildIndexTable;
+
+class CKeyValuesArena
+{
+public:
+	CKeyValuesArena( int nBlockSize ) : m_pRoot( NULL ), m_bHasForeignKeys( false ), m_pBlocks( NULL )
+	{
+		m_nBlockSize = nBlockSize > 0 ? nBlockSize : KEYVALUES_ARENA_BLOCK_SIZE;
+	}
+
+	~CKeyValuesArena()
+	{
+		while ( m_pBlocks )
+		{
+			Block_t *pNext = m_pBlocks->m_pNext;
+			free( m_pBlocks );
+			m_pBlocks = pNext;
+		}
+	}
+
+	void *Alloc( int nBytes )
+	{
+		nBytes = AlignValue( nBytes, KEYVALUES_ARENA_ALIGN );
+		if ( !m_pBlocks || m_pBlocks->m_nUsed + nBytes > m_pBlocks->m_nSize )
+		{
+			// big allocations get a block of their own so they don't waste the rest of the current one
+			if ( nBytes > m_nBlockSize / 4 && m_pBlocks )
+			{
+				Block_t *pBlock = NewBlock( nBytes );
+				pBlock->m_pNext = m_pBlocks->m_pNext;
+				m_pBlocks->m_pNext = pBlock;
+				pBlock->m_nUsed = nBytes;
+				return pBlock + 1;
+			}
+
+			Block_t *pBlock = NewBlock( MAX( nBytes, m_nBlockSize ) );
+			pBlock->m_pNext = m_pBlocks;
+			m_pBlocks = pBlock;
+		}
+
+		void *pMem = (uint8 *)( m_pBlocks + 1 ) + m_pBlocks->m_nUsed;
+		m_pBlocks->m_nUsed += nBytes;
+		return pMem;
+	}
+
+	void *AllocKey( size_t nBytes )
+	{
+		CKeyValuesArena **ppArena = (CKeyValuesArena **)Alloc( sizeof( CKeyValuesArena * ) + (int)nBytes );
+		*ppArena = this;
+		return ppArena + 1;
+	}
+
+	static CKeyValuesArena *FromKey( const KeyValues *pKey )
+	{
+		return ( (CKeyValuesArena * const *)pKey )[-1];
+	}
+
+	KeyValues *m_pRoot;
+
+	// set when keys from the pool or another arena were linked into the tree, they
+	// still need to be deleted one by one when the tree goes away
+	bool m_bHasForeignKeys;
+
+	// indexes of this tree's keys, they go away with the arena
+	CKeyValuesChildIndexTable m_ChildIndexes;
+
+private:
+	struct Block_t
+	{
+		Block_t *m_pNext;
+		int m_nSize;
+		int m_nUsed;
+	};
+	COMPILE_TIME_ASSERT( ( sizeof( Block_t ) % KEYVALUES_ARENA_ALIGN ) == 0 );
+
+	Block_t *NewBlock( int nBytes )
+	{
+		Block_t *pBlock = (Block_t *)malloc( sizeof( Block_t ) + nBytes );
+		pBlock->m_nSize = nBytes;
+		pBlock->m_nUsed = 0;
+		return pBlock;
+	}
+
+	Block_t *m_pBlocks;
+	int m_nBlockSize;
+};
+
+// arena that new KeyValues are allocated from on this thread, NULL for the KeyValuesSystem pool
+static CTHREADLOCALPTR( CKeyValuesArena ) s_pCurrentArena;
+
+CKeyValuesArenaScope::CKeyValuesArenaScope( const KeyValues *pKeyValues )
+{
+	m_pPrevArena = s_pCurrentArena;
+	s_pCurrentArena = pKeyValues ? pKeyValues->GetArena() : NULL;
+}
+
+CKeyValuesArenaScope::~CKeyValuesArenaScope()
+{
+	s_pCurrentArena = m_pPrevArena;
+}
+
+//-----------------------------------------------------------------------------
+// Open addressed hash of a key's children by name symbol. Only the first child
+// with a given name is in the table, which is the one FindKey returns.
+//-----------------------------------------------------------------------------
+class CKeyValuesChildIndex
+{
+public:
+	struct Entry_t
+	{
+		intp m_nSymbol;
+		KeyValues *m_pKey;
+	};
+
+	static int AllocSize( int nEntries )
+	{
+		return sizeof( CKeyValuesChildIndex ) + ( nEntries - 1 ) * sizeof( Entry_t );
+	}
+
+	// the table is kept at most half full
+	static int EntriesForChildren( int nChildren )
+	{
+		return SmallestPowerOfTwoGreaterOrEqual( MAX( nChildren * 2, 16 ) );
+	}
+
+	void Reset( int nEntries )
+	{
+		m_pLastChild = NULL;
+		m_nChildren = 0;
+		m_nMask = nEntries - 1;
+		memset( m_Entries, 0, nEntries * sizeof( Entry_t ) );
+	}
+
+	bool IsFull() const
+	{
+		return ( m_nChildren + 1 ) * 2 > m_nMask + 1;
+	}
+
+	KeyValues *Find( intp nSymbol ) const
+	{
+		for ( uint32 i = Hash( nSymbol ); ; i = ( i + 1 ) & m_nMask )
+		{
+			const Entry_t &entry = m_Entries[i];
+			if ( !entry.m_pKey || entry.m_nSymbol == nSymbol )
+				return entry.m_pKey;
+		}
+	}
+
+	// pKey goes after the current last child
+	void Append( KeyValues *pKey )
+	{
+		Assert( !IsFull() );
+
+		m_pLastChild = pKey;
+		m_nChildren++;
+
+		intp nSymbol = pKey->GetNameSymbol();
+		for ( uint32 i = Hash( nSymbol ); ; i = ( i + 1 ) & m_nMask )
+		{
+			Entry_t &entry = m_Entries[i];
+			if ( !entry.m_pKey )
+			{
+				entry.m_nSymbol = nSymbol;
+				entry.m_pKey = pKey;
+				return;
+			}
+
+			if ( entry.m_nSymbol == nSymbol )
+				return;
+		}
+	}
+
+	KeyValues *m_pLastChild;
+	uint32 m_nChildren;
+
+private:
+	uint32 Hash( intp nSymbol ) const
+	{
+		uint32 nHash = (uint32)nSymbol * 0x9E3779B1;
+		return ( nHash ^ ( nHash >> 16 ) ) & m_nMask;
+	}
+
+	uint32 m_nMask;
+	Entry_t m_Entries[1];
+};
+
+
 
 //-----------------------------------------------------------------------------
 // Purpose: Constructor
@@ -454,6 +654,7 @@ void KeyValues::Init()
 	m_pSub = NULL;
 	m_pPeer = NULL;
 	m_pChain = NULL;
+	m_bHasChildIndex = false;
 
 	m_sValue = NULL;
 	m_wsValue = NULL;
@@ -462,8 +663,9 @@ void KeyValues::Init()
 	m_bHasEscapeSequences = false;
 	m_bEvaluateConditionals = true;
 
-	// for future proof
-	memset( unused, 0, sizeof(unused) );
+	// operator new took the memory from the current arena, if there is one. Keys that get
+	// reset after construction (operator=, ReadAsBinary) do it inside a scope for their own arena.
+	m_bArenaAllocated = ( (CKeyValuesArena *)s_pCurrentArena != NULL );
 }
 
 //-----------------------------------------------------------------------------
@@ -487,22 +689,255 @@ void KeyValues::RemoveEverything()
 	{
 		datNext = dat->m_pPeer;
 		dat->m_pPeer = NULL;
-		delete dat;
+		dat->deleteThis();
 	}
 
 	for ( dat = m_pPeer; dat && dat != this; dat = datNext )
 	{
 		datNext = dat->m_pPeer;
 		dat->m_pPeer = NULL;
-		delete dat;
+		dat->deleteThis();
+	}
+
+	FreeAllocatedValue();
+	FreeChildIndex();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Frees the string values, arena values go away with the arena
+//-----------------------------------------------------------------------------
+void KeyValues::FreeAllocatedValue()
+{
+	if ( !m_bArenaAllocated )
+	{
+		delete [] m_sValue;
+		delete [] (char *)m_wsValue;
 	}
 
-	delete [] m_sValue;
 	m_sValue = NULL;
-	delete [] m_wsValue;
 	m_wsValue = NULL;
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: Allocates memory for a string value, FreeAllocatedValue frees it
+//-----------------------------------------------------------------------------
+char *KeyValues::AllocateValueBlock( int size )
+{
+	if ( m_bArenaAllocated )
+		return (char *)GetArena()->Alloc( size );
+
+	return new char[size];
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Creates the root key of an arena tree
+//-----------------------------------------------------------------------------
+KeyValues *KeyValues::CreateArenaTree( const char *setName, int nBlockSize )
+{
+	CKeyValuesArena *pArena = new CKeyValuesArena( nBlockSize );
+
+	CKeyValuesArena *pPrevArena = s_pCurrentArena;
+	s_pCurrentArena = pArena;
+	KeyValues *pRoot = new KeyValues( setName );
+	s_pCurrentArena = pPrevArena;
+
+	pArena->m_pRoot = pRoot;
+	return pRoot;
+}
+
+CKeyValuesArena *KeyValues::GetArena() const
+{
+	return m_bArenaAllocated ? CKeyValuesArena::FromKey( this ) : NULL;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: deleteThis() for arena keys. Only the root frees anything, unless
+//			keys that didn't come from the arena were linked in.
+//-----------------------------------------------------------------------------
+void KeyValues::ReleaseArenaKey()
+{
+	TRACK_KV_REMOVE( this );
+
+	CKeyValuesArena *pArena = GetArena();
+	if ( pArena->m_bHasForeignKeys )
+	{
+		RemoveEverything();
+	}
+
+	if ( pArena->m_pRoot == this )
+	{
+		delete pArena;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Called when pKey gets linked below or after this key
+//-----------------------------------------------------------------------------
+void KeyValues::NoteLinkedKey( KeyValues *pKey )
+{
+	if ( m_bArenaAllocated && pKey && pKey->GetArena() != GetArena() )
+	{
+		GetArena()->m_bHasForeignKeys = true;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Looks up the index of this key's children in the side table
+//-----------------------------------------------------------------------------
+static CKeyValuesChildIndexTable &PoolChildIndexes()
+{
+	static CKeyValuesChildIndexTable s_ChildIndexes;
+	return s_ChildIndexes;
+}
+
+static CThreadSpinRWLock s_PoolChildIndexLock;
+
+CKeyValuesChildIndex *KeyValues::GetChildIndex() const
+{
+	if ( !m_bHasChildIndex )
+		return NULL;
+
+	if ( m_bArenaAllocated )
+	{
+		// an arena tree is only changed by one thread at a time, like any other tree
+		const CKeyValuesChildIndexTable &table = GetArena()->m_ChildIndexes;
+		return table[ table.Find( this ) ];
+	}
+
+	// other threads change the indexes of their own trees meanwhile
+	s_PoolChildIndexLock.LockForRead();
+	const CKeyValuesChildIndexTable &table = PoolChildIndexes();
+	CKeyValuesChildIndex *pIndex = table[ table.Find( this ) ];
+	s_PoolChildIndexLock.UnlockRead();
+	return pIndex;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Records pIndex as the index of this key's children, NULL removes it
+//-----------------------------------------------------------------------------
+void KeyValues::SetChildIndex( CKeyValuesChildIndex *pIndex )
+{
+	if ( !pIndex && !m_bHasChildIndex )
+		return;
+
+	m_bHasChildIndex = ( pIndex != NULL );
+
+	if ( m_bArenaAllocated )
+	{
+		CKeyValuesChildIndexTable &table = GetArena()->m_ChildIndexes;
+		if ( pIndex )
+		{
+			table[ table.Insert( this ) ] = pIndex;
+		}
+		else
+		{
+			table.Remove( this );
+		}
+		return;
+	}
+
+	s_PoolChildIndexLock.LockForWrite();
+	CKeyValuesChildIndexTable &table = PoolChildIndexes();
+	if ( pIndex )
+	{
+		table[ table.Insert( this ) ] = pIndex;
+	}
+	else
+	{
+		table.Remove( this );
+	}
+	s_PoolChildIndexLock.UnlockWrite();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Hashes the children of this key
+//-----------------------------------------------------------------------------
+void KeyValues::BuildChildIndex()
+{
+	int nChildren = 0;
+	for ( KeyValues *dat = m_pSub; dat != NULL; dat = dat->m_pPeer )
+	{
+		nChildren++;
+	}
+
+	FreeChildIndex();
+
+	int nEntries = CKeyValuesChildIndex::EntriesForChildren( nChildren );
+	int nSize = CKeyValuesChildIndex::AllocSize( nEntries );
+	CKeyValuesChildIndex *pIndex = (CKeyValuesChildIndex *)( m_bArenaAllocated ? GetArena()->Alloc( nSize ) : malloc( nSize ) );
+	pIndex->Reset( nEntries );
+
+	for ( KeyValues *dat = m_pSub; dat != NULL; dat = dat->m_pPeer )
+	{
+		pIndex->Append( dat );
+	}
+
+	SetChildIndex( pIndex );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Brings the index back in line with the children after they were
+//			changed some way the index can't follow
+//-----------------------------------------------------------------------------
+void KeyValues::RebuildChildIndex()
+{
+	if ( m_bHasChildIndex )
+	{
+		BuildChildIndex();
+	}
+}
+
+void KeyValues::FreeChildIndex()
+{
+	if ( !m_bHasChildIndex )
+		return;
+
+	CKeyValuesChildIndex *pIndex = GetChildIndex();
+	SetChildIndex( NULL );
+
+	if ( !m_bArenaAllocated )
+	{
+		free( pIndex );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: pKey was just appended to the children
+//-----------------------------------------------------------------------------
+void KeyValues::AddToChildIndex( KeyValues *pKey )
+{
+	CKeyValuesChildIndex *pIndex = GetChildIndex();
+	if ( !pIndex )
+		return;
+
+	if ( pIndex->IsFull() )
+	{
+		// rebuilding sizes the table for the new child as well
+		BuildChildIndex();
+		return;
+	}
+
+	pIndex->Append( pKey );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Indexes the children of every wide key in this tree
+//-----------------------------------------------------------------------------
+void KeyValues::BuildChildIndexes( int nMinChildren )
+{
+	int nChildren = 0;
+	for ( KeyValues *dat = m_pSub; dat != NULL; dat = dat->m_pPeer )
+	{
+		nChildren++;
+		dat->BuildChildIndexes( nMinChildren );
+	}
+
+	if ( nChildren >= nMinChildren )
+	{
+		BuildChildIndex();
+	}
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: 
 // Input  : *f - 
@@ -721,7 +1156,34 @@ bool KeyValues::LoadFromFile( IBaseFileSystem *filesystem, const char *resourceN
 	{
 		buffer[fileSize] = 0; // null terminate file as EOF
 		buffer[fileSize+1] = 0; // double NULL terminating in case this is a unicode file
-		bRetOK = LoadFromBuffer( resourceName, buffer, filesystem );
+
+		// The compiled cache is keyed on this file's text alone, so skip it for files that pull in
+		// others, and when loading into keys that already hold data the file didn't produce
+		bool bUseCompiledCache = !GetFirstSubKey() && !GetNextKey() &&
+			!( fileSize >= 2 && (uint8)buffer[0] == 0xFF && (uint8)buffer[1] == 0xFE ) &&
+			!V_stristr( buffer, "#include" ) && !V_stristr( buffer, "#base" );
+
+		uint64 nHash = 0;
+		int nBlobSize = 0;
+		const void *pBlob = NULL;
+		if ( bUseCompiledCache )
+		{
+			nHash = HashKeyValuesText( buffer, fileSize, m_bHasEscapeSequences != 0, m_bEvaluateConditionals != 0 );
+			pBlob = ((IFileSystem *)filesystem)->FindCompiledKeyValues( nHash, &nBlobSize );
+		}
+
+		if ( pBlob )
+		{
+			bRetOK = CKeyValuesView( pBlob ).CopyTo( this, true );
+		}
+		else
+		{
+			bRetOK = LoadFromBuffer( resourceName, buffer, filesystem );
+			if ( bRetOK && bUseCompiledCache )
+			{
+				((IFileSystem *)filesystem)->AddCompiledKeyValues( nHash, this, &nBlobSize );
+			}
+		}
 	}
 	
 	// The cache relies on the KeyValuesSystem string table, which will only be valid if we're
@@ -972,6 +1434,9 @@ void KeyValues::SaveKeyToFile( KeyValues *dat, IBaseFileSystem *filesystem, File
 //-----------------------------------------------------------------------------
 KeyValues *KeyValues::FindKey(intp keySymbol) const
 {
+	if ( m_bHasChildIndex )
+		return GetChildIndex()->Find( keySymbol );
+
 	for (KeyValues *dat = m_pSub; dat != NULL; dat = dat->m_pPeer)
 	{
 		if (dat->m_iKeyName == keySymbol)
@@ -1017,15 +1482,24 @@ KeyValues *KeyValues::FindKey(const char *keyName, bool bCreate)
 
 	KeyValues *lastItem = NULL;
 	KeyValues *dat;
-	// find the searchStr in the current peer list
-	for (dat = m_pSub; dat != NULL; dat = dat->m_pPeer)
+	if ( m_bHasChildIndex )
 	{
-		lastItem = dat;	// record the last item looked at (for if we need to append to the end of the list)
-
-		// symbol compare
-		if (dat->m_iKeyName == iSearchStr)
+		CKeyValuesChildIndex *pIndex = GetChildIndex();
+		dat = pIndex->Find( iSearchStr );
+		lastItem = pIndex->m_pLastChild;
+	}
+	else
+	{
+		// find the searchStr in the current peer list
+		for (dat = m_pSub; dat != NULL; dat = dat->m_pPeer)
 		{
-			break;
+			lastItem = dat;	// record the last item looked at (for if we need to append to the end of the list)
+
+			// symbol compare
+			if (dat->m_iKeyName == iSearchStr)
+			{
+				break;
+			}
 		}
 	}
 
@@ -1040,7 +1514,10 @@ KeyValues *KeyValues::FindKey(const char *keyName, bool bCreate)
 		if (bCreate)
 		{
 			// we need to create a new key
-			dat = new KeyValues( searchStr );
+			{
+				CKeyValuesArenaScope arenaScope( this );
+				dat = new KeyValues( searchStr );
+			}
 //			Assert(dat != NULL);
 
 			dat->UsesEscapeSequences( m_bHasEscapeSequences != 0 );	// use same format as parent
@@ -1056,6 +1533,7 @@ KeyValues *KeyValues::FindKey(const char *keyName, bool bCreate)
 				m_pSub = dat;
 			}
 			dat->m_pPeer = NULL;
+			AddToChildIndex( dat );
 
 			// a key graduates to be a submsg as soon as it's m_pSub is set
 			// this should be the only place m_pSub is set
@@ -1120,7 +1598,11 @@ KeyValues* KeyValues::CreateKey( const char *keyName )
 KeyValues* KeyValues::CreateKeyUsingKnownLastChild( const char *keyName, KeyValues *pLastChild )
 {
 	// Create a new key
-	KeyValues* dat = new KeyValues( keyName );
+	KeyValues* dat;
+	{
+		CKeyValuesArenaScope arenaScope( this );
+		dat = new KeyValues( keyName );
+	}
 
 	dat->UsesEscapeSequences( m_bHasEscapeSequences != 0 ); // use same format as parent does
 	dat->UsesConditionals( m_bEvaluateConditionals != 0 );
@@ -1161,6 +1643,9 @@ void KeyValues::AddSubkeyUsingKnownLastChild( KeyValues *pSubkey, KeyValues *pLa
 
 		pLastChild->SetNextKey( pSubkey );
 	}
+
+	NoteLinkedKey( pSubkey );
+	AddToChildIndex( pSubkey );
 }
 
 
@@ -1180,14 +1665,12 @@ void KeyValues::AddSubKey( KeyValues *pSubkey )
 	}
 	else
 	{
-		KeyValues *pTempDat = m_pSub;
-		while ( pTempDat->GetNextKey() != NULL )
-		{
-			pTempDat = pTempDat->GetNextKey();
-		}
-
+		KeyValues *pTempDat = FindLastSubKey();
 		pTempDat->SetNextKey( pSubkey );
 	}
+
+	NoteLinkedKey( pSubkey );
+	AddToChildIndex( pSubkey );
 }
 
 
@@ -1222,6 +1705,8 @@ void KeyValues::RemoveSubKey(KeyValues *subKey)
 	}
 
 	subKey->m_pPeer = NULL;
+
+	RebuildChildIndex();
 }
 
 
@@ -1236,6 +1721,9 @@ KeyValues *KeyValues::FindLastSubKey()
 	if ( m_pSub == NULL )
 		return NULL;
 
+	if ( m_bHasChildIndex )
+		return GetChildIndex()->m_pLastChild;
+
 	// Scan for the last one
 	KeyValues *pLastChild = m_pSub;
 	while ( pLastChild->m_pPeer )
@@ -1249,6 +1737,7 @@ KeyValues *KeyValues::FindLastSubKey()
 void KeyValues::SetNextKey( KeyValues *pDat )
 {
 	m_pPeer = pDat;
+	NoteLinkedKey( pDat );
 }
 
 
@@ -1595,11 +2084,8 @@ void KeyValues::SetColor( const char *keyName, Color value)
 
 void KeyValues::SetStringValue( char const *strValue )
 {
-	// delete the old value
-	delete [] m_sValue;
-	// make sure we're not storing the WSTRING  - as we're converting over to STRING
-	delete [] m_wsValue;
-	m_wsValue = NULL;
+	// delete the old value, make sure we're not storing the WSTRING  - as we're converting over to STRING
+	FreeAllocatedValue();
 
 	if (!strValue)
 	{
@@ -1609,7 +2095,7 @@ void KeyValues::SetStringValue( char const *strValue )
 
 	// allocate memory for the new value and copy it in
 	int len = Q_strlen( strValue );
-	m_sValue = new char[len + 1];
+	m_sValue = AllocateValueBlock( len + 1 );
 	Q_memcpy( m_sValue, strValue, len+1 );
 
 	m_iDataType = TYPE_STRING;
@@ -1629,11 +2115,8 @@ void KeyValues::SetString( const char *keyName, const char *value )
 			return;
 		}
 
-		// delete the old value
-		delete [] dat->m_sValue;
-		// make sure we're not storing the WSTRING  - as we're converting over to STRING
-		delete [] dat->m_wsValue;
-		dat->m_wsValue = NULL;
+		// delete the old value, make sure we're not storing the WSTRING  - as we're converting over to STRING
+		dat->FreeAllocatedValue();
 
 		if (!value)
 		{
@@ -1643,7 +2126,7 @@ void KeyValues::SetString( const char *keyName, const char *value )
 
 		// allocate memory for the new value and copy it in
 		int len = Q_strlen( value );
-		dat->m_sValue = new char[len + 1];
+		dat->m_sValue = dat->AllocateValueBlock( len + 1 );
 		Q_memcpy( dat->m_sValue, value, len+1 );
 
 		dat->m_iDataType = TYPE_STRING;
@@ -1658,11 +2141,8 @@ void KeyValues::SetWString( const char *keyName, const wchar_t *value )
 	KeyValues *dat = FindKey( keyName, true );
 	if ( dat )
 	{
-		// delete the old value
-		delete [] dat->m_wsValue;
-		// make sure we're not storing the STRING  - as we're converting over to WSTRING
-		delete [] dat->m_sValue;
-		dat->m_sValue = NULL;
+		// delete the old value, make sure we're not storing the STRING  - as we're converting over to WSTRING
+		dat->FreeAllocatedValue();
 
 		if (!value)
 		{
@@ -1672,7 +2152,7 @@ void KeyValues::SetWString( const char *keyName, const wchar_t *value )
 
 		// allocate memory for the new value and copy it in
 		int len = Q_wcslen( value );
-		dat->m_wsValue = new wchar_t[len + 1];
+		dat->m_wsValue = (wchar_t *)dat->AllocateValueBlock( ( len + 1 ) * sizeof( wchar_t ) );
 		Q_memcpy( dat->m_wsValue, value, (len+1) * sizeof(wchar_t) );
 
 		dat->m_iDataType = TYPE_WSTRING;
@@ -1702,13 +2182,10 @@ void KeyValues::SetUint64( const char *keyName, uint64 value )
 
 	if ( dat )
 	{
-		// delete the old value
-		delete [] dat->m_sValue;
-		// make sure we're not storing the WSTRING  - as we're converting over to STRING
-		delete [] dat->m_wsValue;
-		dat->m_wsValue = NULL;
+		// delete the old value, make sure we're not storing the WSTRING  - as we're converting over to STRING
+		dat->FreeAllocatedValue();
 
-		dat->m_sValue = new char[sizeof(uint64)];
+		dat->m_sValue = dat->AllocateValueBlock( sizeof(uint64) );
 		*((uint64 *)dat->m_sValue) = value;
 		dat->m_iDataType = TYPE_UINT64;
 	}
@@ -1766,6 +2243,7 @@ void KeyValues::CopyKeyValuesFromRecursive( const KeyValues& rootSrc )
 	char tmp[256];
 	KeyValues* localDst = NULL;
 
+	CKeyValuesArenaScope arenaScope( this );
 	CUtlQueue<CopyStruct> nodeQ;
 	nodeQ.Insert({ this, &rootSrc });
 
@@ -1823,7 +2301,7 @@ void KeyValues::CopyKeyValue( const KeyValues& src, size_t tmpBufferSizeB, char*
 		if( src.m_sValue )
 		{
 			int len = Q_strlen(src.m_sValue) + 1;
-			m_sValue = new char[len];
+			m_sValue = AllocateValueBlock( len );
 			Q_strncpy( m_sValue, src.m_sValue, len );
 		}
 		break;
@@ -1832,7 +2310,7 @@ void KeyValues::CopyKeyValue( const KeyValues& src, size_t tmpBufferSizeB, char*
 			m_iValue = src.m_iValue;
 			Q_snprintf( tmpBuffer, tmpBufferSizeB, "%d", m_iValue );
 			int len = Q_strlen(tmpBuffer) + 1;
-			m_sValue = new char[len];
+			m_sValue = AllocateValueBlock( len );
 			Q_strncpy( m_sValue, tmpBuffer, len  );
 		}
 		break;
@@ -1841,7 +2319,7 @@ void KeyValues::CopyKeyValue( const KeyValues& src, size_t tmpBufferSizeB, char*
 			m_flValue = src.m_flValue;
 			Q_snprintf( tmpBuffer, tmpBufferSizeB, "%f", m_flValue );
 			int len = Q_strlen(tmpBuffer) + 1;
-			m_sValue = new char[len];
+			m_sValue = AllocateValueBlock( len );
 			Q_strncpy( m_sValue, tmpBuffer, len );
 		}
 		break;
@@ -1852,7 +2330,7 @@ void KeyValues::CopyKeyValue( const KeyValues& src, size_t tmpBufferSizeB, char*
 		break;
 	case TYPE_UINT64:
 		{
-			m_sValue = new char[sizeof(uint64)];
+			m_sValue = AllocateValueBlock( sizeof(uint64) );
 			Q_memcpy( m_sValue, src.m_sValue, sizeof(uint64) );
 		}
 		break;
@@ -1876,6 +2354,7 @@ void KeyValues::CopyKeyValue( const KeyValues& src, size_t tmpBufferSizeB, char*
 
 KeyValues& KeyValues::operator=( const KeyValues& src )
 {
+	CKeyValuesArenaScope arenaScope( this );
 	RemoveEverything();
 	Init();	// reset all values
 	CopyKeyValuesFromRecursive( src );
@@ -1890,6 +2369,7 @@ void KeyValues::CopySubkeys( KeyValues *pParent ) const
 {
 	// recursively copy subkeys
 	// Also maintain ordering....
+	CKeyValuesArenaScope arenaScope( pParent );
 	KeyValues *pPrev = NULL;
 	for ( KeyValues *sub = m_pSub; sub != NULL; sub = sub->m_pPeer )
 	{
@@ -1908,6 +2388,8 @@ void KeyValues::CopySubkeys( KeyValues *pParent ) const
 		dat->m_pPeer = NULL;
 		pPrev = dat;
 	}
+
+	pParent->RebuildChildIndex();
 }
 
 
@@ -1931,7 +2413,7 @@ KeyValues *KeyValues::MakeCopy( void ) const
 			{
 				int len = Q_strlen( m_sValue );
 				Assert( !newKeyValue->m_sValue );
-				newKeyValue->m_sValue = new char[len + 1];
+				newKeyValue->m_sValue = newKeyValue->AllocateValueBlock( len + 1 );
 				Q_memcpy( newKeyValue->m_sValue, m_sValue, len+1 );
 			}
 		}
@@ -1941,7 +2423,7 @@ KeyValues *KeyValues::MakeCopy( void ) const
 			if ( m_wsValue )
 			{
 				int len = Q_wcslen( m_wsValue );
-				newKeyValue->m_wsValue = new wchar_t[len+1];
+				newKeyValue->m_wsValue = (wchar_t *)newKeyValue->AllocateValueBlock( ( len + 1 ) * sizeof( wchar_t ) );
 				Q_memcpy( newKeyValue->m_wsValue, m_wsValue, (len+1)*sizeof(wchar_t));
 			}
 		}
@@ -1967,7 +2449,7 @@ KeyValues *KeyValues::MakeCopy( void ) const
 		break;
 
 	case TYPE_UINT64:
-		newKeyValue->m_sValue = new char[sizeof(uint64)];
+		newKeyValue->m_sValue = newKeyValue->AllocateValueBlock( sizeof(uint64) );
 		Q_memcpy( newKeyValue->m_sValue, m_sValue, sizeof(uint64) );
 		break;
 	};
@@ -2017,8 +2499,12 @@ bool KeyValues::IsEmpty(const char *keyName)
 //-----------------------------------------------------------------------------
 void KeyValues::Clear( void )
 {
-	delete m_pSub;
+	if ( m_pSub )
+	{
+		m_pSub->deleteThis();
+	}
 	m_pSub = NULL;
+	FreeChildIndex();
 	m_iDataType = TYPE_NONE;
 }
 
@@ -2039,6 +2525,12 @@ KeyValues::types_t KeyValues::GetDataType(const char *keyName)
 //-----------------------------------------------------------------------------
 void KeyValues::deleteThis()
 {
+	if ( m_bArenaAllocated )
+	{
+		ReleaseArenaKey();
+		return;
+	}
+
 	delete this;
 }
 
@@ -2172,6 +2664,7 @@ void KeyValues::RecursiveMergeKeyValues( KeyValues *baseKV )
 		// If not merged, append this key
 		if ( !bFoundMatch )
 		{
+			CKeyValuesArenaScope arenaScope( this );
 			KeyValues *dat = baseChild->MakeCopy();
 			Assert( dat );
 			AddSubKey( dat );
@@ -2259,6 +2752,7 @@ bool KeyValues::LoadFromBuffer( char const *resourceName, CUtlBuffer &buf, IBase
 	CUtlVector< KeyValues * > baseKeys;
 	bool wasQuoted;
 	bool wasConditional;
+	CKeyValuesArenaScope arenaScope( this );
 	g_KeyValuesErrorStack.SetFilename( resourceName );	
 	do 
 	{
@@ -2502,11 +2996,7 @@ void KeyValues::RecursiveLoadFromBuffer( char const *resourceName, CUtlBuffer &b
 				break;
 			}
 			
-			if (dat->m_sValue)
-			{
-				delete[] dat->m_sValue;
-				dat->m_sValue = NULL;
-			}
+			dat->FreeAllocatedValue();
 
 			int len = Q_strlen( value );
 
@@ -2546,7 +3036,7 @@ void KeyValues::RecursiveLoadFromBuffer( char const *resourceName, CUtlBuffer &b
 							digit -= 'A' - ( '9' + 1 );
 					retVal = ( retVal * 16 ) + ( digit - '0' );
 				}
-				dat->m_sValue = new char[sizeof(uint64)];
+				dat->m_sValue = dat->AllocateValueBlock( sizeof(uint64) );
 				*((uint64 *)dat->m_sValue) = retVal;
 				dat->m_iDataType = TYPE_UINT64;
 			}
@@ -2568,7 +3058,7 @@ void KeyValues::RecursiveLoadFromBuffer( char const *resourceName, CUtlBuffer &b
 			if (dat->m_iDataType == TYPE_STRING)
 			{
 				// copy in the string information
-				dat->m_sValue = new char[len+1];
+				dat->m_sValue = dat->AllocateValueBlock( len + 1 );
 				Q_memcpy( dat->m_sValue, value, len+1 );
 			}
 
@@ -2604,6 +3094,7 @@ void KeyValues::RecursiveLoadFromBuffer( char const *resourceName, CUtlBuffer &b
 				Assert( pLastChild->m_pPeer == dat );
 				pLastChild->m_pPeer = NULL;
 			}
+			RebuildChildIndex();
 
 			dat->deleteThis();
 			dat = NULL;
@@ -2709,6 +3200,7 @@ bool KeyValues::ReadAsBinary( CUtlBuffer &buffer, int nStackDepth )
 	if ( !buffer.IsValid() ) // must be valid, no overflows etc
 		return false;
 
+	CKeyValuesArenaScope arenaScope( this );
 	RemoveEverything(); // remove current content
 	Init();	// reset
 	
@@ -2751,7 +3243,7 @@ bool KeyValues::ReadAsBinary( CUtlBuffer &buffer, int nStackDepth )
 				token[KEYVALUES_TOKEN_SIZE-1] = 0;
 
 				int len = Q_strlen( token );
-				dat->m_sValue = new char[len + 1];
+				dat->m_sValue = dat->AllocateValueBlock( len + 1 );
 				Q_memcpy( dat->m_sValue, token, len+1 );
 								
 				break;
@@ -2770,7 +3262,7 @@ bool KeyValues::ReadAsBinary( CUtlBuffer &buffer, int nStackDepth )
 
 		case TYPE_UINT64:
 			{
-				dat->m_sValue = new char[sizeof(uint64)];
+				dat->m_sValue = dat->AllocateValueBlock( sizeof(uint64) );
 				*((uint64 *)dat->m_sValue) = buffer.GetInt64();
 				break;
 			}
@@ -2820,12 +3312,20 @@ bool KeyValues::ReadAsBinary( CUtlBuffer &buffer, int nStackDepth )
 //-----------------------------------------------------------------------------
 void *KeyValues::operator new( size_t iAllocSize )
 {
+	CKeyValuesArena *pArena = s_pCurrentArena;
+	if ( pArena )
+		return pArena->AllocKey( iAllocSize );
+
 	MEM_ALLOC_CREDIT();
 	return KeyValuesSystem()->AllocKeyValuesMemory( (int)iAllocSize );
 }
 
 void *KeyValues::operator new( size_t iAllocSize, int nBlockUse, const char *pFileName, int nLine )
 {
+	CKeyValuesArena *pArena = s_pCurrentArena;
+	if ( pArena )
+		return pArena->AllocKey( iAllocSize );
+
 	MemAlloc_PushAllocDbgInfo( pFileName, nLine );
 	void *p = KeyValuesSystem()->AllocKeyValuesMemory( (int)iAllocSize );
 	MemAlloc_PopAllocDbgInfo();
@@ -3016,6 +3516,7 @@ bool KeyValues::ProcessResolutionKeys( const char *pResString )
 
 				// rename the marked key
 				pSubKey->SetName( normalKeyName );
+				RebuildChildIndex();
 			}
 		}
 	}
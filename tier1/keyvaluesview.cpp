@@ -0,0 +1,557 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Flat, position independent form of a KeyValues tree, and a read-only
+//			view that looks keys up in place.
+//
+// $NoKeywords: $
+//=============================================================================//
+
+#include "tier1/keyvaluesview.h"
+#include "tier1/utlbuffer.h"
+#include "tier1/utldict.h"
+#include "tier1/utlvector.h"
+#include "tier1/generichash.h"
+#include "tier1/strtools.h"
+#include "tier0/dbg.h"
+
+// memdbgon must be the last include file in a .cpp file!!!
+#include "tier0/memdbgon.h"
+
+#define KEYVALUES_BLOB_ESCAPE_SEQUENCES		0x1
+#define KEYVALUES_BLOB_CONDITIONALS			0x2
+
+//-----------------------------------------------------------------------------
+// Builds the node array depth first, so children and later siblings always
+// have a higher index than the node that points at them
+//-----------------------------------------------------------------------------
+class CKeyValuesBlobBuilder
+{
+public:
+	CKeyValuesBlobBuilder() : m_Strings( k_eDictCompareTypeCaseSensitive ) {}
+
+	bool AddKeys( KeyValues *pKeyValues, uint32 *pFirst );
+	void Write( CUtlBuffer &buf, uint32 nFlags );
+
+private:
+	uint32 AddString( const char *pString );
+
+	CUtlVector< KeyValuesBlobNode_t > m_Nodes;
+	CUtlDict< uint32, int > m_Strings;
+	CUtlBuffer m_StringPool;
+};
+
+uint32 CKeyValuesBlobBuilder::AddString( const char *pString )
+{
+	if ( !pString )
+	{
+		pString = "";
+	}
+
+	int i = m_Strings.Find( pString );
+	if ( i != m_Strings.InvalidIndex() )
+		return m_Strings[i];
+
+	uint32 nOffset = m_StringPool.TellPut();
+	m_StringPool.Put( pString, V_strlen( pString ) + 1 );
+	m_Strings.Insert( pString, nOffset );
+	return nOffset;
+}
+
+bool CKeyValuesBlobBuilder::AddKeys( KeyValues *pKeyValues, uint32 *pFirst )
+{
+	*pFirst = 0;
+
+	uint32 nPrev = 0;
+	bool bFirst = true;
+	for ( KeyValues *pKey = pKeyValues; pKey; pKey = pKey->GetNextKey() )
+	{
+		uint32 nNode = m_Nodes.AddToTail();
+		if ( bFirst )
+		{
+			*pFirst = nNode;
+			bFirst = false;
+		}
+		else
+		{
+			m_Nodes[nPrev].m_nNext = nNode;
+		}
+		nPrev = nNode;
+
+		KeyValuesBlobNode_t node;
+		memset( &node, 0, sizeof( node ) );
+		node.m_nName = AddString( pKey->GetName() );
+		node.m_nType = pKey->GetDataType();
+
+		switch ( pKey->GetDataType() )
+		{
+		case KeyValues::TYPE_NONE:
+			{
+				// store the node before recursing, the vector may grow
+				m_Nodes[nNode] = node;
+
+				uint32 nChild;
+				if ( !AddKeys( pKey->GetFirstSubKey(), &nChild ) )
+					return false;
+
+				m_Nodes[nNode].m_nValue = nChild;
+				continue;
+			}
+		case KeyValues::TYPE_STRING:
+			node.m_nValue = AddString( pKey->GetString() );
+			break;
+		case KeyValues::TYPE_INT:
+			node.m_nValue = (uint32)pKey->GetInt();
+			break;
+		case KeyValues::TYPE_FLOAT:
+			{
+				float flValue = pKey->GetFloat();
+				memcpy( &node.m_nValue, &flValue, sizeof( node.m_nValue ) );
+			}
+			break;
+		case KeyValues::TYPE_UINT64:
+			{
+				uint64 nValue = pKey->GetUint64();
+				node.m_nValue = (uint32)nValue;
+				node.m_nValueHigh = (uint32)( nValue >> 32 );
+			}
+			break;
+		case KeyValues::TYPE_COLOR:
+			{
+				Color color = pKey->GetColor();
+				node.m_nValue = color.GetRawColor();
+			}
+			break;
+		default:
+			// pointers and wide strings have no meaning outside this process
+			return false;
+		}
+
+		m_Nodes[nNode] = node;
+	}
+
+	return true;
+}
+
+void CKeyValuesBlobBuilder::Write( CUtlBuffer &buf, uint32 nFlags )
+{
+	KeyValuesBlobHeader_t header;
+	header.m_nVersion = KEYVALUES_BLOB_VERSION;
+	header.m_nNodes = m_Nodes.Count();
+	header.m_nStringBytes = m_StringPool.TellPut();
+	header.m_nFlags = nFlags;
+
+	buf.Put( &header, sizeof( header ) );
+	buf.Put( m_Nodes.Base(), m_Nodes.Count() * sizeof( KeyValuesBlobNode_t ) );
+	buf.Put( m_StringPool.Base(), m_StringPool.TellPut() );
+}
+
+bool CompileKeyValuesBlob( KeyValues *pKeyValues, CUtlBuffer &buf )
+{
+	Assert( !buf.IsText() );
+	if ( !pKeyValues || buf.IsText() )
+		return false;
+
+	CKeyValuesBlobBuilder builder;
+	uint32 nRoot;
+	if ( !builder.AddKeys( pKeyValues, &nRoot ) )
+		return false;
+
+	Assert( nRoot == 0 );
+
+	// the flags are only tracked per node, and everything a load creates copies them from the root
+	uint32 nFlags = 0;
+	if ( pKeyValues->HasEscapeSequences() )
+	{
+		nFlags |= KEYVALUES_BLOB_ESCAPE_SEQUENCES;
+	}
+	if ( pKeyValues->EvaluatesConditionals() )
+	{
+		nFlags |= KEYVALUES_BLOB_CONDITIONALS;
+	}
+
+	builder.Write( buf, nFlags );
+	return buf.IsValid();
+}
+
+bool IsValidKeyValuesBlob( const void *pBlob, int nSize )
+{
+	if ( !pBlob || nSize < (int)sizeof( KeyValuesBlobHeader_t ) )
+		return false;
+
+	const KeyValuesBlobHeader_t *pHeader = (const KeyValuesBlobHeader_t *)pBlob;
+	if ( pHeader->m_nVersion != KEYVALUES_BLOB_VERSION || pHeader->m_nNodes == 0 || pHeader->m_nStringBytes == 0 )
+		return false;
+
+	uint64 nExpected = sizeof( KeyValuesBlobHeader_t ) + (uint64)pHeader->m_nNodes * sizeof( KeyValuesBlobNode_t ) + pHeader->m_nStringBytes;
+	if ( nExpected > (uint64)nSize )
+		return false;
+
+	const KeyValuesBlobNode_t *pNodes = (const KeyValuesBlobNode_t *)( pHeader + 1 );
+	const char *pStrings = (const char *)( pNodes + pHeader->m_nNodes );
+	if ( pStrings[pHeader->m_nStringBytes - 1] != 0 )
+		return false;
+
+	// links only ever point forward, so walking a valid blob always terminates
+	for ( uint32 i = 0; i < pHeader->m_nNodes; i++ )
+	{
+		const KeyValuesBlobNode_t &node = pNodes[i];
+		if ( node.m_nName >= pHeader->m_nStringBytes )
+			return false;
+
+		if ( node.m_nNext && ( node.m_nNext <= i || node.m_nNext >= pHeader->m_nNodes ) )
+			return false;
+
+		switch ( node.m_nType )
+		{
+		case KeyValues::TYPE_NONE:
+			if ( node.m_nValue && ( node.m_nValue <= i || node.m_nValue >= pHeader->m_nNodes ) )
+				return false;
+			break;
+		case KeyValues::TYPE_STRING:
+			if ( node.m_nValue >= pHeader->m_nStringBytes )
+				return false;
+			break;
+		case KeyValues::TYPE_INT:
+		case KeyValues::TYPE_FLOAT:
+		case KeyValues::TYPE_UINT64:
+		case KeyValues::TYPE_COLOR:
+			break;
+		default:
+			return false;
+		}
+	}
+
+	return true;
+}
+
+uint64 HashKeyValuesText( const void *pText, int nTextBytes, bool bEscapeSequences, bool bConditionals )
+{
+	// the same text parses differently depending on these
+	uint32 nSeed = KEYVALUES_BLOB_VERSION << 8;
+	if ( bEscapeSequences )
+	{
+		nSeed |= 0x1;
+	}
+	if ( bConditionals )
+	{
+		nSeed |= 0x2;
+		if ( IsSteamDeck() )
+		{
+			nSeed |= 0x4;
+		}
+	}
+
+	return MurmurHash64( pText, nTextBytes, nSeed );
+}
+
+
+//-----------------------------------------------------------------------------
+// CKeyValuesView
+//-----------------------------------------------------------------------------
+const char *CKeyValuesView::GetName() const
+{
+	if ( !m_pBlob )
+		return "";
+
+	return String( Node( m_nNode )->m_nName );
+}
+
+KeyValues::types_t CKeyValuesView::GetDataType( const char *pszKeyName ) const
+{
+	CKeyValuesView key = FindKey( pszKeyName );
+	if ( !key.IsValid() )
+		return KeyValues::TYPE_NONE;
+
+	return (KeyValues::types_t)key.Node( key.m_nNode )->m_nType;
+}
+
+CKeyValuesView CKeyValuesView::FindKey( const char *pszKeyName ) const
+{
+	// return the current key if a NULL subkey is asked for
+	if ( !m_pBlob || !pszKeyName || !pszKeyName[0] )
+		return *this;
+
+	uint32 nNode = m_nNode;
+	const char *pSearch = pszKeyName;
+	for ( ;; )
+	{
+		const char *pSlash = strchr( pSearch, '/' );
+		int nLen = pSlash ? pSlash - pSearch : V_strlen( pSearch );
+
+		const KeyValuesBlobNode_t *pNode = Node( nNode );
+		if ( pNode->m_nType != KeyValues::TYPE_NONE )
+			return CKeyValuesView();
+
+		uint32 nChild = pNode->m_nValue;
+		for ( ; nChild; nChild = Node( nChild )->m_nNext )
+		{
+			const char *pName = String( Node( nChild )->m_nName );
+			if ( !V_strnicmp( pName, pSearch, nLen ) && pName[nLen] == 0 )
+				break;
+		}
+
+		if ( !nChild )
+			return CKeyValuesView();
+
+		if ( !pSlash )
+			return CKeyValuesView( m_pBlob, nChild );
+
+		nNode = nChild;
+		pSearch = pSlash + 1;
+	}
+}
+
+CKeyValuesView CKeyValuesView::GetFirstSubKey() const
+{
+	if ( !m_pBlob )
+		return CKeyValuesView();
+
+	const KeyValuesBlobNode_t *pNode = Node( m_nNode );
+	if ( pNode->m_nType != KeyValues::TYPE_NONE || !pNode->m_nValue )
+		return CKeyValuesView();
+
+	return CKeyValuesView( m_pBlob, pNode->m_nValue );
+}
+
+CKeyValuesView CKeyValuesView::GetNextKey() const
+{
+	if ( !m_pBlob || !Node( m_nNode )->m_nNext )
+		return CKeyValuesView();
+
+	return CKeyValuesView( m_pBlob, Node( m_nNode )->m_nNext );
+}
+
+int CKeyValuesView::GetInt( const char *pszKeyName, int nDefault ) const
+{
+	CKeyValuesView key = FindKey( pszKeyName );
+	if ( !key.IsValid() )
+		return nDefault;
+
+	const KeyValuesBlobNode_t *pNode = key.Node( key.m_nNode );
+	switch ( pNode->m_nType )
+	{
+	case KeyValues::TYPE_STRING:
+		return atoi( key.String( pNode->m_nValue ) );
+	case KeyValues::TYPE_FLOAT:
+		{
+			float flValue;
+			memcpy( &flValue, &pNode->m_nValue, sizeof( flValue ) );
+			return (int)flValue;
+		}
+	case KeyValues::TYPE_UINT64:
+		// can't convert, since it would lose data
+		Assert( 0 );
+		return 0;
+	default:
+		return (int)pNode->m_nValue;
+	}
+}
+
+uint64 CKeyValuesView::GetUint64( const char *pszKeyName, uint64 nDefault ) const
+{
+	CKeyValuesView key = FindKey( pszKeyName );
+	if ( !key.IsValid() )
+		return nDefault;
+
+	const KeyValuesBlobNode_t *pNode = key.Node( key.m_nNode );
+	switch ( pNode->m_nType )
+	{
+	case KeyValues::TYPE_STRING:
+		return (uint64)V_atoi64( key.String( pNode->m_nValue ) );
+	case KeyValues::TYPE_FLOAT:
+		{
+			float flValue;
+			memcpy( &flValue, &pNode->m_nValue, sizeof( flValue ) );
+			return (int)flValue;
+		}
+	case KeyValues::TYPE_UINT64:
+		return ( (uint64)pNode->m_nValueHigh << 32 ) | pNode->m_nValue;
+	default:
+		return (int)pNode->m_nValue;
+	}
+}
+
+float CKeyValuesView::GetFloat( const char *pszKeyName, float flDefault ) const
+{
+	CKeyValuesView key = FindKey( pszKeyName );
+	if ( !key.IsValid() )
+		return flDefault;
+
+	const KeyValuesBlobNode_t *pNode = key.Node( key.m_nNode );
+	switch ( pNode->m_nType )
+	{
+	case KeyValues::TYPE_STRING:
+		return (float)atof( key.String( pNode->m_nValue ) );
+	case KeyValues::TYPE_FLOAT:
+		{
+			float flValue;
+			memcpy( &flValue, &pNode->m_nValue, sizeof( flValue ) );
+			return flValue;
+		}
+	case KeyValues::TYPE_INT:
+		return (float)(int)pNode->m_nValue;
+	case KeyValues::TYPE_UINT64:
+		return (float)( ( (uint64)pNode->m_nValueHigh << 32 ) | pNode->m_nValue );
+	default:
+		return 0.0f;
+	}
+}
+
+bool CKeyValuesView::GetBool( const char *pszKeyName, bool bDefault ) const
+{
+	if ( !FindKey( pszKeyName ).IsValid() )
+		return bDefault;
+
+	return GetInt( pszKeyName, 0 ) != 0;
+}
+
+Color CKeyValuesView::GetColor( const char *pszKeyName ) const
+{
+	Color color( 0, 0, 0, 0 );
+	CKeyValuesView key = FindKey( pszKeyName );
+	if ( !key.IsValid() )
+		return color;
+
+	const KeyValuesBlobNode_t *pNode = key.Node( key.m_nNode );
+	switch ( pNode->m_nType )
+	{
+	case KeyValues::TYPE_COLOR:
+		color.SetRawColor( pNode->m_nValue );
+		break;
+	case KeyValues::TYPE_FLOAT:
+	case KeyValues::TYPE_INT:
+		color[0] = key.GetInt();
+		break;
+	case KeyValues::TYPE_STRING:
+		{
+			// parse the colors out of the string
+			float a = 0.0f, b = 0.0f, c = 0.0f, d = 0.0f;
+			sscanf( key.String( pNode->m_nValue ), "%f %f %f %f", &a, &b, &c, &d );
+			color[0] = (unsigned char)a;
+			color[1] = (unsigned char)b;
+			color[2] = (unsigned char)c;
+			color[3] = (unsigned char)d;
+		}
+		break;
+	}
+	return color;
+}
+
+const char *CKeyValuesView::GetString( const char *pszKeyName, const char *pszDefault, char *pBuf, int nBufSize ) const
+{
+	CKeyValuesView key = FindKey( pszKeyName );
+	if ( !key.IsValid() )
+		return pszDefault;
+
+	const KeyValuesBlobNode_t *pNode = key.Node( key.m_nNode );
+	if ( pNode->m_nType == KeyValues::TYPE_STRING )
+		return key.String( pNode->m_nValue );
+
+	// the blob is read-only, so unlike KeyValues we can't store the converted value
+	if ( !pBuf || nBufSize <= 0 )
+		return pszDefault;
+
+	switch ( pNode->m_nType )
+	{
+	case KeyValues::TYPE_FLOAT:
+		V_snprintf( pBuf, nBufSize, "%f", key.GetFloat() );
+		break;
+	case KeyValues::TYPE_INT:
+		V_snprintf( pBuf, nBufSize, "%d", key.GetInt() );
+		break;
+	case KeyValues::TYPE_UINT64:
+		V_snprintf( pBuf, nBufSize, "%lld", key.GetUint64() );
+		break;
+	default:
+		return pszDefault;
+	}
+	return pBuf;
+}
+
+void CKeyValuesView::CopyValue( KeyValues *pDest, const KeyValuesBlobNode_t *pNode ) const
+{
+	switch ( pNode->m_nType )
+	{
+	case KeyValues::TYPE_STRING:
+		pDest->SetStringValue( String( pNode->m_nValue ) );
+		break;
+	case KeyValues::TYPE_INT:
+		pDest->SetInt( NULL, (int)pNode->m_nValue );
+		break;
+	case KeyValues::TYPE_FLOAT:
+		{
+			float flValue;
+			memcpy( &flValue, &pNode->m_nValue, sizeof( flValue ) );
+			pDest->SetFloat( NULL, flValue );
+		}
+		break;
+	case KeyValues::TYPE_UINT64:
+		pDest->SetUint64( NULL, ( (uint64)pNode->m_nValueHigh << 32 ) | pNode->m_nValue );
+		break;
+	case KeyValues::TYPE_COLOR:
+		{
+			Color color;
+			color.SetRawColor( pNode->m_nValue );
+			pDest->SetColor( NULL, color );
+		}
+		break;
+	case KeyValues::TYPE_NONE:
+		CopySubKeys( pDest, pNode );
+		break;
+	}
+}
+
+void CKeyValuesView::CopySubKeys( KeyValues *pDest, const KeyValuesBlobNode_t *pNode ) const
+{
+	bool bEscapeSequences = ( Header()->m_nFlags & KEYVALUES_BLOB_ESCAPE_SEQUENCES ) != 0;
+	bool bConditionals = ( Header()->m_nFlags & KEYVALUES_BLOB_CONDITIONALS ) != 0;
+
+	KeyValues *pLastChild = pDest->FindLastSubKey();
+	for ( uint32 nChild = pNode->m_nValue; nChild; nChild = Node( nChild )->m_nNext )
+	{
+		const KeyValuesBlobNode_t *pChild = Node( nChild );
+
+		KeyValues *pKey = new KeyValues( String( pChild->m_nName ) );
+		pKey->UsesEscapeSequences( bEscapeSequences );
+		pKey->UsesConditionals( bConditionals );
+		CopyValue( pKey, pChild );
+
+		pDest->AddSubkeyUsingKnownLastChild( pKey, pLastChild );
+		pLastChild = pKey;
+	}
+}
+
+bool CKeyValuesView::CopyTo( KeyValues *pDest, bool bPeers ) const
+{
+	if ( !m_pBlob || !pDest )
+		return false;
+
+	// new keys go wherever pDest lives
+	CKeyValuesArenaScope arenaScope( pDest );
+
+	const KeyValuesBlobNode_t *pNode = Node( m_nNode );
+	pDest->SetName( String( pNode->m_nName ) );
+	CopyValue( pDest, pNode );
+
+	if ( !bPeers )
+		return true;
+
+	bool bEscapeSequences = ( Header()->m_nFlags & KEYVALUES_BLOB_ESCAPE_SEQUENCES ) != 0;
+	bool bConditionals = ( Header()->m_nFlags & KEYVALUES_BLOB_CONDITIONALS ) != 0;
+
+	KeyValues *pPrevious = pDest;
+	for ( uint32 nPeer = pNode->m_nNext; nPeer; nPeer = Node( nPeer )->m_nNext )
+	{
+		const KeyValuesBlobNode_t *pPeer = Node( nPeer );
+
+		KeyValues *pKey = new KeyValues( String( pPeer->m_nName ) );
+		pKey->UsesEscapeSequences( bEscapeSequences );
+		pKey->UsesConditionals( bConditionals );
+		CopyValue( pKey, pPeer );
+
+		pPrevious->SetNextKey( pKey );
+		pPrevious = pKey;
+	}
+
+	return true;
+}
@@ -0,0 +1,128 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Unit test for ParallelProcess and ParallelLoopProcess item
+//			distribution, and a throughput comparison against the old
+//			single shared counter distribution.
+//
+// $NoKeywords: $
+//=============================================================================//
+
+#include "unitlib/unitlib.h"
+#include "vstdlib/jobthread.h"
+#include "tier1/utlvector.h"
+
+
+DEFINE_TESTSUITE( JobThreadTestSuite )
+
+// includes counts below, at and just above the number of threads
+static const int s_ItemCounts[] = { 1, 3, 4, 5, 1000, 10000 };
+static const int s_ThreadCounts[] = { 2, 4, 64 };
+static const int s_nRuns = 3;
+
+static void ProcessTinyItem( uint32 &item )
+{
+	item = item * 3 + 1;
+}
+
+static uint32 *s_pLoopItems;
+
+static void ProcessTinyLoopItem( long const &i )
+{
+	s_pLoopItems[i] = s_pLoopItems[i] * 3 + 1;
+}
+
+// Every item must have been processed exactly once per run
+static bool CheckItems( const CUtlVector<uint32> &items )
+{
+	for ( int i = 0; i < items.Count(); i++ )
+	{
+		uint32 expected = i;
+		for ( int nRun = 0; nRun < s_nRuns; nRun++ )
+		{
+			expected = expected * 3 + 1;
+		}
+
+		if ( items[i] != expected )
+			return false;
+	}
+	return true;
+}
+
+static void ResetItems( CUtlVector<uint32> &items, int nItems )
+{
+	items.SetCount( nItems );
+	for ( int i = 0; i < nItems; i++ )
+	{
+		items[i] = i;
+	}
+}
+
+DEFINE_TESTCASE( JobThreadParallelProcessTest, JobThreadTestSuite )
+{
+	CUtlVector<uint32> items;
+
+	for ( int iThreads = 0; iThreads < ( int )ARRAYSIZE( s_ThreadCounts ); iThreads++ )
+	{
+		int nThreads = s_ThreadCounts[iThreads];
+
+		// the calling thread works too
+		IThreadPool *pPool = CreateThreadPool();
+		ThreadPoolStartParams_t params;
+		params.nThreads = nThreads - 1;
+		pPool->Start( params );
+
+		for ( int iItems = 0; iItems < ( int )ARRAYSIZE( s_ItemCounts ); iItems++ )
+		{
+			int nItems = s_ItemCounts[iItems];
+			ResetItems( items, nItems );
+
+			for ( int nRun = 0; nRun < s_nRuns; nRun++ )
+			{
+				ParallelProcess( "JobThreadParallelProcessTest", pPool, items.Base(), nItems, &ProcessTinyItem );
+			}
+
+			Shipping_Assert( CheckItems( items ) );
+		}
+
+		pPool->Stop();
+		DestroyThreadPool( pPool );
+	}
+}
+
+DEFINE_TESTCASE( JobThreadParallelLoopProcessTest, JobThreadTestSuite )
+{
+	CUtlVector<uint32> items;
+
+	for ( int iThreads = 0; iThreads < ( int )ARRAYSIZE( s_ThreadCounts ); iThreads++ )
+	{
+		int nThreads = s_ThreadCounts[iThreads];
+
+		// ParallelLoopProcess always runs on g_pThreadPool
+		ThreadPoolStartParams_t params;
+		params.nThreads = nThreads - 1;
+		g_pThreadPool->Start( params );
+
+		for ( int iItems = 0; iItems < ( int )ARRAYSIZE( s_ItemCounts ); iItems++ )
+		{
+			int nItems = s_ItemCounts[iItems];
+			ResetItems( items, nItems );
+			s_pLoopItems = items.Base();
+
+			for ( int nRun = 0; nRun < s_nRuns; nRun++ )
+			{
+				ParallelLoopProcess( "JobThreadParallelLoopProcessTest", 0, nItems, &ProcessTinyLoopItem );
+			}
+
+			Shipping_Assert( CheckItems( items ) );
+		}
+
+		g_pThreadPool->Stop();
+	}
+}
+
+// Prints shared counter vs. work stealing timings for 2-64 threads, the
+// numbers vary by machine so only the output is checked by hand
+DEFINE_TESTCASE( JobThreadParallelProcessBenchmark, JobThreadTestSuite )
+{
+	RunParallelProcessBenchmark( 10000, 20 );
+}
@@ -0,0 +1,203 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Unit test for arena allocated KeyValues trees and child indexes
+//
+// $NoKeywords: $
+//=============================================================================//
+
+#include "tier0/dbg.h"
+#include "unitlib/unitlib.h"
+#include "tier1/KeyValues.h"
+#include "tier1/utlbuffer.h"
+#include "tier1/strtools.h"
+#include "keyvaluestesthelpers.h"
+
+DEFINE_TESTSUITE( KeyValuesArenaTestSuite )
+
+static const char *s_pTestFile =
+	"\"Sounds\"\n"
+	"{\n"
+	"	\"Weapon.Fire\"\n"
+	"	{\n"
+	"		\"channel\"	\"CHAN_WEAPON\"\n"
+	"		\"volume\"	\"0.7\"\n"
+	"		\"pitch\"	\"100\"\n"
+	"		\"wave\"	\"weapons/fire.wav\"\n"
+	"	}\n"
+	"	\"Weapon.Reload\"\n"
+	"	{\n"
+	"		\"wave\"	\"weapons/reload.wav\"\n"
+	"	}\n"
+	"}\n"
+	"\"Peer\"\n"
+	"{\n"
+	"	\"key\"	\"value\"\n"
+	"}\n";
+
+static bool AllKeysInArena( KeyValues *pKey, bool bArena )
+{
+	for ( ; pKey; pKey = pKey->GetNextKey() )
+	{
+		if ( pKey->IsArenaAllocated() != bArena || !AllKeysInArena( pKey->GetFirstSubKey(), bArena ) )
+			return false;
+	}
+	return true;
+}
+
+static void ArenaTests()
+{
+	KeyValues *pHeap = new KeyValues( "test" );
+	Shipping_Assert( pHeap->LoadFromBuffer( "test", s_pTestFile ) );
+	Shipping_Assert( !pHeap->IsArenaAllocated() );
+
+	// a small block size so the tree spans several blocks
+	KeyValues *pArena = KeyValues::CreateArenaTree( "test", 256 );
+	Shipping_Assert( pArena->LoadFromBuffer( "test", s_pTestFile ) );
+	Shipping_Assert( AllKeysInArena( pArena, true ) );
+	Shipping_Assert( CompareKeys( pHeap, pArena ) );
+
+	// values set later come from the arena as well
+	pArena->SetString( "Weapon.Reload/channel", "CHAN_ITEM" );
+	pArena->SetWString( "Weapon.Reload/wide", L"wide" );
+	pArena->SetUint64( "Weapon.Reload/big", 0x123456789ABCDEF0ull );
+	Shipping_Assert( pArena->FindKey( "Weapon.Reload/channel" )->IsArenaAllocated() );
+	Shipping_Assert( !V_strcmp( pArena->GetString( "Weapon.Reload/channel" ), "CHAN_ITEM" ) );
+	Shipping_Assert( !V_wcscmp( pArena->GetWString( "Weapon.Reload/wide" ), L"wide" ) );
+	Shipping_Assert( pArena->GetUint64( "Weapon.Reload/big" ) == 0x123456789ABCDEF0ull );
+
+	// copies of an arena tree are ordinary keys, copies into an arena tree stay in the arena
+	KeyValues *pCopy = pArena->MakeCopy( true );
+	Shipping_Assert( AllKeysInArena( pCopy, false ) );
+	Shipping_Assert( CompareKeys( pCopy, pArena ) );
+
+	KeyValues *pCopyTarget = pArena->FindKey( "Copy", true );
+	pHeap->CopySubkeys( pCopyTarget );
+	Shipping_Assert( AllKeysInArena( pCopyTarget, true ) );
+	Shipping_Assert( CompareKeys( pCopyTarget->GetFirstSubKey(), pHeap->GetFirstSubKey() ) );
+
+	// deleting keys inside the tree frees nothing, the root frees everything
+	KeyValues *pReload = pArena->FindKey( "Weapon.Reload" );
+	pArena->RemoveSubKey( pReload );
+	pReload->deleteThis();
+	Shipping_Assert( !pArena->FindKey( "Weapon.Reload" ) );
+	pArena->FindKey( "Weapon.Fire" )->Clear();
+
+	// keys that didn't come from the arena still get deleted with it
+	pArena->AddSubKey( new KeyValues( "heap", "key", "value" ) );
+	Shipping_Assert( !pArena->FindKey( "heap" )->IsArenaAllocated() );
+	Shipping_Assert( !V_strcmp( pArena->GetString( "heap/key" ), "value" ) );
+	pArena->deleteThis();
+
+	// and an arena tree below an ordinary key is freed with it
+	KeyValues *pArenaChild = KeyValues::CreateArenaTree( "child" );
+	pArenaChild->SetInt( "int", 5 );
+	pCopy->AddSubKey( pArenaChild );
+	Shipping_Assert( pCopy->GetInt( "child/int" ) == 5 );
+	pCopy->deleteThis();
+
+	// binary round trip
+	CUtlBuffer buf;
+	Shipping_Assert( pHeap->WriteAsBinary( buf ) );
+	KeyValues *pBinary = KeyValues::CreateArenaTree( "" );
+	Shipping_Assert( pBinary->ReadAsBinary( buf ) );
+	Shipping_Assert( AllKeysInArena( pBinary, true ) );
+	Shipping_Assert( CompareKeys( pHeap, pBinary ) );
+	pBinary->deleteThis();
+
+	// keys built by hand inside a scope go where the scope says
+	KeyValues *pScoped = KeyValues::CreateArenaTree( "scoped" );
+	{
+		CKeyValuesArenaScope arenaScope( pScoped );
+		KeyValues *pKey = new KeyValues( "key" );
+		Shipping_Assert( pKey->IsArenaAllocated() );
+		pScoped->AddSubKey( pKey );
+
+		CKeyValuesArenaScope heapScope( NULL );
+		KeyValues *pHeapKey = new KeyValues( "heap" );
+		Shipping_Assert( !pHeapKey->IsArenaAllocated() );
+		pHeapKey->deleteThis();
+	}
+	pScoped->deleteThis();
+
+	pHeap->deleteThis();
+}
+
+static void IndexTests( KeyValues *pRoot )
+{
+	const int nKeys = 200;
+	char szName[32];
+	for ( int i = 0; i < nKeys; i++ )
+	{
+		V_snprintf( szName, sizeof( szName ), "key%d", i );
+		pRoot->SetInt( szName, i );
+	}
+
+	// a duplicate name, FindKey keeps returning the first one
+	KeyValues *pDuplicate = pRoot->CreateNewKey();
+	pDuplicate->SetName( "key7" );
+	pDuplicate->SetInt( NULL, -1 );
+
+	KeyValues *pSmall = pRoot->FindKey( "small", true );
+	pSmall->SetInt( "a", 1 );
+
+	pRoot->BuildChildIndexes( 16 );
+
+	for ( int i = 0; i < nKeys; i++ )
+	{
+		V_snprintf( szName, sizeof( szName ), "key%d", i );
+		Shipping_Assert( pRoot->GetInt( szName, -2 ) == i );
+		Shipping_Assert( pRoot->FindKey( KeyValues::CallGetSymbolForString( szName ) ) == pRoot->FindKey( szName ) );
+	}
+	Shipping_Assert( !pRoot->FindKey( "missing" ) );
+	Shipping_Assert( pRoot->GetInt( "small/a" ) == 1 );
+
+	// keys added through the parent are found, and in order
+	for ( int i = nKeys; i < nKeys * 2; i++ )
+	{
+		V_snprintf( szName, sizeof( szName ), "key%d", i );
+		pRoot->SetInt( szName, i );
+	}
+	pRoot->AddSubKey( new KeyValues( "added", "key", 3 ) );
+	Shipping_Assert( pRoot->GetInt( "key399" ) == 399 );
+	Shipping_Assert( pRoot->GetInt( "added/key" ) == 3 );
+
+	int nFound = 0;
+	int nLast = -1;
+	FOR_EACH_SUBKEY( pRoot, pKey )
+	{
+		if ( !V_strncmp( pKey->GetName(), "key", 3 ) && pKey != pDuplicate )
+		{
+			Shipping_Assert( pKey->GetInt() == nLast + 1 );
+			nLast = pKey->GetInt();
+			nFound++;
+		}
+	}
+	Shipping_Assert( nFound == nKeys * 2 );
+	Shipping_Assert( !V_strcmp( pRoot->FindLastSubKey()->GetName(), "added" ) );
+
+	// removing the first duplicate uncovers the second
+	KeyValues *pFirst = pRoot->FindKey( "key7" );
+	pRoot->RemoveSubKey( pFirst );
+	pFirst->deleteThis();
+	Shipping_Assert( pRoot->FindKey( "key7" ) == pDuplicate );
+
+	pRoot->Clear();
+	Shipping_Assert( !pRoot->FindKey( "key0" ) );
+	pRoot->SetInt( "key0", 1 );
+	Shipping_Assert( pRoot->GetInt( "key0" ) == 1 );
+}
+
+DEFINE_TESTCASE( KeyValuesArenaTest, KeyValuesArenaTestSuite )
+{
+	Msg( "Running KeyValues arena tests\n" );
+
+	ArenaTests();
+
+	KeyValues *pHeap = new KeyValues( "index" );
+	IndexTests( pHeap );
+	pHeap->deleteThis();
+
+	KeyValues *pArena = KeyValues::CreateArenaTree( "index" );
+	IndexTests( pArena );
+	pArena->deleteThis();
+}
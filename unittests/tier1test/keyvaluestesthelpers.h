@@ -0,0 +1,38 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Helpers shared by the KeyValues unit tests
+//
+// $NoKeywords: $
+//=============================================================================//
+
+#ifndef KEYVALUESTESTHELPERS_H
+#define KEYVALUESTESTHELPERS_H
+#ifdef _WIN32
+#pragma once
+#endif
+
+#include "tier1/KeyValues.h"
+#include "tier1/strtools.h"
+
+// True if both peer lists have the same names, types and values, subkeys included
+inline bool CompareKeys( KeyValues *pA, KeyValues *pB )
+{
+	for ( ; pA && pB; pA = pA->GetNextKey(), pB = pB->GetNextKey() )
+	{
+		if ( V_strcmp( pA->GetName(), pB->GetName() ) || pA->GetDataType() != pB->GetDataType() )
+			return false;
+
+		if ( pA->GetDataType() == KeyValues::TYPE_NONE )
+		{
+			if ( !CompareKeys( pA->GetFirstSubKey(), pB->GetFirstSubKey() ) )
+				return false;
+		}
+		else if ( V_strcmp( pA->GetString(), pB->GetString() ) )
+		{
+			return false;
+		}
+	}
+	return !pA && !pB;
+}
+
+#endif // KEYVALUESTESTHELPERS_H
@@ -0,0 +1,135 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Unit test for compiled KeyValues blobs and CKeyValuesView
+//
+// $NoKeywords: $
+//=============================================================================//
+
+#include "tier0/dbg.h"
+#include "unitlib/unitlib.h"
+#include "tier1/keyvaluesview.h"
+#include "tier1/utlbuffer.h"
+#include "keyvaluestesthelpers.h"
+
+DEFINE_TESTSUITE( KeyValuesViewTestSuite )
+
+static const char *s_pTestFile =
+	"\"LightmappedGeneric\"\n"
+	"{\n"
+	"	\"$basetexture\"	\"brick/brickwall001a\"\n"
+	"	\"$surfaceprop\"	\"brick\"\n"
+	"	\"$detailscale\"	\"4\"\n"
+	"	\"$envmaptint\"	\"0.25\"\n"
+	"	\"Proxies\"\n"
+	"	{\n"
+	"		\"Sine\"\n"
+	"		{\n"
+	"			\"sineperiod\"	\"2\"\n"
+	"			\"resultVar\"	\"$alpha\"\n"
+	"		}\n"
+	"	}\n"
+	"}\n"
+	"\"Peer\"\n"
+	"{\n"
+	"	\"empty\"	\"\"\n"
+	"}\n";
+
+static void CompileTests()
+{
+	KeyValues *pKeyValues = new KeyValues( "test" );
+	Shipping_Assert( pKeyValues->LoadFromBuffer( "test", s_pTestFile ) );
+
+	CUtlBuffer buf;
+	Shipping_Assert( CompileKeyValuesBlob( pKeyValues, buf ) );
+	Shipping_Assert( IsValidKeyValuesBlob( buf.Base(), buf.TellPut() ) );
+
+	// truncated or damaged blobs must be caught
+	Shipping_Assert( !IsValidKeyValuesBlob( buf.Base(), buf.TellPut() - 1 ) );
+	KeyValuesBlobNode_t *pRoot = (KeyValuesBlobNode_t *)( (uint8 *)buf.Base() + sizeof( KeyValuesBlobHeader_t ) );
+	uint32 nNext = pRoot->m_nNext;
+	pRoot->m_nNext = 0xFFFF;
+	Shipping_Assert( !IsValidKeyValuesBlob( buf.Base(), buf.TellPut() ) );
+	pRoot->m_nNext = nNext;
+
+	// rebuilding the tree gives the same keys, peers included
+	KeyValues *pCopy = new KeyValues( "" );
+	Shipping_Assert( CKeyValuesView( buf.Base() ).CopyTo( pCopy, true ) );
+	Shipping_Assert( CompareKeys( pKeyValues, pCopy ) );
+
+	pCopy->deleteThis();
+	pKeyValues->deleteThis();
+
+	// pointers can't be compiled
+	KeyValues *pPtr = new KeyValues( "ptr" );
+	pPtr->SetPtr( "p", &buf );
+	CUtlBuffer ptrBuf;
+	Shipping_Assert( !CompileKeyValuesBlob( pPtr, ptrBuf ) );
+	pPtr->deleteThis();
+}
+
+static void ViewTests()
+{
+	KeyValues *pKeyValues = new KeyValues( "test" );
+	Shipping_Assert( pKeyValues->LoadFromBuffer( "test", s_pTestFile ) );
+	pKeyValues->SetUint64( "big", 0x123456789ABCDEF0ull );
+	pKeyValues->SetColor( "color", Color( 1, 2, 3, 4 ) );
+
+	CUtlBuffer buf;
+	Shipping_Assert( CompileKeyValuesBlob( pKeyValues, buf ) );
+	pKeyValues->deleteThis();
+
+	CKeyValuesView view( buf.Base() );
+	Shipping_Assert( !V_strcmp( view.GetName(), "LightmappedGeneric" ) );
+	Shipping_Assert( !V_strcmp( view.GetString( "$BaseTexture" ), "brick/brickwall001a" ) );
+	Shipping_Assert( view.GetInt( "$detailscale" ) == 4 );
+	Shipping_Assert( view.GetFloat( "$envmaptint" ) == 0.25f );
+	Shipping_Assert( view.GetUint64( "big" ) == 0x123456789ABCDEF0ull );
+	Shipping_Assert( view.GetColor( "color" ) == Color( 1, 2, 3, 4 ) );
+	Shipping_Assert( view.GetInt( "missing", 7 ) == 7 );
+	Shipping_Assert( !V_strcmp( view.GetString( "missing", "default" ), "default" ) );
+	Shipping_Assert( view.GetBool( "$detailscale" ) );
+
+	// numbers need a buffer to come back as strings
+	char szBuf[64];
+	Shipping_Assert( !V_strcmp( view.GetString( "$detailscale", "none" ), "none" ) );
+	Shipping_Assert( !V_strcmp( view.GetString( "$detailscale", "none", szBuf, sizeof( szBuf ) ), "4" ) );
+
+	// paths and iteration
+	Shipping_Assert( !V_strcmp( view.GetString( "proxies/sine/resultvar" ), "$alpha" ) );
+	Shipping_Assert( view.GetInt( "proxies/sine/sineperiod" ) == 2 );
+	Shipping_Assert( !view.FindKey( "proxies/cosine" ).IsValid() );
+	Shipping_Assert( !view.FindKey( "$surfaceprop/child" ).IsValid() );
+	Shipping_Assert( view.GetDataType( "proxies" ) == KeyValues::TYPE_NONE );
+
+	int nKeys = 0;
+	for ( CKeyValuesView key = view.GetFirstSubKey(); key.IsValid(); key = key.GetNextKey() )
+	{
+		nKeys++;
+	}
+	Shipping_Assert( nKeys == 7 );
+
+	CKeyValuesView peer = view.GetNextKey();
+	Shipping_Assert( !V_strcmp( peer.GetName(), "Peer" ) );
+	Shipping_Assert( peer.GetDataType( "empty" ) == KeyValues::TYPE_STRING );
+	Shipping_Assert( !V_strcmp( peer.GetString( "empty", "default" ), "" ) );
+	Shipping_Assert( !peer.GetNextKey().IsValid() );
+}
+
+static void HashTests()
+{
+	int nLen = V_strlen( s_pTestFile );
+	uint64 nHash = HashKeyValuesText( s_pTestFile, nLen, false, true );
+	Shipping_Assert( nHash == HashKeyValuesText( s_pTestFile, nLen, false, true ) );
+	Shipping_Assert( nHash != HashKeyValuesText( s_pTestFile, nLen, true, true ) );
+	Shipping_Assert( nHash != HashKeyValuesText( s_pTestFile, nLen, false, false ) );
+	Shipping_Assert( nHash != HashKeyValuesText( s_pTestFile, nLen - 1, false, true ) );
+}
+
+DEFINE_TESTCASE( KeyValuesViewTest, KeyValuesViewTestSuite )
+{
+	Msg( "Running KeyValues view tests\n" );
+
+	CompileTests();
+	ViewTests();
+	HashTests();
+}
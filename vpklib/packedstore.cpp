@@ -23,6 +23,13 @@
 #include <windows.h>
 #endif
 
+#ifdef POSIX
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 // memdbgon must be the last include file in a .cpp file!!!
 #include "tier0/memdbgon.h"
 
@@ -153,13 +160,68 @@ static inline int SkipAllFilesInDir( char const * & pData )
 }
 
 
-CFileHeaderFixedData *CPackedStore::FindFileEntry( char const *pDirname, char const *pBaseName, char const *pExtension, uint8 **pExtBaseOut , uint8 **pNameBaseOut )
+// 64 bit FNV-1a over "dir/base.ext", fed a component at a time so lookups don't have to
+// assemble the path. Paths in a VPK are lowercase, so this is case sensitive.
+static inline uint64 HashPackedPathComponent( uint64 nHash, char const *pString )
+{
+	while ( *pString )
+	{
+		nHash ^= (uint8)*( pString++ );
+		nHash *= 0x100000001b3ull;
+	}
+	return nHash;
+}
+
+static uint64 HashPackedPath( char const *pDirname, char const *pBaseName, char const *pExtension )
+{
+	uint64 nHash = 0xcbf29ce484222325ull;
+	nHash = HashPackedPathComponent( nHash, pDirname );
+	nHash = HashPackedPathComponent( nHash, "/" );
+	nHash = HashPackedPathComponent( nHash, pBaseName );
+	nHash = HashPackedPathComponent( nHash, "." );
+	return HashPackedPathComponent( nHash, pExtension );
+}
+
+// Scrambles the path hash with a seed, used to pick buckets and slots
+static FORCEINLINE uint64 MixPackedPathHash( uint64 nHash, uint32 nSeed )
+{
+	nHash += nSeed * 0x9e3779b97f4a7c15ull;
+	nHash ^= nHash >> 30;
+	nHash *= 0xbf58476d1ce4e5b9ull;
+	nHash ^= nHash >> 27;
+	nHash *= 0x94d049bb133111ebull;
+	nHash ^= nHash >> 31;
+	return nHash;
+}
+
+CFileHeaderFixedData *CPackedStore::FindFileEntry( char const *pDirname, char const *pBaseName, char const *pExtension, uint8 **pNameBaseOut )
 {
-	if ( pExtBaseOut )
-		*pExtBaseOut = NULL;
 	if ( pNameBaseOut )
 		*pNameBaseOut = NULL;
 
+	if ( m_PathHashEntries.Count() )
+	{
+		uint64 nPathHash = HashPackedPath( pDirname, pBaseName, pExtension );
+		int32 nSeed = m_PathHashSeeds[ MixPackedPathHash( nPathHash, 0 ) % (uint64)m_PathHashSeeds.Count() ];
+		int nSlot = ( nSeed < 0 ) ? -nSeed - 1 : MixPackedPathHash( nPathHash, nSeed ) % (uint64)m_PathHashEntries.Count();
+
+		// every path lands on some slot, so misses are only caught by comparing
+		PackedPathEntry_t const &entry = m_PathHashEntries[nSlot];
+		if ( entry.m_nHashCheck != (uint32)nPathHash )
+			return NULL;
+
+		char const *pData = reinterpret_cast< char const *>( DirectoryData() );
+		PackedPathDir_t const &dir = m_PathHashDirs[entry.m_nDirIndex];
+		if ( V_strcmp( pData + entry.m_nNameOffset, pBaseName ) ||
+			 V_strcmp( pData + dir.m_nDirOffset, pDirname ) ||
+			 V_strcmp( pData + dir.m_nExtOffset, pExtension ) )
+			return NULL;
+
+		if ( pNameBaseOut )
+			*pNameBaseOut = (uint8 *)( pData + entry.m_nNameOffset );
+		return ( CFileHeaderFixedData * )( pData + entry.m_nNameOffset + 1 + V_strlen( pData + entry.m_nNameOffset ) );
+	}
+
 	int nExtensionHash = HashString( pExtension ) % PACKEDFILE_EXT_HASH_SIZE;
 	CFileExtensionData const *pExt = m_pExtensionData[nExtensionHash].FindNamedNodeCaseSensitive( pExtension );
 	if ( pExt )
@@ -168,8 +230,6 @@ CFileHeaderFixedData *CPackedStore::FindFileEntry( char const *pDirname, char co
 		CFileDirectoryData const *pDir = pExt->m_pDirectoryHashTable[nDirHash].FindNamedNodeCaseSensitive( pDirname );
 		if ( pDir )
 		{
-			if ( pExtBaseOut )
-				*pExtBaseOut = (uint8 *) pDir;
 			// we found the right directory. now, sequential search. data is heavily packed, so
 			// this is a little awkward. See fileformat.txt
 			char const *pData = pDir->m_Name;
@@ -222,15 +282,217 @@ void CPackedStore::Init( void )
 	m_Signature.Purge();
 	m_SignaturePrivateKey.Purge();
 	m_SignaturePublicKey.Purge();
+
+	m_bUseMemoryMapping = false;
+	memset( (void *)m_pMappedChunks, 0, sizeof( m_pMappedChunks ) );
 }
    
 void CPackedStore::BuildHashTables( void )
 {
 	m_nHighestChunkFileIndex = -1;
-	for( int i = 0; i < ARRAYSIZE( m_pExtensionData ) ; i++ )
+	PurgeExtensionHashTables();
+	m_PathHashSeeds.Purge();
+	m_PathHashEntries.Purge();
+	m_PathHashDirs.Purge();
+
+	// gather every file, in directory order
+	CUtlVector<uint64> pathHashes;
+	char const *pBase = reinterpret_cast< char const *>( DirectoryData() );
+	char const *pData = pBase;
+	while( *pData )
 	{
-		m_pExtensionData[i].Purge();
+		// for each extension
+		char const *pExt = pData;
+		pData += 1 + strlen( pData );
+		// now, iterate over all directories associated with this extension
+		while( *pData )
+		{
+			PackedPathDir_t dir;
+			dir.m_nExtOffset = pExt - pBase;
+			dir.m_nDirOffset = pData - pBase;
+			int nDirIndex = m_PathHashDirs.AddToTail( dir );
+			char const *pDir = pData;
+			pData += 1 + strlen( pData );
+			while( *pData )
+			{
+				PackedPathEntry_t &entry = m_PathHashEntries[ m_PathHashEntries.AddToTail() ];
+				entry.m_nNameOffset = pData - pBase;
+				entry.m_nDirIndex = nDirIndex;
+				pathHashes.AddToTail( HashPackedPath( pDir, pData, pExt ) );
+				int nFileChunk = SkipFile( pData );
+				m_nHighestChunkFileIndex = MAX( m_nHighestChunkFileIndex, nFileChunk );
+			}
+			// step past \0
+			pData++;
+		}
+		// step past \0
+		pData++;
+	}
+
+	if ( !BuildPathHash( pathHashes ) )
+	{
+		// duplicate paths (or a 64 bit hash collision), fall back to the per-extension tables
+		Warning( "Couldn't build path hash for %s, using slower lookups\n", m_pszFullPathName );
+		BuildExtensionHashTables();
+	}
+}
+
+// Hash and displace: keys are spread over as many buckets as there are keys, and the biggest
+// buckets are placed first, each searching for a seed that sends all its keys to free slots.
+// Single key buckets go into whatever slots are left and record the slot directly. Fewer,
+// bigger buckets would save seed memory but make the search crawl as the table fills up.
+// Reorders m_PathHashEntries so each file sits in its slot.
+bool CPackedStore::BuildPathHash( CUtlVector<uint64> &pathHashes )
+{
+	const int nKeys = pathHashes.Count();
+	if ( !nKeys )
+		return true;
+
+	const int nMaxSeed = 1 << 20;
+	const int nBuckets = nKeys;
+
+	// counting sort of the keys by bucket
+	CUtlVector<int> bucketStart;
+	bucketStart.SetCount( nBuckets + 1 );
+	memset( bucketStart.Base(), 0, bucketStart.Count() * sizeof( int ) );
+	CUtlVector<int> keyBucket;
+	keyBucket.SetCount( nKeys );
+	for ( int i = 0; i < nKeys; i++ )
+	{
+		keyBucket[i] = MixPackedPathHash( pathHashes[i], 0 ) % (uint64)nBuckets;
+		bucketStart[ keyBucket[i] + 1 ]++;
+	}
+	int nLargestBucket = 0;
+	for ( int i = 0; i < nBuckets; i++ )
+	{
+		nLargestBucket = MAX( nLargestBucket, bucketStart[i + 1] );
+		bucketStart[i + 1] += bucketStart[i];
+	}
+	CUtlVector<int> bucketKeys;
+	bucketKeys.SetCount( nKeys );
+	{
+		CUtlVector<int> bucketFill;
+		bucketFill.CopyArray( bucketStart.Base(), nBuckets );
+		for ( int i = 0; i < nKeys; i++ )
+		{
+			bucketKeys[ bucketFill[ keyBucket[i] ]++ ] = i;
+		}
+	}
+
+	// and of the buckets by size, biggest first
+	CUtlVector<int> bucketOrder;
+	bucketOrder.SetCount( nBuckets );
+	{
+		CUtlVector<int> sizeStart;
+		sizeStart.SetCount( nLargestBucket + 2 );
+		memset( sizeStart.Base(), 0, sizeStart.Count() * sizeof( int ) );
+		for ( int i = 0; i < nBuckets; i++ )
+		{
+			sizeStart[ nLargestBucket - ( bucketStart[i + 1] - bucketStart[i] ) + 1 ]++;
+		}
+		for ( int i = 0; i <= nLargestBucket; i++ )
+		{
+			sizeStart[i + 1] += sizeStart[i];
+		}
+		for ( int i = 0; i < nBuckets; i++ )
+		{
+			bucketOrder[ sizeStart[ nLargestBucket - ( bucketStart[i + 1] - bucketStart[i] ) ]++ ] = i;
+		}
+	}
+
+	m_PathHashSeeds.SetCount( nBuckets );
+	memset( m_PathHashSeeds.Base(), 0, nBuckets * sizeof( int32 ) );
+
+	CUtlVector<int> slotKey;
+	slotKey.SetCount( nKeys );
+	for ( int i = 0; i < nKeys; i++ )
+	{
+		slotKey[i] = -1;
+	}
+
+	CUtlVector<int> bucketSlots;
+	bucketSlots.SetCount( nLargestBucket );
+
+	int nOrder = 0;
+	for ( ; nOrder < nBuckets; nOrder++ )
+	{
+		int nBucket = bucketOrder[nOrder];
+		int nFirst = bucketStart[nBucket];
+		int nSize = bucketStart[nBucket + 1] - nFirst;
+		if ( nSize <= 1 )
+			break;
+
+		int nSeed = 1;
+		for ( ; nSeed < nMaxSeed; nSeed++ )
+		{
+			int nPlaced = 0;
+			for ( ; nPlaced < nSize; nPlaced++ )
+			{
+				int nSlot = MixPackedPathHash( pathHashes[ bucketKeys[nFirst + nPlaced] ], nSeed ) % (uint64)nKeys;
+				if ( slotKey[nSlot] != -1 )
+					break;
+
+				int j = 0;
+				while ( j < nPlaced && bucketSlots[j] != nSlot )
+				{
+					j++;
+				}
+				if ( j < nPlaced )
+					break;
+
+				bucketSlots[nPlaced] = nSlot;
+			}
+
+			if ( nPlaced == nSize )
+				break;
+		}
+
+		if ( nSeed == nMaxSeed )
+			return false;
+
+		m_PathHashSeeds[nBucket] = nSeed;
+		for ( int i = 0; i < nSize; i++ )
+		{
+			slotKey[ bucketSlots[i] ] = bucketKeys[nFirst + i];
+		}
 	}
+
+	// the rest are single key buckets (empty ones keep seed 0)
+	int nFreeSlot = 0;
+	for ( ; nOrder < nBuckets; nOrder++ )
+	{
+		int nBucket = bucketOrder[nOrder];
+		if ( bucketStart[nBucket + 1] == bucketStart[nBucket] )
+			break;
+
+		while ( slotKey[nFreeSlot] != -1 )
+		{
+			nFreeSlot++;
+		}
+		slotKey[nFreeSlot] = bucketKeys[ bucketStart[nBucket] ];
+		m_PathHashSeeds[nBucket] = -nFreeSlot - 1;
+	}
+
+	// put each entry in its slot
+	CUtlVector<PackedPathEntry_t> entries;
+	entries.SetCount( nKeys );
+	for ( int i = 0; i < nKeys; i++ )
+	{
+		entries[i] = m_PathHashEntries[ slotKey[i] ];
+		entries[i].m_nHashCheck = (uint32)pathHashes[ slotKey[i] ];
+	}
+	m_PathHashEntries.Swap( entries );
+	return true;
+}
+
+void CPackedStore::BuildExtensionHashTables( void )
+{
+	m_nHighestChunkFileIndex = -1;
+	PurgeExtensionHashTables();
+	m_PathHashSeeds.Purge();
+	m_PathHashEntries.Purge();
+	m_PathHashDirs.Purge();
+
 	char const *pData = reinterpret_cast< char const *>( DirectoryData() );
 	while( *pData )
 	{
@@ -255,6 +517,14 @@ void CPackedStore::BuildHashTables( void )
 	}
 }
 
+void CPackedStore::PurgeExtensionHashTables( void )
+{
+	for( int i = 0; i < ARRAYSIZE( m_pExtensionData ) ; i++ )
+	{
+		m_pExtensionData[i].Purge();
+	}
+}
+
 
 bool CPackedStore::IsEmpty( void ) const
 {
@@ -454,10 +724,7 @@ void CPackedStore::GetDataFileName( char *pchFileNameOut, int cchFileNameOut, in
 
 CPackedStore::~CPackedStore( void )
 {
-	for( int i = 0; i < ARRAYSIZE( m_pExtensionData ) ; i++ )
-	{
-		m_pExtensionData[i].Purge();
-	}
+	PurgeExtensionHashTables();
 
 	for (int i = 0; i < ARRAYSIZE( m_FileHandles ); i++ )
 	{
@@ -472,6 +739,14 @@ CPackedStore::~CPackedStore( void )
 		}
 	}
 
+	for ( int i = 0; i < ARRAYSIZE( m_pMappedChunks ); i++ )
+	{
+		if ( m_pMappedChunks[i] )
+		{
+			m_pMappedChunks[i]->Release();
+		}
+	}
+
 	// Free the FindFirst cache data
 	m_directoryList.PurgeAndDeleteElementsArray();
 
@@ -581,7 +856,7 @@ CPackedStoreFileHandle CPackedStore::OpenFile( char const *pFileName )
 
 	CPackedStoreFileHandle ret;
 
-	CFileHeaderFixedData *pHeader = FindFileEntry( dirName, baseName, extName, NULL, &( ret.m_pDirFileNamePtr ) );
+	CFileHeaderFixedData *pHeader = FindFileEntry( dirName, baseName, extName, &( ret.m_pDirFileNamePtr ) );
 	
 	if ( pHeader )
 	{
@@ -1154,6 +1429,17 @@ void CPackedStore::GetPackFileLoadErrorSummary( CUtlString &sErrors )
 
 }
 
+int CPackedStore::GetChunkFileOffset( const CPackedStoreFileHandle &handle ) const
+{
+	int nPos = handle.m_nFileOffset + handle.m_nCurrentFileOffset - handle.m_nMetaDataSize;
+	if ( handle.m_nFileNumber == VPKFILENUMBER_EMBEDDED_IN_DIR_FILE )
+	{
+		// for file data in the directory header, all offsets are relative to the size of the dir header.
+		nPos += m_nDirectoryDataSize + sizeof( VPKDirHeader_t );
+	}
+	return nPos;
+}
+
 int CPackedStore::ReadData( CPackedStoreFileHandle &handle, void *pOutData, int nNumBytes )
 {
 	int nRet = 0;
@@ -1176,15 +1462,19 @@ int CPackedStore::ReadData( CPackedStoreFileHandle &handle, void *pOutData, int
 		// satisfy remaining bytes from file
 		if ( nNumBytes > 0 )
 		{
+			int nDesiredPos = GetChunkFileOffset( handle );
+
+			CPackedStoreMappedChunk *pChunk = m_bUseMemoryMapping ? GetMappedChunk( handle.m_nFileNumber ) : NULL;
+			if ( pChunk && nDesiredPos + (int64)nNumBytes <= pChunk->m_nSize )
+			{
+				memcpy( pOutData, pChunk->m_pBase + nDesiredPos, nNumBytes );
+				handle.m_nCurrentFileOffset += nNumBytes;
+				return nRet + nNumBytes;
+			}
+
 			FileHandleTracker_t &fHandle = GetFileHandle( handle.m_nFileNumber );
-			int nDesiredPos = handle.m_nFileOffset + handle.m_nCurrentFileOffset - handle.m_nMetaDataSize;
 			int nRead;
 			fHandle.m_Mutex.Lock();
-			if ( handle.m_nFileNumber == VPKFILENUMBER_EMBEDDED_IN_DIR_FILE )
-			{
-				// for file data in the directory header, all offsets are relative to the size of the dir header.
-				nDesiredPos += m_nDirectoryDataSize + sizeof( VPKDirHeader_t );
-			}
 
 			if ( m_PackedStoreReadCache.BCanSatisfyFromReadCache( (uint8 *)pOutData, handle, fHandle, nDesiredPos, nNumBytes, nRead ) )
 			{
@@ -1473,6 +1763,78 @@ FileHandleTracker_t & CPackedStore::GetFileHandle( int nFileNumber )
 	return invalid;
 }
 
+CPackedStoreMappedChunk *CPackedStore::GetMappedChunk( int nFileNumber )
+{
+#ifdef POSIX
+	int nChunkIdx = nFileNumber % ARRAYSIZE( m_pMappedChunks );
+
+	// A slot is never replaced once set, so only the first reads of a chunk lock
+	CPackedStoreMappedChunk *pChunk = m_pMappedChunks[nChunkIdx];
+	if ( !pChunk )
+	{
+		AUTO_LOCK( m_Mutex );
+		pChunk = m_pMappedChunks[nChunkIdx];
+		if ( !pChunk )
+		{
+			char szDataFileName[MAX_PATH];
+			GetDataFileName( szDataFileName, sizeof( szDataFileName ), nFileNumber );
+
+			// Failures are remembered too, those reads keep going through the file handles
+			void *pBase = NULL;
+			int64 nSize = 0;
+			int fd = open( szDataFileName, O_RDONLY );
+			if ( fd >= 0 )
+			{
+				struct stat st;
+				if ( fstat( fd, &st ) == 0 && st.st_size > 0 )
+				{
+					pBase = mmap( NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+					if ( pBase == MAP_FAILED )
+					{
+						pBase = NULL;
+					}
+					else
+					{
+						nSize = st.st_size;
+					}
+				}
+				close( fd );
+			}
+
+			pChunk = new CPackedStoreMappedChunk( nFileNumber, pBase, nSize );
+
+			// the chunk has to be complete before readers outside the lock can see it
+			ThreadMemoryBarrier();
+			m_pMappedChunks[nChunkIdx] = pChunk;
+		}
+	}
+
+	if ( pChunk->m_nFileNumber != nFileNumber || !pChunk->m_pBase )
+		return NULL;
+
+	return pChunk;
+#else
+	return NULL;
+#endif
+}
+
+CPackedStoreMappedChunk::CPackedStoreMappedChunk( int nFileNumber, void *pBase, int64 nSize )
+{
+	m_nFileNumber = nFileNumber;
+	m_pBase = (const uint8 *)pBase;
+	m_nSize = nSize;
+}
+
+CPackedStoreMappedChunk::~CPackedStoreMappedChunk()
+{
+#ifdef POSIX
+	if ( m_pBase )
+	{
+		munmap( (void *)m_pBase, m_nSize );
+	}
+#endif
+}
+
 bool CPackedStore::RemoveFileFromDirectory( const char *pszName )
 {
 	// Remove it without building hash tables
@@ -1480,7 +1842,7 @@ bool CPackedStore::RemoveFileFromDirectory( const char *pszName )
 		return false;
 
 	// We removed it, we need to rebuild hash tables
-	BuildHashTables();
+	BuildExtensionHashTables();
 	return true;
 }
 
@@ -1508,7 +1870,12 @@ void CPackedStore::AddFileToDirectory( const VPKContentFileInfo_t &info )
 
 	// First, remove it if it's already there,
 	// without rebuilding the hash tables
-	InternalRemoveFileFromDirectory( info.m_sName );
+	// Edits go through the per-extension tables, rebuilding the path hash after every file
+	// would make adding lots of files crawl. BuildHashTables switches back to it.
+	if ( InternalRemoveFileFromDirectory( info.m_sName ) || m_PathHashEntries.Count() )
+	{
+		BuildExtensionHashTables();
+	}
 
 	// let's build out a header
 	char pszExt[MAX_PATH];
@@ -1590,7 +1957,7 @@ void CPackedStore::AddFileToDirectory( const VPKContentFileInfo_t &info )
 	}
 	m_DirectoryData.InsertMultipleBefore( nInsertOffset, nTotalHeaderSize );
 	memcpy( &m_DirectoryData[nInsertOffset], pHeaderInsertPtr, nTotalHeaderSize );
-	BuildHashTables();
+	BuildExtensionHashTables();
 }
 
 ePackedStoreAddResultCode CPackedStore::AddFile( char const *pFile, uint16 nMetaDataSize, const void *pFileData, uint32 nFileTotalSize, bool bMultiChunk, uint32 const *pCrcValue )
@@ -0,0 +1,142 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Special case hash table for console commands
+//
+// $NoKeywords: $
+//
+//===========================================================================//
+
+#if !defined( CONCOMMANDHASH_H )
+#define CONCOMMANDHASH_H
+#ifdef _WIN32
+#pragma once
+#endif
+
+#include "tier1/utllinkedlist.h"
+#include "tier1/generichash.h"
+#include "tier1/convar.h"
+
+// This is a hash table class very similar to the CUtlHashFast, but
+// modified specifically so that we can look up ConCommandBases
+// by string names without having to actually store those strings in
+// the dictionary.
+// It uses separate chaining: each key hashes to a bucket, each
+// bucket is a linked list of hashed commands. We store the hash of
+// the command's string name as well as its pointer, so we can do
+// the linked list march part of the Find() operation more quickly.
+// Iteration still goes through CCvar's ConCommandBase list, which keeps
+// registration order.
+class CConCommandHash
+{
+public:
+	// CUtlFixedLinkedList indices are pointer sized
+	typedef intp CCommandHashHandle_t;
+	typedef unsigned int HashKey_t;
+
+	// Constructor/Deconstructor.
+	CConCommandHash();
+	~CConCommandHash();
+
+	// Memory.
+	void Purge( bool bReinitialize );
+
+	// Invalid handle.
+	static CCommandHashHandle_t InvalidHandle( void )	{ return datapool_t::InvalidIndex(); }
+	inline bool IsValidHandle( CCommandHashHandle_t hHash ) const;
+
+	/// Initialize.
+	void Init( void ); // bucket count is hardcoded in enum below.
+
+	/// Get hash value for a concommand
+	static inline HashKey_t Hash( const ConCommandBase *cmd );
+
+	// Insertion.
+	CCommandHashHandle_t Insert( ConCommandBase *cmd );
+	CCommandHashHandle_t FastInsert( ConCommandBase *cmd );
+
+	// Removal.
+	void Remove( CCommandHashHandle_t hHash );
+	void RemoveAll( void );
+
+	// Retrieval.
+	inline CCommandHashHandle_t Find( const char *name ) const;
+	CCommandHashHandle_t Find( const ConCommandBase *cmd ) const;
+	// A convenience version of Find that skips the handle part
+	// and returns a pointer to a concommand, or NULL if none was found.
+	inline ConCommandBase * FindPtr( const char *name ) const;
+
+	inline ConCommandBase * &operator[]( CCommandHashHandle_t hHash );
+	inline ConCommandBase *const &operator[]( CCommandHashHandle_t hHash ) const;
+
+	// Dump a report to MSG
+	void Report( void );
+
+private:
+	// a find func where we've already computed the hash for the string.
+	// (hidden private in case we decide to invent a custom string hash func
+	//  for this class)
+	CCommandHashHandle_t Find( const char *name, HashKey_t hash) const;
+
+protected:
+	enum
+	{
+		kNUM_BUCKETS = 1024,
+		kBUCKETMASK  = kNUM_BUCKETS - 1,
+	};
+
+	struct HashEntry_t
+	{
+		HashKey_t m_uiKey;
+		ConCommandBase *m_Data;
+
+		HashEntry_t(unsigned int _hash, ConCommandBase * _cmd)
+			: m_uiKey(_hash), m_Data(_cmd) {};
+
+		HashEntry_t(){};
+	};
+
+	typedef CUtlFixedLinkedList<HashEntry_t> datapool_t;
+
+	CUtlVector<CCommandHashHandle_t>	m_aBuckets;
+	datapool_t							m_aDataPool;
+};
+
+inline bool CConCommandHash::IsValidHandle( CCommandHashHandle_t hHash ) const
+{
+	return m_aDataPool.IsValidIndex(hHash);
+}
+
+inline CConCommandHash::CCommandHashHandle_t CConCommandHash::Find( const char *name ) const
+{
+	return Find( name, HashStringCaseless(name) );
+}
+
+inline ConCommandBase * &CConCommandHash::operator[]( CCommandHashHandle_t hHash )
+{
+	return ( m_aDataPool[hHash].m_Data );
+}
+
+inline ConCommandBase *const &CConCommandHash::operator[]( CCommandHashHandle_t hHash ) const
+{
+	return ( m_aDataPool[hHash].m_Data );
+}
+
+inline CConCommandHash::HashKey_t CConCommandHash::Hash( const ConCommandBase *cmd )
+{
+	return HashStringCaseless( cmd->GetName() );
+}
+
+inline ConCommandBase * CConCommandHash::FindPtr( const char *name ) const
+{
+	CCommandHashHandle_t handle = Find(name);
+	if (handle == InvalidHandle())
+	{
+		return NULL;
+	}
+	else
+	{
+		return (*this)[handle];
+	}
+}
+
+#endif
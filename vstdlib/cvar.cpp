@@ -16,6 +16,7 @@
 #include "tier0/vprof.h"
 #include "tier1/tier1.h"
 #include "tier1/utlbuffer.h"
+#include "concommandhash.h"
 
 #ifdef _X360
 #include "xbox/xbox_console.h"
@@ -104,6 +105,9 @@ public:
 	virtual void			QueueMaterialThreadSetValue( ConVar *pConVar, float flValue );
 	virtual bool			HasQueuedMaterialThreadConVarSets() const;
 	virtual int				ProcessQueuedMaterialThreadConVarSets();
+
+	// Prints the bucket load of the console command hash (cvar_hashreport)
+	void					HashReport();
 private:
 	enum
 	{
@@ -118,6 +122,7 @@ private:
 	CUtlVector< IConsoleDisplayFunc* >	m_DisplayFuncs;
 	int									m_nNextDLLIdentifier;
 	ConCommandBase						*m_pConCommandList;
+	CConCommandHash						m_CommandHash;
 
 	// temporary console area so we can store prints before console display funs are installed
 	mutable CUtlBuffer					m_TempConsoleBuffer;
@@ -206,6 +211,11 @@ ICvar::ICVarIteratorInternal *CCvar::FactoryInternalIterator( void )
 static CCvar s_Cvar;
 EXPOSE_SINGLE_INTERFACE_GLOBALVAR( CCvar, ICvar, CVAR_INTERFACE_VERSION, s_Cvar );
 
+CON_COMMAND_F( cvar_hashreport, "Print the bucket load of the console command hash.", FCVAR_DEVELOPMENTONLY )
+{
+	s_Cvar.HashReport();
+}
+
 
 //-----------------------------------------------------------------------------
 // Returns a CVar dictionary for tool usage
@@ -405,6 +415,7 @@ void CCvar::RegisterConCommand( ConCommandBase *variable )
 	// link the variable in
 	variable->m_pNext = m_pConCommandList;
 	m_pConCommandList = variable;
+	m_CommandHash.FastInsert( variable );
 }
 
 void CCvar::UnregisterConCommand( ConCommandBase *pCommandToRemove )
@@ -434,6 +445,7 @@ void CCvar::UnregisterConCommand( ConCommandBase *pCommandToRemove )
 			pPrev->m_pNext = pCommand->m_pNext;
 		}
 		pCommand->m_pNext = NULL;
+		m_CommandHash.Remove( m_CommandHash.Find( pCommand ) );
 		break;
 	}
 }
@@ -464,6 +476,7 @@ void CCvar::UnregisterConCommands( CVarDLLIdentifier_t id )
 			// Unlink
 			pCommand->m_bRegistered = false;
 			pCommand->m_pNext = NULL;
+			m_CommandHash.Remove( m_CommandHash.Find( pCommand ) );
 		}
 
 		pCommand = pNext;
@@ -482,24 +495,14 @@ void CCvar::UnregisterConCommands( CVarDLLIdentifier_t id )
 //-----------------------------------------------------------------------------
 const ConCommandBase *CCvar::FindCommandBase( const char *name ) const
 {
-	const ConCommandBase *cmd = GetCommands();
-	for ( ; cmd; cmd = cmd->GetNext() )
-	{
-		if ( !Q_stricmp( name, cmd->GetName() ) )
-			return cmd;
-	}
-	return NULL;
+	VPROF_INCREMENT_COUNTER( "CCvar::FindCommandBase", 1 );
+	return m_CommandHash.FindPtr( name );
 }
 
 ConCommandBase *CCvar::FindCommandBase( const char *name )
 {
-	ConCommandBase *cmd = GetCommands();
-	for ( ; cmd; cmd = cmd->GetNext() )
-	{
-		if ( !Q_stricmp( name, cmd->GetName() ) )
-			return cmd;
-	}
-	return NULL;
+	VPROF_INCREMENT_COUNTER( "CCvar::FindCommandBase", 1 );
+	return m_CommandHash.FindPtr( name );
 }
 
 
@@ -897,3 +900,203 @@ void CCvar::Find( const CCommand &args )
 }
 
 
+
+void CCvar::HashReport()
+{
+	m_CommandHash.Report();
+}
+
+
+//-----------------------------------------------------------------------------
+// Console command hash data structure
+//-----------------------------------------------------------------------------
+CConCommandHash::CConCommandHash()
+{
+	Purge( true );
+}
+
+CConCommandHash::~CConCommandHash()
+{
+	Purge( false );
+}
+
+void CConCommandHash::Purge( bool bReinitialize )
+{
+	m_aBuckets.Purge();
+	m_aDataPool.Purge();
+	if ( bReinitialize )
+	{
+		Init();
+	}
+}
+
+// Initialize.
+void CConCommandHash::Init( void )
+{
+	// kNUM_BUCKETS must be a power of two.
+	COMPILE_TIME_ASSERT((kNUM_BUCKETS & ( kNUM_BUCKETS - 1 )) == 0);
+
+	// Set the bucket size.
+	m_aBuckets.SetSize( kNUM_BUCKETS );
+	for ( int iBucket = 0; iBucket < kNUM_BUCKETS; ++iBucket )
+	{
+		m_aBuckets[iBucket] = m_aDataPool.InvalidIndex();
+	}
+
+	// Calculate the grow size.
+	int nGrowSize = 4 * kNUM_BUCKETS;
+	m_aDataPool.SetGrowSize( nGrowSize );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Insert data into the hash table given its key (unsigned int), 
+//			WITH a check to see if the element already exists within the hash.
+//-----------------------------------------------------------------------------
+CConCommandHash::CCommandHashHandle_t CConCommandHash::Insert( ConCommandBase *cmd )
+{
+	// Check to see if that key already exists in the buckets (should be unique).
+	CCommandHashHandle_t hHash = Find( cmd );
+	if( hHash != InvalidHandle() )
+		return hHash;
+
+	return FastInsert( cmd );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Insert data into the hash table given its key (unsigned int),
+//          WITHOUT a check to see if the element already exists within the hash.
+//-----------------------------------------------------------------------------
+CConCommandHash::CCommandHashHandle_t CConCommandHash::FastInsert( ConCommandBase *cmd )
+{
+	// Get a new element from the pool.
+	CCommandHashHandle_t iHashData = m_aDataPool.Alloc( true );
+	HashEntry_t * pHashData = &m_aDataPool[iHashData];
+	if ( !pHashData )
+		return InvalidHandle();
+
+	HashKey_t key = Hash(cmd);
+
+	// Add data to new element.
+	pHashData->m_uiKey = key;
+	pHashData->m_Data = cmd;
+
+	// Link element.
+	int iBucket = key & kBUCKETMASK ;
+	m_aDataPool.LinkBefore( m_aBuckets[iBucket], iHashData );
+	m_aBuckets[iBucket] = iHashData;
+
+	return iHashData;	
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Remove a given element from the hash.
+//-----------------------------------------------------------------------------
+void CConCommandHash::Remove( CCommandHashHandle_t hHash )
+{
+	if ( !IsValidHandle( hHash ) )
+	{
+		Assert( 0 );
+		return;
+	}
+
+	HashEntry_t * entry = &m_aDataPool[hHash];
+	HashKey_t iBucket = entry->m_uiKey & kBUCKETMASK ;
+	if ( m_aBuckets[iBucket] == hHash )
+	{
+		// It is a bucket head.
+		m_aBuckets[iBucket] = m_aDataPool.Next( hHash );
+	}
+	else
+	{
+		// Not a bucket head.
+		m_aDataPool.Unlink( hHash );
+	}
+
+	// Remove the element.
+	m_aDataPool.Remove( hHash );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Remove all elements from the hash
+//-----------------------------------------------------------------------------
+void CConCommandHash::RemoveAll( void )
+{
+	m_aDataPool.RemoveAll();
+	for ( int iBucket = 0; iBucket < m_aBuckets.Count(); ++iBucket )
+	{
+		m_aBuckets[iBucket] = m_aDataPool.InvalidIndex();
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Find hash entry corresponding to a string name
+//-----------------------------------------------------------------------------
+CConCommandHash::CCommandHashHandle_t CConCommandHash::Find( const char *name, HashKey_t hashkey) const
+{
+	// hash the "key" - get the correct hash table "bucket"
+	int iBucket = hashkey & kBUCKETMASK;
+	int nProbes = 0;
+
+	for ( datapool_t::IndexLocalType_t iElement = m_aBuckets[iBucket]; iElement != m_aDataPool.InvalidIndex(); iElement = m_aDataPool.Next( iElement ) )
+	{
+		const HashEntry_t &element = m_aDataPool[iElement];
+		++nProbes;
+		if ( element.m_uiKey == hashkey && // if hashes of strings match,
+			 V_stricmp( name, element.m_Data->GetName() ) == 0) // then test the actual strings
+		{
+			// compare with "CCvar::FindCommandBase"; the old list walk cost one stricmp per registered command
+			VPROF_INCREMENT_COUNTER( "CCvar::FindCommandBase probes", nProbes );
+			return iElement;
+		}
+	}
+
+	// found nuffink
+	VPROF_INCREMENT_COUNTER( "CCvar::FindCommandBase probes", nProbes );
+	return InvalidHandle();
+}
+
+//-----------------------------------------------------------------------------
+// Find a command in the hash.
+//-----------------------------------------------------------------------------
+CConCommandHash::CCommandHashHandle_t CConCommandHash::Find( const ConCommandBase *cmd ) const
+{
+	HashKey_t hashkey = Hash(cmd);
+	int iBucket = hashkey & kBUCKETMASK;
+
+	// hunt through all entries in that bucket
+	for ( datapool_t::IndexLocalType_t iElement = m_aBuckets[iBucket]; iElement != m_aDataPool.InvalidIndex(); iElement = m_aDataPool.Next( iElement ) )
+	{
+		const HashEntry_t &element = m_aDataPool[iElement];
+		if ( element.m_uiKey == hashkey && // if the hashes match... 
+			 element.m_Data  == cmd	) // and the pointers...
+		{
+			return iElement;
+		}
+	}
+
+	// found nothing.
+	return InvalidHandle();
+}
+
+// Dump a report to MSG
+void CConCommandHash::Report( void )
+{
+	Msg("Console command hash bucket load:\n");
+	int total = 0;
+	int nMax = 0;
+	for ( int iBucket = 0 ; iBucket < kNUM_BUCKETS ; ++iBucket )
+	{
+		int count = 0;
+		CCommandHashHandle_t iElement = m_aBuckets[iBucket]; // get the head of the bucket
+		while ( iElement != m_aDataPool.InvalidIndex() )
+		{
+			++count;
+			iElement = m_aDataPool.Next( iElement );
+		}
+
+		total += count;
+		nMax = MAX( nMax, count );
+	}
+
+	Msg("\t%d commands in %d buckets, average %.2f, longest chain %d\n", total, (int)kNUM_BUCKETS, total / ((float)(kNUM_BUCKETS)), nMax );
+}
@@ -18,6 +18,7 @@
 #include "tier1/utlvector.h"
 #include "tier1/generichash.h"
 #include "tier0/vprof.h"
+#include "tier0/fasttimer.h"
 
 #if defined( _X360 )
 #include "xbox/xbox_win32stubs.h"
@@ -1439,3 +1440,115 @@ void RunThreadPoolTests()
 
 	ThreadPoolTest::TestForcedExecute();
 }
+
+//-----------------------------------------------------------------------------
+// Times ParallelProcess against the item distribution it used before
+// CWorkStealingRange, where every item was claimed with an interlocked
+// increment of one shared pointer
+//-----------------------------------------------------------------------------
+namespace ParallelProcessBenchmark
+{
+
+class CSharedCounterProcessor
+{
+public:
+	void Run( IThreadPool *pPool, uint32 *pItems, unsigned nItems )
+	{
+		m_pItems = pItems;
+		m_pLimit = pItems + nItems;
+
+		int nJobs = MIN( pPool->NumThreads(), (int)nItems - 1 );
+		CJob **jobs = (CJob **)stackalloc( MAX( nJobs, 1 ) * sizeof(CJob **) );
+
+		for ( int i = 0; i < nJobs; i++ )
+		{
+			jobs[i] = pPool->QueueCall( this, &CSharedCounterProcessor::DoExecute );
+		}
+
+		DoExecute();
+
+		for ( int i = 0; i < nJobs; i++ )
+		{
+			jobs[i]->Abort();
+			jobs[i]->Release();
+		}
+	}
+
+private:
+	void DoExecute()
+	{
+		uint32 *pLimit = m_pLimit;
+		for (;;)
+		{
+			uint32 *pCurrent = m_pItems++;
+			if ( pCurrent >= pLimit )
+				break;
+			ProcessItem( *pCurrent );
+		}
+	}
+
+public:
+	static void ProcessItem( uint32 &item )
+	{
+		item = item * 3 + 1;
+	}
+
+private:
+	CInterlockedPtr<uint32>	m_pItems;
+	uint32 *				m_pLimit;
+};
+
+static double TimeSharedCounter( IThreadPool *pPool, CUtlVector<uint32> &items, int nRuns )
+{
+	CSharedCounterProcessor processor;
+	CFastTimer timer;
+	timer.Start();
+	for ( int i = 0; i < nRuns; i++ )
+	{
+		processor.Run( pPool, items.Base(), items.Count() );
+	}
+	timer.End();
+	return timer.GetDuration().GetSeconds();
+}
+
+static double TimeWorkStealing( IThreadPool *pPool, CUtlVector<uint32> &items, int nRuns )
+{
+	CFastTimer timer;
+	timer.Start();
+	for ( int i = 0; i < nRuns; i++ )
+	{
+		ParallelProcess( "ParallelProcessBenchmark", pPool, items.Base(), items.Count(), &CSharedCounterProcessor::ProcessItem );
+	}
+	timer.End();
+	return timer.GetDuration().GetSeconds();
+}
+
+} // namespace ParallelProcessBenchmark
+
+void RunParallelProcessBenchmark( int nItems, int nRuns )
+{
+	static const int s_ThreadCounts[] = { 2, 4, 8, 16, 32, 64 };
+
+	CUtlVector<uint32> items;
+	items.SetCount( MAX( nItems, 1 ) );
+	items.FillWithValue( 0 );
+	nRuns = MAX( nRuns, 1 );
+
+	Msg( "ParallelProcess: %d items, %d runs\n", items.Count(), nRuns );
+	Msg( "threads  shared counter  work stealing  speedup\n" );
+
+	for ( int i = 0; i < ( int )ARRAYSIZE( s_ThreadCounts ); i++ )
+	{
+		CThreadPool pool;
+		ThreadPoolStartParams_t params;
+		params.nThreads = s_ThreadCounts[i] - 1;		// the calling thread works too
+		pool.Start( params, "PPBench" );
+
+		double flShared = ParallelProcessBenchmark::TimeSharedCounter( &pool, items, nRuns );
+		double flStealing = ParallelProcessBenchmark::TimeWorkStealing( &pool, items, nRuns );
+
+		Msg( "%7d  %11.3f ms  %10.3f ms  %6.2fx\n", s_ThreadCounts[i], flShared * 1000.0, flStealing * 1000.0, flStealing > 0 ? flShared / flStealing : 0.0 );
+
+		pool.Stop();
+	}
+}